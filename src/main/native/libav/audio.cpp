@@ -0,0 +1,570 @@
+/*
+ * audio.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+#include "libavutil/audioconvert.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/samplefmt.h"
+}
+
+#include <error.hpp>
+#include <libav/audio.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+#include <libav/trace.hpp>
+
+#include <cstring>
+
+using namespace std;
+
+
+/**
+ * @file audio.cpp
+ *
+ * The implementation of the audio.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+/**
+ * @return the name of the little endian PCM encoder of the supplied interleaved
+ *      sample format, or an empty string if there isn't one.
+ */
+static string pcmEncoderName(AVSampleFormat format) {
+
+    switch (format) {
+
+        case AV_SAMPLE_FMT_U8: return "pcm_u8";
+        case AV_SAMPLE_FMT_S16: return "pcm_s16le";
+        case AV_SAMPLE_FMT_S32: return "pcm_s32le";
+        case AV_SAMPLE_FMT_FLT: return "pcm_f32le";
+        case AV_SAMPLE_FMT_DBL: return "pcm_f64le";
+        default: return "";
+    }
+}
+
+/**
+ * @return whether the supplied encoder takes samples of the supplied format.
+ */
+static bool takesSampleFormat(const AVCodec *codec, AVSampleFormat format) {
+
+    // An encoder that doesn't list its formats takes any of them.
+    if (NULL == codec->sample_fmts) return true;
+
+    for (const AVSampleFormat *it = codec->sample_fmts; AV_SAMPLE_FMT_NONE != *it; ++it) {
+
+        if (format == *it) return true;
+    }
+
+    return false;
+}
+
+AudioEncoder::AudioEncoder(const AVCodecContext *decoder, const string& encoderName,
+        int bitRate, const PacketSink& sink, const AVFormatContext *output) :
+        _encoder(NULL), _encoderOpened(false), _interleave(false), _channels(0),
+        _sampleBytes(0), _sink(sink), _pending(), _pendingSamples(0), _samplesEncoded(0),
+        _packetsEncoded(0) {
+
+    if (NULL == decoder || AVMEDIA_TYPE_AUDIO != findCodecType(decoder)) {
+
+        throw IllegalArgumentException("The decoder of an audio encoder must decode audio.");
+    }
+
+    if (0 > bitRate) {
+
+        throw IllegalArgumentException("The bit rate of an audio encoder can't be negative.");
+    }
+
+    if (!sink) throw IllegalArgumentException("The sink of an audio encoder cannot be empty.");
+
+    AVSampleFormat interleaved = av_get_packed_sample_fmt(decoder->sample_fmt);
+
+    string name = encoderName.empty() ? pcmEncoderName(interleaved) : encoderName;
+
+    AVCodec *codec = name.empty() ? NULL : avcodec_find_encoder_by_name(name.c_str());
+
+    if (NULL == codec) {
+
+        throw CodecException("Could not find the " + name + " encoder.");
+    }
+
+    AVSampleFormat format = decoder->sample_fmt;
+
+    if (!takesSampleFormat(codec, format)) {
+
+        if (interleaved == format || !takesSampleFormat(codec, interleaved)) {
+
+            throw CodecException("The " + name
+                    + " encoder can't take the sample format of the decoder.");
+        }
+
+        format = interleaved;
+
+        _interleave = true;
+    }
+
+    if (av_sample_fmt_is_planar(format) && AV_NUM_DATA_POINTERS < decoder->channels) {
+
+        throw CodecException("There are too many channels to encode as planar samples.");
+    }
+
+    _channels = decoder->channels;
+    _sampleBytes = av_get_bytes_per_sample(format);
+
+    _pending.resize(av_sample_fmt_is_planar(format) ? _channels : 1);
+
+    try {
+
+        _encoder = avcodec_alloc_context3(codec);
+
+        if (NULL == _encoder) throw IllegalStateException("Could not allocate an encoder.");
+
+        _encoder->sample_rate = decoder->sample_rate;
+        _encoder->channels = decoder->channels;
+        _encoder->channel_layout = 0 != decoder->channel_layout ? decoder->channel_layout
+                : av_get_default_channel_layout(decoder->channels);
+        _encoder->sample_fmt = format;
+        _encoder->time_base.num = 1;
+        _encoder->time_base.den = decoder->sample_rate;
+
+        if (0 < bitRate) _encoder->bit_rate = bitRate;
+
+        if (NULL != output && 0 != (output->oformat->flags & AVFMT_GLOBALHEADER)) {
+
+            _encoder->flags |= CODEC_FLAG_GLOBAL_HEADER;
+        }
+
+        openEncodeCodecContext(_encoder);
+
+        _encoderOpened = true;
+
+    } catch (...) {
+
+        release();
+
+        throw;
+    }
+}
+
+AudioEncoder::~AudioEncoder() {
+
+    release();
+}
+
+int AudioEncoder::push(const AVFrame *frame) {
+
+    if (NULL == frame) {
+
+        throw IllegalArgumentException("The frame pushed to an audio encoder cannot be null.");
+    }
+
+    size_t bytes = static_cast<size_t>(frame->nb_samples) * _sampleBytes;
+
+    if (_interleave) {
+
+        vector<uint8_t>& pending = _pending[0];
+
+        size_t start = pending.size();
+
+        pending.resize(start + bytes * _channels);
+
+        for (int sample = 0; sample < frame->nb_samples; sample++) {
+
+            for (int channel = 0; channel < _channels; channel++) {
+
+                memcpy(&pending[start + (sample * _channels + channel) * _sampleBytes],
+                        frame->extended_data[channel] + sample * _sampleBytes, _sampleBytes);
+            }
+        }
+
+    } else if (1 == _pending.size()) {
+
+        _pending[0].insert(_pending[0].end(), frame->extended_data[0],
+                frame->extended_data[0] + bytes * _channels);
+
+    } else {
+
+        for (size_t channel = 0; channel < _pending.size(); channel++) {
+
+            _pending[channel].insert(_pending[channel].end(), frame->extended_data[channel],
+                    frame->extended_data[channel] + bytes);
+        }
+    }
+
+    _pendingSamples += frame->nb_samples;
+
+    // An encoder without a frame size takes frames of any size.
+    if (0 >= _encoder->frame_size) return 0 < _pendingSamples ? encode(_pendingSamples) : 0;
+
+    int written = 0;
+
+    while (_encoder->frame_size <= _pendingSamples) written += encode(_encoder->frame_size);
+
+    return written;
+}
+
+int AudioEncoder::finish() {
+
+    TraceSpan span("audioEncoderFinish");
+
+    // The encoder pads a short last frame with silence if it has to.
+    int written = 0 < _pendingSamples ? encode(_pendingSamples) : 0;
+
+    while (0 != (_encoder->codec->capabilities & CODEC_CAP_DELAY)) {
+
+        AVPacket packet;
+
+        av_init_packet(&packet);
+
+        packet.data = NULL;
+        packet.size = 0;
+
+        int packetEncoded = 0;
+
+        int errorCode = avcodec_encode_audio2(_encoder, &packet, NULL, &packetEncoded);
+
+        if (0 > errorCode) throw CodecException(errorMessage(errorCode));
+
+        if (0 == packetEncoded) break;
+
+        try {
+
+            write(&packet);
+
+        } catch (...) {
+
+            av_free_packet(&packet);
+
+            throw;
+        }
+
+        av_free_packet(&packet);
+
+        written++;
+    }
+
+    return written;
+}
+
+const AVCodecContext* AudioEncoder::encoder() const {
+
+    return _encoder;
+}
+
+int64_t AudioEncoder::packetsEncoded() const {
+
+    return _packetsEncoded;
+}
+
+int AudioEncoder::encode(int samples) {
+
+    size_t bytes = static_cast<size_t>(samples) * _sampleBytes
+            * (1 == _pending.size() ? _channels : 1);
+
+    AVFrame frame;
+
+    avcodec_get_frame_defaults(&frame);
+
+    for (size_t i = 0; i < _pending.size(); i++) frame.data[i] = &_pending[i][0];
+
+    frame.extended_data = frame.data;
+    frame.linesize[0] = bytes;
+    frame.nb_samples = samples;
+    frame.pts = _samplesEncoded;
+
+    AVPacket *packet = encodeAudioFrame(_encoder, &frame);
+
+    for (size_t i = 0; i < _pending.size(); i++) {
+
+        _pending[i].erase(_pending[i].begin(), _pending[i].begin() + bytes);
+    }
+
+    _pendingSamples -= samples;
+    _samplesEncoded += samples;
+
+    if (NULL == packet) return 0;
+
+    try {
+
+        write(packet);
+
+    } catch (...) {
+
+        freePacket(&packet);
+
+        throw;
+    }
+
+    freePacket(&packet);
+
+    return 1;
+}
+
+void AudioEncoder::write(AVPacket *packet) {
+
+    packet->stream_index = 0;
+
+    _sink(packet);
+
+    _packetsEncoded++;
+}
+
+void AudioEncoder::release() {
+
+    try {
+
+        if (NULL != _encoder) {
+
+            AVCodecContext *encoder = _encoder;
+
+            _encoder = NULL;
+
+            if (_encoderOpened) closeCodecContext(&encoder);
+
+            av_free(encoder);
+        }
+
+    } catch (const exception&) {
+
+        // There is nothing more that can be done for an encoder being torn down.
+    }
+}
+
+AudioExtractor::AudioExtractor(const string& fileName, int streamIndex) :
+        _formatContext(NULL), _decoder(NULL), _streamIndex(-1) {
+
+    TraceSpan span("openAudioExtractor");
+
+    _formatContext = openFormatContext(fileName);
+
+    try {
+
+        int count = static_cast<int>(_formatContext->nb_streams);
+
+        if (0 <= streamIndex) {
+
+            if (count <= streamIndex
+                    || AVMEDIA_TYPE_AUDIO != findStreamType(_formatContext->streams[streamIndex])) {
+
+                throw IllegalArgumentException("The stream to extract must be an audio stream.");
+            }
+
+            _streamIndex = streamIndex;
+        }
+
+        for (int i = 0; i < count && 0 > _streamIndex; i++) {
+
+            if (AVMEDIA_TYPE_AUDIO == findStreamType(_formatContext->streams[i])) _streamIndex = i;
+        }
+
+        if (0 > _streamIndex) throw IllegalStateException("There is no audio stream to extract.");
+
+        // Demuxers that honour the discard level skip these packets without
+        // reading them, readNextPacket drops them for the rest.
+        for (int i = 0; i < count; i++) {
+
+            if (_streamIndex != i) _formatContext->streams[i]->discard = AVDISCARD_ALL;
+        }
+
+        _decoder = openDecodeCodecContext(_formatContext->streams[_streamIndex]->codec);
+
+    } catch (...) {
+
+        release();
+
+        throw;
+    }
+}
+
+AudioExtractor::~AudioExtractor() {
+
+    release();
+}
+
+/**
+ * Hand every one of the supplied frames to the supplied sink, freeing them all
+ * whether or not the sink throws.
+ */
+static void deliverFrames(vector<AVFrame*>& frames, const AudioFrameSink& sink,
+        AudioResult& result) {
+
+    try {
+
+        for (size_t i = 0; i < frames.size(); i++) {
+
+            result.framesDecoded++;
+            result.samplesDecoded += frames[i]->nb_samples;
+
+            sink(frames[i]);
+
+            freeFrame(&frames[i]);
+        }
+
+    } catch (...) {
+
+        for (size_t i = 0; i < frames.size(); i++) {
+
+            if (NULL != frames[i]) freeFrame(&frames[i]);
+        }
+
+        throw;
+    }
+}
+
+AudioResult AudioExtractor::run(const AudioFrameSink& sink) {
+
+    if (!sink) throw IllegalArgumentException("The sink of an audio extractor cannot be empty.");
+
+    TraceSpan span("extractAudio", _streamIndex);
+
+    AudioResult result;
+
+    for (AVPacket *packet = readNextPacket(_formatContext); NULL != packet;
+            packet = readNextPacket(_formatContext)) {
+
+        try {
+
+            if (_streamIndex == packet->stream_index) {
+
+                result.packetsRead++;
+
+                vector<AVFrame*> frames = decodeAudioPacket(_decoder, packet);
+
+                deliverFrames(frames, sink, result);
+            }
+
+        } catch (...) {
+
+            freePacket(&packet);
+
+            throw;
+        }
+
+        freePacket(&packet);
+    }
+
+    return result;
+}
+
+AVStream* AudioExtractor::stream() const {
+
+    return _formatContext->streams[_streamIndex];
+}
+
+const AVCodecContext* AudioExtractor::decoder() const {
+
+    return _decoder;
+}
+
+void AudioExtractor::release() {
+
+    try {
+
+        if (NULL != _decoder) closeCodecContext(&_decoder);
+
+        _decoder = NULL;
+
+        if (NULL != _formatContext) closeFormatContext(&_formatContext);
+
+    } catch (const exception&) {
+
+        // There is nothing more that can be done for a file being closed.
+    }
+}
+
+/**
+ * Where the packets of an extracted audio stream are written.
+ */
+struct AudioOutput {
+
+    AVFormatContext *output;
+    AVRational timeBase;
+};
+
+/**
+ * Writes the packets of an audio encoder to its output, in the time base of the
+ * output stream.
+ */
+struct AudioOutputSink {
+
+    AudioOutput *audio;
+
+    void operator()(AVPacket *packet) const {
+
+        AVRational timeBase = audio->output->streams[0]->time_base;
+
+        if (AV_NOPTS_VALUE != packet->pts) {
+
+            packet->pts = av_rescale_q(packet->pts, audio->timeBase, timeBase);
+        }
+
+        if (AV_NOPTS_VALUE != packet->dts) {
+
+            packet->dts = av_rescale_q(packet->dts, audio->timeBase, timeBase);
+        }
+
+        packet->duration = av_rescale_q(packet->duration, audio->timeBase, timeBase);
+
+        writePacket(audio->output, packet);
+    }
+};
+
+
+AudioResult extractAudio(const string& fileName, const string& outputFileName,
+        const AudioOptions& options) {
+
+    AudioExtractor extractor(fileName, options.streamIndex);
+
+    AudioOutput audio = { NULL, extractor.decoder()->time_base };
+
+    audio.output = openOutputFormatContext(outputFileName, options.formatName);
+
+    AudioResult result;
+
+    try {
+
+        AudioOutputSink sink = { &audio };
+
+        AudioEncoder encoder(extractor.decoder(), options.encoderName, options.bitRate, sink,
+                audio.output);
+
+        audio.timeBase = encoder.encoder()->time_base;
+
+        addOutputStream(audio.output, encoder.encoder());
+
+        writeOutputHeader(audio.output);
+
+        result = extractor.run(std::tr1::bind(&AudioEncoder::push, &encoder,
+                std::tr1::placeholders::_1));
+
+        encoder.finish();
+
+    } catch (...) {
+
+        try {
+
+            closeOutputFormatContext(&audio.output);
+
+        } catch (const exception&) {
+
+            // The first failure is the one worth reporting.
+        }
+
+        throw;
+    }
+
+    closeOutputFormatContext(&audio.output);
+
+    return result;
+}
+
+} /* namespace libav */
+} /* namespace transcode */
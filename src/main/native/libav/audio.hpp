@@ -0,0 +1,283 @@
+/*
+ * audio.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __AUDIO_HPP__
+#define __AUDIO_HPP__
+
+#include <libav/libav.hpp>
+#include <libav/pipeline.hpp>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <tr1/functional>
+
+/**
+ * @file audio.hpp
+ *
+ * A fast path for jobs that only want the audio of a file.
+ *
+ * Every other stream is set to be discarded at the demuxer as soon as the file
+ * is opened, so demuxers that honour the discard level skip the video and
+ * subtitle packets without reading them, and only the decoder of the audio
+ * stream is ever opened. The decoded frames go straight on to a sink, which can
+ * be an <code>AudioEncoder</code>, without being queued.
+ */
+
+struct AVFormatContext;
+struct AVStream;
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * Called with every decoded audio frame as soon as it is decoded.
+ *
+ * Note: The frame is freed once the sink returns, so the sink must copy any
+ * samples it wants to keep.
+ */
+typedef std::tr1::function<void(const AVFrame *frame)> AudioFrameSink;
+
+/**
+ * What was done to extract the audio of a file.
+ */
+struct AudioResult {
+
+    /**
+     * The number of packets of the audio stream that were read.
+     */
+    int64_t packetsRead;
+
+    /**
+     * The number of frames decoded from them.
+     */
+    int64_t framesDecoded;
+
+    /**
+     * The number of samples in each channel of those frames.
+     */
+    int64_t samplesDecoded;
+
+    AudioResult() : packetsRead(0), framesDecoded(0), samplesDecoded(0) {
+    }
+};
+
+/**
+ * Encodes decoded audio frames the moment they are pushed to it.
+ *
+ * The encoder is opened with the sample rate, channels and sample format of the
+ * decoder. A decoder that gives planar samples can be encoded with an encoder
+ * that only takes the same samples interleaved, any other conversion isn't
+ * supported. The samples are cut into frames of the size the encoder takes.
+ */
+class AudioEncoder {
+
+private:
+    AudioEncoder(AudioEncoder const&); // Should not be implemented.
+
+    void operator=(AudioEncoder const&); // Should not be implemented.
+
+    AVCodecContext *_encoder;
+    bool _encoderOpened;
+    bool _interleave;
+    int _channels;
+    int _sampleBytes;
+    PacketSink _sink;
+
+    // The samples pushed that haven't been encoded yet, one buffer for each
+    // channel if the encoder takes planar samples and one for all of them if
+    // it doesn't.
+    std::vector<std::vector<uint8_t> > _pending;
+    int _pendingSamples;
+
+    int64_t _samplesEncoded;
+    int64_t _packetsEncoded;
+
+    /**
+     * Encode the supplied number of the pending samples.
+     *
+     * @return the number of packets handed to the sink.
+     */
+    int encode(int samples);
+
+    /**
+     * Hand the supplied encoded packet to the sink.
+     */
+    void write(AVPacket *packet);
+
+    /**
+     * Free everything that is still held.
+     */
+    void release();
+
+public:
+    /**
+     * Instantiate a new <code>AudioEncoder</code> and open the encoder.
+     *
+     * @param decoder - the opened decoder of the frames that will be pushed.
+     * @param encoderName - the name of the encoder, or empty for the PCM
+     *      encoder of the sample format of the decoder.
+     * @param bitRate - the bit rate in bits per second, or 0 for the default of
+     *      the encoder.
+     * @param sink - called with every encoded packet, its timestamps are in
+     *      the time base of the encoder and its stream index is 0.
+     * @param output - the output the packets are written to, or NULL if they
+     *      aren't written to a container. An output that keeps the headers of
+     *      its streams in its own header gets them in the extradata of the
+     *      encoder instead of in the packets.
+     */
+    AudioEncoder(const AVCodecContext *decoder, const std::string& encoderName, int bitRate,
+            const PacketSink& sink, const AVFormatContext *output = NULL);
+
+    /**
+     * Close the encoder.
+     */
+    ~AudioEncoder();
+
+    /**
+     * Encode the samples of the supplied frame, as many as fill whole frames of
+     * the encoder.
+     *
+     * @param frame - a frame decoded by the decoder the encoder was opened for.
+     * @return the number of encoded packets handed to the sink.
+     */
+    int push(const AVFrame *frame);
+
+    /**
+     * Encode the samples that are left over and write out the packets the
+     * encoder is still holding, at the end of the stream.
+     *
+     * @return the number of encoded packets handed to the sink.
+     */
+    int finish();
+
+    /**
+     * @return the opened encoder, to add an output stream for.
+     */
+    const AVCodecContext* encoder() const;
+
+    /**
+     * @return the number of packets handed to the sink so far.
+     */
+    int64_t packetsEncoded() const;
+};
+
+/**
+ * Opens a file for its audio alone, discarding every other stream and only
+ * opening the decoder of the one audio stream.
+ */
+class AudioExtractor {
+
+private:
+    AudioExtractor(AudioExtractor const&); // Should not be implemented.
+
+    void operator=(AudioExtractor const&); // Should not be implemented.
+
+    AVFormatContext *_formatContext;
+    AVCodecContext *_decoder;
+    int _streamIndex;
+
+    /**
+     * Free everything that is still held.
+     */
+    void release();
+
+public:
+    /**
+     * Open the supplied file and the decoder of its audio stream.
+     *
+     * @param fileName - the path to the media file.
+     * @param streamIndex - the index of the audio stream to decode, or -1 for
+     *      the first audio stream.
+     */
+    explicit AudioExtractor(const std::string& fileName, int streamIndex = -1);
+
+    /**
+     * Close the decoder and the file.
+     */
+    ~AudioExtractor();
+
+    /**
+     * Decode every packet of the audio stream, handing each frame to the
+     * supplied sink as soon as it is decoded.
+     *
+     * Note: Decoders that delay frames aren't flushed at the end of the
+     * stream, none of the audio decoders in use do.
+     *
+     * @param sink - called with every decoded frame.
+     * @return what was read and decoded.
+     */
+    AudioResult run(const AudioFrameSink& sink);
+
+    /**
+     * @return the audio stream being decoded.
+     */
+    AVStream* stream() const;
+
+    /**
+     * @return the opened decoder of the audio stream.
+     */
+    const AVCodecContext* decoder() const;
+};
+
+/**
+ * How the audio of a file is extracted by <code>extractAudio</code>.
+ */
+struct AudioOptions {
+
+    /**
+     * The index of the audio stream to extract, or -1 for the first.
+     */
+    int streamIndex;
+
+    /**
+     * The name of the encoder, or empty for PCM samples.
+     */
+    std::string encoderName;
+
+    /**
+     * The bit rate in bits per second, or 0 for the default of the encoder.
+     */
+    int bitRate;
+
+    /**
+     * The short name of the container format to write, or empty to guess it
+     * from the name of the output file.
+     */
+    std::string formatName;
+
+    AudioOptions() : streamIndex(-1), encoderName(), bitRate(0), formatName() {
+    }
+};
+
+/**
+ * Extract the audio of the supplied file into the supplied output file,
+ * through the audio only fast path.
+ *
+ * @param fileName - the path to the media file.
+ * @param outputFileName - the path of the file to write.
+ * @param options - which stream to extract and how to encode it.
+ * @return what was read and decoded.
+ */
+AudioResult extractAudio(const std::string& fileName, const std::string& outputFileName,
+        const AudioOptions& options = AudioOptions());
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __AUDIO_HPP__ */
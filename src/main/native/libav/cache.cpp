@@ -0,0 +1,563 @@
+/*
+ * cache.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#include <error.hpp>
+#include <libav/cache.hpp>
+#include <libav/trace.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+
+/**
+ * @file cache.cpp
+ *
+ * The implementation of the cache.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+// The size of the blocks a file is hashed in, a multiple of the word size so
+// the hash doesn't depend on where the blocks split.
+static const size_t HASH_BLOCK_BYTES = 64 * 1024;
+
+static const uint64_t PRIME_1 = UINT64_C(0x9E3779B185EBCA87);
+static const uint64_t PRIME_2 = UINT64_C(0xC2B2AE3D27D4EB4F);
+static const uint64_t PRIME_3 = UINT64_C(0x165667B19E3779F9);
+
+// The number of hexadecimal digits of a hash.
+static const size_t HASH_DIGITS = 32;
+
+static const string TEMPORARY_EXTENSION = ".tmp";
+
+static uint64_t rotateLeft(uint64_t value, int bits) {
+
+    return (value << bits) | (value >> (64 - bits));
+}
+
+/**
+ * Mix every bit of the supplied value into every other bit.
+ */
+static uint64_t avalanche(uint64_t value) {
+
+    value ^= value >> 33;
+    value *= PRIME_2;
+    value ^= value >> 29;
+    value *= PRIME_3;
+    value ^= value >> 32;
+
+    return value;
+}
+
+/**
+ * A 128 bit hash that takes a word at a time, in two lanes that are mixed
+ * differently. It is for telling files apart, not for security.
+ */
+class Hasher {
+
+private:
+    uint64_t _first;
+    uint64_t _second;
+    uint64_t _length;
+
+    void word(uint64_t value) {
+
+        _first = rotateLeft(_first ^ (value * PRIME_1), 31) * PRIME_2;
+        _second = rotateLeft(_second ^ (value * PRIME_2), 27) * PRIME_3 + PRIME_1;
+    }
+
+public:
+    Hasher() : _first(PRIME_1), _second(PRIME_3), _length(0) {
+    }
+
+    void update(const char *data, size_t size) {
+
+        size_t words = size / sizeof(uint64_t);
+
+        for (size_t i = 0; i < words; i++) {
+
+            uint64_t value;
+
+            memcpy(&value, data + i * sizeof(uint64_t), sizeof(uint64_t));
+
+            word(value);
+        }
+
+        size_t remaining = size % sizeof(uint64_t);
+
+        if (0 < remaining) {
+
+            uint64_t value = 0;
+
+            memcpy(&value, data + words * sizeof(uint64_t), remaining);
+
+            word(value ^ (static_cast<uint64_t>(remaining) << 56));
+        }
+
+        _length += size;
+    }
+
+    void update(uint64_t value) {
+
+        word(value);
+    }
+
+    string digest() const {
+
+        ostringstream hex;
+
+        hex << std::hex << setfill('0') << setw(16) << avalanche(_first ^ _length)
+                << setw(16) << avalanche(_second + _length);
+
+        return hex.str();
+    }
+};
+
+/**
+ * Hash the supplied number of bytes of the supplied file from the supplied
+ * offset.
+ */
+static void hashRange(ifstream& in, const string& fileName, uint64_t offset, uint64_t bytes,
+        Hasher& hasher) {
+
+    vector<char> block(HASH_BLOCK_BYTES);
+
+    in.seekg(offset);
+
+    while (0 < bytes) {
+
+        size_t wanted = static_cast<size_t>(min<uint64_t>(bytes, block.size()));
+
+        in.read(&block[0], wanted);
+
+        if (static_cast<size_t>(in.gcount()) != wanted) {
+
+            throw IOException("Could not read " + fileName + " to hash it.");
+        }
+
+        hasher.update(&block[0], wanted);
+
+        bytes -= wanted;
+    }
+}
+
+/**
+ * @return whether the supplied file name is the name of a file in the cache.
+ */
+static bool isKey(const string& name) {
+
+    if (2 * HASH_DIGITS + 1 != name.size() || '-' != name[HASH_DIGITS]) return false;
+
+    for (size_t i = 0; i < name.size(); i++) {
+
+        if (HASH_DIGITS != i && !isxdigit(static_cast<unsigned char>(name[i]))) return false;
+    }
+
+    return true;
+}
+
+/**
+ * Copy the supplied file, replacing the file it is copied to.
+ */
+static void copyFile(const string& from, const string& to) {
+
+    TraceSpan span("cacheCopy");
+
+    ifstream in(from.c_str(), ios::in | ios::binary);
+
+    if (!in) throw IOException("Could not read the cached file " + from);
+
+    ofstream out(to.c_str(), ios::out | ios::trunc | ios::binary);
+
+    out << in.rdbuf();
+
+    if (!out) throw IOException("Could not write the cached file to " + to);
+}
+
+
+string hashFile(const string& fileName, uint64_t sampleBytes) {
+
+    TraceSpan span("hashFile");
+
+    ifstream in(fileName.c_str(), ios::in | ios::binary);
+
+    if (!in) throw IOException("Could not open " + fileName + " to hash it.");
+
+    in.seekg(0, ios::end);
+
+    uint64_t size = static_cast<uint64_t>(in.tellg());
+
+    Hasher hasher;
+
+    hasher.update(size);
+    hasher.update(sampleBytes);
+
+    if (0 == sampleBytes || 3 * sampleBytes >= size) {
+
+        hashRange(in, fileName, 0, size, hasher);
+
+    } else {
+
+        hashRange(in, fileName, 0, sampleBytes, hasher);
+        hashRange(in, fileName, (size - sampleBytes) / 2, sampleBytes, hasher);
+        hashRange(in, fileName, size - sampleBytes, sampleBytes, hasher);
+    }
+
+    return hasher.digest();
+}
+
+EncodeSettings::EncodeSettings() : _values() {
+}
+
+EncodeSettings& EncodeSettings::set(const string& name, const string& value) {
+
+    _values[name] = value;
+
+    return *this;
+}
+
+EncodeSettings& EncodeSettings::set(const string& name, int64_t value) {
+
+    ostringstream text;
+
+    text << value;
+
+    return set(name, text.str());
+}
+
+string EncodeSettings::serialise() const {
+
+    ostringstream text;
+
+    for (map<string, string>::const_iterator it = _values.begin(); it != _values.end(); ++it) {
+
+        text << it->first.size() << ":" << it->first << it->second.size() << ":"
+                << it->second << ";";
+    }
+
+    return text.str();
+}
+
+EncodeSettings encodeSettings(const PipelineOptions& options) {
+
+    EncodeSettings settings;
+
+    settings.set("encoder", options.encoderName)
+            .set("width", options.width)
+            .set("height", options.height)
+            .set("bitRate", options.bitRate)
+            .set("quantizer", options.quantizer)
+            .set("profile", options.encodeOptions.profile)
+            .set("slices", options.encodeOptions.slices);
+
+    return settings;
+}
+
+OutputCache::OutputCache(const string& directory, uint64_t quotaBytes, uint64_t sampleBytes) :
+        _directory(directory), _quotaBytes(quotaBytes), _sampleBytes(sampleBytes), _entries(),
+        _index(), _statistics(), _mutex() {
+
+    if (directory.empty()) {
+
+        throw IllegalArgumentException("The directory of a cache cannot be empty.");
+    }
+
+    // The files already in the cache by when they were last fetched, and then
+    // by their name and size.
+    vector<pair<time_t, pair<string, uint64_t> > > found;
+
+    try {
+
+        boost::filesystem::create_directories(directory);
+
+        for (boost::filesystem::directory_iterator it(directory);
+                it != boost::filesystem::directory_iterator(); ++it) {
+
+            string name = it->path().filename().string();
+
+            // Temporary files may still be being written by another process.
+            if (!boost::filesystem::is_regular_file(it->status()) || !isKey(name)) continue;
+
+            found.push_back(make_pair(boost::filesystem::last_write_time(it->path()),
+                    make_pair(name, boost::filesystem::file_size(it->path()))));
+        }
+
+    } catch (const boost::filesystem::filesystem_error& e) {
+
+        throw IOException(e.what());
+    }
+
+    sort(found.begin(), found.end());
+
+    // The most recently fetched is pushed last, to the front.
+    for (size_t i = 0; i < found.size(); i++) {
+
+        Entry entry = { found[i].second.first, found[i].second.second, 0 };
+
+        _entries.push_front(entry);
+
+        _index[entry.key] = _entries.begin();
+
+        _statistics.bytes += entry.bytes;
+        _statistics.entries++;
+    }
+
+    evict();
+}
+
+string OutputCache::fileName(const string& key) const {
+
+    return (boost::filesystem::path(_directory) / key).string();
+}
+
+void OutputCache::remove(EntryList::iterator entry) {
+
+    boost::system::error_code error;
+
+    // A file that can't be removed is forgotten all the same, it is found
+    // again when the cache is next opened.
+    boost::filesystem::remove(fileName(entry->key), error);
+
+    _statistics.bytes -= entry->bytes;
+    _statistics.entries--;
+
+    _index.erase(entry->key);
+    _entries.erase(entry);
+}
+
+void OutputCache::evict() {
+
+    EntryList::iterator next = _entries.end();
+
+    while (_statistics.bytes > _quotaBytes && _entries.begin() != next) {
+
+        EntryList::iterator entry = next;
+
+        --entry;
+
+        // A file being copied out is left for the next eviction after it.
+        if (0 < entry->pins) {
+
+            next = entry;
+
+            continue;
+        }
+
+        remove(entry);
+
+        _statistics.evicted++;
+    }
+}
+
+void OutputCache::copyPinned(const string& key, const string& outputFileName) {
+
+    try {
+
+        copyFile(fileName(key), outputFileName);
+
+    } catch (...) {
+
+        boost::mutex::scoped_lock lock(_mutex);
+
+        _index[key]->pins--;
+
+        evict();
+
+        throw;
+    }
+
+    boost::mutex::scoped_lock lock(_mutex);
+
+    _index[key]->pins--;
+
+    evict();
+}
+
+string OutputCache::key(const string& inputFileName, const EncodeSettings& settings) const {
+
+    string serialised = settings.serialise();
+
+    Hasher hasher;
+
+    hasher.update(serialised.data(), serialised.size());
+
+    return hashFile(inputFileName, _sampleBytes) + "-" + hasher.digest();
+}
+
+bool OutputCache::fetch(const string& inputFileName, const EncodeSettings& settings,
+        const string& outputFileName, const CacheProducer& producer) {
+
+    if (outputFileName.empty()) {
+
+        throw IllegalArgumentException("The output file of a cache fetch cannot be empty.");
+    }
+
+    if (!producer) {
+
+        throw IllegalArgumentException("The producer of a cache fetch cannot be empty.");
+    }
+
+    string wanted = key(inputFileName, settings);
+
+    bool hit = false;
+
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+
+        map<string, EntryList::iterator>::iterator found = _index.find(wanted);
+
+        hit = found != _index.end();
+
+        if (hit) {
+
+            _entries.splice(_entries.begin(), _entries, found->second);
+
+            boost::system::error_code error;
+
+            // Only used to order the files when the cache is opened again.
+            boost::filesystem::last_write_time(fileName(wanted), time(NULL), error);
+
+            _statistics.hits++;
+
+            found->second->pins++;
+
+        } else {
+
+            _statistics.misses++;
+        }
+    }
+
+    if (hit) {
+
+        copyPinned(wanted, outputFileName);
+
+        return true;
+    }
+
+    string temporaryFileName;
+
+    try {
+
+        temporaryFileName = (boost::filesystem::path(_directory)
+                / boost::filesystem::unique_path(wanted + "-%%%%-%%%%" + TEMPORARY_EXTENSION))
+                .string();
+
+    } catch (const boost::filesystem::filesystem_error& e) {
+
+        throw IOException(e.what());
+    }
+
+    uint64_t bytes = 0;
+
+    try {
+
+        producer(temporaryFileName);
+
+        bytes = boost::filesystem::file_size(temporaryFileName);
+
+    } catch (const boost::filesystem::filesystem_error& e) {
+
+        boost::system::error_code error;
+
+        boost::filesystem::remove(temporaryFileName, error);
+
+        throw IOException("The transcode didn't write " + temporaryFileName + ": " + e.what());
+
+    } catch (...) {
+
+        boost::system::error_code error;
+
+        boost::filesystem::remove(temporaryFileName, error);
+
+        throw;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+
+        try {
+
+            boost::filesystem::rename(temporaryFileName, fileName(wanted));
+
+        } catch (const boost::filesystem::filesystem_error& e) {
+
+            boost::system::error_code error;
+
+            boost::filesystem::remove(temporaryFileName, error);
+
+            throw IOException(e.what());
+        }
+
+        map<string, EntryList::iterator>::iterator found = _index.find(wanted);
+
+        if (found != _index.end()) {
+
+            // Another thread may have transcoded the same input in the
+            // meantime, its file has just been replaced. Any fetch still
+            // copying it out reads the file it opened.
+            _statistics.bytes -= found->second->bytes;
+
+            found->second->bytes = bytes;
+
+            _entries.splice(_entries.begin(), _entries, found->second);
+
+        } else {
+
+            Entry entry = { wanted, bytes, 0 };
+
+            _entries.push_front(entry);
+
+            _index[wanted] = _entries.begin();
+
+            _statistics.entries++;
+        }
+
+        _statistics.bytes += bytes;
+
+        _entries.front().pins++;
+
+        evict();
+    }
+
+    copyPinned(wanted, outputFileName);
+
+    return false;
+}
+
+void OutputCache::clear() {
+
+    boost::mutex::scoped_lock lock(_mutex);
+
+    for (EntryList::iterator it = _entries.begin(); it != _entries.end();) {
+
+        EntryList::iterator entry = it++;
+
+        if (0 == entry->pins) remove(entry);
+    }
+}
+
+CacheStatistics OutputCache::statistics() const {
+
+    boost::mutex::scoped_lock lock(_mutex);
+
+    return _statistics;
+}
+
+} /* namespace libav */
+} /* namespace transcode */
@@ -0,0 +1,263 @@
+/*
+ * cache.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __CACHE_HPP__
+#define __CACHE_HPP__
+
+#include <libav/pipeline.hpp>
+
+#include <boost/thread/mutex.hpp>
+
+#include <list>
+#include <map>
+#include <stdint.h>
+#include <string>
+
+#include <tr1/functional>
+
+/**
+ * @file cache.hpp
+ *
+ * A cache of transcoded files on disk, so an input that has already been
+ * transcoded with the same settings isn't transcoded again.
+ */
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * The default most bytes an <code>OutputCache</code> keeps on disk.
+ */
+const uint64_t DEFAULT_CACHE_QUOTA_BYTES = 1024 * 1024 * 1024;
+
+/**
+ * The default number of bytes hashed from each of the start, middle and end of
+ * an input, 0 to hash the whole input.
+ */
+const uint64_t DEFAULT_HASH_SAMPLE_BYTES = 0;
+
+/**
+ * Hash the contents of the supplied file.
+ *
+ * Only the size of the file and the samples at its start, middle and end are
+ * hashed when a sample size is given and the file is bigger than the samples,
+ * which is much faster for large files.
+ *
+ * Note: A sampled hash won't change for a file that is only changed outside of
+ * its samples, so sampling is only safe for inputs that are never changed in
+ * place.
+ *
+ * @param fileName - the path of the file to hash.
+ * @param sampleBytes - the size of each sample, or 0 to hash the whole file.
+ * @return the hash as 32 hexadecimal digits.
+ */
+std::string hashFile(const std::string& fileName,
+        uint64_t sampleBytes = DEFAULT_HASH_SAMPLE_BYTES);
+
+/**
+ * The settings a file is transcoded with, written out the same way whatever
+ * order they were set in.
+ */
+class EncodeSettings {
+
+private:
+    std::map<std::string, std::string> _values;
+
+public:
+    EncodeSettings();
+
+    /**
+     * Set the supplied setting, replacing the value it had.
+     *
+     * @return these settings.
+     */
+    EncodeSettings& set(const std::string& name, const std::string& value);
+
+    /**
+     * Set the supplied setting, replacing the value it had.
+     *
+     * @return these settings.
+     */
+    EncodeSettings& set(const std::string& name, int64_t value);
+
+    /**
+     * @return every setting, sorted by name, with the length of each name and
+     *      value in front of it so no two different settings are written the
+     *      same.
+     */
+    std::string serialise() const;
+};
+
+/**
+ * @return the settings of the supplied pipeline options.
+ */
+EncodeSettings encodeSettings(const PipelineOptions& options);
+
+/**
+ * Writes the transcoded file to the supplied path when it isn't in the cache.
+ */
+typedef std::tr1::function<void(const std::string& outputFileName)> CacheProducer;
+
+/**
+ * The statistics of an <code>OutputCache</code>.
+ */
+struct CacheStatistics {
+
+    // The fetches that were answered from the cache.
+    unsigned long hits;
+
+    // The fetches that had to transcode the input.
+    unsigned long misses;
+
+    // The files removed to keep the cache within its quota.
+    unsigned long evicted;
+
+    // The files currently in the cache.
+    size_t entries;
+
+    // The bytes currently in the cache.
+    uint64_t bytes;
+
+    CacheStatistics() : hits(0), misses(0), evicted(0), entries(0), bytes(0) {
+    }
+};
+
+/**
+ * An <code>OutputCache</code> keeps transcoded files in a directory, named by
+ * a hash of the contents of their input and of the settings they were
+ * transcoded with. Fetching a file that is already there copies it instead of
+ * transcoding the input again.
+ *
+ * The least recently fetched files are removed when the cache is over its
+ * quota, a file that is bigger than the whole quota is copied to where it was
+ * asked for and not kept. The modification time of a file is set when it is
+ * fetched, so a cache opened on a directory that is already filled picks up
+ * where it left off.
+ *
+ * A cache can be shared between threads. A new file is written under a
+ * temporary name and renamed once it is finished, so a transcode that fails or
+ * a process that dies never leaves a partial file in the cache. Files are
+ * copied out without holding the lock of the cache, the file being copied is
+ * pinned so it isn't evicted or cleared until the copy is finished.
+ */
+class OutputCache {
+
+private:
+    /**
+     * A file in the cache.
+     */
+    struct Entry {
+
+        std::string key;
+        uint64_t bytes;
+
+        // The number of fetches still copying the file out.
+        int pins;
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    std::string _directory;
+    uint64_t _quotaBytes;
+    uint64_t _sampleBytes;
+
+    // The files in the cache, the most recently fetched at the front.
+    EntryList _entries;
+
+    std::map<std::string, EntryList::iterator> _index;
+
+    CacheStatistics _statistics;
+
+    mutable boost::mutex _mutex;
+
+    OutputCache(OutputCache const&); // Should not be implemented.
+
+    void operator=(OutputCache const&); // Should not be implemented.
+
+    /**
+     * @return the path of the file with the supplied key.
+     */
+    std::string fileName(const std::string& key) const;
+
+    /**
+     * Remove the least recently fetched files that aren't pinned until the
+     * cache is within its quota.
+     */
+    void evict();
+
+    /**
+     * Copy the file with the supplied key, which must have been pinned while
+     * the lock was held, to the supplied path and unpin it.
+     */
+    void copyPinned(const std::string& key, const std::string& outputFileName);
+
+    /**
+     * Remove the file of the supplied entry from the cache.
+     */
+    void remove(EntryList::iterator entry);
+
+public:
+    /**
+     * Open the cache in the supplied directory, creating it if it doesn't
+     * exist, with the files already in it.
+     *
+     * @param directory - the directory the files are kept in.
+     * @param quotaBytes - the most bytes to keep in the cache.
+     * @param sampleBytes - the size of the samples inputs are hashed with, or
+     *      0 to hash the whole of every input.
+     */
+    explicit OutputCache(const std::string& directory,
+            uint64_t quotaBytes = DEFAULT_CACHE_QUOTA_BYTES,
+            uint64_t sampleBytes = DEFAULT_HASH_SAMPLE_BYTES);
+
+    /**
+     * @return the key the supplied input transcoded with the supplied settings
+     *      is kept under.
+     */
+    std::string key(const std::string& inputFileName, const EncodeSettings& settings) const;
+
+    /**
+     * Write the supplied input transcoded with the supplied settings to the
+     * supplied file, copying it from the cache if it is there and otherwise
+     * calling the producer to transcode it and keeping the result.
+     *
+     * @param inputFileName - the path of the input.
+     * @param settings - the settings the input is transcoded with.
+     * @param outputFileName - the path to write the transcoded file to.
+     * @param producer - called to transcode the input into the file it is
+     *      given if it isn't in the cache.
+     * @return true if the file was in the cache.
+     */
+    bool fetch(const std::string& inputFileName, const EncodeSettings& settings,
+            const std::string& outputFileName, const CacheProducer& producer);
+
+    /**
+     * Remove every file from the cache, except those that are still being
+     * copied out.
+     */
+    void clear();
+
+    /**
+     * @return the statistics of this cache.
+     */
+    CacheStatistics statistics() const;
+};
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __CACHE_HPP__ */
@@ -0,0 +1,90 @@
+/*
+ * cancellation.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#include <libav/cancellation.hpp>
+#include <libav/counters.hpp>
+#include <libav/job.hpp>
+#include <libav/libaverror.hpp>
+
+#include <cstddef>
+
+using namespace std;
+
+
+/**
+ * @file cancellation.cpp
+ *
+ * The implementation of the cancellation.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+// A deadline of 0 means there isn't one.
+static const uint64_t NO_DEADLINE = 0;
+
+
+CancellationToken::CancellationToken() : _cancelled(false), _deadlineNanoseconds(NO_DEADLINE) {
+}
+
+void CancellationToken::cancel() {
+
+    _cancelled.store(true, boost::memory_order_relaxed);
+}
+
+void CancellationToken::setDeadline(int64_t milliseconds) {
+
+    uint64_t now = monotonicNanoseconds();
+
+    // A deadline that has already passed is kept just after the epoch of the
+    // clock, so it can't be mistaken for no deadline at all.
+    uint64_t deadline = 0 < milliseconds ? now + static_cast<uint64_t>(milliseconds) * 1000000
+            : 1;
+
+    _deadlineNanoseconds.store(deadline, boost::memory_order_relaxed);
+}
+
+void CancellationToken::clearDeadline() {
+
+    _deadlineNanoseconds.store(NO_DEADLINE, boost::memory_order_relaxed);
+}
+
+bool CancellationToken::isCancelled() const {
+
+    return _cancelled.load(boost::memory_order_relaxed);
+}
+
+bool CancellationToken::isPastDeadline() const {
+
+    uint64_t deadline = _deadlineNanoseconds.load(boost::memory_order_relaxed);
+
+    // The clock is only read when there is a deadline.
+    return NO_DEADLINE != deadline && monotonicNanoseconds() >= deadline;
+}
+
+bool CancellationToken::shouldStop() const {
+
+    return isCancelled() || isPastDeadline();
+}
+
+void CancellationToken::throwIfStopped() const {
+
+    if (isCancelled()) throw CancelledException("The job was cancelled.");
+
+    if (isPastDeadline()) throw CancelledException("The job ran past its deadline.");
+}
+
+void throwIfCancelled() {
+
+    Job *job = currentJob();
+
+    if (NULL != job) job->cancellation().throwIfStopped();
+}
+
+} /* namespace libav */
+} /* namespace transcode */
@@ -0,0 +1,115 @@
+/*
+ * cancellation.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __CANCELLATION_HPP__
+#define __CANCELLATION_HPP__
+
+#include <boost/atomic.hpp>
+
+#include <stdint.h>
+
+/**
+ * @file cancellation.hpp
+ *
+ * Stopping a job that was cancelled or ran out of time.
+ *
+ * Every format context opened on a thread a job is bound to has the token of
+ * the job as its interrupt callback, so a read or write blocked inside libav
+ * gives up as soon as libav next polls it. <code>readNextPacket</code> and
+ * <code>writePacket</code> check the token as well, so every loop built from
+ * them stops between one packet and the next. Either way a
+ * <code>CancelledException</code> is thrown and unwinds through the normal
+ * clean up of the caller.
+ *
+ * Note: The format contexts keep a pointer to the token of the job, so a job
+ * must outlive every format context opened for it.
+ */
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * Whether a job should stop, because it was cancelled or its deadline has
+ * passed. It can be cancelled from any thread.
+ */
+class CancellationToken {
+
+private:
+    boost::atomic<bool> _cancelled;
+    boost::atomic<uint64_t> _deadlineNanoseconds;
+
+    CancellationToken(CancellationToken const&); // Should not be implemented.
+
+    void operator=(CancellationToken const&); // Should not be implemented.
+
+public:
+    /**
+     * Instantiate a new <code>CancellationToken</code> that isn't cancelled
+     * and has no deadline.
+     */
+    CancellationToken();
+
+    /**
+     * Cancel the job, it can't be undone.
+     */
+    void cancel();
+
+    /**
+     * Set the deadline of the job to the supplied time from now.
+     *
+     * @param milliseconds - the time the job has left, 0 or less is already
+     *      past.
+     */
+    void setDeadline(int64_t milliseconds);
+
+    /**
+     * Remove the deadline of the job.
+     */
+    void clearDeadline();
+
+    /**
+     * @return true if the job was cancelled.
+     */
+    bool isCancelled() const;
+
+    /**
+     * @return true if the job has a deadline and it has passed.
+     */
+    bool isPastDeadline() const;
+
+    /**
+     * @return true if the job was cancelled or its deadline has passed.
+     */
+    bool shouldStop() const;
+
+    /**
+     * Throw a <code>CancelledException</code> if the job should stop.
+     */
+    void throwIfStopped() const;
+};
+
+/**
+ * Throw a <code>CancelledException</code> if the job bound to the calling
+ * thread should stop. Long running loops that don't read or write packets
+ * should call this between units of work.
+ */
+void throwIfCancelled();
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __CANCELLATION_HPP__ */
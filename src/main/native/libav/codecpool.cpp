@@ -0,0 +1,334 @@
+/*
+ * codecpool.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+}
+
+#include <error.hpp>
+#include <libav/codecpool.hpp>
+#include <libav/job.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+
+/**
+ * @file codecpool.cpp
+ *
+ * The implementation of the codecpool.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+CodecContextPool::CodecContextPool(size_t maxIdle) :
+        _maxIdle(maxIdle), _idle(), _inUse(), _statistics(), _mutex() {
+}
+
+CodecContextPool::~CodecContextPool() {
+
+    clear();
+}
+
+CodecContextPool::Key CodecContextPool::key(const AVCodecContext *parameters,
+        bool encoder) {
+
+    stringstream fields;
+
+    // Everything that is copied into a new codec context and changes what it
+    // decodes or encodes.
+    fields << (NULL == parameters->codec ? "" : parameters->codec->name)
+            << " " << parameters->codec_type
+            << " " << parameters->codec_id
+            << " " << parameters->codec_tag
+            << " " << parameters->width << "x" << parameters->height
+            << " " << parameters->pix_fmt
+            << " " << parameters->sample_rate
+            << " " << parameters->channels
+            << " " << parameters->channel_layout
+            << " " << parameters->sample_fmt
+            << " " << parameters->bit_rate
+            << " " << parameters->time_base.num << "/" << parameters->time_base.den
+            << " " << parameters->gop_size
+            << " " << parameters->max_b_frames
+            << " " << parameters->flags
+            << " " << parameters->flags2
+            << " " << parameters->thread_count
+            << " " << parameters->lowres
+            << " " << parameters->skip_frame
+            << " " << parameters->skip_loop_filter
+            << " " << parameters->skip_idct
+            << " ";
+
+    if (NULL != parameters->extradata && 0 < parameters->extradata_size) {
+
+        fields.write(reinterpret_cast<const char*>(parameters->extradata),
+                parameters->extradata_size);
+    }
+
+    Key key = { encoder, fields.str() };
+
+    return key;
+}
+
+void CodecContextPool::destroy(AVCodecContext *codecContext, bool opened) {
+
+    if (opened) closeCodecContext(&codecContext);
+
+    // These are the copies made by avcodec_copy_context, avcodec_close leaves
+    // them for the caller to free.
+    av_freep(&codecContext->extradata);
+    av_freep(&codecContext->subtitle_header);
+    av_freep(&codecContext->rc_override);
+    av_freep(&codecContext->intra_matrix);
+    av_freep(&codecContext->inter_matrix);
+
+    av_free(codecContext);
+}
+
+AVCodecContext* CodecContextPool::acquire(const AVCodecContext *parameters,
+        bool encoder) {
+
+    if (NULL == parameters) {
+
+        throw IllegalArgumentException(
+                "Cannot acquire a codec context for NULL codec parameters.");
+    }
+
+    Key wanted = key(parameters, encoder);
+
+    AVCodecContext *codecContext = NULL;
+
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+
+        for (IdleList::iterator it = _idle.begin(); it != _idle.end(); ++it) {
+
+            if (wanted < it->first || it->first < wanted) continue;
+
+            codecContext = it->second;
+
+            _idle.erase(it);
+
+            break;
+        }
+
+        if (NULL == codecContext) _statistics.misses++;
+        else _statistics.hits++;
+
+        if (NULL != codecContext) _inUse[codecContext] = wanted;
+    }
+
+    if (NULL != codecContext) {
+
+        // The codec context was kept in the process account while it was idle.
+        chargeCodecContext(codecContext);
+
+        return codecContext;
+    }
+
+    AVCodec *codec = NULL;
+
+    if (!encoder) codec = avcodec_find_decoder(parameters->codec_id);
+    else if (NULL != parameters->codec) codec = parameters->codec;
+    else codec = avcodec_find_encoder(parameters->codec_id);
+
+    if (NULL == codec) throw CodecException("Could not find a supported codec.");
+
+    codecContext = avcodec_alloc_context3(codec);
+
+    if (NULL == codecContext) throw CodecException("Could not allocate a codec context.");
+
+    try {
+
+        if (0 > avcodec_copy_context(codecContext, parameters)) {
+
+            throw CodecException("Could not copy the codec parameters.");
+        }
+
+        codecContext->codec = encoder ? codec : NULL;
+
+        if (encoder) openEncodeCodecContext(codecContext);
+        else openDecodeCodecContext(codecContext);
+
+    } catch (...) {
+
+        // A codec that fails to open is left closed by avcodec_open2.
+        destroy(codecContext, false);
+
+        throw;
+    }
+
+    boost::mutex::scoped_lock lock(_mutex);
+
+    _inUse[codecContext] = wanted;
+
+    return codecContext;
+}
+
+AVCodecContext* CodecContextPool::acquireDecodeCodecContext(
+        const AVCodecContext *parameters) {
+
+    return acquire(parameters, false);
+}
+
+AVCodecContext* CodecContextPool::acquireEncodeCodecContext(
+        const AVCodecContext *parameters) {
+
+    return acquire(parameters, true);
+}
+
+void CodecContextPool::release(AVCodecContext **codecContext) {
+
+    if (NULL == codecContext || NULL == *codecContext) {
+
+        throw IllegalArgumentException("Cannot release a NULL AVCodecContext.");
+    }
+
+    AVCodecContext *released = *codecContext;
+
+    Key releasedKey;
+
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+
+        map<AVCodecContext*, Key>::iterator it = _inUse.find(released);
+
+        if (_inUse.end() == it) {
+
+            throw IllegalArgumentException(
+                    "The AVCodecContext was not acquired from this pool.");
+        }
+
+        releasedKey = it->second;
+
+        _inUse.erase(it);
+    }
+
+    *codecContext = NULL;
+
+    bool reusable = 0 < _maxIdle;
+
+    bool opened = true;
+
+    if (releasedKey.encoder && reusable) {
+
+        // Encoders keep their rate control, frame counters and reference
+        // frames in private state that avcodec_flush_buffers doesn't reset,
+        // and a delayed encoder won't take any more frames once it has been
+        // drained, so the next borrower would encode differently. Opening it
+        // again is the only reset that works for every encoder.
+        AVCodec *codec = released->codec;
+
+        try {
+
+            opened = false;
+
+            closeCodecContext(&released);
+
+            released->codec = codec;
+
+            openEncodeCodecContext(released);
+
+            opened = true;
+
+        } catch (const CodecException&) {
+
+            reusable = false;
+        }
+
+    } else if (!releasedKey.encoder) {
+
+        avcodec_flush_buffers(released);
+    }
+
+    if (!reusable) {
+
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+
+            _statistics.discarded++;
+        }
+
+        destroy(released, opened);
+
+        return;
+    }
+
+    {
+        // Idle codec contexts belong to no job, so the job that released this
+        // one can finish without its account still being charged for it.
+        ScopedJob unbound(NULL);
+
+        chargeCodecContext(released);
+    }
+
+    AVCodecContext *evicted = NULL;
+
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+
+        _idle.push_front(make_pair(releasedKey, released));
+
+        _statistics.released++;
+
+        if (_idle.size() > _maxIdle) {
+
+            evicted = _idle.back().second;
+
+            _idle.pop_back();
+
+            _statistics.discarded++;
+        }
+    }
+
+    if (NULL != evicted) destroy(evicted, true);
+}
+
+void CodecContextPool::clear() {
+
+    IdleList idle;
+
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+
+        idle.swap(_idle);
+    }
+
+    for (IdleList::iterator it = idle.begin(); it != idle.end(); ++it) {
+
+        try {
+
+            destroy(it->second, true);
+
+        } catch (const exception&) {
+
+            // Carry on closing the rest, the codec context is lost either way.
+        }
+    }
+}
+
+CodecPoolStatistics CodecContextPool::statistics() const {
+
+    boost::mutex::scoped_lock lock(_mutex);
+
+    CodecPoolStatistics statistics = _statistics;
+
+    statistics.idle = _idle.size();
+    statistics.inUse = _inUse.size();
+
+    return statistics;
+}
+
+} /* namespace libav */
+} /* namespace transcode */
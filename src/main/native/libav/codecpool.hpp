@@ -0,0 +1,190 @@
+/*
+ * codecpool.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __CODECPOOL_HPP__
+#define __CODECPOOL_HPP__
+
+#include <boost/thread/mutex.hpp>
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <string>
+
+/**
+ * @file codecpool.hpp
+ *
+ * A pool of opened codec contexts that are reused instead of being closed and
+ * opened again for every file.
+ */
+
+struct AVCodecContext;
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * The default maximum number of idle codec contexts a <code>CodecContextPool</code>
+ * keeps open.
+ */
+const size_t DEFAULT_MAX_IDLE_CODEC_CONTEXTS = 16;
+
+/**
+ * The statistics of a <code>CodecContextPool</code>.
+ */
+struct CodecPoolStatistics {
+
+    // The acquires that reused an idle codec context.
+    unsigned long hits;
+
+    // The acquires that had to open a new codec context.
+    unsigned long misses;
+
+    // The codec contexts released back into the pool to be reused.
+    unsigned long released;
+
+    // The codec contexts closed on release instead of being kept, because the
+    // pool was full or they couldn't be reset.
+    unsigned long discarded;
+
+    // The codec contexts currently kept open in the pool.
+    size_t idle;
+
+    // The codec contexts currently acquired from the pool.
+    size_t inUse;
+
+    CodecPoolStatistics() : hits(0), misses(0), released(0), discarded(0), idle(0),
+            inUse(0) {
+    }
+};
+
+/**
+ * A <code>CodecContextPool</code> keeps opened codec contexts after they are
+ * released so that the next file with the same codec parameters can reuse them,
+ * instead of paying for <code>avcodec_open2</code> to allocate its tables and
+ * threads again.
+ *
+ * Codec contexts are keyed by whether they decode or encode, the codec and every
+ * parameter that is fixed once a codec is opened. Decoders are flushed when they
+ * are released. Encoders keep state that flushing doesn't reset, so they are
+ * closed and opened again on release, which still saves allocating them, and
+ * are closed instead of being kept if they can't be opened again.
+ *
+ * The least recently released codec context is closed when the pool is full. A
+ * pool can be shared between threads, the codec contexts taken from it can't.
+ *
+ * Note: Every codec context acquired from a pool must be released back to it
+ * before the pool is destroyed.
+ */
+class CodecContextPool {
+
+private:
+    /**
+     * The parameters that decide if an idle codec context can be reused.
+     */
+    struct Key {
+
+        bool encoder;
+        std::string parameters;
+
+        bool operator<(const Key& key) const {
+
+            return encoder != key.encoder ? encoder < key.encoder : parameters < key.parameters;
+        }
+    };
+
+    typedef std::list<std::pair<Key, AVCodecContext*> > IdleList;
+
+    size_t _maxIdle;
+
+    // The idle codec contexts, the most recently released at the front.
+    IdleList _idle;
+
+    std::map<AVCodecContext*, Key> _inUse;
+
+    CodecPoolStatistics _statistics;
+
+    mutable boost::mutex _mutex;
+
+    CodecContextPool(CodecContextPool const&); // Should not be implemented.
+
+    void operator=(CodecContextPool const&); // Should not be implemented.
+
+    AVCodecContext* acquire(const AVCodecContext *parameters, bool encoder);
+
+    static Key key(const AVCodecContext *parameters, bool encoder);
+
+    static void destroy(AVCodecContext *codecContext, bool opened);
+
+public:
+    /**
+     * Create an empty pool.
+     *
+     * @param maxIdle - the most codec contexts to keep open while they aren't
+     *      being used.
+     */
+    explicit CodecContextPool(size_t maxIdle = DEFAULT_MAX_IDLE_CODEC_CONTEXTS);
+
+    /**
+     * Close every idle codec context.
+     */
+    ~CodecContextPool();
+
+    /**
+     * Take an opened decoder for the supplied codec parameters, reusing an idle
+     * one if there is one.
+     *
+     * @param parameters - the codec context to copy the parameters from, usually
+     *      the codec context of a stream. It isn't opened or changed.
+     * @return an opened decoder that must be released back to this pool.
+     */
+    AVCodecContext* acquireDecodeCodecContext(const AVCodecContext *parameters);
+
+    /**
+     * Take an opened encoder for the supplied codec parameters, reusing an idle
+     * one if there is one.
+     *
+     * @param parameters - the codec context to copy the parameters from, the
+     *      encoder is found the same way as <code>openEncodeCodecContext</code>.
+     *      It isn't opened or changed.
+     * @return an opened encoder that must be released back to this pool.
+     */
+    AVCodecContext* acquireEncodeCodecContext(const AVCodecContext *parameters);
+
+    /**
+     * Give a codec context back to the pool to be reset and reused.
+     *
+     * @param codecContext - a pointer to a codec context acquired from this pool,
+     *      this is set to NULL.
+     */
+    void release(AVCodecContext **codecContext);
+
+    /**
+     * Close every idle codec context.
+     */
+    void clear();
+
+    /**
+     * @return the statistics of this pool.
+     */
+    CodecPoolStatistics statistics() const;
+};
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __CODECPOOL_HPP__ */
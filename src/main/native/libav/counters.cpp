@@ -0,0 +1,383 @@
+/*
+ * counters.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#include <libav/counters.hpp>
+
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <exception>
+#include <set>
+#include <sstream>
+
+#include <time.h>
+
+using namespace std;
+
+
+/**
+ * @file counters.cpp
+ *
+ * The implementation of the counters.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+/**
+ * The report names of the stages, in the same order as the <code>Stage</code> enum.
+ */
+static const char* STAGE_NAMES[STAGE_COUNT] = {
+    "open_format_context",
+    "close_format_context",
+    "read_packet",
+    "write_packet",
+    "open_codec_context",
+    "close_codec_context",
+    "decode_audio",
+    "decode_video",
+    "encode_audio",
+    "encode_video"
+};
+
+/**
+ * Add the supplied amount to a counter that is only ever written by one thread.
+ * Other threads only read the counters so a relaxed load and store is enough,
+ * and is a lot cheaper than an atomic add.
+ *
+ * @param counter - the counter to add to.
+ * @param amount - the amount to add.
+ */
+static inline void increase(boost::atomic<uint64_t>& counter, uint64_t amount) {
+
+    counter.store(counter.load(boost::memory_order_relaxed) + amount,
+            boost::memory_order_relaxed);
+}
+
+/**
+ * The counters for a single stage of a single thread.
+ */
+struct ThreadStageCounters {
+
+    boost::atomic<uint64_t> calls;
+    boost::atomic<uint64_t> errors;
+    boost::atomic<uint64_t> bytesIn;
+    boost::atomic<uint64_t> bytesOut;
+    boost::atomic<uint64_t> totalNanoseconds;
+    boost::atomic<uint64_t> latencyHistogram[LATENCY_BUCKETS];
+
+    ThreadStageCounters() : calls(0), errors(0), bytesIn(0), bytesOut(0),
+            totalNanoseconds(0) {
+
+        for (int i = 0; i < LATENCY_BUCKETS; i++) latencyHistogram[i] = 0;
+    }
+
+    void addTo(StageCounters& total) const {
+
+        total.calls += calls.load(boost::memory_order_relaxed);
+        total.errors += errors.load(boost::memory_order_relaxed);
+        total.bytesIn += bytesIn.load(boost::memory_order_relaxed);
+        total.bytesOut += bytesOut.load(boost::memory_order_relaxed);
+        total.totalNanoseconds += totalNanoseconds.load(boost::memory_order_relaxed);
+
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+
+            total.latencyHistogram[i] += latencyHistogram[i].load(boost::memory_order_relaxed);
+        }
+    }
+};
+
+/**
+ * The counters for every stage of a single thread.
+ */
+struct ThreadCounters {
+
+    ThreadStageCounters stages[STAGE_COUNT];
+
+    void addTo(PerformanceCounters& total) const {
+
+        for (int i = 0; i < STAGE_COUNT; i++) stages[i].addTo(total.stages[i]);
+    }
+};
+
+/**
+ * Add the second value to the first, or take it away.
+ */
+static inline void combine(uint64_t& total, uint64_t value, bool subtract) {
+
+    total = subtract ? total - value : total + value;
+}
+
+/**
+ * Add the second set of counters to the first, or take them away.
+ *
+ * @param total - the counters to change.
+ * @param counters - the counters to add or take away.
+ * @param subtract - true to take the counters away, false to add them.
+ */
+static void combine(PerformanceCounters& total, const PerformanceCounters& counters,
+        bool subtract) {
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+
+        StageCounters& t = total.stages[i];
+        const StageCounters& c = counters.stages[i];
+
+        combine(t.calls, c.calls, subtract);
+        combine(t.errors, c.errors, subtract);
+        combine(t.bytesIn, c.bytesIn, subtract);
+        combine(t.bytesOut, c.bytesOut, subtract);
+        combine(t.totalNanoseconds, c.totalNanoseconds, subtract);
+
+        for (int j = 0; j < LATENCY_BUCKETS; j++) {
+
+            combine(t.latencyHistogram[j], c.latencyHistogram[j], subtract);
+        }
+    }
+}
+
+/**
+ * Guards the set of live thread counters and the totals below.
+ */
+static boost::mutex registryMutex;
+
+/**
+ * The counters of every thread that is still running.
+ */
+static set<ThreadCounters*> liveCounters;
+
+/**
+ * The total of the counters of every thread that has finished.
+ */
+static PerformanceCounters retiredCounters;
+
+/**
+ * The total of all the counters when they were last reset. Resetting takes a
+ * snapshot instead of clearing the counters so that the owning threads are the
+ * only ones that ever write to them.
+ */
+static PerformanceCounters resetCounters;
+
+/**
+ * Fold the counters of a finishing thread into the retired totals.
+ *
+ * @param counters - the counters of the thread that is finishing.
+ */
+static void retireCounters(ThreadCounters *counters) {
+
+    boost::mutex::scoped_lock lock(registryMutex);
+
+    counters->addTo(retiredCounters);
+
+    liveCounters.erase(counters);
+
+    delete counters;
+}
+
+static boost::thread_specific_ptr<ThreadCounters> threadCounters(retireCounters);
+
+static boost::atomic<bool> countersEnabled(true);
+
+/**
+ * @return the counters of the calling thread, creating them on first use.
+ */
+static ThreadCounters& currentThreadCounters() {
+
+    ThreadCounters *counters = threadCounters.get();
+
+    if (NULL != counters) return *counters;
+
+    counters = new ThreadCounters();
+
+    {
+        boost::mutex::scoped_lock lock(registryMutex);
+
+        liveCounters.insert(counters);
+    }
+
+    threadCounters.reset(counters);
+
+    return *counters;
+}
+
+/**
+ * Find the histogram bucket for the supplied latency.
+ *
+ * @param nanoseconds - the latency to find the bucket of.
+ * @return the index of the bucket.
+ */
+static inline int latencyBucket(uint64_t nanoseconds) {
+
+    if (0 == nanoseconds) return 0;
+
+    int bucket = 63 - __builtin_clzll(nanoseconds);
+
+    return LATENCY_BUCKETS > bucket ? bucket : LATENCY_BUCKETS - 1;
+}
+
+
+StageCounters::StageCounters() : calls(0), errors(0), bytesIn(0), bytesOut(0),
+        totalNanoseconds(0) {
+
+    for (int i = 0; i < LATENCY_BUCKETS; i++) latencyHistogram[i] = 0;
+}
+
+StageTimer::StageTimer(Stage stage) :
+        _stage(stage), _enabled(countersEnabled.load(boost::memory_order_relaxed)),
+        _failed(false), _start(0), _bytesIn(0), _bytesOut(0) {
+
+    if (_enabled) _start = monotonicNanoseconds();
+}
+
+StageTimer::~StageTimer() {
+
+    if (!_enabled) return;
+
+    uint64_t elapsed = monotonicNanoseconds() - _start;
+
+    ThreadStageCounters& counters = currentThreadCounters().stages[_stage];
+
+    increase(counters.calls, 1);
+    increase(counters.totalNanoseconds, elapsed);
+    increase(counters.latencyHistogram[latencyBucket(elapsed)], 1);
+
+    if (0 != _bytesIn) increase(counters.bytesIn, _bytesIn);
+    if (0 != _bytesOut) increase(counters.bytesOut, _bytesOut);
+
+    // A timer destroyed while an exception is unwinding the stack is timing a
+    // call that failed.
+    if (_failed || uncaught_exception()) increase(counters.errors, 1);
+}
+
+void StageTimer::addBytesIn(uint64_t bytes) {
+
+    _bytesIn += bytes;
+}
+
+void StageTimer::addBytesOut(uint64_t bytes) {
+
+    _bytesOut += bytes;
+}
+
+void StageTimer::failed() {
+
+    _failed = true;
+}
+
+const char* stageName(Stage stage) {
+
+    if (0 > stage || STAGE_COUNT <= stage) return "unknown";
+
+    return STAGE_NAMES[stage];
+}
+
+void setPerformanceCountersEnabled(bool enabled) {
+
+    countersEnabled.store(enabled, boost::memory_order_relaxed);
+}
+
+/**
+ * Add together the counters of every thread without taking away the reset
+ * snapshot. The registry mutex must be held when this is called.
+ *
+ * @return the total of every counter since the process started.
+ */
+static PerformanceCounters totalCounters() {
+
+    PerformanceCounters total = retiredCounters;
+
+    for (set<ThreadCounters*>::const_iterator it = liveCounters.begin();
+            it != liveCounters.end(); ++it) {
+
+        (*it)->addTo(total);
+    }
+
+    return total;
+}
+
+PerformanceCounters performanceCounters() {
+
+    boost::mutex::scoped_lock lock(registryMutex);
+
+    PerformanceCounters total = totalCounters();
+
+    combine(total, resetCounters, true);
+
+    return total;
+}
+
+void resetPerformanceCounters() {
+
+    boost::mutex::scoped_lock lock(registryMutex);
+
+    resetCounters = totalCounters();
+}
+
+void writePerformanceCountersJson(ostream& out,
+        const PerformanceCounters& counters) {
+
+    out << "{\"histogram_bucket_upper_bounds_ns\":[";
+
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+
+        if (0 < i) out << ",";
+
+        out << (UINT64_C(2) << i);
+    }
+
+    out << "],\"stages\":{";
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+
+        const StageCounters& stage = counters.stages[i];
+
+        if (0 < i) out << ",";
+
+        out << "\"" << stageName(static_cast<Stage>(i)) << "\":{"
+                << "\"calls\":" << stage.calls
+                << ",\"errors\":" << stage.errors
+                << ",\"bytes_in\":" << stage.bytesIn
+                << ",\"bytes_out\":" << stage.bytesOut
+                << ",\"total_ns\":" << stage.totalNanoseconds
+                << ",\"mean_ns\":" << (0 == stage.calls ? 0 : stage.totalNanoseconds / stage.calls)
+                << ",\"latency_histogram\":[";
+
+        for (int j = 0; j < LATENCY_BUCKETS; j++) {
+
+            if (0 < j) out << ",";
+
+            out << stage.latencyHistogram[j];
+        }
+
+        out << "]}";
+    }
+
+    out << "}}";
+}
+
+string performanceCountersJson() {
+
+    stringstream json;
+
+    writePerformanceCountersJson(json, performanceCounters());
+
+    return json.str();
+}
+
+uint64_t monotonicNanoseconds() {
+
+    timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+} /* namespace libav */
+} /* namespace transcode */
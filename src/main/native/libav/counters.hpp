@@ -0,0 +1,189 @@
+/*
+ * counters.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __COUNTERS_HPP__
+#define __COUNTERS_HPP__
+
+#include <stdint.h>
+#include <ostream>
+#include <string>
+
+/**
+ * @file counters.hpp
+ *
+ * Low overhead performance counters for each stage of the libav functions.
+ *
+ * Every thread counts into its own set of counters so the hot paths never share a
+ * cache line or take a lock, the counters of all the threads are only added
+ * together when they are asked for.
+ */
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * The stages of the libav functions that are counted.
+ */
+enum Stage {
+    STAGE_OPEN_FORMAT_CONTEXT,
+    STAGE_CLOSE_FORMAT_CONTEXT,
+    STAGE_READ_PACKET,
+    STAGE_WRITE_PACKET,
+    STAGE_OPEN_CODEC_CONTEXT,
+    STAGE_CLOSE_CODEC_CONTEXT,
+    STAGE_DECODE_AUDIO,
+    STAGE_DECODE_VIDEO,
+    STAGE_ENCODE_AUDIO,
+    STAGE_ENCODE_VIDEO,
+    STAGE_COUNT
+};
+
+/**
+ * The number of buckets in a latency histogram. Bucket i counts the calls that
+ * took less than 2^(i + 1) nanoseconds and at least 2^i nanoseconds, the last
+ * bucket also counts everything slower than that.
+ */
+const int LATENCY_BUCKETS = 32;
+
+/**
+ * The counters for a single stage.
+ */
+struct StageCounters {
+
+    uint64_t calls;
+    uint64_t errors;
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t totalNanoseconds;
+    uint64_t latencyHistogram[LATENCY_BUCKETS];
+
+    StageCounters();
+};
+
+/**
+ * The counters for every stage.
+ */
+struct PerformanceCounters {
+
+    StageCounters stages[STAGE_COUNT];
+};
+
+/**
+ * Times a single call to a stage and counts it against the calling thread when it
+ * goes out of scope. A call is counted as an error if it is left by an exception
+ * or if <code>failed</code> was called.
+ */
+class StageTimer {
+
+private:
+    Stage _stage;
+    bool _enabled;
+    bool _failed;
+    uint64_t _start;
+    uint64_t _bytesIn;
+    uint64_t _bytesOut;
+
+    StageTimer(StageTimer const&); // Should not be implemented.
+
+    void operator=(StageTimer const&); // Should not be implemented.
+
+public:
+    /**
+     * Start timing a call to the supplied stage.
+     *
+     * @param stage - the stage being called.
+     */
+    explicit StageTimer(Stage stage);
+
+    /**
+     * Stop timing and count the call.
+     */
+    ~StageTimer();
+
+    /**
+     * Add to the number of bytes passed into the stage.
+     *
+     * @param bytes - the number of bytes.
+     */
+    void addBytesIn(uint64_t bytes);
+
+    /**
+     * Add to the number of bytes produced by the stage.
+     *
+     * @param bytes - the number of bytes.
+     */
+    void addBytesOut(uint64_t bytes);
+
+    /**
+     * Count this call as an error even though no exception was thrown.
+     */
+    void failed();
+};
+
+/**
+ * Return the name used for the supplied stage in reports.
+ *
+ * @param stage - the stage to name.
+ * @return the stage name.
+ */
+const char* stageName(Stage stage);
+
+/**
+ * Turn the counting on or off for all threads, counting is on by default.
+ *
+ * @param enabled - true to count, false to stop counting.
+ */
+void setPerformanceCountersEnabled(bool enabled);
+
+/**
+ * Add together the counters of every thread, including the threads that have
+ * finished.
+ *
+ * @return the total of all the counters.
+ */
+PerformanceCounters performanceCounters();
+
+/**
+ * Reset the counters of every thread to 0.
+ */
+void resetPerformanceCounters();
+
+/**
+ * Write the supplied counters to the supplied stream as JSON.
+ *
+ * @param out - the stream to write to.
+ * @param counters - the counters to write.
+ */
+void writePerformanceCountersJson(std::ostream& out,
+        const PerformanceCounters& counters);
+
+/**
+ * Return the current total of the counters as JSON.
+ *
+ * @return the counters as a JSON document.
+ */
+std::string performanceCountersJson();
+
+/**
+ * @return the current value of the monotonic clock in nanoseconds.
+ */
+uint64_t monotonicNanoseconds();
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __COUNTERS_HPP__ */
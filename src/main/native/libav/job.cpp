@@ -0,0 +1,73 @@
+/*
+ * job.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#include <libav/job.hpp>
+
+#include <cstddef>
+
+using namespace std;
+
+
+/**
+ * @file job.cpp
+ *
+ * The implementation of the job.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+/**
+ * The job bound to each thread. This is read for every packet and frame so it is
+ * a plain thread local instead of a <code>boost::thread_specific_ptr</code>, a
+ * thread never owns the job it is bound to so nothing has to be cleaned up.
+ */
+static __thread Job *threadJob = NULL;
+
+
+Job::Job(int64_t memoryBudget) : _memory(&processMemoryAccount(), memoryBudget),
+        _progress(), _cancellation() {
+}
+
+MemoryAccount& Job::memory() {
+
+    return _memory;
+}
+
+Progress& Job::progress() {
+
+    return _progress;
+}
+
+CancellationToken& Job::cancellation() {
+
+    return _cancellation;
+}
+
+ScopedJob::ScopedJob(Job *job) : _previous(threadJob) {
+
+    threadJob = job;
+}
+
+ScopedJob::~ScopedJob() {
+
+    threadJob = _previous;
+}
+
+Job* currentJob() {
+
+    return threadJob;
+}
+
+MemoryAccount& currentMemoryAccount() {
+
+    return NULL == threadJob ? processMemoryAccount() : threadJob->memory();
+}
+
+} /* namespace libav */
+} /* namespace transcode */
@@ -0,0 +1,118 @@
+/*
+ * job.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __JOB_HPP__
+#define __JOB_HPP__
+
+#include <libav/cancellation.hpp>
+#include <libav/memory.hpp>
+#include <libav/progress.hpp>
+
+/**
+ * @file job.hpp
+ *
+ * A job is a single transcode. The libav functions find the job they are working
+ * for through the calling thread, so a job has to be bound to every thread that
+ * works on it with a <code>ScopedJob</code>.
+ */
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * The state shared by all the work done for a single transcode.
+ */
+class Job {
+
+private:
+    MemoryAccount _memory;
+    Progress _progress;
+    CancellationToken _cancellation;
+
+    Job(Job const&); // Should not be implemented.
+
+    void operator=(Job const&); // Should not be implemented.
+
+public:
+    /**
+     * Instantiate a new <code>Job</code>.
+     *
+     * @param memoryBudget - the number of bytes the job may hold before the
+     *      stages that read ahead are paused, or <code>UNLIMITED_MEMORY</code>.
+     */
+    explicit Job(int64_t memoryBudget = UNLIMITED_MEMORY);
+
+    /**
+     * @return the account of the memory held by this job, its parent is the
+     *      process account.
+     */
+    MemoryAccount& memory();
+
+    /**
+     * @return the progress of this job through its input.
+     */
+    Progress& progress();
+
+    /**
+     * @return the token that cancels this job or gives it a deadline.
+     */
+    CancellationToken& cancellation();
+};
+
+/**
+ * Binds a job to the calling thread for as long as it is in scope. Scoped jobs
+ * can be nested, the job that was bound before is bound again when the inner
+ * one goes out of scope.
+ */
+class ScopedJob {
+
+private:
+    Job *_previous;
+
+    ScopedJob(ScopedJob const&); // Should not be implemented.
+
+    void operator=(ScopedJob const&); // Should not be implemented.
+
+public:
+    /**
+     * Bind the supplied job to the calling thread.
+     *
+     * @param job - the job to bind, or NULL to unbind the current job.
+     */
+    explicit ScopedJob(Job *job);
+
+    /**
+     * Bind the job that was bound before this one.
+     */
+    ~ScopedJob();
+};
+
+/**
+ * @return the job bound to the calling thread, or NULL if there isn't one.
+ */
+Job* currentJob();
+
+/**
+ * @return the memory account of the job bound to the calling thread, or the
+ *      process account if there isn't one.
+ */
+MemoryAccount& currentMemoryAccount();
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __JOB_HPP__ */
@@ -0,0 +1,1013 @@
+/*
+ * ladder.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+#include "libavutil/mathematics.h"
+#include "libswscale/swscale.h"
+}
+
+#include <error.hpp>
+#include <libav/cancellation.hpp>
+#include <libav/job.hpp>
+#include <libav/ladder.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+#include <libav/memory.hpp>
+#include <libav/segmenter.hpp>
+#include <libav/trace.hpp>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <deque>
+
+using namespace std;
+
+
+/**
+ * @file ladder.cpp
+ *
+ * The implementation of the ladder.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+// The planes of a shared decoder buffer are aligned to at least this many bytes.
+static const int PLANE_ALIGN = 32;
+
+/**
+ * The memory behind the planes of a shared frame, charged to the memory account
+ * of the job that decoded it until the last frame that uses it is freed.
+ */
+class FrameBuffer {
+
+private:
+    FrameBuffer(FrameBuffer const&); // Should not be implemented.
+
+    void operator=(FrameBuffer const&); // Should not be implemented.
+
+    MemoryAccount *_account;
+    int64_t _bytes;
+
+public:
+    uint8_t *planes[AV_NUM_DATA_POINTERS];
+
+    explicit FrameBuffer(MemoryAccount *account) : _account(account), _bytes(0) {
+
+        fill(planes, planes + AV_NUM_DATA_POINTERS, static_cast<uint8_t*>(NULL));
+    }
+
+    ~FrameBuffer() {
+
+        for (int i = 0; i < AV_NUM_DATA_POINTERS; i++) av_free(planes[i]);
+
+        _account->release(_bytes);
+    }
+
+    /**
+     * Allocate the supplied plane.
+     *
+     * @return the plane, or NULL if it couldn't be allocated.
+     */
+    uint8_t* allocate(int plane, size_t bytes) {
+
+        planes[plane] = static_cast<uint8_t*>(av_malloc(bytes));
+
+        if (NULL == planes[plane]) return NULL;
+
+        _bytes += bytes;
+
+        _account->charge(bytes);
+
+        return planes[plane];
+    }
+};
+
+typedef boost::shared_ptr<FrameBuffer> FrameBufferPtr;
+
+/**
+ * A decoded frame shared read only by every branch of the ladder.
+ */
+struct SharedFrame {
+
+    AVPicture picture;
+    int width;
+    int height;
+    PixelFormat pixelFormat;
+
+    /**
+     * The position of the frame in the decode, which every branch uses as its
+     * presentation time.
+     */
+    int64_t index;
+
+    FrameBufferPtr buffer;
+};
+
+typedef boost::shared_ptr<const SharedFrame> SharedFramePtr;
+
+/**
+ * @return true if the decoder can decode the supplied pixel format into a
+ *      shared buffer.
+ */
+static bool isSharedFormat(PixelFormat pixelFormat) {
+
+    return PIX_FMT_YUV420P == pixelFormat || PIX_FMT_YUVJ420P == pixelFormat;
+}
+
+/**
+ * The get_buffer callback of a ladder decoder. Pictures are decoded into buffers
+ * the ladder owns, so a picture can go on being shared after the decoder has
+ * released it. Each picture holds a reference to its buffer in its opaque.
+ */
+static int getSharedBuffer(AVCodecContext *codecContext, AVFrame *frame) {
+
+    if (!isSharedFormat(codecContext->pix_fmt)) {
+
+        return avcodec_default_get_buffer(codecContext, frame);
+    }
+
+    try {
+
+        int width = codecContext->width;
+        int height = codecContext->height;
+        int strideAlign[AV_NUM_DATA_POINTERS];
+
+        avcodec_align_dimensions2(codecContext, &width, &height, strideAlign);
+
+        // Decoders that draw past the edges of the picture need the room to do so.
+        int edge = 0 != (codecContext->flags & CODEC_FLAG_EMU_EDGE) ? 0
+                : avcodec_get_edge_width();
+
+        FrameBufferPtr buffer(new FrameBuffer(
+                static_cast<MemoryAccount*>(codecContext->opaque)));
+
+        for (int plane = 0; plane < 3; plane++) {
+
+            int shift = 0 == plane ? 0 : 1;
+            int align = max(PLANE_ALIGN, strideAlign[plane]);
+            int planeEdge = edge >> shift;
+            int lineSize = FFALIGN(((width + 2 * edge) >> shift) + align, align);
+            int lines = ((height + 2 * edge) >> shift) + 1;
+
+            uint8_t *data = buffer->allocate(plane, lineSize * lines + align);
+
+            if (NULL == data) return AVERROR(ENOMEM);
+
+            frame->data[plane] = data + FFALIGN(lineSize * planeEdge + planeEdge, align);
+            frame->linesize[plane] = lineSize;
+        }
+
+        frame->opaque = new FrameBufferPtr(buffer);
+
+    } catch (const exception&) {
+
+        return AVERROR(ENOMEM);
+    }
+
+    frame->type = FF_BUFFER_TYPE_USER;
+    frame->reordered_opaque = codecContext->reordered_opaque;
+    frame->format = codecContext->pix_fmt;
+    frame->width = codecContext->width;
+    frame->height = codecContext->height;
+
+    // The packet of the codec context isn't the one a threaded decoder is
+    // decoding, and the ladder numbers its frames itself.
+    frame->pkt_pts = AV_NOPTS_VALUE;
+
+    return 0;
+}
+
+/**
+ * The release_buffer callback of a ladder decoder, the decoder gives up its
+ * reference to the buffer but any frame still shared keeps it.
+ */
+static void releaseSharedBuffer(AVCodecContext *codecContext, AVFrame *frame) {
+
+    if (FF_BUFFER_TYPE_USER != frame->type) {
+
+        avcodec_default_release_buffer(codecContext, frame);
+
+        return;
+    }
+
+    delete static_cast<FrameBufferPtr*>(frame->opaque);
+
+    frame->opaque = NULL;
+
+    fill(frame->data, frame->data + AV_NUM_DATA_POINTERS, static_cast<uint8_t*>(NULL));
+}
+
+/**
+ * A bounded queue of shared frames from the decode to one branch.
+ */
+class FrameQueue {
+
+private:
+    FrameQueue(FrameQueue const&); // Should not be implemented.
+
+    void operator=(FrameQueue const&); // Should not be implemented.
+
+    size_t _maxFrames;
+    deque<SharedFramePtr> _frames;
+    bool _finished;
+    bool _closed;
+
+    boost::mutex _mutex;
+    boost::condition_variable _frameAvailable;
+    boost::condition_variable _spaceAvailable;
+
+public:
+    explicit FrameQueue(size_t maxFrames) : _maxFrames(maxFrames), _frames(),
+            _finished(false), _closed(false), _mutex(), _frameAvailable(),
+            _spaceAvailable() {
+    }
+
+    /**
+     * Add the supplied frame, waiting while the queue is full.
+     *
+     * @return false if the branch has stopped taking frames.
+     */
+    bool push(const SharedFramePtr& frame) {
+
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+
+            if (!_closed && _maxFrames <= _frames.size()) {
+
+                TraceSpan span("ladderQueueFullWait");
+
+                while (!_closed && _maxFrames <= _frames.size()) _spaceAvailable.wait(lock);
+            }
+
+            if (_closed) return false;
+
+            _frames.push_back(frame);
+        }
+
+        _frameAvailable.notify_one();
+
+        return true;
+    }
+
+    /**
+     * Take the next frame, waiting while the queue is empty.
+     *
+     * @return false once the decode has finished and every frame has been taken.
+     */
+    bool pop(SharedFramePtr& frame) {
+
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+
+            while (!_finished && !_closed && _frames.empty()) _frameAvailable.wait(lock);
+
+            if (_frames.empty()) return false;
+
+            frame = _frames.front();
+
+            _frames.pop_front();
+        }
+
+        _spaceAvailable.notify_one();
+
+        return true;
+    }
+
+    /**
+     * There are no more frames to come.
+     */
+    void finish() {
+
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+
+            _finished = true;
+        }
+
+        _frameAvailable.notify_all();
+    }
+
+    /**
+     * The branch has stopped taking frames, drop the frames waiting for it so
+     * their buffers can be freed.
+     */
+    void close() {
+
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+
+            _closed = true;
+
+            _frames.clear();
+        }
+
+        _spaceAvailable.notify_all();
+        _frameAvailable.notify_all();
+    }
+};
+
+/**
+ * Scales and encodes the shared frames for one rendition and writes them out.
+ * Everything is opened on the calling thread so a rendition that can't be
+ * encoded fails before anything is decoded, only <code>run</code> is called
+ * on the branch's own thread.
+ */
+class LadderBranch {
+
+private:
+    LadderBranch(LadderBranch const&); // Should not be implemented.
+
+    void operator=(LadderBranch const&); // Should not be implemented.
+
+    const LadderOptions *_options;
+    AVFormatContext *_output;
+    SegmentWriter *_segments;
+    AVCodecContext *_encoder;
+    bool _encoderOpened;
+    SwsContext *_scaleContext;
+    AVFrame *_scaled;
+
+    /**
+     * Write the supplied encoded packet to the output.
+     */
+    void write(AVPacket *packet) {
+
+        if (NULL != _segments) {
+
+            // The segment writer rescales the timestamps itself.
+            packet->stream_index = 0;
+
+            _segments->writePacket(packet);
+
+            return;
+        }
+
+        AVRational timeBase = _output->streams[0]->time_base;
+
+        if (AV_NOPTS_VALUE != packet->pts) {
+
+            packet->pts = av_rescale_q(packet->pts, _encoder->time_base, timeBase);
+        }
+
+        if (AV_NOPTS_VALUE != packet->dts) {
+
+            packet->dts = av_rescale_q(packet->dts, _encoder->time_base, timeBase);
+        }
+
+        packet->stream_index = 0;
+
+        writePacket(_output, packet);
+    }
+
+    /**
+     * Encode the supplied frame, scaling it first if the rendition is a
+     * different size or pixel format.
+     */
+    void encode(const SharedFrame& frame) {
+
+        AVFrame picture;
+
+        avcodec_get_frame_defaults(&picture);
+
+        if (frame.width == _encoder->width && frame.height == _encoder->height
+                && frame.pixelFormat == _encoder->pix_fmt) {
+
+            // The encoder only reads the picture, so it is encoded in place.
+            copy(frame.picture.data, frame.picture.data + 4, picture.data);
+            copy(frame.picture.linesize, frame.picture.linesize + 4, picture.linesize);
+
+        } else {
+
+            _scaleContext = sws_getCachedContext(_scaleContext,
+                    frame.width, frame.height, frame.pixelFormat,
+                    _encoder->width, _encoder->height, _encoder->pix_fmt,
+                    SWS_BILINEAR, NULL, NULL, NULL);
+
+            if (NULL == _scaleContext) {
+
+                throw CodecException("Could not scale the video to the size of the rendition.");
+            }
+
+            sws_scale(_scaleContext, frame.picture.data, frame.picture.linesize, 0,
+                    frame.height, _scaled->data, _scaled->linesize);
+
+            copy(_scaled->data, _scaled->data + 4, picture.data);
+            copy(_scaled->linesize, _scaled->linesize + 4, picture.linesize);
+        }
+
+        picture.pts = frame.index;
+
+        if (0 == frame.index % _options->keyFrameInterval) {
+
+            picture.pict_type = AV_PICTURE_TYPE_I;
+        }
+
+        AVPacket *packet = encodeVideoFrame(_encoder, &picture);
+
+        if (NULL == packet) return;
+
+        try {
+
+            write(packet);
+
+        } catch (...) {
+
+            freePacket(&packet);
+
+            throw;
+        }
+
+        freePacket(&packet);
+
+        framesEncoded++;
+    }
+
+    /**
+     * Write out the packets an encoder with a delay is still holding.
+     */
+    void flush() {
+
+        if (0 == (_encoder->codec->capabilities & CODEC_CAP_DELAY)) return;
+
+        while (true) {
+
+            AVPacket packet;
+
+            av_init_packet(&packet);
+
+            packet.data = NULL;
+            packet.size = 0;
+
+            int packetEncoded = 0;
+
+            int errorCode = avcodec_encode_video2(_encoder, &packet, NULL, &packetEncoded);
+
+            if (0 > errorCode) throw CodecException(errorMessage(errorCode));
+
+            if (0 == packetEncoded) return;
+
+            try {
+
+                write(&packet);
+
+            } catch (...) {
+
+                av_free_packet(&packet);
+
+                throw;
+            }
+
+            av_free_packet(&packet);
+
+            framesEncoded++;
+        }
+    }
+
+public:
+    FrameQueue queue;
+    int64_t framesEncoded;
+    string error;
+
+    LadderBranch(const Rendition& rendition, const AVStream *input,
+            const LadderOptions& options) : _options(&options), _output(NULL),
+            _segments(NULL), _encoder(NULL), _encoderOpened(false), _scaleContext(NULL), _scaled(NULL),
+            queue(options.queueFrames), framesEncoded(0), error() {
+
+        const AVCodecContext *decoder = input->codec;
+
+        AVCodec *codec = avcodec_find_encoder_by_name(rendition.encoderName.c_str());
+
+        if (NULL == codec) {
+
+            throw CodecException("Could not find the " + rendition.encoderName + " encoder.");
+        }
+
+        int width = 0 < rendition.width ? rendition.width : decoder->width;
+        int height = 0 < rendition.height ? rendition.height
+                : static_cast<int>(av_rescale(width, decoder->height, decoder->width));
+
+        try {
+
+            if (rendition.segmentDirectory.empty()) {
+
+                _output = openOutputFormatContext(rendition.fileName, rendition.formatName);
+
+            } else {
+
+                SegmentOptions segmentOptions;
+
+                segmentOptions.directory = rendition.segmentDirectory;
+                segmentOptions.segmentMilliseconds = options.segmentMilliseconds;
+
+                _segments = new SegmentWriter(segmentOptions);
+            }
+
+            _encoder = avcodec_alloc_context3(codec);
+
+            if (NULL == _encoder) throw IllegalStateException("Could not allocate an encoder.");
+
+            // The chroma planes of most encoders are half the size of the picture.
+            _encoder->width = max(2, width & ~1);
+            _encoder->height = max(2, height & ~1);
+            _encoder->pix_fmt = NULL != codec->pix_fmts ? codec->pix_fmts[0] : PIX_FMT_YUV420P;
+            _encoder->gop_size = options.keyFrameInterval;
+
+            if (0 < rendition.bitRate) _encoder->bit_rate = rendition.bitRate;
+
+            _encoder->time_base.num = 1;
+            _encoder->time_base.den = 25;
+
+            if (0 < input->r_frame_rate.num && 0 < input->r_frame_rate.den) {
+
+                _encoder->time_base.num = input->r_frame_rate.den;
+                _encoder->time_base.den = input->r_frame_rate.num;
+            }
+
+            if (NULL != _output && 0 != (_output->oformat->flags & AVFMT_GLOBALHEADER)) {
+
+                _encoder->flags |= CODEC_FLAG_GLOBAL_HEADER;
+            }
+
+            openEncodeCodecContext(_encoder);
+
+            _encoderOpened = true;
+
+            if (NULL != _segments) {
+
+                _segments->addStream(_encoder, _encoder->time_base);
+
+            } else {
+
+                addOutputStream(_output, _encoder);
+
+                writeOutputHeader(_output);
+            }
+
+            _scaled = avcodec_alloc_frame();
+
+            if (NULL == _scaled || 0 > avpicture_alloc(reinterpret_cast<AVPicture*>(_scaled),
+                    _encoder->pix_fmt, _encoder->width, _encoder->height)) {
+
+                throw IllegalStateException("Could not allocate a picture to scale into.");
+            }
+
+        } catch (...) {
+
+            release();
+
+            throw;
+        }
+    }
+
+    ~LadderBranch() {
+
+        release();
+    }
+
+    /**
+     * Encode the frames of the queue until the decode has finished, any error is
+     * kept in <code>error</code>.
+     */
+    void run() {
+
+        TraceSpan span("ladderBranch");
+
+        try {
+
+            SharedFramePtr frame;
+
+            while (queue.pop(frame)) {
+
+                encode(*frame);
+
+                // Let the buffer go as soon as this branch is done with it.
+                frame.reset();
+            }
+
+            flush();
+
+        } catch (const exception& e) {
+
+            error = e.what();
+
+            queue.close();
+
+        } catch (...) {
+
+            error = UNKNOWN;
+
+            queue.close();
+        }
+    }
+
+    /**
+     * Write the trailer and close the output of a branch that ran successfully,
+     * or finish its last segment and its playlist.
+     */
+    void close() {
+
+        if (NULL != _segments) _segments->finish();
+        else closeOutputFormatContext(&_output);
+    }
+
+    /**
+     * Free everything that is still held.
+     */
+    void release() {
+
+        if (NULL != _scaleContext) {
+
+            sws_freeContext(_scaleContext);
+
+            _scaleContext = NULL;
+        }
+
+        if (NULL != _scaled) {
+
+            avpicture_free(reinterpret_cast<AVPicture*>(_scaled));
+
+            av_free(_scaled);
+
+            _scaled = NULL;
+        }
+
+        // The segment writer copies the codec parameters of the encoder.
+        delete _segments;
+
+        _segments = NULL;
+
+        try {
+
+            if (NULL != _encoder) {
+
+                AVCodecContext *encoder = _encoder;
+
+                _encoder = NULL;
+
+                if (_encoderOpened) closeCodecContext(&encoder);
+
+                av_free(encoder);
+            }
+
+            if (NULL != _output) closeOutputFormatContext(&_output);
+
+        } catch (const exception&) {
+
+            // There is nothing more that can be done for a branch that failed.
+        }
+    }
+};
+
+/**
+ * Runs a branch on its own thread for the job that encodes the ladder.
+ */
+struct BranchWorker {
+
+    LadderBranch *branch;
+    Job *job;
+
+    void operator()() const {
+
+        ScopedJob scopedJob(job);
+
+        branch->run();
+    }
+};
+
+/**
+ * The decoder of the ladder, which decodes into shared buffers where it can.
+ */
+class LadderDecoder {
+
+private:
+    LadderDecoder(LadderDecoder const&); // Should not be implemented.
+
+    void operator=(LadderDecoder const&); // Should not be implemented.
+
+public:
+    AVFormatContext *formatContext;
+    int streamIndex;
+    AVCodecContext *codecContext;
+
+    explicit LadderDecoder(const string& fileName) : formatContext(NULL), streamIndex(-1),
+            codecContext(NULL) {
+
+        formatContext = openFormatContext(fileName);
+
+        for (unsigned int i = 0; i < formatContext->nb_streams && 0 > streamIndex; i++) {
+
+            if (AVMEDIA_TYPE_VIDEO == findStreamType(formatContext->streams[i])) streamIndex = i;
+        }
+
+        if (0 > streamIndex) {
+
+            closeFormatContext(&formatContext);
+
+            throw IllegalStateException("There is no video stream to encode a ladder from.");
+        }
+
+        AVCodecContext *parameters = stream()->codec;
+
+        if (0 >= parameters->width || 0 >= parameters->height) {
+
+            closeFormatContext(&formatContext);
+
+            throw IllegalStateException("The size of the video is not known.");
+        }
+
+        AVCodec *codec = avcodec_find_decoder(parameters->codec_id);
+
+        // Only decoders that can decode into buffers they don't own are given
+        // shared buffers, the frames of the others are copied once instead.
+        if (NULL != codec && 0 != (codec->capabilities & CODEC_CAP_DR1)) {
+
+            parameters->get_buffer = getSharedBuffer;
+            parameters->release_buffer = releaseSharedBuffer;
+            parameters->thread_safe_callbacks = 1;
+            parameters->opaque = &currentMemoryAccount();
+        }
+
+        try {
+
+            codecContext = openDecodeCodecContext(parameters);
+
+        } catch (...) {
+
+            closeFormatContext(&formatContext);
+
+            throw;
+        }
+    }
+
+    ~LadderDecoder() {
+
+        try {
+
+            if (NULL != codecContext) closeCodecContext(&codecContext);
+
+        } catch (const exception&) {
+
+            // The format context still has to be closed.
+        }
+
+        closeFormatContext(&formatContext);
+    }
+
+    AVStream* stream() const {
+
+        return formatContext->streams[streamIndex];
+    }
+
+    /**
+     * Share the supplied decoded frame, copying it out of the decoder if it
+     * wasn't decoded into a shared buffer.
+     *
+     * @param copied - set to true if the frame was copied.
+     */
+    SharedFramePtr share(const AVFrame *frame, int64_t index, bool *copied) const {
+
+        boost::shared_ptr<SharedFrame> shared(new SharedFrame());
+
+        shared->width = codecContext->width;
+        shared->height = codecContext->height;
+        shared->pixelFormat = codecContext->pix_fmt;
+        shared->index = index;
+
+        if (FF_BUFFER_TYPE_USER == frame->type && NULL != frame->opaque) {
+
+            shared->buffer = *static_cast<const FrameBufferPtr*>(frame->opaque);
+
+            copy(frame->data, frame->data + 4, shared->picture.data);
+            copy(frame->linesize, frame->linesize + 4, shared->picture.linesize);
+
+            *copied = false;
+
+            return shared;
+        }
+
+        shared->buffer.reset(new FrameBuffer(&currentMemoryAccount()));
+
+        int bytes = avpicture_get_size(shared->pixelFormat, shared->width, shared->height);
+
+        uint8_t *data = 0 < bytes ? shared->buffer->allocate(0, bytes) : NULL;
+
+        if (NULL == data) throw IllegalStateException("Could not allocate a shared frame.");
+
+        avpicture_fill(&shared->picture, data, shared->pixelFormat, shared->width,
+                shared->height);
+
+        av_picture_copy(&shared->picture, reinterpret_cast<const AVPicture*>(frame),
+                shared->pixelFormat, shared->width, shared->height);
+
+        *copied = true;
+
+        return shared;
+    }
+};
+
+/**
+ * Hand the supplied decoded frame to every branch that is still taking frames.
+ *
+ * @return false if no branch is taking frames any more.
+ */
+static bool publish(const LadderDecoder& decoder, const AVFrame *frame,
+        vector<boost::shared_ptr<LadderBranch> >& branches, LadderResult& result) {
+
+    bool copied = false;
+
+    SharedFramePtr shared = decoder.share(frame, result.framesDecoded, &copied);
+
+    result.framesDecoded++;
+
+    if (copied) result.framesCopied++;
+
+    bool taken = false;
+
+    for (size_t i = 0; i < branches.size(); i++) {
+
+        if (branches[i]->queue.push(shared)) taken = true;
+    }
+
+    return taken;
+}
+
+/**
+ * Decode every frame of the video and hand them to the branches.
+ */
+static void decodeLadder(LadderDecoder& decoder,
+        vector<boost::shared_ptr<LadderBranch> >& branches, LadderResult& result) {
+
+    TraceSpan span("ladderDecode");
+
+    bool taken = true;
+
+    while (taken) {
+
+        AVPacket *packet = readNextPacket(decoder.formatContext);
+
+        if (NULL == packet) break;
+
+        if (decoder.streamIndex == packet->stream_index) {
+
+            AVFrame *frame = NULL;
+
+            result.decodeErrors.add(tryDecodeVideoPacket(decoder.codecContext, packet, &frame));
+
+            if (NULL != frame) {
+
+                try {
+
+                    taken = publish(decoder, frame, branches, result);
+
+                } catch (...) {
+
+                    freeFrame(&frame);
+                    freePacket(&packet);
+
+                    throw;
+                }
+
+                freeFrame(&frame);
+            }
+        }
+
+        freePacket(&packet);
+    }
+
+    // A decoder with a delay still holds the last frames.
+    while (taken && 0 != (decoder.codecContext->codec->capabilities & CODEC_CAP_DELAY)) {
+
+        AVPacket flush;
+
+        av_init_packet(&flush);
+
+        flush.data = NULL;
+        flush.size = 0;
+
+        AVFrame *frame = NULL;
+
+        result.decodeErrors.add(tryDecodeVideoPacket(decoder.codecContext, &flush, &frame));
+
+        if (NULL == frame) break;
+
+        try {
+
+            taken = publish(decoder, frame, branches, result);
+
+        } catch (...) {
+
+            freeFrame(&frame);
+
+            throw;
+        }
+
+        freeFrame(&frame);
+    }
+}
+
+
+LadderResult encodeLadder(const string& fileName, const vector<Rendition>& renditions,
+        const LadderOptions& options) {
+
+    if (renditions.empty()) {
+
+        throw IllegalArgumentException("A ladder must have at least one rendition.");
+    }
+
+    if (0 >= options.keyFrameInterval || 0 >= options.queueFrames
+            || 0 >= options.segmentMilliseconds) {
+
+        throw IllegalArgumentException(
+                "The key frame interval, queue size and segment length of a ladder must be positive.");
+    }
+
+    for (size_t i = 0; i < renditions.size(); i++) {
+
+        if ((renditions[i].fileName.empty() && renditions[i].segmentDirectory.empty())
+                || 0 > renditions[i].width
+                || 0 > renditions[i].height || 0 > renditions[i].bitRate) {
+
+            throw IllegalArgumentException(
+                    "A rendition must have a file name or segment directory and its size and bit rate can't be negative.");
+        }
+    }
+
+    LadderDecoder decoder(fileName);
+
+    vector<boost::shared_ptr<LadderBranch> > branches;
+
+    for (size_t i = 0; i < renditions.size(); i++) {
+
+        branches.push_back(boost::shared_ptr<LadderBranch>(
+                new LadderBranch(renditions[i], decoder.stream(), options)));
+    }
+
+    LadderResult result;
+
+    boost::thread_group workers;
+
+    for (size_t i = 0; i < branches.size(); i++) {
+
+        BranchWorker worker = { branches[i].get(), currentJob() };
+
+        workers.create_thread(worker);
+    }
+
+    string decodeError;
+
+    try {
+
+        decodeLadder(decoder, branches, result);
+
+    } catch (const exception& e) {
+
+        decodeError = e.what();
+
+    } catch (...) {
+
+        decodeError = UNKNOWN;
+    }
+
+    for (size_t i = 0; i < branches.size(); i++) {
+
+        if (decodeError.empty()) branches[i]->queue.finish();
+        else branches[i]->queue.close();
+    }
+
+    workers.join_all();
+
+    if (!decodeError.empty()) {
+
+        // The decode only keeps the message, so a cancelled job is told apart here.
+        throwIfCancelled();
+
+        throw Exception(decodeError);
+    }
+
+    for (size_t i = 0; i < branches.size(); i++) {
+
+        if (!branches[i]->error.empty()) throw Exception(branches[i]->error);
+
+        branches[i]->close();
+
+        result.framesEncoded.push_back(branches[i]->framesEncoded);
+    }
+
+    return result;
+}
+
+} /* namespace libav */
+} /* namespace transcode */
@@ -0,0 +1,188 @@
+/*
+ * ladder.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __LADDER_HPP__
+#define __LADDER_HPP__
+
+#include <libav/libav.hpp>
+#include <libav/segmenter.hpp>
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @file ladder.hpp
+ *
+ * An adaptive bitrate ladder encoded from a single decode. The first video
+ * stream of the input is decoded once on the calling thread and every decoded
+ * frame is handed to one branch per rendition, each of which scales and encodes
+ * it on its own thread into its own output file.
+ *
+ * The frames are shared between the branches read only and freed once the last
+ * branch is done with them. Decoders that can decode into buffers they don't
+ * own decode straight into the shared frames, the frames of any other decoder
+ * are copied out of the decoder once, however many renditions there are.
+ *
+ * A rendition can be written as segments and a playlist instead of a single
+ * file, the segments of every rendition start at the same frames as long as the
+ * segment length is a whole number of key frame intervals.
+ */
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * The default number of frames each rendition can fall behind the decode.
+ */
+const size_t DEFAULT_LADDER_QUEUE_FRAMES = 8;
+
+/**
+ * The default number of frames between the key frames of every rendition.
+ */
+const int DEFAULT_LADDER_KEY_FRAME_INTERVAL = 48;
+
+/**
+ * One rendition of the ladder, the video is written on its own to the output file.
+ */
+struct Rendition {
+
+    /**
+     * The path of the output file.
+     */
+    std::string fileName;
+
+    /**
+     * The directory to write the rendition to as MPEG-TS segments and an HLS
+     * playlist, or empty to write it to the output file.
+     */
+    std::string segmentDirectory;
+
+    /**
+     * The short name of the container format, or empty to guess it from the
+     * file name.
+     */
+    std::string formatName;
+
+    /**
+     * The name of the encoder.
+     */
+    std::string encoderName;
+
+    /**
+     * The width in pixels, or 0 to keep the width of the video.
+     */
+    int width;
+
+    /**
+     * The height in pixels, or 0 to keep the aspect ratio of the video.
+     */
+    int height;
+
+    /**
+     * The bit rate in bits per second, or 0 for the default of the encoder.
+     */
+    int bitRate;
+
+    Rendition() : fileName(), segmentDirectory(), formatName(), encoderName("mpeg4"),
+            width(0), height(0), bitRate(0) {
+    }
+
+    Rendition(const std::string& fileName, int width, int height, int bitRate) :
+            fileName(fileName), segmentDirectory(), formatName(), encoderName("mpeg4"),
+            width(width), height(height), bitRate(bitRate) {
+    }
+};
+
+/**
+ * How the ladder is encoded.
+ */
+struct LadderOptions {
+
+    /**
+     * The number of frames between key frames. Every rendition has a key frame
+     * at the same frames, so a player can switch between them at any of them.
+     */
+    int keyFrameInterval;
+
+    /**
+     * The number of decoded frames each rendition can fall behind before the
+     * decode waits for it.
+     */
+    size_t queueFrames;
+
+    /**
+     * The length of the segments of the renditions that are written as segments.
+     */
+    int64_t segmentMilliseconds;
+
+    LadderOptions() : keyFrameInterval(DEFAULT_LADDER_KEY_FRAME_INTERVAL),
+            queueFrames(DEFAULT_LADDER_QUEUE_FRAMES),
+            segmentMilliseconds(DEFAULT_SEGMENT_MILLISECONDS) {
+    }
+};
+
+/**
+ * What was done to encode a ladder.
+ */
+struct LadderResult {
+
+    /**
+     * The number of frames decoded from the input.
+     */
+    int64_t framesDecoded;
+
+    /**
+     * The number of decoded frames that had to be copied out of the decoder
+     * to be shared, because it couldn't decode straight into a shared frame.
+     */
+    int64_t framesCopied;
+
+    /**
+     * The number of frames encoded for each rendition, in the order of the
+     * renditions.
+     */
+    std::vector<int64_t> framesEncoded;
+
+    /**
+     * The number of packets of the input that failed to decode and were
+     * skipped.
+     */
+    DecodeErrorCounts decodeErrors;
+
+    LadderResult() : framesDecoded(0), framesCopied(0), framesEncoded(), decodeErrors() {
+    }
+};
+
+/**
+ * Decode the first video stream of the supplied file once and encode it as each
+ * of the supplied renditions in parallel.
+ *
+ * @param fileName - the path to the media file.
+ * @param renditions - the renditions to encode.
+ * @param options - how the ladder is encoded.
+ * @return what was done to encode the ladder.
+ */
+LadderResult encodeLadder(const std::string& fileName,
+        const std::vector<Rendition>& renditions,
+        const LadderOptions& options = LadderOptions());
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __LADDER_HPP__ */
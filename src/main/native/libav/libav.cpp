@@ -8,18 +8,33 @@
 extern "C" {
 #include "libavformat/avformat.h"
 #include "libavcodec/avcodec.h"
+#include "libavutil/dict.h"
 #include "libavutil/error.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/samplefmt.h"
 }
 
 #include <error.hpp>
+#include <libav/cancellation.hpp>
+#include <libav/counters.hpp>
+#include <libav/job.hpp>
 #include <libav/libav.hpp>
 #include <libav/libaverror.hpp>
+#include <libav/memory.hpp>
+#include <libav/trace.hpp>
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
 #include <sstream>
 #include <iostream>
 
 #include <tr1/functional>
 
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+
 using namespace std;
 
 
@@ -34,9 +49,556 @@ namespace transcode {
 namespace libav {
 
 /**
- * The buffer size of a decoded packet, this is hopefully big enough for any packet.
+ * The decode failures seen by this process, these are only touched when a decode
+ * fails so they add nothing to the cost of a successful decode.
+ */
+static boost::atomic<unsigned long> invalidDataCount(0);
+static boost::atomic<unsigned long> decodeFailedCount(0);
+
+/**
+ * Convert the supplied libav decode return value into a <code>DecodeResult</code>,
+ * counting it if it is a failure.
+ *
+ * @param result - the value returned by one of the avcodec_decode functions.
+ * @return the matching decode result.
+ */
+static DecodeResult toDecodeResult(const int& result) {
+
+    if (0 <= result) return DecodeResult();
+
+    if (AVERROR_INVALIDDATA == result) {
+
+        invalidDataCount.fetch_add(1, boost::memory_order_relaxed);
+
+        return DecodeResult(DECODE_INVALID_DATA, result);
+    }
+
+    decodeFailedCount.fetch_add(1, boost::memory_order_relaxed);
+
+    return DecodeResult(DECODE_FAILED, result);
+}
+
+/**
+ * Find the number of bytes of raw media held by the supplied frame.
+ *
+ * @param codecContext - the codec context the frame was decoded with or is to be
+ *      encoded with.
+ * @param frame - the frame to find the size of.
+ * @return the size of the frames media data in bytes.
+ */
+static int frameSize(const AVCodecContext *codecContext, const AVFrame *frame) {
+
+    int size = 0;
+
+    if (AVMEDIA_TYPE_AUDIO == codecContext->codec_type) {
+
+        size = av_samples_get_buffer_size(NULL, codecContext->channels,
+                frame->nb_samples, codecContext->sample_fmt, 1);
+
+    } else if (AVMEDIA_TYPE_VIDEO == codecContext->codec_type) {
+
+        size = avpicture_get_size(codecContext->pix_fmt, codecContext->width,
+                codecContext->height);
+    }
+
+    return 0 < size ? size : 0;
+}
+
+namespace locking {
+
+/**
+ * The lock manager libav uses to make <code>avcodec_open2</code> and
+ * <code>avcodec_close</code> safe to call from more than one thread at once.
+ *
+ * Exceptions can't be thrown back through libav so every failure is returned
+ * as a non zero value instead.
+ *
+ * @param mutex - where the mutex is, or is to be, stored.
+ * @param operation - the operation libav wants done with the mutex.
+ * @return 0 on success, otherwise non zero.
+ */
+static int lockManager(void **mutex, AVLockOp operation) {
+
+    try {
+
+        switch (operation) {
+
+        case AV_LOCK_CREATE:
+            *mutex = new boost::mutex();
+            return 0;
+
+        case AV_LOCK_OBTAIN:
+            static_cast<boost::mutex*>(*mutex)->lock();
+            return 0;
+
+        case AV_LOCK_RELEASE:
+            static_cast<boost::mutex*>(*mutex)->unlock();
+            return 0;
+
+        case AV_LOCK_DESTROY:
+            delete static_cast<boost::mutex*>(*mutex);
+            *mutex = NULL;
+            return 0;
+        }
+
+    } catch (...) {
+
+        // Fall through to report the failure to libav.
+    }
+
+    return 1;
+}
+
+}
+
+namespace registration {
+
+#ifdef TRANSCODE_SELECTIVE_REGISTRATION
+
+/**
+ * The kinds of component that can be registered on their own.
+ */
+enum ComponentKind {
+    DEMUXER,
+    MUXER,
+    DECODER,
+    ENCODER,
+    PARSER
+};
+
+}
+
+// The libav component definitions aren't in any public header, they are
+// declared here from the same list that builds the table below.
+extern "C" {
+#define REGISTER_DEMUXER(name, symbol) extern AVInputFormat symbol;
+#define REGISTER_MUXER(name, symbol) extern AVOutputFormat symbol;
+#define REGISTER_DECODER(name, symbol) extern AVCodec symbol;
+#define REGISTER_ENCODER(name, symbol) extern AVCodec symbol;
+#define REGISTER_PARSER(name, symbol) extern AVCodecParser symbol;
+#include <libav/registration.def>
+#undef REGISTER_DEMUXER
+#undef REGISTER_MUXER
+#undef REGISTER_DECODER
+#undef REGISTER_ENCODER
+#undef REGISTER_PARSER
+
+extern URLProtocol ff_file_protocol;
+}
+
+namespace registration {
+
+#define REGISTER_DEMUXER(name, symbol) \
+    static void register_##symbol() { av_register_input_format(&symbol); }
+#define REGISTER_MUXER(name, symbol) \
+    static void register_##symbol() { av_register_output_format(&symbol); }
+#define REGISTER_DECODER(name, symbol) \
+    static void register_##symbol() { avcodec_register(&symbol); }
+#define REGISTER_ENCODER(name, symbol) \
+    static void register_##symbol() { avcodec_register(&symbol); }
+#define REGISTER_PARSER(name, symbol) \
+    static void register_##symbol() { av_register_codec_parser(&symbol); }
+#include <libav/registration.def>
+#undef REGISTER_DEMUXER
+#undef REGISTER_MUXER
+#undef REGISTER_DECODER
+#undef REGISTER_ENCODER
+#undef REGISTER_PARSER
+
+/**
+ * A component that can be registered on its own.
+ */
+struct Component {
+
+    ComponentKind kind;
+    const char *name;
+    void (*registerComponent)();
+};
+
+/**
+ * Every component listed in registration.def.
+ */
+static const Component COMPONENTS[] = {
+#define REGISTER_DEMUXER(name, symbol) { DEMUXER, name, register_##symbol },
+#define REGISTER_MUXER(name, symbol) { MUXER, name, register_##symbol },
+#define REGISTER_DECODER(name, symbol) { DECODER, name, register_##symbol },
+#define REGISTER_ENCODER(name, symbol) { ENCODER, name, register_##symbol },
+#define REGISTER_PARSER(name, symbol) { PARSER, name, register_##symbol },
+#include <libav/registration.def>
+#undef REGISTER_DEMUXER
+#undef REGISTER_MUXER
+#undef REGISTER_DECODER
+#undef REGISTER_ENCODER
+#undef REGISTER_PARSER
+};
+
+static const size_t COMPONENT_COUNT = sizeof(COMPONENTS) / sizeof(COMPONENTS[0]);
+
+/**
+ * Find a component in the table.
+ *
+ * @param kind - the kind of component.
+ * @param name - the libav name of the component.
+ * @return the component, or NULL if it isn't in the table.
+ */
+static const Component* findComponent(ComponentKind kind, const string& name) {
+
+    for (size_t i = 0; i < COMPONENT_COUNT; i++) {
+
+        if (kind == COMPONENTS[i].kind && name == COMPONENTS[i].name) {
+
+            return &COMPONENTS[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Find every named component of one kind, so that nothing is registered if
+ * any of the names are wrong.
+ *
+ * @param kind - the kind of the components.
+ * @param kindName - the name of the kind used in the error message.
+ * @param names - the libav names of the components.
+ * @param components - the vector the components are added to.
+ */
+static void findComponents(ComponentKind kind, const char *kindName,
+        const vector<string>& names, vector<const Component*>& components) {
+
+    for (vector<string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+
+        const Component *component = findComponent(kind, *it);
+
+        if (NULL == component) {
+
+            throw IllegalArgumentException("There is no " + string(kindName)
+                    + " called '" + *it + "' that can be registered on its own.");
+        }
+
+        components.push_back(component);
+    }
+}
+
+#endif
+
+/**
+ * The components to register when the singleton is created, only ever
+ * changed by <code>initialise</code> before that happens. Guarded by
+ * <code>initialiseMutex</code>.
+ */
+static Registration pending;
+
+/**
+ * Set once the components have been picked, either by
+ * <code>initialise</code> or by the singleton being created with every
+ * component. Guarded by <code>initialiseMutex</code>.
+ */
+static bool initialised = false;
+
+/**
+ * Makes sure only one call to <code>initialise</code> gets to pick the
+ * components, and that the singleton sees the ones it picked.
+ */
+static boost::mutex initialiseMutex;
+
+/**
+ * Check that the supplied components can be registered, before libav is
+ * initialised with them.
+ *
+ * @param registration - the components to check.
+ */
+static void validate(const Registration& registration) {
+
+    if (registration.all) return;
+
+#ifdef TRANSCODE_SELECTIVE_REGISTRATION
+
+    vector<const Component*> components;
+
+    findComponents(DEMUXER, "demuxer", registration.demuxers, components);
+    findComponents(MUXER, "muxer", registration.muxers, components);
+    findComponents(DECODER, "decoder", registration.decoders, components);
+    findComponents(ENCODER, "encoder", registration.encoders, components);
+    findComponents(PARSER, "parser", registration.parsers, components);
+
+#else
+
+    throw IllegalStateException("Registering only some of the libav components "
+            "needs libav to be linked statically and TRANSCODE_SELECTIVE_REGISTRATION "
+            "to be defined.");
+
+#endif
+}
+
+/**
+ * Register the supplied components with libav.
+ *
+ * @param registration - the components to register, already validated.
+ */
+static void registerComponents(const Registration& registration) {
+
+    if (registration.all) {
+
+        avcodec_register_all();
+        av_register_all();
+
+        return;
+    }
+
+#ifdef TRANSCODE_SELECTIVE_REGISTRATION
+
+    vector<const Component*> components;
+
+    findComponents(DEMUXER, "demuxer", registration.demuxers, components);
+    findComponents(MUXER, "muxer", registration.muxers, components);
+    findComponents(DECODER, "decoder", registration.decoders, components);
+    findComponents(ENCODER, "encoder", registration.encoders, components);
+    findComponents(PARSER, "parser", registration.parsers, components);
+
+    for (size_t i = 0; i < components.size(); i++) components[i]->registerComponent();
+
+    // Every format is opened through a file name, so the file protocol is
+    // always needed.
+    av_register_protocol2(&ff_file_protocol, sizeof(URLProtocol));
+
+#endif
+}
+
+}
+
+namespace memory {
+
+/**
+ * The bytes charged for a codec context, so the same bytes can be released from
+ * the same account when it is closed even if the codec context has changed.
+ */
+struct CodecCharge {
+
+    MemoryAccount *account;
+    int64_t bytes;
+};
+
+/**
+ * Guards the codec charges, codec contexts are only opened and closed a few times
+ * per job so a single lock is fine.
+ */
+static boost::mutex codecChargesMutex;
+
+static map<const AVCodecContext*, CodecCharge> codecCharges;
+
+/**
+ * @return the bytes held by the supplied packet.
+ */
+static int64_t packetBytes(const AVPacket *packet) {
+
+    return sizeof(AVPacket) + packet->size + FF_INPUT_BUFFER_PADDING_SIZE;
+}
+
+/**
+ * Estimate the bytes held inside an open codec context. A video codec keeps
+ * its reference frames and the frames it has handed out, an audio codec keeps
+ * about one packets worth of samples.
+ *
+ * @return the estimated bytes held by the codec.
+ */
+static int64_t codecBytes(const AVCodecContext *codecContext) {
+
+    if (AVMEDIA_TYPE_AUDIO == codecContext->codec_type) return AVCODEC_MAX_AUDIO_FRAME_SIZE;
+
+    if (AVMEDIA_TYPE_VIDEO != codecContext->codec_type) return 0;
+
+    int pictureSize = avpicture_get_size(codecContext->pix_fmt, codecContext->width,
+            codecContext->height);
+
+    if (0 >= pictureSize) return 0;
+
+    int frames = max(codecContext->refs, 1) + codecContext->has_b_frames
+            + max(codecContext->thread_count, 1) + 1;
+
+    return static_cast<int64_t>(pictureSize) * frames;
+}
+
+/**
+ * Charge the estimated internals of a codec context that has just been opened to
+ * the job bound to the calling thread.
+ */
+static void chargeCodec(const AVCodecContext *codecContext) {
+
+    CodecCharge charge = { &currentMemoryAccount(), codecBytes(codecContext) };
+
+    charge.account->charge(charge.bytes);
+
+    boost::mutex::scoped_lock lock(codecChargesMutex);
+
+    map<const AVCodecContext*, CodecCharge>::iterator previous =
+            codecCharges.find(codecContext);
+
+    // A codec context that was freed without being closed can leave a charge
+    // behind for a new codec context at the same address.
+    if (codecCharges.end() != previous) {
+
+        previous->second.account->release(previous->second.bytes);
+    }
+
+    codecCharges[codecContext] = charge;
+}
+
+/**
+ * Release the charge of a codec context that is being closed, if it has one.
+ */
+static void releaseCodec(const AVCodecContext *codecContext) {
+
+    boost::mutex::scoped_lock lock(codecChargesMutex);
+
+    map<const AVCodecContext*, CodecCharge>::iterator charge =
+            codecCharges.find(codecContext);
+
+    if (codecCharges.end() == charge) return;
+
+    charge->second.account->release(charge->second.bytes);
+
+    codecCharges.erase(charge);
+}
+
+}
+
+namespace interruption {
+
+/**
+ * The interrupt callback of a format context, libav gives up whatever it is
+ * blocked on when it returns 1.
+ */
+static int interrupted(void *token) {
+
+    return static_cast<const CancellationToken*>(token)->shouldStop() ? 1 : 0;
+}
+
+/**
+ * @return the interrupt callback for the job bound to the calling thread, or
+ *      an empty one if there isn't a job.
+ */
+static AVIOInterruptCB currentCallback() {
+
+    AVIOInterruptCB callback = { NULL, NULL };
+
+    Job *job = currentJob();
+
+    if (NULL != job) {
+
+        callback.callback = interrupted;
+        callback.opaque = &job->cancellation();
+    }
+
+    return callback;
+}
+
+}
+
+namespace progress {
+
+/**
+ * Start the progress of the job bound to the calling thread over with the
+ * supplied newly opened input.
+ */
+static void inputOpened(AVFormatContext *formatContext) {
+
+    Job *job = currentJob();
+
+    if (NULL == job) return;
+
+    // The duration of a format context is in AV_TIME_BASE, which is microseconds.
+    int64_t duration = AV_NOPTS_VALUE != formatContext->duration ? formatContext->duration : 0;
+
+    int64_t size = NULL != formatContext->pb ? avio_size(formatContext->pb) : 0;
+
+    job->progress().inputOpened(formatContext, duration, size);
+}
+
+/**
+ * Record that the supplied input was closed against the progress of the job
+ * bound to the calling thread.
+ */
+static void inputClosed(AVFormatContext *formatContext) {
+
+    Job *job = currentJob();
+
+    if (NULL != job) job->progress().inputClosed(formatContext);
+}
+
+/**
+ * Record the supplied packet read from the supplied input against the progress
+ * of the job bound to the calling thread.
+ */
+static void packetRead(AVFormatContext *formatContext, const AVPacket *packet) {
+
+    Job *job = currentJob();
+
+    if (NULL == job) return;
+
+    int64_t timestamp = AV_NOPTS_VALUE != packet->pts ? packet->pts : packet->dts;
+
+    int64_t media = -1;
+
+    if (AV_NOPTS_VALUE != timestamp) {
+
+        media = av_rescale_q(timestamp, formatContext->streams[packet->stream_index]->time_base,
+                AV_TIME_BASE_Q);
+
+        if (AV_NOPTS_VALUE != formatContext->start_time) media -= formatContext->start_time;
+    }
+
+    int64_t position = NULL != formatContext->pb ? avio_tell(formatContext->pb) : 0;
+
+    job->progress().packetRead(media, position);
+}
+
+/**
+ * Record the supplied number of decoded frames against the progress of the job
+ * bound to the calling thread.
+ */
+static void framesDecoded(size_t frames) {
+
+    Job *job = currentJob();
+
+    if (NULL != job && 0 < frames) job->progress().framesDecoded(frames);
+}
+
+}
+
+/**
+ * Check if the supplied packet should have been dropped by the demuxer, because
+ * its stream is discarding every packet or every packet that isn't a key frame.
+ */
+static bool isDiscarded(const AVFormatContext *formatContext, const AVPacket *packet) {
+
+    if (0 > packet->stream_index
+            || formatContext->nb_streams <= static_cast<unsigned int>(packet->stream_index)) {
+
+        return false;
+    }
+
+    AVDiscard discard = formatContext->streams[packet->stream_index]->discard;
+
+    if (AVDISCARD_ALL <= discard) return true;
+
+    return AVDISCARD_NONKEY <= discard && 0 == (packet->flags & AV_PKT_FLAG_KEY);
+}
+
+/**
+ * Throw the exception that matches the supplied failed decode result.
+ *
+ * @param result - the result of the failed decode.
  */
-const int BUFFER_SIZE = AVCODEC_MAX_AUDIO_FRAME_SIZE + FF_INPUT_BUFFER_PADDING_SIZE;
+static void throwDecodeException(const DecodeResult& result) {
+
+    if (DECODE_INVALID_DATA == result.status) {
+
+        throw InvalidPacketDataException(errorMessage(result.errorCode));
+    }
+
+    throw PacketDecodeException(errorMessage(result.errorCode));
+}
 
 namespace wrappers {
 
@@ -66,18 +628,42 @@ template<typename T> T decodePacketTemplate(AVCodecContext *codecContext, const
         throw IllegalArgumentException("The packet for decoding cannot be null.");
     }
 
+    if (0 > packet->size || (NULL == packet->data && 0 < packet->size)) {
+
+        throw IllegalArgumentException("The packet for decoding has no data for its size.");
+    }
+
     // A copy of the supplied packet that will be used during the decoding so that we
     // don't mutate the supplied packet. If we mutated the supplied packet it would no
     // longer be able to be correctly deleted.
     AVPacket packetCopy;
-    // Create a new large buffer array to hold the audio packet.
-    uint8_t buffer[BUFFER_SIZE];
-    // Set all the values within to 0 so that there is no question about the data end.
-    memset(buffer, 0, BUFFER_SIZE);
-    // Copy the packet data into the new buffer.
-    memcpy(buffer, packet->data, packet->size);
-    // Set the copy packets data and size.
-    packetCopy.data = buffer;
+
+    av_init_packet(&packetCopy);
+
+    // The timestamps are handed on to the frames the packet decodes to.
+    packetCopy.pts = packet->pts;
+    packetCopy.dts = packet->dts;
+    packetCopy.flags = packet->flags;
+    packetCopy.duration = packet->duration;
+    packetCopy.pos = packet->pos;
+
+    // Decoders may read past the end of the data, so the copy is followed by
+    // zeroed padding. It is as big as the packet, whatever size that is. An
+    // empty packet is left without data, which is how a delayed decoder is
+    // asked for the frames it is still holding.
+    vector<uint8_t> buffer;
+
+    packetCopy.data = NULL;
+
+    if (0 < packet->size) {
+
+        buffer.assign(packet->size + FF_INPUT_BUFFER_PADDING_SIZE, 0);
+
+        memcpy(&buffer[0], packet->data, packet->size);
+
+        packetCopy.data = &buffer[0];
+    }
+
     packetCopy.size = packet->size;
 
     return decodeCallback(codecContext, &packetCopy);
@@ -108,6 +694,12 @@ static AVPacket* encodeFrameWrapper(AVCodecContext *codecContext, const AVFrame
 
     int result = encodeCallback(codecContext, packet, frame, &packetEncoded);
 
+    if (0 <= result && 0 != packetEncoded) return packet;
+
+    // Encoders with a delay don't always return a packet, so the empty
+    // packet must be freed here as well as when the encode fails.
+    delete packet;
+
     if (AVERROR_INVALIDDATA == result) {
 
         throw InvalidPacketDataException(errorMessage(result));
@@ -118,8 +710,6 @@ static AVPacket* encodeFrameWrapper(AVCodecContext *codecContext, const AVFrame
         throw PacketDecodeException(errorMessage(result));
     }
 
-    if (0 != packetEncoded) return packet;
-
     return NULL;
 }
 
@@ -133,10 +723,11 @@ namespace callbacks {
  *
  * @param codecContext - the codec context that will be used to decode the callback.
  * @param packet - the packet that is to be decoded.
- * @return the decoded packet as a vector of AVFrames.
+ * @param frames - the vector the decoded AVFrames will be added to.
+ * @return the result of the decode.
  */
-static vector<AVFrame*> decodeAudioPacketCallback(AVCodecContext *codecContext,
-        AVPacket *packet) {
+static DecodeResult decodeAudioPacketCallback(AVCodecContext *codecContext,
+        AVPacket *packet, vector<AVFrame*> *frames) {
 
     if (AVMEDIA_TYPE_AUDIO != findCodecType(codecContext)) {
 
@@ -144,9 +735,6 @@ static vector<AVFrame*> decodeAudioPacketCallback(AVCodecContext *codecContext,
                 "The supplied codec context for decoding audio must have media type AVMEDIA_TYPE_AUDIO.");
     }
 
-    // This vector will contain all the audio frames decoded from the supplied packet.
-    vector<AVFrame*> frames;
-
     // The frame pointer that will hold each new frame before it is placed in the vector.
     AVFrame *decodedFrame = NULL;
 
@@ -167,22 +755,19 @@ static vector<AVFrame*> decodeAudioPacketCallback(AVCodecContext *codecContext,
                 &frameDecoded,
                 packet);
 
-        // If there is an invalid data error throw a more specific exception.
-        if (AVERROR_INVALIDDATA == bytesDecoded) {
-
-            throw InvalidPacketDataException(errorMessage(bytesDecoded));
-        }
-
+        // Stop at the first failure and hand back what was decoded before it.
         if (0 > bytesDecoded) {
 
-            throw PacketDecodeException(errorMessage(bytesDecoded));
+            av_free(decodedFrame);
+
+            return toDecodeResult(bytesDecoded);
         }
 
         // If a frame was successfully decoded add it the vector to be returned and
         // set the pointer to null to indicate we need a new frame allocated.
         if (0 != frameDecoded) {
 
-            frames.push_back(decodedFrame);
+            frames->push_back(decodedFrame);
 
             decodedFrame = NULL;
 
@@ -200,7 +785,10 @@ static vector<AVFrame*> decodeAudioPacketCallback(AVCodecContext *codecContext,
         packet->size -= bytesDecoded;
     }
 
-    return frames;
+    // A frame that was allocated but never decoded into is no longer needed.
+    if (NULL != decodedFrame) av_free(decodedFrame);
+
+    return DecodeResult();
 }
 
 static int encodeAudioFrameCallback(AVCodecContext *codecContext, AVPacket *packet,
@@ -221,10 +809,11 @@ static int encodeAudioFrameCallback(AVCodecContext *codecContext, AVPacket *pack
  *
  * @param codecContext - the codec context that will be used to decode the callback.
  * @param packet - the packet that is to be decoded.
- * @return the decoded packet as an AVFrame.
+ * @param frame - set to the decoded AVFrame, or NULL if no frame was decoded.
+ * @return the result of the decode.
  */
-static AVFrame* decodeVideoPacketCallBack(AVCodecContext *codecContext,
-        AVPacket *packet) {
+static DecodeResult decodeVideoPacketCallBack(AVCodecContext *codecContext,
+        AVPacket *packet, AVFrame **frame) {
 
     if (AVMEDIA_TYPE_VIDEO != findCodecType(codecContext)) {
 
@@ -232,6 +821,8 @@ static AVFrame* decodeVideoPacketCallBack(AVCodecContext *codecContext,
                 "The supplied codec context for decodeVideoPacket(AVCodecContext*,AVPacket*) must have media type AVMEDIA_TYPE_VIDEO.");
     }
 
+    *frame = NULL;
+
     AVFrame *decodedFrame = avcodec_alloc_frame();
 
     int bytesDecoded = 0;
@@ -242,19 +833,16 @@ static AVFrame* decodeVideoPacketCallBack(AVCodecContext *codecContext,
             &frameDecoded,
             packet);
 
-    if (AVERROR_INVALIDDATA == bytesDecoded) {
+    if (0 <= bytesDecoded && 0 != frameDecoded) {
 
-        throw InvalidPacketDataException(errorMessage(bytesDecoded));
-    }
+        *frame = decodedFrame;
 
-    if (0 > bytesDecoded) {
+    } else {
 
-        throw PacketDecodeException(errorMessage(bytesDecoded));
+        av_free(decodedFrame);
     }
 
-    if (0 != frameDecoded) return decodedFrame;
-
-    return NULL;
+    return toDecodeResult(bytesDecoded);
 }
 
 static int encodeVideoFrameCallback(AVCodecContext *codecContext, AVPacket *packet,
@@ -287,18 +875,35 @@ private:
 
 public:
     static const LibavSingleton& getInstance() {
+        // g++ guards the initialisation of function statics, so the first
+        // calls can safely race from any number of threads.
         static LibavSingleton instance;
         return instance;
     }
 
     string errorMessage(const int& errorCode) const;
 
-    AVFormatContext* openFormatContext(const string& fileName) const;
+    AVFormatContext* openFormatContext(const string& fileName,
+            const InputOptions& options) const;
 
     void closeFormatContext(AVFormatContext **formatContext) const;
 
     AVPacket* readNextPacket(AVFormatContext *formatContext) const;
 
+    void setKeyFramesOnly(AVFormatContext *formatContext, bool keyFramesOnly) const;
+
+    AVFormatContext* openOutputFormatContext(const string& fileName,
+            const string& formatName) const;
+
+    AVStream* addOutputStream(AVFormatContext *formatContext,
+            const AVCodecContext *codecContext) const;
+
+    void writeOutputHeader(AVFormatContext *formatContext) const;
+
+    void writePacket(AVFormatContext *formatContext, AVPacket *packet) const;
+
+    void closeOutputFormatContext(AVFormatContext **formatContext) const;
+
     AVMediaType findStreamType(const AVStream *stream) const;
 
     AVMediaType findCodecType(const AVCodecContext *codecContext) const;
@@ -306,139 +911,439 @@ public:
     AVMediaType findPacketType(const AVFormatContext *formatContext,
             const AVPacket *packet) const;
 
-    AVCodecContext* openDecodeCodecContext(AVCodecContext *codecContext) const;
+    AVCodecContext* openDecodeCodecContext(AVCodecContext *codecContext,
+            const DecodeOptions& options) const;
 
-    AVCodecContext* openEncodeCodecContext(AVCodecContext *codecContext) const;
+    AVCodecContext* openEncodeCodecContext(AVCodecContext *codecContext,
+            const EncodeOptions& options) const;
 
     void closeCodecContext(AVCodecContext **codecContext) const;
 
     vector<AVFrame*> decodeAudioPacket(AVCodecContext *codecContext,
             const AVPacket *packet) const;
 
+    DecodeResult tryDecodeAudioPacket(AVCodecContext *codecContext,
+            const AVPacket *packet, vector<AVFrame*>& frames) const;
+
     AVPacket* encodeAudioFrame(AVCodecContext *codecContext,
             const AVFrame *frame) const;
 
     AVFrame* decodeVideoPacket(AVCodecContext *codecContext,
             const AVPacket *packet) const;
 
+    DecodeResult tryDecodeVideoPacket(AVCodecContext *codecContext,
+            const AVPacket *packet, AVFrame **frame) const;
+
     AVPacket* encodeVideoFrame(AVCodecContext *codecContext,
             const AVFrame *frame) const;
+
+    void freePacket(AVPacket **packet) const;
+
+    void freeFrame(AVFrame **frame) const;
+
+    void chargeCodecContext(const AVCodecContext *codecContext) const;
 };
 
 LibavSingleton::LibavSingleton() {
 
-    // Initialise the libav library so we can use it to inspect
-    // the media file.
-    avcodec_register_all();
-    av_register_all();
+    // The lock manager has to be in place before any codec is opened, this
+    // version of libav only guards avcodec_open2 and avcodec_close with it.
+    if (0 != av_lockmgr_register(locking::lockManager)) {
+
+        throw IllegalStateException("Could not register the libav lock manager.");
+    }
+
+    {
+        boost::mutex::scoped_lock lock(registration::initialiseMutex);
+
+        // Initialise the libav library so we can use it to inspect
+        // the media file, with every component unless initialise was called.
+        registration::registerComponents(registration::pending);
+
+        registration::initialised = true;
+    }
+
+    // Set the log level to fatal to stop any warnings.
+    av_log_set_level(AV_LOG_INFO);
+}
+
+string LibavSingleton::errorMessage(const int& errorCode) const {
+
+    size_t bufferSize = 1024;
+
+    char buffer[bufferSize];
+
+    // Make sure that the buffer is null terminated so that it
+    // represents a valid C++ string.
+    memset(buffer, 0, bufferSize);
+
+    int err = av_strerror(errorCode, buffer, bufferSize);
+
+    return err == 0 ? string(buffer) : UNKNOWN;
+}
+
+AVFormatContext* LibavSingleton::openFormatContext(
+        const string& filePath, const InputOptions& options) const {
+
+    StageTimer timer(STAGE_OPEN_FORMAT_CONTEXT);
+    TraceSpan span("openFormatContext");
+
+    throwIfCancelled();
+
+    AVInputFormat *inputFormat = NULL;
+
+    if (!options.formatName.empty()) {
+
+        inputFormat = av_find_input_format(options.formatName.c_str());
+
+        if (NULL == inputFormat) {
+
+            throw IllegalArgumentException("There is no input format named " + options.formatName);
+        }
+    }
+
+    // Open the media file. This will populate the AVFormatContext
+    // with all the information about this media file.
+    AVFormatContext *formatContext = avformat_alloc_context();
+
+    if (NULL == formatContext) throw IllegalStateException("Could not allocate a format context.");
+
+    formatContext->interrupt_callback = interruption::currentCallback();
+
+    int probeBytes = 0 < options.probeBytes ? options.probeBytes
+            : options.live ? DEFAULT_LIVE_PROBE_BYTES : 0;
+
+    int64_t analyzeMicroseconds = 0 < options.analyzeMicroseconds ? options.analyzeMicroseconds
+            : options.live ? DEFAULT_LIVE_ANALYZE_MICROSECONDS : 0;
+
+    if (0 < probeBytes) formatContext->probesize = probeBytes;
+    if (0 < analyzeMicroseconds) formatContext->max_analyze_duration = analyzeMicroseconds;
+
+    // Packets read while finding the stream info are dropped instead of being
+    // returned later, they would be stale by the time they were.
+    if (options.live) formatContext->flags |= AVFMT_FLAG_NOBUFFER;
+
+    // The format context is freed if it can't be opened.
+    int errorCode = avformat_open_input(&formatContext, filePath.c_str(), inputFormat,
+            NULL);
+
+    // If the media file could not be opened successfully throw an exception
+    // containing the errors codes message.
+    if (0 != errorCode) {
+
+        throwIfCancelled();
+
+        throw IOException(errorMessage(errorCode));
+    }
+
+    // Have a double try at extracting the info from the media file because
+    // sometimes opening it is not enough.
+    errorCode = avformat_find_stream_info(formatContext, NULL);
+
+    // If all is successful return the newly opened format context.
+    if (0 <= errorCode) {
+
+        progress::inputOpened(formatContext);
+
+        return formatContext;
+    }
+
+    // Other wise fail.
+    avformat_close_input(&formatContext);
+
+    throwIfCancelled();
+
+    throw IOException(errorMessage(errorCode));
+}
+
+void LibavSingleton::closeFormatContext(AVFormatContext **formatContext) const {
+
+    StageTimer timer(STAGE_CLOSE_FORMAT_CONTEXT);
+
+    if (NULL == (*formatContext)) {
+
+        throw IllegalArgumentException("Cannot close a NULL AVFormatContext");
+    }
+
+    if (0 >= (*formatContext)->nb_streams) {
+
+        throw IllegalStateException(
+                "The AVFormatContext does not contain any valid streams");
+    }
+
+    AVStream *stream = NULL;
+
+    // Close all the codec contexts within the format context to make sure they
+    // are cleaned up.
+    for (int i = 0; i < (*formatContext)->nb_streams; i++) {
+
+        stream = (*formatContext)->streams[i];
+
+        if (NULL == stream) continue;
+
+        memory::releaseCodec(stream->codec);
+
+        avcodec_close(stream->codec);
+    }
+
+    progress::inputClosed(*formatContext);
+
+    avformat_close_input(formatContext);
+}
+
+AVPacket* LibavSingleton::readNextPacket(AVFormatContext *formatContext) const {
+
+    StageTimer timer(STAGE_READ_PACKET);
+    TraceSpan span("readNextPacket");
+
+    if (NULL == formatContext) {
+
+        throw IllegalArgumentException(
+                "Cannot read a packet from a NULL AVFormatContext");
+    }
+
+    if (0 >= formatContext->nb_streams) {
+
+        throw IllegalStateException(
+                "There are no streams within the AVFormatContext to read a packet from.");
+    }
+
+    // Checked between every packet, for demuxers that don't read through the
+    // interrupt callback.
+    throwIfCancelled();
+
+    AVPacket *packet = new AVPacket();
+
+    av_init_packet(packet);
+
+    int error = 0;
+
+    // Not every demuxer honours the stream discard levels, so the packets
+    // they should have dropped are dropped here.
+    while (0 == (error = av_read_frame(formatContext, packet))
+            && isDiscarded(formatContext, packet)) {
+
+        av_free_packet(packet);
+    }
+
+    // If error equals 0 then we have a valid packet so return it.
+    if (0 == error) {
+
+        timer.addBytesOut(packet->size);
+        span.setStreamIndex(packet->stream_index);
+
+        progress::packetRead(formatContext, packet);
+
+        currentMemoryAccount().charge(memory::packetBytes(packet));
+
+        return packet;
+    }
+
+    // No packet was read so the empty one is no longer needed.
+    delete packet;
+
+    // An interrupted read looks like the end of the file, or any other error.
+    throwIfCancelled();
+
+    // If we have reached the end of the file return NULL;
+    if (AVERROR_EOF == error) return NULL;
+
+    // Double check to see if we have reached the end of the file.
+    // Because the AVERROR_EOF error code isn't always returned.
+    AVIOContext *ioContext = formatContext->pb;
+    if (NULL != ioContext && ioContext->eof_reached) return NULL;
+
+    // Otherwise throw an exception with the error message.
+    throw PacketReadException(errorMessage(error));
+}
+
+void LibavSingleton::setKeyFramesOnly(AVFormatContext *formatContext,
+        bool keyFramesOnly) const {
+
+    if (NULL == formatContext) {
+
+        throw IllegalArgumentException(
+                "Cannot set key frames only on a NULL AVFormatContext");
+    }
+
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+
+        AVStream *stream = formatContext->streams[i];
+
+        if (AVMEDIA_TYPE_VIDEO != findStreamType(stream)) continue;
+
+        // Demuxers that honour the discard level skip these packets without
+        // reading them, readNextPacket drops them for the rest.
+        stream->discard = keyFramesOnly ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+    }
+}
+
+AVFormatContext* LibavSingleton::openOutputFormatContext(
+        const string& fileName, const string& formatName) const {
+
+    StageTimer timer(STAGE_OPEN_FORMAT_CONTEXT);
+    TraceSpan span("openOutputFormatContext");
+
+    throwIfCancelled();
+
+    AVOutputFormat *outputFormat = av_guess_format(
+            formatName.empty() ? NULL : formatName.c_str(), fileName.c_str(), NULL);
+
+    if (NULL == outputFormat) {
+
+        throw IllegalArgumentException(
+                "Could not find an output format for the file: " + fileName);
+    }
+
+    AVFormatContext *formatContext = avformat_alloc_context();
+
+    if (NULL == formatContext) {
+
+        throw IllegalStateException("Could not allocate an output AVFormatContext.");
+    }
+
+    formatContext->oformat = outputFormat;
+    formatContext->interrupt_callback = interruption::currentCallback();
+
+    snprintf(formatContext->filename, sizeof(formatContext->filename), "%s",
+            fileName.c_str());
+
+    // Some formats such as image sequences open their own files.
+    if (0 != (outputFormat->flags & AVFMT_NOFILE)) return formatContext;
+
+    // Opening a FIFO blocks until there is a reader, so it can be interrupted.
+    int errorCode = avio_open2(&formatContext->pb, fileName.c_str(), AVIO_FLAG_WRITE,
+            &formatContext->interrupt_callback, NULL);
+
+    if (0 <= errorCode) return formatContext;
+
+    avformat_free_context(formatContext);
+
+    throwIfCancelled();
+
+    throw IOException(errorMessage(errorCode));
+}
+
+AVStream* LibavSingleton::addOutputStream(AVFormatContext *formatContext,
+        const AVCodecContext *codecContext) const {
+
+    if (NULL == formatContext || NULL == formatContext->oformat) {
+
+        throw IllegalArgumentException(
+                "The supplied format context for addOutputStream(AVFormatContext*,AVCodecContext*) must be an output format context.");
+    }
+
+    if (NULL == codecContext) {
+
+        throw IllegalArgumentException(
+                "The supplied codec context for addOutputStream(AVFormatContext*,AVCodecContext*) cannot be null.");
+    }
+
+    AVStream *stream = avformat_new_stream(formatContext, NULL);
+
+    if (NULL == stream) throw IllegalStateException("Could not allocate an output stream.");
 
-    // Set the log level to fatal to stop any warnings.
-    av_log_set_level(AV_LOG_INFO);
-}
+    int errorCode = avcodec_copy_context(stream->codec, codecContext);
 
-string LibavSingleton::errorMessage(const int& errorCode) const {
+    if (0 > errorCode) throw CodecException(errorMessage(errorCode));
 
-    size_t bufferSize = 1024;
+    // The codec tag of the source container may mean nothing in the output
+    // container, so let the muxer pick its own.
+    stream->codec->codec_tag = 0;
 
-    char buffer[bufferSize];
+    stream->time_base = codecContext->time_base;
 
-    // Make sure that the buffer is null terminated so that it
-    // represents a valid C++ string.
-    memset(buffer, 0, bufferSize);
+    if (0 != (formatContext->oformat->flags & AVFMT_GLOBALHEADER)) {
 
-    int err = av_strerror(errorCode, buffer, bufferSize);
+        stream->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+    }
 
-    return err == 0 ? string(buffer) : UNKNOWN;
+    return stream;
 }
 
-AVFormatContext* LibavSingleton::openFormatContext(
-        const string& filePath) const {
+void LibavSingleton::writeOutputHeader(AVFormatContext *formatContext) const {
 
-    // Open the media file. This will populate the AVFormatContext
-    // with all the information about this media file.
-    AVFormatContext *formatContext = NULL;
+    if (NULL == formatContext || NULL == formatContext->oformat) {
 
-    int errorCode = avformat_open_input(&formatContext, filePath.c_str(), NULL,
-            NULL);
+        throw IllegalArgumentException(
+                "The supplied format context for writeOutputHeader(AVFormatContext*) must be an output format context.");
+    }
 
-    // If the media file could not be opened successfully throw an exception
-    // containing the errors codes message.
-    if (0 != errorCode) {
+    if (0 >= formatContext->nb_streams) {
 
-        throw IOException(errorMessage(errorCode));
+        throw IllegalStateException(
+                "There are no streams within the AVFormatContext to write a header for.");
     }
 
-    // Have a double try at extracting the info from the media file because
-    // sometimes opening it is not enough.
-    errorCode = avformat_find_stream_info(formatContext, NULL);
-
-    // If all is successful return the newly opened format context.
-    if (0 <= errorCode) return formatContext;
+    int errorCode = avformat_write_header(formatContext, NULL);
 
-    // Other wise fail.
-    throw IOException(errorMessage(errorCode));
+    if (0 > errorCode) throw IOException(errorMessage(errorCode));
 }
 
-void LibavSingleton::closeFormatContext(AVFormatContext **formatContext) const {
+void LibavSingleton::writePacket(AVFormatContext *formatContext,
+        AVPacket *packet) const {
 
-    if (NULL == (*formatContext)) {
+    StageTimer timer(STAGE_WRITE_PACKET);
+    TraceSpan span("writePacket", NULL != packet ? packet->stream_index : -1);
 
-        throw IllegalArgumentException("Cannot close a NULL AVFormatContext");
+    if (NULL == formatContext || NULL == formatContext->oformat) {
+
+        throw IllegalArgumentException(
+                "The supplied format context for writePacket(AVFormatContext*,AVPacket*) must be an output format context.");
     }
 
-    if (0 >= (*formatContext)->nb_streams) {
+    if (NULL == packet) {
 
-        throw IllegalStateException(
-                "The AVFormatContext does not contain any valid streams");
+        throw IllegalArgumentException(
+                "The supplied packet for writePacket(AVFormatContext*,AVPacket*) cannot be null.");
     }
 
-    AVStream *stream = NULL;
+    throwIfCancelled();
 
-    // Close all the codec contexts within the format context to make sure they
-    // are cleaned up.
-    for (int i = 0; i < (*formatContext)->nb_streams; i++) {
+    timer.addBytesIn(packet->size);
 
-        stream = (*formatContext)->streams[i];
+    int errorCode = av_interleaved_write_frame(formatContext, packet);
 
-        if (NULL != stream) avcodec_close(stream->codec);
-    }
+    if (0 > errorCode) {
 
-    avformat_close_input(formatContext);
+        throwIfCancelled();
+
+        throw IOException(errorMessage(errorCode));
+    }
 }
 
-AVPacket* LibavSingleton::readNextPacket(AVFormatContext *formatContext) const {
+void LibavSingleton::closeOutputFormatContext(AVFormatContext **formatContext) const {
 
-    if (NULL == formatContext) {
+    StageTimer timer(STAGE_CLOSE_FORMAT_CONTEXT);
 
-        throw IllegalArgumentException(
-                "Cannot read a packet from a NULL AVFormatContext");
+    if (NULL == formatContext || NULL == *formatContext) {
+
+        throw IllegalArgumentException("Cannot close a NULL output AVFormatContext");
     }
 
-    if (0 >= formatContext->nb_streams) {
+    AVFormatContext *context = *formatContext;
 
-        throw IllegalStateException(
-                "There are no streams within the AVFormatContext to read a packet from.");
-    }
+    // Only write a trailer if the header was written, which is the case once
+    // the muxer has allocated its private data.
+    int errorCode = NULL != context->priv_data ? av_write_trailer(context) : 0;
 
-    AVPacket *packet = new AVPacket();
+    for (unsigned int i = 0; i < context->nb_streams; i++) {
 
-    av_init_packet(packet);
+        memory::releaseCodec(context->streams[i]->codec);
+
+        avcodec_close(context->streams[i]->codec);
+    }
 
-    int error = av_read_frame(formatContext, packet);
+    if (0 == (context->oformat->flags & AVFMT_NOFILE) && NULL != context->pb) {
 
-    // If error equals 0 then we have a valid packet so return it.
-    if (0 == error) return packet;
+        avio_close(context->pb);
+    }
 
-    // If we have reached the end of the file return NULL;
-    if (AVERROR_EOF == error) return NULL;
+    avformat_free_context(context);
 
-    // Double check to see if we have reached the end of the file.
-    // Because the AVERROR_EOF error code isn't always returned.
-    AVIOContext *ioContext = formatContext->pb;
-    if (NULL != ioContext && ioContext->eof_reached) return NULL;
+    *formatContext = NULL;
 
-    // Otherwise throw an exception with the error message.
-    throw PacketReadException(errorMessage(error));
+    if (0 > errorCode) throw IOException(errorMessage(errorCode));
 }
 
 AVMediaType LibavSingleton::findStreamType(const AVStream *stream) const {
@@ -515,7 +1420,9 @@ AVMediaType LibavSingleton::findPacketType(const AVFormatContext *formatContext,
 }
 
 AVCodecContext* LibavSingleton::openDecodeCodecContext(
-        AVCodecContext *codecContext) const {
+        AVCodecContext *codecContext, const DecodeOptions& options) const {
+
+    StageTimer timer(STAGE_OPEN_CODEC_CONTEXT);
 
     if (NULL == codecContext) {
 
@@ -523,26 +1430,104 @@ AVCodecContext* LibavSingleton::openDecodeCodecContext(
                 "The supplied codec context for openCodecContext(AVCodecContext*) cannot be null.");
     }
 
+    if (options.keyFramesOnly) {
+
+        // Most of the cost of the key frames themselves is the loop filter,
+        // which makes little difference to a still image.
+        codecContext->skip_frame = AVDISCARD_NONKEY;
+        codecContext->skip_loop_filter = AVDISCARD_ALL;
+        codecContext->flags2 |= CODEC_FLAG2_FAST;
+    }
+
     // Find the codec for the provided codec context.
     AVCodec *codec = avcodec_find_decoder(codecContext->codec_id);
 
     if (NULL == codec) throw CodecException("Could not find a supported codec.");
 
+    if (PROXY_FULL != options.proxyScale && AVMEDIA_TYPE_VIDEO == codecContext->codec_type) {
+
+        // Avcodec_open2 divides the width and height by the lowres factor.
+        codecContext->lowres = min(static_cast<int>(options.proxyScale),
+                static_cast<int>(codec->max_lowres));
+
+        // Errors from skipping the IDCT of frames nothing refers to can't
+        // spread to later frames.
+        codecContext->skip_loop_filter = AVDISCARD_ALL;
+        codecContext->skip_idct = AVDISCARD_NONREF;
+        codecContext->flags2 |= CODEC_FLAG2_FAST;
+    }
+
     int codecOpenResult = avcodec_open2(codecContext, codec, NULL);
 
-    if (0 == codecOpenResult) return codecContext;
+    if (0 == codecOpenResult) {
+
+        memory::chargeCodec(codecContext);
+
+        return codecContext;
+    }
 
     throw CodecException(errorMessage(codecOpenResult));
 }
 
 AVCodecContext* LibavSingleton::openEncodeCodecContext(
-        AVCodecContext *codecContext) const {
+        AVCodecContext *codecContext, const EncodeOptions& options) const {
 
-    return NULL;
+    StageTimer timer(STAGE_OPEN_CODEC_CONTEXT);
+
+    if (NULL == codecContext) {
+
+        throw IllegalArgumentException(
+                "The supplied codec context for openEncodeCodecContext(AVCodecContext*) cannot be null.");
+    }
+
+    // Use the encoder the codec context was allocated for if there is one,
+    // some codecs have more than one encoder.
+    AVCodec *codec = codecContext->codec;
+
+    if (NULL == codec) codec = avcodec_find_encoder(codecContext->codec_id);
+
+    if (NULL == codec) throw CodecException("Could not find a supported encoder.");
+
+    if (0 > options.slices) {
+
+        throw IllegalArgumentException("The number of slices of an encoder cannot be negative.");
+    }
+
+    AVDictionary *encoderOptions = NULL;
+
+    if (ENCODE_ZERO_LATENCY == options.profile) {
+
+        // Each of these holds frames back inside the encoder.
+        codecContext->max_b_frames = 0;
+        codecContext->rc_lookahead = 0;
+        codecContext->thread_type = FF_THREAD_SLICE;
+
+        codecContext->slices = 0 < options.slices ? options.slices
+                : max(1, codecContext->thread_count);
+
+        // Only libx264 has these, every other encoder leaves them unused.
+        av_dict_set(&encoderOptions, "tune", "zerolatency", 0);
+        av_dict_set(&encoderOptions, "intra-refresh", "1", 0);
+    }
+
+    int codecOpenResult = avcodec_open2(codecContext, codec, &encoderOptions);
+
+    av_dict_free(&encoderOptions);
+
+    if (0 == codecOpenResult) {
+
+        memory::chargeCodec(codecContext);
+
+        return codecContext;
+    }
+
+    throw CodecException(errorMessage(codecOpenResult));
 }
 
 void LibavSingleton::closeCodecContext(AVCodecContext **codecContext) const {
 
+    StageTimer timer(STAGE_CLOSE_CODEC_CONTEXT);
+
     if (NULL == codecContext) {
 
         throw IllegalArgumentException(
@@ -555,6 +1540,8 @@ void LibavSingleton::closeCodecContext(AVCodecContext **codecContext) const {
                 "The supplied codec context for closeCodecContext(AVCodecContext**) cannot be null.");
     }
 
+    memory::releaseCodec(*codecContext);
+
     int codecCloseResult = avcodec_close(*codecContext);
 
     if (0 == codecCloseResult) return;
@@ -566,32 +1553,203 @@ vector<AVFrame*> LibavSingleton::decodeAudioPacket(
         AVCodecContext *codecContext,
         const AVPacket *packet) const {
 
-    return wrappers::decodePacketTemplate<vector<AVFrame*> >(codecContext, packet,
-            callbacks::decodeAudioPacketCallback);
+    vector<AVFrame*> frames;
+
+    DecodeResult result = tryDecodeAudioPacket(codecContext, packet, frames);
+
+    if (result.succeeded()) return frames;
+
+    // The caller never sees the frames decoded before the failure so they have
+    // to be freed here.
+    for (size_t i = 0; i < frames.size(); i++) freeFrame(&frames[i]);
+
+    throwDecodeException(result);
+
+    return frames;
+}
+
+DecodeResult LibavSingleton::tryDecodeAudioPacket(
+        AVCodecContext *codecContext,
+        const AVPacket *packet, vector<AVFrame*>& frames) const {
+
+    StageTimer timer(STAGE_DECODE_AUDIO);
+    TraceSpan span("decodeAudioPacket", NULL != packet ? packet->stream_index : -1);
+
+    size_t firstFrame = frames.size();
+
+    DecodeResult result = wrappers::decodePacketTemplate<DecodeResult>(codecContext, packet,
+            std::tr1::bind(callbacks::decodeAudioPacketCallback,
+                    std::tr1::placeholders::_1, std::tr1::placeholders::_2, &frames));
+
+    timer.addBytesIn(packet->size);
+
+    MemoryAccount& account = currentMemoryAccount();
+
+    for (size_t i = firstFrame; i < frames.size(); i++) {
+
+        timer.addBytesOut(frameSize(codecContext, frames[i]));
+
+        account.charge(sizeof(AVFrame));
+    }
+
+    progress::framesDecoded(frames.size() - firstFrame);
+
+    if (!result.succeeded()) timer.failed();
+
+    return result;
 }
 
 AVPacket* LibavSingleton::encodeAudioFrame(AVCodecContext *codecContext,
         const AVFrame *frame) const {
 
-    return wrappers::encodeFrameWrapper(codecContext, frame,
+    StageTimer timer(STAGE_ENCODE_AUDIO);
+    TraceSpan span("encodeAudioFrame");
+
+    AVPacket *packet = wrappers::encodeFrameWrapper(codecContext, frame,
             callbacks::encodeAudioFrameCallback);
+
+    timer.addBytesIn(frameSize(codecContext, frame));
+
+    if (NULL != packet) {
+
+        timer.addBytesOut(packet->size);
+
+        currentMemoryAccount().charge(memory::packetBytes(packet));
+    }
+
+    return packet;
 }
 
 AVFrame* LibavSingleton::decodeVideoPacket(AVCodecContext *codecContext,
         const AVPacket *packet) const {
 
-    return wrappers::decodePacketTemplate<AVFrame*>(codecContext, packet,
-            callbacks::decodeVideoPacketCallBack);
+    AVFrame *frame = NULL;
+
+    DecodeResult result = tryDecodeVideoPacket(codecContext, packet, &frame);
+
+    if (result.succeeded()) return frame;
+
+    throwDecodeException(result);
+
+    return NULL;
+}
+
+DecodeResult LibavSingleton::tryDecodeVideoPacket(AVCodecContext *codecContext,
+        const AVPacket *packet, AVFrame **frame) const {
+
+    StageTimer timer(STAGE_DECODE_VIDEO);
+    TraceSpan span("decodeVideoPacket", NULL != packet ? packet->stream_index : -1);
+
+    if (NULL == frame) {
+
+        throw IllegalArgumentException("The frame pointer for decoding cannot be null.");
+    }
+
+    DecodeResult result = wrappers::decodePacketTemplate<DecodeResult>(codecContext, packet,
+            std::tr1::bind(callbacks::decodeVideoPacketCallBack,
+                    std::tr1::placeholders::_1, std::tr1::placeholders::_2, frame));
+
+    timer.addBytesIn(packet->size);
+
+    if (NULL != *frame) {
+
+        timer.addBytesOut(frameSize(codecContext, *frame));
+
+        currentMemoryAccount().charge(sizeof(AVFrame));
+
+        progress::framesDecoded(1);
+    }
+
+    if (!result.succeeded()) timer.failed();
+
+    return result;
 }
 
 AVPacket* LibavSingleton::encodeVideoFrame(AVCodecContext *codecContext,
         const AVFrame *frame) const {
 
-    return wrappers::encodeFrameWrapper(codecContext, frame,
+    StageTimer timer(STAGE_ENCODE_VIDEO);
+    TraceSpan span("encodeVideoFrame");
+
+    AVPacket *packet = wrappers::encodeFrameWrapper(codecContext, frame,
             callbacks::encodeVideoFrameCallback);
+
+    timer.addBytesIn(frameSize(codecContext, frame));
+
+    if (NULL != packet) {
+
+        timer.addBytesOut(packet->size);
+
+        currentMemoryAccount().charge(memory::packetBytes(packet));
+    }
+
+    return packet;
+}
+
+void LibavSingleton::freePacket(AVPacket **packet) const {
+
+    if (NULL == packet || NULL == *packet) {
+
+        throw IllegalArgumentException("Cannot free a NULL AVPacket.");
+    }
+
+    currentMemoryAccount().release(memory::packetBytes(*packet));
+
+    av_free_packet(*packet);
+
+    delete *packet;
+
+    *packet = NULL;
+}
+
+void LibavSingleton::freeFrame(AVFrame **frame) const {
+
+    if (NULL == frame || NULL == *frame) {
+
+        throw IllegalArgumentException("Cannot free a NULL AVFrame.");
+    }
+
+    currentMemoryAccount().release(sizeof(AVFrame));
+
+    av_free(*frame);
+
+    *frame = NULL;
+}
+
+void LibavSingleton::chargeCodecContext(const AVCodecContext *codecContext) const {
+
+    if (NULL == codecContext) {
+
+        throw IllegalArgumentException("Cannot charge a NULL AVCodecContext.");
+    }
+
+    // Charging again releases the charge held by the previous account.
+    memory::chargeCodec(codecContext);
 }
 
 
+void initialise(const Registration& components) {
+
+    {
+        boost::mutex::scoped_lock lock(registration::initialiseMutex);
+
+        if (registration::initialised) {
+
+            throw IllegalStateException("Libav has already been initialised.");
+        }
+
+        registration::validate(components);
+
+        registration::pending = components;
+
+        registration::initialised = true;
+    }
+
+    // The singleton takes the lock to read the components, so it is created
+    // once the lock has been let go of.
+    LibavSingleton::getInstance();
+}
+
 string errorMessage(const int& errorCode) {
 
     return LibavSingleton::getInstance().errorMessage(errorCode);
@@ -599,7 +1757,12 @@ string errorMessage(const int& errorCode) {
 
 AVFormatContext* openFormatContext(const string& fileName) {
 
-    return LibavSingleton::getInstance().openFormatContext(fileName);
+    return LibavSingleton::getInstance().openFormatContext(fileName, InputOptions());
+}
+
+AVFormatContext* openFormatContext(const string& fileName, const InputOptions& options) {
+
+    return LibavSingleton::getInstance().openFormatContext(fileName, options);
 }
 
 void closeFormatContext(AVFormatContext **formatContext) {
@@ -612,6 +1775,38 @@ AVPacket* readNextPacket(AVFormatContext *formatContext) {
     return LibavSingleton::getInstance().readNextPacket(formatContext);
 }
 
+void setKeyFramesOnly(AVFormatContext *formatContext, bool keyFramesOnly) {
+
+    LibavSingleton::getInstance().setKeyFramesOnly(formatContext, keyFramesOnly);
+}
+
+AVFormatContext* openOutputFormatContext(const string& fileName,
+        const string& formatName) {
+
+    return LibavSingleton::getInstance().openOutputFormatContext(fileName, formatName);
+}
+
+AVStream* addOutputStream(AVFormatContext *formatContext,
+        const AVCodecContext *codecContext) {
+
+    return LibavSingleton::getInstance().addOutputStream(formatContext, codecContext);
+}
+
+void writeOutputHeader(AVFormatContext *formatContext) {
+
+    LibavSingleton::getInstance().writeOutputHeader(formatContext);
+}
+
+void writePacket(AVFormatContext *formatContext, AVPacket *packet) {
+
+    LibavSingleton::getInstance().writePacket(formatContext, packet);
+}
+
+void closeOutputFormatContext(AVFormatContext **formatContext) {
+
+    LibavSingleton::getInstance().closeOutputFormatContext(formatContext);
+}
+
 AVMediaType findStreamType(const AVStream *stream) {
 
     return LibavSingleton::getInstance().findStreamType(stream);
@@ -630,12 +1825,26 @@ AVMediaType findPacketType(const AVFormatContext *formatContext,
 
 AVCodecContext* openDecodeCodecContext(AVCodecContext *codecContext) {
 
-    return LibavSingleton::getInstance().openDecodeCodecContext(codecContext);
+    return LibavSingleton::getInstance().openDecodeCodecContext(codecContext,
+            DecodeOptions());
+}
+
+AVCodecContext* openDecodeCodecContext(AVCodecContext *codecContext,
+        const DecodeOptions& options) {
+
+    return LibavSingleton::getInstance().openDecodeCodecContext(codecContext, options);
 }
 
 AVCodecContext* openEncodeCodecContext(AVCodecContext *codecContext) {
 
-    return LibavSingleton::getInstance().openEncodeCodecContext(codecContext);
+    return LibavSingleton::getInstance().openEncodeCodecContext(codecContext,
+            EncodeOptions());
+}
+
+AVCodecContext* openEncodeCodecContext(AVCodecContext *codecContext,
+        const EncodeOptions& options) {
+
+    return LibavSingleton::getInstance().openEncodeCodecContext(codecContext, options);
 }
 
 void closeCodecContext(AVCodecContext **codecContext) {
@@ -649,6 +1858,12 @@ vector<AVFrame*> decodeAudioPacket(AVCodecContext *codecContext,
     return LibavSingleton::getInstance().decodeAudioPacket(codecContext, packet);
 }
 
+DecodeResult tryDecodeAudioPacket(AVCodecContext *codecContext,
+        const AVPacket *packet, vector<AVFrame*>& frames) {
+
+    return LibavSingleton::getInstance().tryDecodeAudioPacket(codecContext, packet, frames);
+}
+
 AVPacket* encodeAudioFrame(AVCodecContext *codecContext,
         const AVFrame *frame) {
 
@@ -661,12 +1876,49 @@ AVFrame* decodeVideoPacket(AVCodecContext *codecContext,
     return LibavSingleton::getInstance().decodeVideoPacket(codecContext, packet);
 }
 
+DecodeResult tryDecodeVideoPacket(AVCodecContext *codecContext,
+        const AVPacket *packet, AVFrame **frame) {
+
+    return LibavSingleton::getInstance().tryDecodeVideoPacket(codecContext, packet, frame);
+}
+
+DecodeErrorCounts decodeErrorCounts() {
+
+    DecodeErrorCounts counts;
+
+    counts.invalidData = invalidDataCount.load(boost::memory_order_relaxed);
+    counts.failed = decodeFailedCount.load(boost::memory_order_relaxed);
+
+    return counts;
+}
+
+void resetDecodeErrorCounts() {
+
+    invalidDataCount.store(0, boost::memory_order_relaxed);
+    decodeFailedCount.store(0, boost::memory_order_relaxed);
+}
+
 AVPacket* encodeVideoFrame(AVCodecContext *codecContext,
         const AVFrame *frame) {
 
     return LibavSingleton::getInstance().encodeVideoFrame(codecContext, frame);
 }
 
+void freePacket(AVPacket **packet) {
+
+    LibavSingleton::getInstance().freePacket(packet);
+}
+
+void freeFrame(AVFrame **frame) {
+
+    LibavSingleton::getInstance().freeFrame(frame);
+}
+
+void chargeCodecContext(const AVCodecContext *codecContext) {
+
+    LibavSingleton::getInstance().chargeCodecContext(codecContext);
+}
+
 
 } /* namespace util */
 } /* namespace transcode */
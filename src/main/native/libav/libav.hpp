@@ -20,6 +20,16 @@ extern "C" {
  *
  * The libav utility functions that provide a simple
  * abstraction of the libav API's.
+ *
+ * Thread safety: libav is initialised the first time any of
+ * these functions is called, which is safe from any thread, and
+ * a lock manager is registered so that codec contexts can be
+ * opened and closed from many threads at once. Every function can
+ * be called concurrently as long as no two threads use the same
+ * format context, codec context, packet or frame at the same time.
+ * A format context and the codec contexts of its streams count as
+ * one, so <code>closeFormatContext</code> must not run while another
+ * thread is still using one of its streams codec contexts.
  */
 
 struct AVFormatContext;
@@ -42,6 +52,230 @@ namespace transcode {
 namespace libav {
 
 
+/**
+ * The outcome of one of the non throwing decode functions.
+ */
+enum DecodeStatus {
+    /** The packet was decoded, this does not mean a frame was produced. */
+    DECODE_SUCCESS,
+    /** The packet contained invalid data (AVERROR_INVALIDDATA). */
+    DECODE_INVALID_DATA,
+    /** The packet failed to decode for any other reason. */
+    DECODE_FAILED
+};
+
+/**
+ * The result of one of the non throwing decode functions.
+ *
+ * No error message is built when a decode fails, if one is needed it can be
+ * found by passing the error code to <code>errorMessage</code>.
+ */
+struct DecodeResult {
+
+    /**
+     * The outcome of the decode.
+     */
+    DecodeStatus status;
+
+    /**
+     * The libav error code of a failed decode, 0 if the decode succeeded.
+     */
+    int errorCode;
+
+    DecodeResult() : status(DECODE_SUCCESS), errorCode(0) {
+    }
+
+    DecodeResult(DecodeStatus s, int code) : status(s), errorCode(code) {
+    }
+
+    /**
+     * @return true if the decode succeeded, otherwise false.
+     */
+    bool succeeded() const {
+
+        return DECODE_SUCCESS == status;
+    }
+};
+
+/**
+ * The number of decode failures of each category seen by this process.
+ */
+struct DecodeErrorCounts {
+
+    /**
+     * The number of decodes that failed with DECODE_INVALID_DATA.
+     */
+    unsigned long invalidData;
+
+    /**
+     * The number of decodes that failed with DECODE_FAILED.
+     */
+    unsigned long failed;
+
+    DecodeErrorCounts() : invalidData(0), failed(0) {
+    }
+
+    /**
+     * Count the supplied result if the decode failed.
+     */
+    void add(const DecodeResult& result) {
+
+        if (DECODE_INVALID_DATA == result.status) invalidData++;
+        else if (DECODE_FAILED == result.status) failed++;
+    }
+};
+
+/**
+ * The resolution video is decoded at for proxies and previews.
+ */
+enum ProxyScale {
+    PROXY_FULL = 0,
+    PROXY_HALF = 1,
+    PROXY_QUARTER = 2
+};
+
+/**
+ * How a decoder is configured when it is opened.
+ */
+struct DecodeOptions {
+
+    /**
+     * Only decode key frames and skip the loop filter, for thumbnails and
+     * previews. Video decoders return nothing for the other packets.
+     */
+    bool keyFramesOnly;
+
+    /**
+     * Decode video at a reduced resolution inside the decoder, for proxies.
+     * The loop filter and the IDCT of frames that nothing refers to are
+     * skipped as well. Codecs that can't decode at a lower resolution, or
+     * not as low as asked, decode at the lowest they can, the resolution
+     * used is left in the <code>lowres</code> of the opened codec context
+     * and its width and height are those of the decoded frames.
+     */
+    ProxyScale proxyScale;
+
+    DecodeOptions() : keyFramesOnly(false), proxyScale(PROXY_FULL) {
+    }
+};
+
+/**
+ * The tradeoffs an encoder is opened with.
+ */
+enum EncodeProfile {
+    ENCODE_DEFAULT = 0,
+    ENCODE_ZERO_LATENCY = 1
+};
+
+/**
+ * How an encoder is configured when it is opened.
+ */
+struct EncodeOptions {
+
+    /**
+     * The tradeoffs to open the encoder with. A zero latency encoder returns
+     * the packet of every frame from the call that encodes it: there are no
+     * B-frames and no lookahead, and threads work on slices of the same
+     * frame instead of on frames of their own. Encoders that support it
+     * refresh the picture a column at a time instead of with whole key
+     * frames, so no single packet is much bigger than the rest.
+     */
+    EncodeProfile profile;
+
+    /**
+     * The number of slices each frame of a zero latency encoder is cut into,
+     * or 0 for one per thread.
+     */
+    int slices;
+
+    EncodeOptions() : profile(ENCODE_DEFAULT), slices(0) {
+    }
+};
+
+/**
+ * The most bytes probed when opening a live input, unless set otherwise.
+ */
+const int DEFAULT_LIVE_PROBE_BYTES = 32768;
+
+/**
+ * The most media time analysed when opening a live input, unless set otherwise.
+ */
+const int64_t DEFAULT_LIVE_ANALYZE_MICROSECONDS = 500000;
+
+/**
+ * How an input is opened.
+ */
+struct InputOptions {
+
+    /**
+     * The short name of the container format, or empty to probe for it. Naming
+     * it skips probing the format altogether.
+     */
+    std::string formatName;
+
+    /**
+     * Open a pipe or FIFO that is being written to as it is read. Probing
+     * and analysing the streams is cut short and the packets read while
+     * analysing are dropped instead of being buffered, so the first packet
+     * returned is as close to live as possible.
+     */
+    bool live;
+
+    /**
+     * The most bytes probed for the format and streams, or 0 for the default.
+     */
+    int probeBytes;
+
+    /**
+     * The most media time analysed for the streams, or 0 for the default.
+     */
+    int64_t analyzeMicroseconds;
+
+    InputOptions() : formatName(), live(false), probeBytes(0), analyzeMicroseconds(0) {
+    }
+};
+
+/**
+ * The libav components to register when libav is initialised.
+ *
+ * By default everything libav was built with is registered. For short
+ * lived processes that only handle a few formats, registering only
+ * the components named here makes starting up a lot cheaper. This
+ * needs libav to be linked statically and this library to be built
+ * with TRANSCODE_SELECTIVE_REGISTRATION defined, the components that
+ * can be named are listed in registration.def.
+ */
+struct Registration {
+
+    /**
+     * If true every component is registered and the lists are ignored.
+     */
+    bool all;
+
+    std::vector<std::string> demuxers;
+    std::vector<std::string> muxers;
+    std::vector<std::string> decoders;
+    std::vector<std::string> encoders;
+    std::vector<std::string> parsers;
+
+    Registration() : all(true), demuxers(), muxers(), decoders(), encoders(),
+            parsers() {
+    }
+};
+
+
+/**
+ * Initialise libav, registering the supplied components. If this isn't
+ * called, libav is initialised with every component the first time any
+ * of the other functions is called.
+ *
+ * Note: This must be called before any other function in this file, and
+ * can only be called once.
+ *
+ * @param registration - the components to register.
+ */
+void initialise(const Registration& registration);
+
 /**
  * Return the error message string for the supplied error code.
  *
@@ -60,6 +294,18 @@ std::string errorMessage(const int& errorCode);
  */
 AVFormatContext* openFormatContext(const std::string& fileName);
 
+/**
+ * Open a libav format context for the media file, pipe or FIFO that has the
+ * supplied file name, with the supplied options.
+ *
+ * @param fileName - the name for the file to open the format
+ *      context for.
+ * @param options - how to open the input.
+ * @return the newly opened format context.
+ */
+AVFormatContext* openFormatContext(const std::string& fileName,
+        const InputOptions& options);
+
 /**
  * Close the supplied format context.
  *
@@ -67,13 +313,99 @@ AVFormatContext* openFormatContext(const std::string& fileName);
  */
 void closeFormatContext(AVFormatContext **formatContext);
 
+/**
+ * Open a libav format context for writing a new media file with
+ * the supplied file name. Streams must be added to the format
+ * context with <code>addOutputStream</code> and then the header
+ * written with <code>writeOutputHeader</code> before any packets
+ * can be written.
+ *
+ * @param fileName - the name of the file to write.
+ * @param formatName - the short name of the container format
+ *      to write, if this is empty the format is guessed from
+ *      the file name.
+ * @return the newly opened output format context.
+ */
+AVFormatContext* openOutputFormatContext(const std::string& fileName,
+        const std::string& formatName = "");
+
+/**
+ * Add a new stream to the supplied output format context, with
+ * the codec parameters copied from the supplied codec context.
+ *
+ * @param formatContext - the output format context to add the
+ *      stream to.
+ * @param codecContext - the codec context to copy the stream
+ *      codec parameters from.
+ * @return the newly added stream.
+ */
+AVStream* addOutputStream(AVFormatContext *formatContext,
+        const AVCodecContext *codecContext);
+
+/**
+ * Write the container header of the supplied output format
+ * context, this must be done after all the streams have been
+ * added and before any packets are written.
+ *
+ * @param formatContext - the output format context to write
+ *      the header of.
+ */
+void writeOutputHeader(AVFormatContext *formatContext);
+
+/**
+ * Write the supplied packet to the supplied output format
+ * context. The packets timestamps must be in the time base of
+ * the output stream it is written to.
+ *
+ * Note: The packet is handed to the muxer, which may hold on
+ * to its data, so the caller must not reuse the packet data.
+ *
+ * @param formatContext - the output format context to write to.
+ * @param packet - the packet to write.
+ */
+void writePacket(AVFormatContext *formatContext, AVPacket *packet);
+
+/**
+ * Write the container trailer of the supplied output format
+ * context, then close and free it.
+ *
+ * @param formatContext - the output format context to close.
+ */
+void closeOutputFormatContext(AVFormatContext **formatContext);
+
 /**
  * Read the next packet from the supplied format context.
  *
- * @param formatContext - the format context to close.
+ * The packet is charged to the memory account of the job bound to the
+ * calling thread until it is freed with <code>freePacket</code>, so it
+ * must be freed with <code>freePacket</code> rather than with
+ * <code>av_free_packet</code> and <code>delete</code>, which would leave
+ * the account charged for good. This
+ * never waits for the job to get back under its memory budget, as a
+ * thread that reads and decodes on its own would wait forever for
+ * itself, the read ahead of a <code>PacketReader</code> is paused
+ * instead.
+ *
+ * Packets of streams set to key frames only with
+ * <code>setKeyFramesOnly</code> that aren't key frames are dropped
+ * without being returned.
+ *
+ * @param formatContext - the format context to read the packet from.
+ * @return the next packet or NULL if the end of the file has been reached.
  */
 AVPacket* readNextPacket(AVFormatContext *formatContext);
 
+/**
+ * Set every video stream of the supplied format context to only return
+ * key frame packets from <code>readNextPacket</code>, so that packets a
+ * key frame only decoder would throw away are never passed to it.
+ *
+ * @param formatContext - the format context to set.
+ * @param keyFramesOnly - true to drop the video packets that aren't key
+ *      frames, false to read every packet again.
+ */
+void setKeyFramesOnly(AVFormatContext *formatContext, bool keyFramesOnly);
+
 /**
  * Find the media type for the provided stream.
  *
@@ -115,9 +447,24 @@ AVMediaType findPacketType(const AVFormatContext *formatContext,
  */
 AVCodecContext* openDecodeCodecContext(AVCodecContext *codecContext);
 
+/**
+ * Open the supplied codec context to be used for decoding, configured
+ * with the supplied options.
+ *
+ * @param codecContext - the codec context to open.
+ * @param options - how to configure the decoder.
+ * @return the newly opened codec context.
+ */
+AVCodecContext* openDecodeCodecContext(AVCodecContext *codecContext,
+        const DecodeOptions& options);
+
 /**
  * Open the supplied codec context to be used for encoding.
  *
+ * If the codec context was allocated for a particular encoder
+ * then that encoder is used, otherwise the default encoder for
+ * the codec contexts codec id is used.
+ *
  * Note: This function opens the codec context instance
  * that it was given, it does not create a copy then open
  * that.
@@ -127,6 +474,17 @@ AVCodecContext* openDecodeCodecContext(AVCodecContext *codecContext);
  */
 AVCodecContext* openEncodeCodecContext(AVCodecContext *codecContext);
 
+/**
+ * Open the supplied codec context to be used for encoding, configured
+ * with the supplied options.
+ *
+ * @param codecContext - the codec context to open.
+ * @param options - how to configure the encoder.
+ * @return the newly opened codec context.
+ */
+AVCodecContext* openEncodeCodecContext(AVCodecContext *codecContext,
+        const EncodeOptions& options);
+
 /**
  * Close the supplied codec context.
  *
@@ -150,6 +508,23 @@ void closeCodecContext(AVCodecContext **codecContext);
 std::vector<AVFrame*> decodeAudioPacket(AVCodecContext *codecContext,
         const AVPacket *packet);
 
+/**
+ * Decode the supplied audio packet without throwing an exception if the decode
+ * fails. Use this instead of <code>decodeAudioPacket</code> when decoding streams
+ * that are expected to contain a lot of damaged packets.
+ *
+ * Note: The frames decoded before a failure are still added to the supplied vector
+ * and must be freed by the caller.
+ *
+ * @param codecContext - the codec to use to decode the
+ *      audio packet.
+ * @param packet - the audio packet to be decoded.
+ * @param frames - the vector that the decoded frames will be added to.
+ * @return the result of the decode.
+ */
+DecodeResult tryDecodeAudioPacket(AVCodecContext *codecContext,
+        const AVPacket *packet, std::vector<AVFrame*>& frames);
+
 /**
  * Encode the supplied audio frame.
  *
@@ -173,6 +548,33 @@ AVPacket* encodeAudioFrame(AVCodecContext *codecContext,
 AVFrame* decodeVideoPacket(AVCodecContext *codecContext,
         const AVPacket *packet);
 
+/**
+ * Decode the supplied video packet without throwing an exception if the decode
+ * fails. Use this instead of <code>decodeVideoPacket</code> when decoding streams
+ * that are expected to contain a lot of damaged packets.
+ *
+ * @param codecContext - the codec to use to decode the
+ *      video packet.
+ * @param packet - the video packet to be decoded.
+ * @param frame - set to the decoded frame, or NULL if no frame was decoded.
+ * @return the result of the decode.
+ */
+DecodeResult tryDecodeVideoPacket(AVCodecContext *codecContext,
+        const AVPacket *packet, AVFrame **frame);
+
+/**
+ * Return the number of decode failures of each category seen so far by this
+ * process, across all threads.
+ *
+ * @return the decode failure counts.
+ */
+DecodeErrorCounts decodeErrorCounts();
+
+/**
+ * Reset all the decode failure counts to 0.
+ */
+void resetDecodeErrorCounts();
+
 /**
  * Encode the supplied video frame.
  *
@@ -184,6 +586,36 @@ AVFrame* decodeVideoPacket(AVCodecContext *codecContext,
 AVPacket* encodeVideoFrame(AVCodecContext *codecContext,
         const AVFrame *frame);
 
+/**
+ * Free a packet returned by <code>readNextPacket</code> or one of the
+ * encode functions, and release it from the memory account of the job
+ * bound to the calling thread.
+ *
+ * @param packet - a pointer to the packet to free, this is set to NULL.
+ */
+void freePacket(AVPacket **packet);
+
+/**
+ * Free a frame returned by one of the decode functions, and release it
+ * from the memory account of the job bound to the calling thread.
+ *
+ * Note: The picture or samples of a decoded frame belong to the codec
+ * context that decoded it and are accounted with it, so only the frame
+ * itself is released here.
+ *
+ * @param frame - a pointer to the frame to free, this is set to NULL.
+ */
+void freeFrame(AVFrame **frame);
+
+/**
+ * Move the memory charged for an opened codec context to the memory account
+ * of the job bound to the calling thread, for codec contexts that are handed
+ * from one job to another without being closed.
+ *
+ * @param codecContext - the opened codec context.
+ */
+void chargeCodecContext(const AVCodecContext *codecContext);
+
 } /* namespace util */
 } /* namespace transcode */
 
@@ -103,6 +103,25 @@ public:
     }
 };
 
+/**
+ * A <code>CancelledException</code> is thrown if the job
+ * was cancelled or ran past its deadline.
+ */
+class CancelledException: public Exception {
+
+public:
+    CancelledException() throw () :
+        Exception() {
+    }
+
+    CancelledException(std::string message) throw () :
+        Exception(message) {
+    }
+
+    ~CancelledException() throw () {
+    }
+};
+
 } /* namespace util */
 } /* namespace transcode */
 
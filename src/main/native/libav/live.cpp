@@ -0,0 +1,104 @@
+/*
+ * live.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavutil/mathematics.h"
+}
+
+#include <libav/counters.hpp>
+#include <libav/libav.hpp>
+#include <libav/live.hpp>
+
+#include <algorithm>
+
+using namespace std;
+
+
+/**
+ * @file live.cpp
+ *
+ * The implementation of the live.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+static const AVRational MICROSECONDS = { 1, 1000000 };
+
+/**
+ * Open the supplied input live whatever the supplied options say.
+ */
+static AVFormatContext* openLive(const string& fileName, InputOptions options) {
+
+    options.live = true;
+
+    return openFormatContext(fileName, options);
+}
+
+LiveInput::LiveInput(const string& fileName, const InputOptions& options) :
+        _formatContext(openLive(fileName, options)), _startMicroseconds(AV_NOPTS_VALUE),
+        _startMediaMicroseconds(AV_NOPTS_VALUE), _latency() {
+}
+
+LiveInput::~LiveInput() {
+
+    closeFormatContext(&_formatContext);
+}
+
+AVPacket* LiveInput::readNextPacket() {
+
+    AVPacket *packet = libav::readNextPacket(_formatContext);
+
+    if (NULL != packet) measure(packet);
+
+    return packet;
+}
+
+void LiveInput::measure(const AVPacket *packet) {
+
+    int64_t now = monotonicNanoseconds() / 1000;
+
+    int64_t timestamp = AV_NOPTS_VALUE != packet->pts ? packet->pts : packet->dts;
+
+    if (AV_NOPTS_VALUE == timestamp) return;
+
+    // The streams of a live input share one clock, so the media time of any of
+    // them can be compared against the first packet.
+    int64_t media = av_rescale_q(timestamp,
+            _formatContext->streams[packet->stream_index]->time_base, MICROSECONDS);
+
+    if (AV_NOPTS_VALUE == _startMicroseconds) {
+
+        _startMicroseconds = now;
+        _startMediaMicroseconds = media;
+    }
+
+    // A packet that arrives ahead of its time, as the packets of different
+    // streams can, isn't early, it just has no latency.
+    int64_t latency = max(static_cast<int64_t>(0),
+            (now - _startMicroseconds) - (media - _startMediaMicroseconds));
+
+    _latency.packets++;
+    _latency.lastMicroseconds = latency;
+    _latency.maxMicroseconds = max(_latency.maxMicroseconds, latency);
+    _latency.totalMicroseconds += latency;
+}
+
+AVFormatContext* LiveInput::formatContext() const {
+
+    return _formatContext;
+}
+
+LatencyStatistics LiveInput::latency() const {
+
+    return _latency;
+}
+
+} /* namespace libav */
+} /* namespace transcode */
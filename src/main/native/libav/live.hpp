@@ -0,0 +1,129 @@
+/*
+ * live.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __LIVE_HPP__
+#define __LIVE_HPP__
+
+#include <libav/libav.hpp>
+
+#include <stdint.h>
+#include <string>
+
+/**
+ * @file live.hpp
+ *
+ * Reading from a pipe or FIFO that is being written to in real time, such as
+ * the output of a capture process.
+ *
+ * The input is opened with <code>InputOptions::live</code> set and is read
+ * without a read ahead thread, so every packet is returned as soon as the
+ * demuxer has it. The latency of each packet is how far it arrived behind the
+ * real time pace set by the first packet, so a reader that keeps up has a
+ * latency close to 0 however long it runs.
+ */
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * The latency of the packets read so far from a live input.
+ */
+struct LatencyStatistics {
+
+    /**
+     * The number of packets with a timestamp, only they have a latency.
+     */
+    uint64_t packets;
+
+    int64_t lastMicroseconds;
+    int64_t maxMicroseconds;
+    int64_t totalMicroseconds;
+
+    LatencyStatistics() : packets(0), lastMicroseconds(0), maxMicroseconds(0),
+            totalMicroseconds(0) {
+    }
+
+    /**
+     * @return the mean latency, or 0 if there haven't been any packets.
+     */
+    double meanMicroseconds() const {
+
+        return 0 < packets ? static_cast<double>(totalMicroseconds) / packets : 0;
+    }
+};
+
+/**
+ * A live input and the latency of the packets read from it.
+ */
+class LiveInput {
+
+private:
+    AVFormatContext *_formatContext;
+
+    int64_t _startMicroseconds;
+    int64_t _startMediaMicroseconds;
+
+    LatencyStatistics _latency;
+
+    LiveInput(LiveInput const&); // Should not be implemented.
+
+    void operator=(LiveInput const&); // Should not be implemented.
+
+    /**
+     * Add the latency of the supplied packet to the statistics.
+     */
+    void measure(const AVPacket *packet);
+
+public:
+    /**
+     * Instantiate a new <code>LiveInput</code>, this blocks until something
+     * opens the other end of a FIFO and enough has been written to it to find
+     * the streams.
+     *
+     * @param fileName - the path of the pipe or FIFO.
+     * @param options - how to open the input, it is always opened live.
+     */
+    explicit LiveInput(const std::string& fileName,
+            const InputOptions& options = InputOptions());
+
+    /**
+     * Close the input.
+     */
+    ~LiveInput();
+
+    /**
+     * Read the next packet, blocking until there is one.
+     *
+     * @return the next packet or NULL once the writer has closed the input.
+     */
+    AVPacket* readNextPacket();
+
+    /**
+     * @return the format context that packets are being read from.
+     */
+    AVFormatContext* formatContext() const;
+
+    /**
+     * @return the latency of the packets read so far.
+     */
+    LatencyStatistics latency() const;
+};
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __LIVE_HPP__ */
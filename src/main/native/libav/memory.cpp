@@ -0,0 +1,95 @@
+/*
+ * memory.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#include <libav/memory.hpp>
+
+using namespace std;
+
+
+/**
+ * @file memory.cpp
+ *
+ * The implementation of the memory.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+static MemoryAccount processAccount;
+
+
+MemoryAccount::MemoryAccount(MemoryAccount *parent, int64_t budget) :
+        _parent(parent), _used(0), _peak(0), _budget(budget) {
+}
+
+void MemoryAccount::charge(int64_t bytes) {
+
+    for (MemoryAccount *account = this; NULL != account; account = account->_parent) {
+
+        int64_t used = account->_used.fetch_add(bytes, boost::memory_order_relaxed) + bytes;
+
+        int64_t peak = account->_peak.load(boost::memory_order_relaxed);
+
+        while (used > peak && !account->_peak.compare_exchange_weak(peak, used,
+                boost::memory_order_relaxed)) {
+        }
+    }
+}
+
+void MemoryAccount::release(int64_t bytes) {
+
+    for (MemoryAccount *account = this; NULL != account; account = account->_parent) {
+
+        account->_used.fetch_sub(bytes, boost::memory_order_relaxed);
+    }
+}
+
+int64_t MemoryAccount::used() const {
+
+    return _used.load(boost::memory_order_relaxed);
+}
+
+int64_t MemoryAccount::peak() const {
+
+    return _peak.load(boost::memory_order_relaxed);
+}
+
+int64_t MemoryAccount::budget() const {
+
+    return _budget.load(boost::memory_order_relaxed);
+}
+
+void MemoryAccount::setBudget(int64_t budget) {
+
+    _budget.store(budget, boost::memory_order_relaxed);
+}
+
+bool MemoryAccount::overBudget() const {
+
+    for (const MemoryAccount *account = this; NULL != account; account = account->_parent) {
+
+        int64_t budget = account->budget();
+
+        if (UNLIMITED_MEMORY != budget && account->used() > budget) return true;
+    }
+
+    return false;
+}
+
+MemoryAccount* MemoryAccount::parent() const {
+
+    return _parent;
+}
+
+MemoryAccount& processMemoryAccount() {
+
+    return processAccount;
+}
+
+} /* namespace libav */
+} /* namespace transcode */
@@ -0,0 +1,137 @@
+/*
+ * memory.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __MEMORY_HPP__
+#define __MEMORY_HPP__
+
+#include <stdint.h>
+
+#include <boost/atomic.hpp>
+
+/**
+ * @file memory.hpp
+ *
+ * Accounting of the memory held in packets, frames and codecs so that a process
+ * running many transcodes at once can bound how much memory they use.
+ *
+ * Every account can have a parent, the bytes charged to an account are also
+ * charged to all of its parents. The accounts of each job have the process
+ * account as their parent, so a budget can be set on a single job, on the whole
+ * process or both.
+ *
+ * A budget is never enforced by failing an allocation, instead the stages that
+ * read ahead check <code>overBudget</code> and stop reading until the stages
+ * after them have freed enough memory.
+ */
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * A budget of 0 means the account can grow without bound.
+ */
+const int64_t UNLIMITED_MEMORY = 0;
+
+/**
+ * A count of the bytes currently held by a job or process.
+ *
+ * Charging and releasing never take a lock, so they can be done for every
+ * packet and frame.
+ */
+class MemoryAccount {
+
+private:
+    MemoryAccount *_parent;
+
+    boost::atomic<int64_t> _used;
+    boost::atomic<int64_t> _peak;
+    boost::atomic<int64_t> _budget;
+
+    MemoryAccount(MemoryAccount const&); // Should not be implemented.
+
+    void operator=(MemoryAccount const&); // Should not be implemented.
+
+public:
+    /**
+     * Instantiate a new <code>MemoryAccount</code>.
+     *
+     * @param parent - the account that is also charged for everything charged
+     *      to this account, or NULL if there isn't one.
+     * @param budget - the number of bytes this account may hold before it is
+     *      over budget, or <code>UNLIMITED_MEMORY</code>.
+     */
+    explicit MemoryAccount(MemoryAccount *parent = NULL,
+            int64_t budget = UNLIMITED_MEMORY);
+
+    /**
+     * Charge the supplied number of bytes to this account and all of its parents.
+     *
+     * @param bytes - the number of bytes that are now held.
+     */
+    void charge(int64_t bytes);
+
+    /**
+     * Release the supplied number of bytes from this account and all of its
+     * parents.
+     *
+     * @param bytes - the number of bytes that are no longer held.
+     */
+    void release(int64_t bytes);
+
+    /**
+     * @return the number of bytes currently held.
+     */
+    int64_t used() const;
+
+    /**
+     * @return the most bytes that have been held at once.
+     */
+    int64_t peak() const;
+
+    /**
+     * @return the budget of this account, or <code>UNLIMITED_MEMORY</code>.
+     */
+    int64_t budget() const;
+
+    /**
+     * Set the number of bytes this account may hold before it is over budget.
+     *
+     * @param budget - the new budget, or <code>UNLIMITED_MEMORY</code>.
+     */
+    void setBudget(int64_t budget);
+
+    /**
+     * @return true if this account or any of its parents hold more than their
+     *      budget, otherwise false.
+     */
+    bool overBudget() const;
+
+    /**
+     * @return the parent of this account, or NULL if it doesn't have one.
+     */
+    MemoryAccount* parent() const;
+};
+
+/**
+ * @return the account of every byte held by the whole process.
+ */
+MemoryAccount& processMemoryAccount();
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __MEMORY_HPP__ */
@@ -0,0 +1,244 @@
+/*
+ * packetreader.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+}
+
+#include <error.hpp>
+#include <libav/job.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+#include <libav/memory.hpp>
+#include <libav/packetreader.hpp>
+#include <libav/trace.hpp>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+using namespace std;
+
+
+/**
+ * @file packetreader.cpp
+ *
+ * The implementation of the packetreader.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+/**
+ * Memory freed by other stages of the job doesn't wake the read ahead thread, so
+ * while it is paused for the memory budget it checks the budget again this often.
+ */
+static const long MEMORY_BUDGET_POLL_MILLISECONDS = 20;
+
+PacketReader::PacketReader(AVFormatContext *formatContext, size_t maxPackets,
+        size_t maxBytes) :
+        _formatContext(formatContext), _maxPackets(maxPackets), _maxBytes(maxBytes),
+        _packets(), _bytes(0), _finished(false), _stopped(false), _errorMessage(),
+        _job(currentJob()), _memory(&currentMemoryAccount()),
+        _mutex(), _packetAvailable(), _spaceAvailable(), _thread() {
+
+    // Validate up front so that the read ahead thread only ever has to deal
+    // with read errors.
+    if (NULL == formatContext) {
+
+        throw IllegalArgumentException(
+                "Cannot read packets from a NULL AVFormatContext");
+    }
+
+    if (0 >= formatContext->nb_streams) {
+
+        throw IllegalStateException(
+                "There are no streams within the AVFormatContext to read packets from.");
+    }
+
+    if (0 >= maxPackets) {
+
+        throw IllegalArgumentException(
+                "A PacketReader must be able to read ahead at least one packet.");
+    }
+
+    _thread = boost::thread(&PacketReader::run, this);
+}
+
+PacketReader::~PacketReader() {
+
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+
+        _stopped = true;
+    }
+
+    _spaceAvailable.notify_all();
+
+    _thread.join();
+
+    while (!_packets.empty()) {
+
+        freePacket(&_packets.front());
+
+        _packets.pop_front();
+    }
+}
+
+bool PacketReader::hasSpace() const {
+
+    // Always allow at least one packet so that a packet larger than the byte
+    // limit can't stop the reader from making progress.
+    if (_packets.empty()) return true;
+
+    return _packets.size() < _maxPackets && _bytes < _maxBytes && !_memory->overBudget();
+}
+
+void PacketReader::run() {
+
+    // The packets are read for the job that created the reader.
+    ScopedJob job(_job);
+
+    AVPacket *packet = NULL;
+
+    while (true) {
+
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+
+            if (!_stopped && !hasSpace()) {
+
+                TraceSpan span("readAheadFullWait");
+
+                while (!_stopped && !hasSpace()) {
+
+                    _spaceAvailable.timed_wait(lock,
+                            boost::posix_time::milliseconds(MEMORY_BUDGET_POLL_MILLISECONDS));
+                }
+            }
+
+            if (_stopped) return;
+        }
+
+        // The read happens outside of the lock so that the consumer can keep
+        // taking packets while this thread is blocked on I/O.
+        try {
+
+            packet = transcode::libav::readNextPacket(_formatContext);
+
+            // The packet data may point into the demuxers own buffers which are
+            // reused by the next read, so it must be copied before buffering.
+            if (NULL != packet && 0 > av_dup_packet(packet)) {
+
+                freePacket(&packet);
+
+                throw PacketReadException("Could not copy a read ahead packet.");
+            }
+
+        } catch (const exception& e) {
+
+            boost::mutex::scoped_lock lock(_mutex);
+
+            _errorMessage = e.what();
+            _finished = true;
+
+            if (_errorMessage.empty()) _errorMessage = UNKNOWN;
+
+            _packetAvailable.notify_all();
+
+            return;
+        }
+
+        boost::mutex::scoped_lock lock(_mutex);
+
+        if (NULL == packet) {
+
+            _finished = true;
+
+            _packetAvailable.notify_all();
+
+            return;
+        }
+
+        _packets.push_back(packet);
+        _bytes += packet->size;
+
+        _packetAvailable.notify_one();
+    }
+}
+
+AVPacket* PacketReader::readNextPacket() {
+
+    // The packets already read ahead aren't handed out once the job should stop.
+    if (NULL != _job) _job->cancellation().throwIfStopped();
+
+    boost::mutex::scoped_lock lock(_mutex);
+
+    if (_packets.empty() && !_finished) {
+
+        TraceSpan span("readAheadEmptyWait");
+
+        while (_packets.empty() && !_finished) _packetAvailable.wait(lock);
+    }
+
+    if (_packets.empty()) {
+
+        // Only report the error once all the packets read before it have been
+        // consumed, the same as reading directly would.
+        if (!_errorMessage.empty()) {
+
+            if (NULL != _job) _job->cancellation().throwIfStopped();
+
+            throw PacketReadException(_errorMessage);
+        }
+
+        return NULL;
+    }
+
+    AVPacket *packet = _packets.front();
+
+    _packets.pop_front();
+    _bytes -= packet->size;
+
+    _spaceAvailable.notify_one();
+
+    return packet;
+}
+
+AVFormatContext* PacketReader::formatContext() const {
+
+    return _formatContext;
+}
+
+size_t PacketReader::bufferedPackets() const {
+
+    boost::mutex::scoped_lock lock(_mutex);
+
+    return _packets.size();
+}
+
+size_t PacketReader::bufferedBytes() const {
+
+    boost::mutex::scoped_lock lock(_mutex);
+
+    return _bytes;
+}
+
+
+AVPacket* readNextPacket(PacketReader *packetReader) {
+
+    if (NULL == packetReader) {
+
+        throw IllegalArgumentException(
+                "Cannot read a packet from a NULL PacketReader");
+    }
+
+    return packetReader->readNextPacket();
+}
+
+} /* namespace libav */
+} /* namespace transcode */
@@ -0,0 +1,163 @@
+/*
+ * packetreader.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __PACKETREADER_HPP__
+#define __PACKETREADER_HPP__
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <string>
+
+/**
+ * @file packetreader.hpp
+ *
+ * A packet reader that demuxes packets ahead of the caller on its own thread.
+ */
+
+struct AVFormatContext;
+struct AVPacket;
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+class Job;
+class MemoryAccount;
+
+/**
+ * The default maximum number of packets a <code>PacketReader</code> will read ahead.
+ */
+const size_t DEFAULT_READ_AHEAD_PACKETS = 256;
+
+/**
+ * The default maximum number of packet bytes a <code>PacketReader</code> will read ahead.
+ */
+const size_t DEFAULT_READ_AHEAD_BYTES = 16 * 1024 * 1024;
+
+/**
+ * A <code>PacketReader</code> runs <code>av_read_frame</code> on a background thread
+ * and keeps a bounded buffer of packets ready for the caller, so a slow disk or
+ * network filesystem does not stall the decode.
+ *
+ * The buffer is bounded by both a packet count and a byte count, whichever is hit
+ * first. Reading ahead is also paused while the job that created the reader, or the
+ * whole process, is over its memory budget. A single packet is still buffered when
+ * any of these limits are hit so the reader can always make progress.
+ *
+ * Note: Once a <code>PacketReader</code> has been created for a format context that
+ * format context must not be read from directly until the reader has been destroyed.
+ */
+class PacketReader {
+
+private:
+    AVFormatContext *_formatContext;
+
+    size_t _maxPackets;
+    size_t _maxBytes;
+
+    std::deque<AVPacket*> _packets;
+    size_t _bytes;
+
+    bool _finished;
+    bool _stopped;
+    std::string _errorMessage;
+
+    Job *_job;
+    MemoryAccount *_memory;
+
+    mutable boost::mutex _mutex;
+    boost::condition_variable _packetAvailable;
+    boost::condition_variable _spaceAvailable;
+
+    boost::thread _thread;
+
+    PacketReader(PacketReader const&); // Should not be implemented.
+
+    void operator=(PacketReader const&); // Should not be implemented.
+
+    /**
+     * The body of the read ahead thread.
+     */
+    void run();
+
+    /**
+     * Check to see if the buffer has room for another packet. The mutex must be held
+     * when this is called.
+     *
+     * @return true if another packet can be buffered, otherwise false.
+     */
+    bool hasSpace() const;
+
+public:
+    /**
+     * Instantiate a new <code>PacketReader</code> and start reading packets ahead
+     * from the supplied format context.
+     *
+     * @param formatContext - the format context to read packets from.
+     * @param maxPackets - the maximum number of packets to read ahead.
+     * @param maxBytes - the maximum number of packet bytes to read ahead.
+     */
+    PacketReader(AVFormatContext *formatContext,
+            size_t maxPackets = DEFAULT_READ_AHEAD_PACKETS,
+            size_t maxBytes = DEFAULT_READ_AHEAD_BYTES);
+
+    /**
+     * Stop the read ahead thread and free any packets that are still buffered.
+     */
+    ~PacketReader();
+
+    /**
+     * Read the next packet, blocking until one has been read ahead. The
+     * packet is charged like one from <code>libav::readNextPacket</code> and
+     * must be freed with <code>freePacket</code>.
+     *
+     * @return the next packet or NULL if the end of the file has been reached.
+     */
+    AVPacket* readNextPacket();
+
+    /**
+     * @return the format context that packets are being read from.
+     */
+    AVFormatContext* formatContext() const;
+
+    /**
+     * @return the number of packets currently buffered.
+     */
+    size_t bufferedPackets() const;
+
+    /**
+     * @return the number of packet bytes currently buffered.
+     */
+    size_t bufferedBytes() const;
+};
+
+/**
+ * Read the next packet from the supplied packet reader. The packet must be
+ * freed with <code>freePacket</code>.
+ *
+ * @param packetReader - the packet reader to read the packet from.
+ * @return the next packet or NULL if the end of the file has been reached.
+ */
+AVPacket* readNextPacket(PacketReader *packetReader);
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __PACKETREADER_HPP__ */
@@ -0,0 +1,373 @@
+/*
+ * pipeline.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+#include "libavutil/mathematics.h"
+#include "libswscale/swscale.h"
+}
+
+#include <error.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+#include <libav/pipeline.hpp>
+#include <libav/trace.hpp>
+
+#include <algorithm>
+
+using namespace std;
+
+
+/**
+ * @file pipeline.cpp
+ *
+ * The implementation of the pipeline.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+FramePipeline::FramePipeline(AVStream *input, const PipelineOptions& options,
+        const PacketSink& sink) : _decoder(NULL), _encoder(NULL), _encoderOpened(false),
+        _scaleContext(NULL), _scaled(NULL), _sink(sink), _framesDecoded(0), _framesEncoded(0),
+        _decodeErrors() {
+
+    if (NULL == input) {
+
+        throw IllegalArgumentException("The stream of a pipeline cannot be null.");
+    }
+
+    if (AVMEDIA_TYPE_VIDEO != findStreamType(input)) {
+
+        throw IllegalArgumentException("The stream of a pipeline must be a video stream.");
+    }
+
+    if (0 > options.width || 0 > options.height || 0 > options.bitRate
+            || 0 > options.quantizer) {
+
+        throw IllegalArgumentException(
+                "The size, bit rate and quantiser of a pipeline can't be negative.");
+    }
+
+    if (!sink) throw IllegalArgumentException("The sink of a pipeline cannot be empty.");
+
+    AVCodecContext *parameters = input->codec;
+
+    if (0 >= parameters->width || 0 >= parameters->height) {
+
+        throw IllegalStateException("The size of the video is not known.");
+    }
+
+    AVCodec *codec = avcodec_find_encoder_by_name(options.encoderName.c_str());
+
+    if (NULL == codec) {
+
+        throw CodecException("Could not find the " + options.encoderName + " encoder.");
+    }
+
+    int width = 0 < options.width ? options.width : parameters->width;
+    int height = 0 < options.height ? options.height
+            : static_cast<int>(av_rescale(width, parameters->height, parameters->width));
+
+    try {
+
+        // Frame threads each hold a frame of their own before any is returned.
+        parameters->thread_type = FF_THREAD_SLICE;
+
+        _decoder = openDecodeCodecContext(parameters);
+
+        _encoder = avcodec_alloc_context3(codec);
+
+        if (NULL == _encoder) throw IllegalStateException("Could not allocate an encoder.");
+
+        // The chroma planes of most encoders are half the size of the picture.
+        _encoder->width = max(2, width & ~1);
+        _encoder->height = max(2, height & ~1);
+        _encoder->pix_fmt = NULL != codec->pix_fmts ? codec->pix_fmts[0] : PIX_FMT_YUV420P;
+
+        if (0 < options.bitRate) _encoder->bit_rate = options.bitRate;
+
+        if (0 < options.quantizer) {
+
+            _encoder->flags |= CODEC_FLAG_QSCALE;
+            _encoder->global_quality = FF_QP2LAMBDA * options.quantizer;
+        }
+
+        _encoder->time_base.num = 1;
+        _encoder->time_base.den = 25;
+
+        if (0 < input->r_frame_rate.num && 0 < input->r_frame_rate.den) {
+
+            _encoder->time_base.num = input->r_frame_rate.den;
+            _encoder->time_base.den = input->r_frame_rate.num;
+        }
+
+        openEncodeCodecContext(_encoder, options.encodeOptions);
+
+        _encoderOpened = true;
+
+        _scaled = avcodec_alloc_frame();
+
+        if (NULL == _scaled || 0 > avpicture_alloc(reinterpret_cast<AVPicture*>(_scaled),
+                _encoder->pix_fmt, _encoder->width, _encoder->height)) {
+
+            throw IllegalStateException("Could not allocate a picture to scale into.");
+        }
+
+    } catch (...) {
+
+        release();
+
+        throw;
+    }
+}
+
+FramePipeline::~FramePipeline() {
+
+    release();
+}
+
+int FramePipeline::push(const AVPacket *packet) {
+
+    if (NULL == packet) {
+
+        throw IllegalArgumentException("The packet pushed to a pipeline cannot be null.");
+    }
+
+    TraceSpan span("pipelinePush");
+
+    AVFrame *frame = NULL;
+
+    DecodeResult result = tryDecodeVideoPacket(_decoder, packet, &frame);
+
+    _decodeErrors.add(result);
+
+    if (NULL == frame) return 0;
+
+    int written = 0;
+
+    try {
+
+        written = encode(frame);
+
+    } catch (...) {
+
+        freeFrame(&frame);
+
+        throw;
+    }
+
+    freeFrame(&frame);
+
+    return written;
+}
+
+int FramePipeline::finish() {
+
+    TraceSpan span("pipelineFinish");
+
+    int written = 0;
+
+    // A decoder with a delay still holds the last frames.
+    while (0 != (_decoder->codec->capabilities & CODEC_CAP_DELAY)) {
+
+        AVPacket flush;
+
+        av_init_packet(&flush);
+
+        flush.data = NULL;
+        flush.size = 0;
+
+        AVFrame *frame = NULL;
+
+        DecodeResult result = tryDecodeVideoPacket(_decoder, &flush, &frame);
+
+        _decodeErrors.add(result);
+
+        if (NULL == frame) break;
+
+        try {
+
+            written += encode(frame);
+
+        } catch (...) {
+
+            freeFrame(&frame);
+
+            throw;
+        }
+
+        freeFrame(&frame);
+    }
+
+    // A zero latency encoder holds nothing back, but any other may.
+    while (0 != (_encoder->codec->capabilities & CODEC_CAP_DELAY)) {
+
+        AVPacket packet;
+
+        av_init_packet(&packet);
+
+        packet.data = NULL;
+        packet.size = 0;
+
+        int packetEncoded = 0;
+
+        int errorCode = avcodec_encode_video2(_encoder, &packet, NULL, &packetEncoded);
+
+        if (0 > errorCode) throw CodecException(errorMessage(errorCode));
+
+        if (0 == packetEncoded) break;
+
+        try {
+
+            write(&packet);
+
+        } catch (...) {
+
+            av_free_packet(&packet);
+
+            throw;
+        }
+
+        av_free_packet(&packet);
+
+        written++;
+    }
+
+    return written;
+}
+
+const AVCodecContext* FramePipeline::encoder() const {
+
+    return _encoder;
+}
+
+int64_t FramePipeline::framesDecoded() const {
+
+    return _framesDecoded;
+}
+
+int64_t FramePipeline::framesEncoded() const {
+
+    return _framesEncoded;
+}
+
+const DecodeErrorCounts& FramePipeline::decodeErrors() const {
+
+    return _decodeErrors;
+}
+
+int FramePipeline::encode(const AVFrame *frame) {
+
+    AVFrame picture;
+
+    // A fresh frame, so the picture type of the decoded frame isn't forced on
+    // the encoder.
+    avcodec_get_frame_defaults(&picture);
+
+    if (_decoder->width == _encoder->width && _decoder->height == _encoder->height
+            && _decoder->pix_fmt == _encoder->pix_fmt) {
+
+        // The encoder only reads the picture, so it is encoded in place.
+        copy(frame->data, frame->data + 4, picture.data);
+        copy(frame->linesize, frame->linesize + 4, picture.linesize);
+
+    } else {
+
+        _scaleContext = sws_getCachedContext(_scaleContext,
+                _decoder->width, _decoder->height, _decoder->pix_fmt,
+                _encoder->width, _encoder->height, _encoder->pix_fmt,
+                SWS_BILINEAR, NULL, NULL, NULL);
+
+        if (NULL == _scaleContext) {
+
+            throw CodecException("Could not scale the video to the size of the pipeline.");
+        }
+
+        sws_scale(_scaleContext, frame->data, frame->linesize, 0, _decoder->height,
+                _scaled->data, _scaled->linesize);
+
+        copy(_scaled->data, _scaled->data + 4, picture.data);
+        copy(_scaled->linesize, _scaled->linesize + 4, picture.linesize);
+    }
+
+    picture.pts = _framesDecoded;
+
+    _framesDecoded++;
+
+    AVPacket *packet = encodeVideoFrame(_encoder, &picture);
+
+    if (NULL == packet) return 0;
+
+    try {
+
+        write(packet);
+
+    } catch (...) {
+
+        freePacket(&packet);
+
+        throw;
+    }
+
+    freePacket(&packet);
+
+    return 1;
+}
+
+void FramePipeline::write(AVPacket *packet) {
+
+    packet->stream_index = 0;
+
+    _sink(packet);
+
+    _framesEncoded++;
+}
+
+void FramePipeline::release() {
+
+    if (NULL != _scaleContext) {
+
+        sws_freeContext(_scaleContext);
+
+        _scaleContext = NULL;
+    }
+
+    if (NULL != _scaled) {
+
+        avpicture_free(reinterpret_cast<AVPicture*>(_scaled));
+
+        av_free(_scaled);
+
+        _scaled = NULL;
+    }
+
+    try {
+
+        if (NULL != _encoder) {
+
+            AVCodecContext *encoder = _encoder;
+
+            _encoder = NULL;
+
+            if (_encoderOpened) closeCodecContext(&encoder);
+
+            av_free(encoder);
+        }
+
+        if (NULL != _decoder) closeCodecContext(&_decoder);
+
+    } catch (const exception&) {
+
+        // There is nothing more that can be done for a pipeline being torn down.
+    }
+}
+
+} /* namespace libav */
+} /* namespace transcode */
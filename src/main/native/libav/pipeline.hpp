@@ -0,0 +1,203 @@
+/*
+ * pipeline.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __PIPELINE_HPP__
+#define __PIPELINE_HPP__
+
+#include <libav/libav.hpp>
+
+#include <stdint.h>
+#include <string>
+
+#include <tr1/functional>
+
+/**
+ * @file pipeline.hpp
+ *
+ * A transcode of a single video stream that works on one frame at a time, for
+ * interactive use where every frame has to be out as soon as it is in.
+ *
+ * Each packet is decoded, scaled and encoded on the calling thread, and the
+ * encoded packet is handed to the sink before the call returns. Nothing is
+ * queued between the stages and nothing is batched, the decoder is opened with
+ * slice threads instead of frame threads and the encoder with the zero latency
+ * profile by default. A stream with B-frames is still held back by the decoder
+ * for as long as it takes to put its frames back in order.
+ */
+
+struct AVStream;
+struct SwsContext;
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * Called with every encoded packet as soon as it is encoded. The timestamps of
+ * the packet are in the time base of the encoder and its stream index is 0.
+ *
+ * Note: The packet is freed once the sink returns, so the sink must not hold
+ * on to it.
+ */
+typedef std::tr1::function<void(AVPacket *packet)> PacketSink;
+
+/**
+ * How the frames of a pipeline are encoded.
+ */
+struct PipelineOptions {
+
+    /**
+     * The name of the encoder.
+     */
+    std::string encoderName;
+
+    /**
+     * The width in pixels, or 0 to keep the width of the video.
+     */
+    int width;
+
+    /**
+     * The height in pixels, or 0 to keep the aspect ratio of the video.
+     */
+    int height;
+
+    /**
+     * The bit rate in bits per second, or 0 for the default of the encoder.
+     */
+    int bitRate;
+
+    /**
+     * A fixed quantiser to encode every frame with instead of the bit rate,
+     * from 1 for the best quality to 31, or 0 to use the bit rate. Without
+     * rate control each frame is encoded the same whatever came before it.
+     */
+    int quantizer;
+
+    /**
+     * How the encoder is opened, with the zero latency profile unless set
+     * otherwise.
+     */
+    EncodeOptions encodeOptions;
+
+    PipelineOptions() : encoderName("mpeg4"), width(0), height(0), bitRate(0), quantizer(0),
+            encodeOptions() {
+
+        encodeOptions.profile = ENCODE_ZERO_LATENCY;
+    }
+};
+
+/**
+ * Decodes the packets of a video stream and encodes each frame the moment it is
+ * decoded.
+ */
+class FramePipeline {
+
+private:
+    FramePipeline(FramePipeline const&); // Should not be implemented.
+
+    void operator=(FramePipeline const&); // Should not be implemented.
+
+    AVCodecContext *_decoder;
+    AVCodecContext *_encoder;
+    bool _encoderOpened;
+    SwsContext *_scaleContext;
+    AVFrame *_scaled;
+    PacketSink _sink;
+    int64_t _framesDecoded;
+    int64_t _framesEncoded;
+    DecodeErrorCounts _decodeErrors;
+
+    /**
+     * Encode the supplied decoded frame and hand its packet to the sink.
+     *
+     * @return the number of packets handed to the sink.
+     */
+    int encode(const AVFrame *frame);
+
+    /**
+     * Hand the supplied encoded packet to the sink.
+     */
+    void write(AVPacket *packet);
+
+    /**
+     * Free everything that is still held.
+     */
+    void release();
+
+public:
+    /**
+     * Instantiate a new <code>FramePipeline</code>, opening the decoder on the
+     * codec context of the supplied stream and the encoder.
+     *
+     * Note: The codec context of the stream is opened for decoding and closed
+     * again when the pipeline is destroyed.
+     *
+     * @param input - the video stream to decode.
+     * @param options - how the frames are encoded.
+     * @param sink - called with every encoded packet.
+     */
+    FramePipeline(AVStream *input, const PipelineOptions& options, const PacketSink& sink);
+
+    /**
+     * Close the decoder and the encoder.
+     */
+    ~FramePipeline();
+
+    /**
+     * Decode the supplied packet and encode the frame it decodes to, if any.
+     *
+     * A packet that fails to decode is counted in <code>decodeErrors</code>
+     * and skipped, the next packet is decoded as if it had never been pushed.
+     *
+     * @param packet - a packet of the stream the pipeline was opened on, it is
+     *      not freed.
+     * @return the number of encoded packets handed to the sink.
+     */
+    int push(const AVPacket *packet);
+
+    /**
+     * Encode the frames the decoder is still holding and write out the packets
+     * the encoder is still holding, at the end of the stream.
+     *
+     * @return the number of encoded packets handed to the sink.
+     */
+    int finish();
+
+    /**
+     * @return the opened encoder, to add an output stream for.
+     */
+    const AVCodecContext* encoder() const;
+
+    /**
+     * @return the number of frames decoded so far.
+     */
+    int64_t framesDecoded() const;
+
+    /**
+     * @return the number of packets handed to the sink so far.
+     */
+    int64_t framesEncoded() const;
+
+    /**
+     * @return the number of packets that failed to decode so far.
+     */
+    const DecodeErrorCounts& decodeErrors() const;
+};
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __PIPELINE_HPP__ */
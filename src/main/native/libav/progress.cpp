@@ -0,0 +1,162 @@
+/*
+ * progress.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#include <libav/counters.hpp>
+#include <libav/progress.hpp>
+
+#include <algorithm>
+
+using namespace std;
+
+
+/**
+ * @file progress.cpp
+ *
+ * The implementation of the progress.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+/**
+ * Raise the supplied value to the supplied amount if it is lower. The threads of
+ * a job can read in parallel, so the value is only ever raised with a compare
+ * and exchange, which is only paid for when the value moves forward.
+ */
+static inline void raise(boost::atomic<int64_t>& value, int64_t amount) {
+
+    int64_t current = value.load(boost::memory_order_relaxed);
+
+    while (amount > current && !value.compare_exchange_weak(current, amount,
+            boost::memory_order_relaxed)) {
+    }
+}
+
+
+double ProgressReport::fraction() const {
+
+    double fraction = 0;
+
+    if (0 < durationMicroseconds) {
+
+        fraction = static_cast<double>(mediaMicroseconds) / durationMicroseconds;
+
+    } else if (0 < totalBytes) {
+
+        fraction = static_cast<double>(bytesRead) / totalBytes;
+    }
+
+    return min(1.0, max(0.0, fraction));
+}
+
+int64_t ProgressReport::remainingMicroseconds() const {
+
+    double done = fraction();
+
+    if (0 >= done || 0 >= elapsedMicroseconds) return -1;
+
+    return static_cast<int64_t>(elapsedMicroseconds * (1 - done) / done);
+}
+
+Progress::Progress() : _mediaMicroseconds(0), _durationMicroseconds(0), _bytesRead(0),
+        _totalBytes(0), _framesDecoded(0), _startNanoseconds(monotonicNanoseconds()),
+        _input(NULL), _callback(), _intervalNanoseconds(0), _nextCallbackNanoseconds(0),
+        _calling(false) {
+}
+
+void Progress::inputOpened(const void *input, int64_t durationMicroseconds,
+        int64_t totalBytes) {
+
+    const void *open = NULL;
+
+    // Only the first of the inputs that are open at once starts over.
+    if (!_input.compare_exchange_strong(open, input, boost::memory_order_relaxed)) return;
+
+    _mediaMicroseconds.store(0, boost::memory_order_relaxed);
+    _bytesRead.store(0, boost::memory_order_relaxed);
+    _durationMicroseconds.store(max(static_cast<int64_t>(0), durationMicroseconds),
+            boost::memory_order_relaxed);
+    _totalBytes.store(max(static_cast<int64_t>(0), totalBytes), boost::memory_order_relaxed);
+    _framesDecoded.store(0, boost::memory_order_relaxed);
+    _startNanoseconds.store(monotonicNanoseconds(), boost::memory_order_relaxed);
+
+    _nextCallbackNanoseconds.store(0, boost::memory_order_relaxed);
+}
+
+void Progress::inputClosed(const void *input) {
+
+    const void *open = input;
+
+    _input.compare_exchange_strong(open, NULL, boost::memory_order_relaxed);
+}
+
+void Progress::packetRead(int64_t mediaMicroseconds, int64_t bytesRead) {
+
+    // The packets of different streams are interleaved, so the time only moves
+    // forward.
+    raise(_mediaMicroseconds, mediaMicroseconds);
+    raise(_bytesRead, bytesRead);
+
+    if (!_callback) return;
+
+    uint64_t now = monotonicNanoseconds();
+
+    if (now < _nextCallbackNanoseconds.load(boost::memory_order_relaxed)) return;
+
+    // Whichever thread claims the callback calls it, the others carry on.
+    if (_calling.exchange(true, boost::memory_order_acquire)) return;
+
+    // Another thread may have called it between the check and the claim.
+    if (now >= _nextCallbackNanoseconds.load(boost::memory_order_relaxed)) {
+
+        _nextCallbackNanoseconds.store(now + _intervalNanoseconds, boost::memory_order_relaxed);
+
+        try {
+
+            _callback(report());
+
+        } catch (...) {
+
+            _calling.store(false, boost::memory_order_release);
+
+            throw;
+        }
+    }
+
+    _calling.store(false, boost::memory_order_release);
+}
+
+void Progress::framesDecoded(uint64_t frames) {
+
+    _framesDecoded.fetch_add(frames, boost::memory_order_relaxed);
+}
+
+ProgressReport Progress::report() const {
+
+    ProgressReport report;
+
+    report.mediaMicroseconds = _mediaMicroseconds.load(boost::memory_order_relaxed);
+    report.durationMicroseconds = _durationMicroseconds.load(boost::memory_order_relaxed);
+    report.bytesRead = _bytesRead.load(boost::memory_order_relaxed);
+    report.totalBytes = _totalBytes.load(boost::memory_order_relaxed);
+    report.framesDecoded = _framesDecoded.load(boost::memory_order_relaxed);
+    report.elapsedMicroseconds = (monotonicNanoseconds()
+            - _startNanoseconds.load(boost::memory_order_relaxed)) / 1000;
+
+    return report;
+}
+
+void Progress::setCallback(const ProgressCallback& callback, int64_t intervalMilliseconds) {
+
+    _callback = callback;
+    _intervalNanoseconds = max(static_cast<int64_t>(0), intervalMilliseconds) * 1000000;
+    _nextCallbackNanoseconds.store(0, boost::memory_order_relaxed);
+}
+
+} /* namespace libav */
+} /* namespace transcode */
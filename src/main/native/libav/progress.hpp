@@ -0,0 +1,199 @@
+/*
+ * progress.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __PROGRESS_HPP__
+#define __PROGRESS_HPP__
+
+#include <boost/atomic.hpp>
+
+#include <stdint.h>
+
+#include <tr1/functional>
+
+/**
+ * @file progress.hpp
+ *
+ * How far along a job is, and how long it has left.
+ *
+ * The progress of a job is updated by <code>openFormatContext</code>,
+ * <code>readNextPacket</code> and the decode functions when they are called on
+ * a thread the job is bound to, so any loop built from them reports progress
+ * without doing anything itself. The updates are relaxed atomics, so the
+ * threads of a job can read the same input in parallel, and the only cost of
+ * reading the clock is paid when there is a callback to throttle.
+ */
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * The default least time between two calls of a progress callback.
+ */
+const int64_t DEFAULT_PROGRESS_INTERVAL_MILLISECONDS = 500;
+
+/**
+ * A snapshot of the progress of a job.
+ */
+struct ProgressReport {
+
+    /**
+     * The media time read so far, from the start of the input.
+     */
+    int64_t mediaMicroseconds;
+
+    /**
+     * The duration of the input, or 0 if the container doesn't say.
+     */
+    int64_t durationMicroseconds;
+
+    /**
+     * The bytes of the input read so far.
+     */
+    int64_t bytesRead;
+
+    /**
+     * The size of the input, or 0 if it isn't known, as for pipes.
+     */
+    int64_t totalBytes;
+
+    /**
+     * The number of audio and video frames decoded so far.
+     */
+    uint64_t framesDecoded;
+
+    /**
+     * The time since the input was opened.
+     */
+    int64_t elapsedMicroseconds;
+
+    ProgressReport() : mediaMicroseconds(0), durationMicroseconds(0), bytesRead(0),
+            totalBytes(0), framesDecoded(0), elapsedMicroseconds(0) {
+    }
+
+    /**
+     * @return how much of the input has been read, from 0 to 1, by media time
+     *      if the duration is known and by bytes otherwise, or 0 if neither is.
+     */
+    double fraction() const;
+
+    /**
+     * @return an estimate of the time left at the average pace so far, or -1
+     *      if there is nothing to base an estimate on yet.
+     */
+    int64_t remainingMicroseconds() const;
+};
+
+/**
+ * Called with the progress of a job on the thread that read the packet.
+ */
+typedef std::tr1::function<void(const ProgressReport& report)> ProgressCallback;
+
+/**
+ * The progress of a single job. It can be polled from any thread.
+ */
+class Progress {
+
+private:
+    boost::atomic<int64_t> _mediaMicroseconds;
+    boost::atomic<int64_t> _durationMicroseconds;
+    boost::atomic<int64_t> _bytesRead;
+    boost::atomic<int64_t> _totalBytes;
+    boost::atomic<uint64_t> _framesDecoded;
+    boost::atomic<uint64_t> _startNanoseconds;
+
+    // The input the progress was started over for, until it is closed.
+    boost::atomic<const void*> _input;
+
+    ProgressCallback _callback;
+    uint64_t _intervalNanoseconds;
+    boost::atomic<uint64_t> _nextCallbackNanoseconds;
+
+    // Set by the one thread that is calling the callback.
+    boost::atomic<bool> _calling;
+
+    Progress(Progress const&); // Should not be implemented.
+
+    void operator=(Progress const&); // Should not be implemented.
+
+public:
+    /**
+     * Instantiate a new <code>Progress</code> with nothing read.
+     */
+    Progress();
+
+    /**
+     * Start over with a newly opened input. A job that opens one input after
+     * another reports the progress of the last one opened. An input opened
+     * while the one the progress was started over for is still open adds to
+     * its progress instead, as the workers of a job that read the same file
+     * in parallel do.
+     *
+     * @param input - what identifies the input until it is closed.
+     * @param durationMicroseconds - the duration of the input, or 0 if it
+     *      isn't known.
+     * @param totalBytes - the size of the input, or 0 if it isn't known.
+     */
+    void inputOpened(const void *input, int64_t durationMicroseconds, int64_t totalBytes);
+
+    /**
+     * Record that the supplied input was closed, so the next input opened
+     * starts the progress over.
+     *
+     * @param input - what identified the input when it was opened.
+     */
+    void inputClosed(const void *input);
+
+    /**
+     * Record a packet read from the input, and call the callback if it is due.
+     *
+     * @param mediaMicroseconds - the media time of the packet from the start
+     *      of the input, or a negative number if it has no timestamp.
+     * @param bytesRead - the position in the input after the packet.
+     */
+    void packetRead(int64_t mediaMicroseconds, int64_t bytesRead);
+
+    /**
+     * Record the supplied number of decoded frames.
+     */
+    void framesDecoded(uint64_t frames);
+
+    /**
+     * @return a snapshot of the progress so far.
+     */
+    ProgressReport report() const;
+
+    /**
+     * Set the callback that is called as packets are read, at most once
+     * every interval.
+     *
+     * The callback is only ever called by one thread at a time, a thread that
+     * finds it due while another is calling it skips it.
+     *
+     * Note: Setting the callback is not synchronised with the reading
+     * threads, so it must be set before the job starts reading.
+     *
+     * @param callback - the callback, or an empty one for none.
+     * @param intervalMilliseconds - the least time between two calls.
+     */
+    void setCallback(const ProgressCallback& callback,
+            int64_t intervalMilliseconds = DEFAULT_PROGRESS_INTERVAL_MILLISECONDS);
+};
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __PROGRESS_HPP__ */
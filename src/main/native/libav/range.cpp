@@ -0,0 +1,437 @@
+/*
+ * range.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+}
+
+#include <error.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+#include <libav/packetreader.hpp>
+#include <libav/range.hpp>
+
+#include <deque>
+#include <vector>
+
+using namespace std;
+
+
+/**
+ * @file range.cpp
+ *
+ * The implementation of the range.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+/**
+ * The shared state of a <code>PacketRange</code> and all of its copies.
+ */
+struct PacketRangeState {
+
+    AVFormatContext *formatContext;
+    PacketReader *packetReader;
+
+    AVPacket *packet;
+
+    bool started;
+    bool finished;
+
+    PacketRangeState(AVFormatContext *fc, PacketReader *pr) :
+            formatContext(fc), packetReader(pr), packet(NULL), started(false),
+            finished(false) {
+    }
+
+    ~PacketRangeState() {
+
+        freePacket();
+    }
+
+    void freePacket() {
+
+        if (NULL == packet) return;
+
+        libav::freePacket(&packet);
+    }
+
+    /**
+     * Read the first packet if it hasn't been read yet.
+     */
+    void start() {
+
+        if (!started) advance();
+    }
+
+    /**
+     * Free the current packet and read the next one.
+     */
+    void advance() {
+
+        if (finished) return;
+
+        freePacket();
+
+        started = true;
+
+        packet = NULL == packetReader
+                ? readNextPacket(formatContext)
+                : readNextPacket(packetReader);
+
+        if (NULL == packet) finished = true;
+    }
+};
+
+/**
+ * The shared state of a <code>FrameRange</code> and all of its copies.
+ */
+struct FrameRangeState {
+
+    AVCodecContext *codecContext;
+    AVMediaType type;
+    int streamIndex;
+
+    // Keeps the packet range alive for as long as the frames are being decoded.
+    boost::shared_ptr<PacketRangeState> packets;
+
+    // Audio packets can decode into more than one frame so the extra frames
+    // wait here until they are iterated.
+    deque<AVFrame*> frames;
+
+    bool started;
+    bool packetDecoded;
+    bool draining;
+    bool finished;
+
+    FrameRangeState(AVCodecContext *cc, AVMediaType t, int index,
+            boost::shared_ptr<PacketRangeState> p) :
+            codecContext(cc), type(t), streamIndex(index), packets(p), frames(),
+            started(false), packetDecoded(false), draining(false), finished(false) {
+    }
+
+    ~FrameRangeState() {
+
+        while (!frames.empty()) {
+
+            freeFrame(&frames.front());
+
+            frames.pop_front();
+        }
+    }
+
+    /**
+     * Decode the first frame if it hasn't been decoded yet.
+     */
+    void start() {
+
+        if (started) return;
+
+        while (frames.empty() && !finished) decodeNext();
+
+        started = true;
+    }
+
+    /**
+     * Free the current frame and decode the next one.
+     */
+    void advance() {
+
+        start();
+
+        if (!frames.empty()) {
+
+            freeFrame(&frames.front());
+
+            frames.pop_front();
+        }
+
+        while (frames.empty() && !finished) decodeNext();
+    }
+
+    /**
+     * Decode the next packet that belongs to this ranges stream.
+     */
+    void decodeNext() {
+
+        if (draining) {
+
+            drain();
+
+            return;
+        }
+
+        // The first packet decoded is the one the packet range is currently on,
+        // so frames can be taken from a packet range that has already been
+        // partly iterated.
+        if (packetDecoded) {
+
+            packets->advance();
+
+        } else {
+
+            packets->start();
+        }
+
+        packetDecoded = true;
+
+        AVPacket *packet = packets->packet;
+
+        if (NULL == packet) {
+
+            // Codecs with a delay still hold frames once the packets run out.
+            draining = NULL != codecContext->codec
+                    && AVMEDIA_TYPE_VIDEO == type
+                    && 0 != (codecContext->codec->capabilities & CODEC_CAP_DELAY);
+
+            finished = !draining;
+
+            return;
+        }
+
+        if (streamIndex != packet->stream_index) return;
+
+        if (AVMEDIA_TYPE_VIDEO == type) {
+
+            AVFrame *frame = decodeVideoPacket(codecContext, packet);
+
+            if (NULL != frame) frames.push_back(frame);
+
+        } else {
+
+            vector<AVFrame*> decoded = decodeAudioPacket(codecContext, packet);
+
+            frames.insert(frames.end(), decoded.begin(), decoded.end());
+        }
+    }
+
+    /**
+     * Decode an empty packet to flush one of the frames held by the codec.
+     */
+    void drain() {
+
+        AVPacket packet;
+
+        av_init_packet(&packet);
+
+        packet.data = NULL;
+        packet.size = 0;
+
+        AVFrame *frame = decodeVideoPacket(codecContext, &packet);
+
+        if (NULL == frame) {
+
+            draining = false;
+            finished = true;
+
+            return;
+        }
+
+        frames.push_back(frame);
+    }
+};
+
+
+PacketRange::iterator::iterator() : _state(NULL) {
+}
+
+PacketRange::iterator::iterator(PacketRangeState *state) : _state(state) {
+}
+
+PacketRange::iterator::reference PacketRange::iterator::operator*() const {
+
+    if (NULL == _state || _state->finished) {
+
+        throw IllegalStateException("Cannot dereference the end of a PacketRange.");
+    }
+
+    return _state->packet;
+}
+
+PacketRange::iterator& PacketRange::iterator::operator++() {
+
+    if (NULL != _state) _state->advance();
+
+    return *this;
+}
+
+void PacketRange::iterator::operator++(int) {
+
+    ++(*this);
+}
+
+bool PacketRange::iterator::operator==(const iterator& other) const {
+
+    bool atEnd = NULL == _state || _state->finished;
+    bool otherAtEnd = NULL == other._state || other._state->finished;
+
+    if (atEnd || otherAtEnd) return atEnd == otherAtEnd;
+
+    return _state == other._state;
+}
+
+bool PacketRange::iterator::operator!=(const iterator& other) const {
+
+    return !(*this == other);
+}
+
+PacketRange::PacketRange(AVFormatContext *formatContext) :
+        _state(new PacketRangeState(formatContext, NULL)) {
+
+    if (NULL == formatContext) {
+
+        throw IllegalArgumentException(
+                "Cannot create a PacketRange for a NULL AVFormatContext");
+    }
+}
+
+PacketRange::PacketRange(PacketReader *packetReader) :
+        _state() {
+
+    if (NULL == packetReader) {
+
+        throw IllegalArgumentException(
+                "Cannot create a PacketRange for a NULL PacketReader");
+    }
+
+    _state.reset(new PacketRangeState(packetReader->formatContext(), packetReader));
+}
+
+PacketRange::iterator PacketRange::begin() {
+
+    _state->start();
+
+    return iterator(_state.get());
+}
+
+PacketRange::iterator PacketRange::end() {
+
+    return iterator();
+}
+
+AVFormatContext* PacketRange::formatContext() const {
+
+    return _state->formatContext;
+}
+
+
+FrameRange::iterator::iterator() : _state(NULL) {
+}
+
+FrameRange::iterator::iterator(FrameRangeState *state) : _state(state) {
+}
+
+FrameRange::iterator::reference FrameRange::iterator::operator*() const {
+
+    if (NULL == _state || _state->frames.empty()) {
+
+        throw IllegalStateException("Cannot dereference the end of a FrameRange.");
+    }
+
+    return _state->frames.front();
+}
+
+FrameRange::iterator& FrameRange::iterator::operator++() {
+
+    if (NULL != _state) _state->advance();
+
+    return *this;
+}
+
+void FrameRange::iterator::operator++(int) {
+
+    ++(*this);
+}
+
+bool FrameRange::iterator::operator==(const iterator& other) const {
+
+    bool atEnd = NULL == _state || _state->frames.empty();
+    bool otherAtEnd = NULL == other._state || other._state->frames.empty();
+
+    if (atEnd || otherAtEnd) return atEnd == otherAtEnd;
+
+    return _state == other._state;
+}
+
+bool FrameRange::iterator::operator!=(const iterator& other) const {
+
+    return !(*this == other);
+}
+
+FrameRange::FrameRange(AVCodecContext *codecContext, const PacketRange& packets) :
+        _state() {
+
+    AVMediaType type = findCodecType(codecContext);
+
+    if (AVMEDIA_TYPE_AUDIO != type && AVMEDIA_TYPE_VIDEO != type) {
+
+        throw IllegalArgumentException(
+                "The codec context for a FrameRange must have media type AVMEDIA_TYPE_AUDIO or AVMEDIA_TYPE_VIDEO.");
+    }
+
+    AVFormatContext *formatContext = packets.formatContext();
+
+    int streamIndex = -1;
+
+    // Find the stream the codec context belongs to so that packets from all the
+    // other streams can be skipped.
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+
+        if (codecContext == formatContext->streams[i]->codec) {
+
+            streamIndex = i;
+
+            break;
+        }
+    }
+
+    if (0 > streamIndex) {
+
+        throw IllegalArgumentException(
+                "The codec context for a FrameRange must belong to a stream of the packet ranges format context.");
+    }
+
+    _state.reset(new FrameRangeState(codecContext, type, streamIndex, packets._state));
+}
+
+FrameRange::iterator FrameRange::begin() {
+
+    _state->start();
+
+    return iterator(_state.get());
+}
+
+FrameRange::iterator FrameRange::end() {
+
+    return iterator();
+}
+
+int FrameRange::streamIndex() const {
+
+    return _state->streamIndex;
+}
+
+
+PacketRange packets(AVFormatContext *formatContext) {
+
+    return PacketRange(formatContext);
+}
+
+PacketRange packets(PacketReader *packetReader) {
+
+    return PacketRange(packetReader);
+}
+
+FrameRange frames(AVCodecContext *codecContext, const PacketRange& packets) {
+
+    return FrameRange(codecContext, packets);
+}
+
+} /* namespace libav */
+} /* namespace transcode */
@@ -0,0 +1,235 @@
+/*
+ * range.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __RANGE_HPP__
+#define __RANGE_HPP__
+
+#include <boost/shared_ptr.hpp>
+
+#include <cstddef>
+#include <iterator>
+
+/**
+ * @file range.hpp
+ *
+ * Lazy ranges over the packets of a format context and the frames decoded from
+ * them. Nothing is read or decoded until the range is iterated, so a scan can stop
+ * early without reading the rest of the file.
+ *
+ * For example, to look at the first ten key frame packets of a file:
+ *
+ * <pre>
+ * PacketRange range = packets(formatContext);
+ * int found = 0;
+ * for (PacketRange::iterator it = range.begin(); it != range.end() && 10 > found; ++it) {
+ *     if ((*it)->flags & AV_PKT_FLAG_KEY) found++;
+ * }
+ * </pre>
+ *
+ * Ranges are single pass. Copies of a range share the same position, and the
+ * packet or frame an iterator points at is only valid until the iterator is
+ * incremented or the range is destroyed, so anything that needs to be kept must
+ * be copied by the caller.
+ */
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVPacket;
+struct AVFrame;
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+class PacketReader;
+
+struct PacketRangeState;
+struct FrameRangeState;
+
+/**
+ * A single pass range over the packets of a format context, packets are read with
+ * <code>readNextPacket</code> only as the range is iterated.
+ */
+class PacketRange {
+
+private:
+    boost::shared_ptr<PacketRangeState> _state;
+
+    friend class FrameRange;
+
+public:
+    /**
+     * An input iterator over a <code>PacketRange</code>.
+     */
+    class iterator {
+
+    private:
+        PacketRangeState *_state;
+
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef AVPacket* value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef AVPacket* const* pointer;
+        typedef AVPacket* const& reference;
+
+        iterator();
+
+        explicit iterator(PacketRangeState *state);
+
+        reference operator*() const;
+
+        iterator& operator++();
+
+        void operator++(int);
+
+        bool operator==(const iterator& other) const;
+
+        bool operator!=(const iterator& other) const;
+    };
+
+    /**
+     * Instantiate a new <code>PacketRange</code> that reads directly from the
+     * supplied format context.
+     *
+     * @param formatContext - the format context to read packets from.
+     */
+    explicit PacketRange(AVFormatContext *formatContext);
+
+    /**
+     * Instantiate a new <code>PacketRange</code> that reads from the supplied
+     * read ahead packet reader.
+     *
+     * @param packetReader - the packet reader to read packets from.
+     */
+    explicit PacketRange(PacketReader *packetReader);
+
+    /**
+     * @return an iterator at the current packet of the range, reading the first
+     *      packet if none has been read yet.
+     */
+    iterator begin();
+
+    /**
+     * @return the iterator marking the end of the range.
+     */
+    iterator end();
+
+    /**
+     * @return the format context the packets are read from.
+     */
+    AVFormatContext* formatContext() const;
+};
+
+/**
+ * A single pass range over the frames decoded from one stream of a
+ * <code>PacketRange</code>. Packets from other streams are skipped without being
+ * decoded and packets are only read as the frames are needed.
+ */
+class FrameRange {
+
+private:
+    boost::shared_ptr<FrameRangeState> _state;
+
+public:
+    /**
+     * An input iterator over a <code>FrameRange</code>.
+     */
+    class iterator {
+
+    private:
+        FrameRangeState *_state;
+
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef AVFrame* value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef AVFrame* const* pointer;
+        typedef AVFrame* const& reference;
+
+        iterator();
+
+        explicit iterator(FrameRangeState *state);
+
+        reference operator*() const;
+
+        iterator& operator++();
+
+        void operator++(int);
+
+        bool operator==(const iterator& other) const;
+
+        bool operator!=(const iterator& other) const;
+    };
+
+    /**
+     * Instantiate a new <code>FrameRange</code> that decodes the packets of the
+     * supplied range that belong to the supplied codec context.
+     *
+     * @param codecContext - the opened audio or video codec context to decode
+     *      with, this must be the codec context of one of the streams of the
+     *      packet ranges format context.
+     * @param packets - the packets to decode.
+     */
+    FrameRange(AVCodecContext *codecContext, const PacketRange& packets);
+
+    /**
+     * @return an iterator at the current frame of the range, decoding the first
+     *      frame if none has been decoded yet.
+     */
+    iterator begin();
+
+    /**
+     * @return the iterator marking the end of the range.
+     */
+    iterator end();
+
+    /**
+     * @return the index of the stream the frames are decoded from.
+     */
+    int streamIndex() const;
+};
+
+/**
+ * Create a lazy range over the packets of the supplied format context.
+ *
+ * @param formatContext - the format context to read packets from.
+ * @return the new packet range.
+ */
+PacketRange packets(AVFormatContext *formatContext);
+
+/**
+ * Create a lazy range over the packets of the supplied packet reader.
+ *
+ * @param packetReader - the packet reader to read packets from.
+ * @return the new packet range.
+ */
+PacketRange packets(PacketReader *packetReader);
+
+/**
+ * Create a lazy range over the frames decoded from the supplied packets with the
+ * supplied codec context.
+ *
+ * @param codecContext - the opened audio or video codec context to decode with.
+ * @param packets - the packets to decode.
+ * @return the new frame range.
+ */
+FrameRange frames(AVCodecContext *codecContext, const PacketRange& packets);
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __RANGE_HPP__ */
@@ -0,0 +1,139 @@
+/*
+ * resilient.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+}
+
+#include <error.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+#include <libav/resilient.hpp>
+
+using namespace std;
+
+
+/**
+ * @file resilient.cpp
+ *
+ * The implementation of the resilient.hpp classes.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+/**
+ * Find the best timestamp for the supplied packet.
+ *
+ * @param packet - the packet to find the timestamp of.
+ * @return the packets presentation time, or its decode time if it has no
+ *      presentation time.
+ */
+static int64_t packetTime(const AVPacket *packet) {
+
+    return AV_NOPTS_VALUE != packet->pts ? packet->pts : packet->dts;
+}
+
+ResilientDecoder::ResilientDecoder(AVCodecContext *codecContext) :
+        _codecContext(codecContext), _type(findCodecType(codecContext)),
+        _resyncing(false), _gaps() {
+
+    if (AVMEDIA_TYPE_AUDIO != _type && AVMEDIA_TYPE_VIDEO != _type) {
+
+        throw IllegalArgumentException(
+                "The codec context for a ResilientDecoder must have media type AVMEDIA_TYPE_AUDIO or AVMEDIA_TYPE_VIDEO.");
+    }
+}
+
+void ResilientDecoder::extendGap(const AVPacket *packet) {
+
+    DecodeGap& gap = _gaps.back();
+
+    int64_t time = packetTime(packet);
+
+    gap.packetCount++;
+
+    if (AV_NOPTS_VALUE == time) return;
+
+    if (AV_NOPTS_VALUE == gap.startTime) gap.startTime = time;
+
+    gap.endTime = time + packet->duration;
+}
+
+vector<AVFrame*> ResilientDecoder::decodePacket(const AVPacket *packet) {
+
+    if (NULL == packet) {
+
+        throw IllegalArgumentException("The packet for decoding cannot be null.");
+    }
+
+    vector<AVFrame*> frames;
+
+    if (_resyncing) {
+
+        // Anything other than a key frame depends on the frames that were lost, so
+        // it would only decode into garbage or fail again.
+        if (0 == (packet->flags & AV_PKT_FLAG_KEY)) {
+
+            extendGap(packet);
+
+            return frames;
+        }
+
+        _resyncing = false;
+    }
+
+    DecodeResult result;
+
+    if (AVMEDIA_TYPE_VIDEO == _type) {
+
+        AVFrame *frame = NULL;
+
+        result = tryDecodeVideoPacket(_codecContext, packet, &frame);
+
+        if (NULL != frame) frames.push_back(frame);
+
+    } else {
+
+        result = tryDecodeAudioPacket(_codecContext, packet, frames);
+    }
+
+    if (result.succeeded()) return frames;
+
+    // Drop whatever the codec was holding from before the damage and start a
+    // new gap that lasts until the next key frame.
+    avcodec_flush_buffers(_codecContext);
+
+    DecodeGap gap;
+
+    gap.startTime = AV_NOPTS_VALUE;
+    gap.endTime = AV_NOPTS_VALUE;
+    gap.result = result;
+
+    _gaps.push_back(gap);
+
+    extendGap(packet);
+
+    _resyncing = true;
+
+    return frames;
+}
+
+bool ResilientDecoder::resyncing() const {
+
+    return _resyncing;
+}
+
+const vector<DecodeGap>& ResilientDecoder::gaps() const {
+
+    return _gaps;
+}
+
+} /* namespace libav */
+} /* namespace transcode */
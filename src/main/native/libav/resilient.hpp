@@ -0,0 +1,129 @@
+/*
+ * resilient.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __RESILIENT_HPP__
+#define __RESILIENT_HPP__
+
+#include <libav/libav.hpp>
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @file resilient.hpp
+ *
+ * A decoder that carries on past damaged packets instead of failing.
+ */
+
+struct AVCodecContext;
+struct AVPacket;
+struct AVFrame;
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * A run of packets that were not decoded because of damaged data.
+ */
+struct DecodeGap {
+
+    /**
+     * The time of the first packet in the gap, in the streams time base. This is
+     * AV_NOPTS_VALUE if the packet had no timestamp.
+     */
+    int64_t startTime;
+
+    /**
+     * The time just after the last packet in the gap, in the streams time base.
+     * This is AV_NOPTS_VALUE if the packet had no timestamp.
+     */
+    int64_t endTime;
+
+    /**
+     * The number of packets that were not decoded, including the damaged one.
+     */
+    int packetCount;
+
+    /**
+     * The result of the failed decode that started the gap.
+     */
+    DecodeResult result;
+
+    DecodeGap() : startTime(0), endTime(0), packetCount(0), result() {
+    }
+};
+
+/**
+ * A <code>ResilientDecoder</code> decodes the packets of one stream and survives
+ * damaged packets. When a packet fails to decode the codec is flushed and every
+ * packet up to the next key frame is skipped, and the skipped time range is
+ * recorded as a <code>DecodeGap</code>. Damaged inputs can then be decoded in a
+ * single pass instead of failing on the first bad packet.
+ */
+class ResilientDecoder {
+
+private:
+    AVCodecContext *_codecContext;
+    AVMediaType _type;
+
+    bool _resyncing;
+
+    std::vector<DecodeGap> _gaps;
+
+    /**
+     * Add the supplied packet to the current gap.
+     *
+     * @param packet - the packet that was not decoded.
+     */
+    void extendGap(const AVPacket *packet);
+
+public:
+    /**
+     * Instantiate a new <code>ResilientDecoder</code> that decodes with the
+     * supplied codec context.
+     *
+     * @param codecContext - the opened audio or video codec context to decode with.
+     */
+    ResilientDecoder(AVCodecContext *codecContext);
+
+    /**
+     * Decode the supplied packet. If the packet is being skipped while waiting for
+     * a key frame no frames are returned, and if it is damaged only the frames
+     * decoded before the damage are returned.
+     *
+     * @param packet - the packet to decode, this must belong to the stream of the
+     *      decoders codec context.
+     * @return the frames that were decoded from the packet, these must be freed by
+     *      the caller.
+     */
+    std::vector<AVFrame*> decodePacket(const AVPacket *packet);
+
+    /**
+     * @return true if packets are being skipped until the next key frame.
+     */
+    bool resyncing() const;
+
+    /**
+     * @return the gaps that have been skipped so far, in the order they happened.
+     */
+    const std::vector<DecodeGap>& gaps() const;
+};
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __RESILIENT_HPP__ */
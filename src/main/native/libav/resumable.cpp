@@ -0,0 +1,659 @@
+/*
+ * resumable.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+#include "libavutil/mathematics.h"
+}
+
+#include <error.hpp>
+#include <libav/cache.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+#include <libav/pipeline.hpp>
+#include <libav/resumable.hpp>
+#include <libav/trace.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+
+/**
+ * @file resumable.cpp
+ *
+ * The implementation of the resumable.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+static const AVRational MILLISECONDS = { 1, 1000 };
+
+// The container every segment is written in.
+static const string SEGMENT_FORMAT = "mpegts";
+static const string SEGMENT_EXTENSION = ".ts";
+
+// The first line of every journal, changed if the format of the journal is.
+static const string JOURNAL_HEADER = "transcode-journal 1";
+
+/**
+ * A finished segment, as it is recorded in the journal.
+ */
+struct JournalEntry {
+
+    int index;
+    int64_t firstFrame;
+    int64_t frames;
+
+    // The timestamp of the input key frame the next segment starts at, or
+    // AV_NOPTS_VALUE if this is the last segment.
+    int64_t nextTimestamp;
+};
+
+/**
+ * @return the path of the segment at the supplied index.
+ */
+static string segmentFileName(const ResumableOptions& options, int index) {
+
+    ostringstream name;
+
+    name << options.segmentPrefix << setw(5) << setfill('0') << index << SEGMENT_EXTENSION;
+
+    return (boost::filesystem::path(options.directory) / name.str()).string();
+}
+
+/**
+ * @return the timestamp a packet is known by, its presentation timestamp if it
+ *      has one and its decode timestamp otherwise.
+ */
+static int64_t packetTimestamp(const AVPacket *packet) {
+
+    return AV_NOPTS_VALUE != packet->pts ? packet->pts : packet->dts;
+}
+
+/**
+ * The segments of a transcode that are finished, kept in a text file with a
+ * line for each segment.
+ *
+ * The journal only ever has lines added to the end of it, so a process that
+ * dies while writing to it can leave at most the last line incomplete, which
+ * is ignored when the journal is loaded again.
+ */
+class Journal {
+
+private:
+    Journal(Journal const&); // Should not be implemented.
+
+    void operator=(Journal const&); // Should not be implemented.
+
+    string _fileName;
+    string _signature;
+    vector<JournalEntry> _entries;
+    bool _finished;
+
+    /**
+     * Add the supplied line to the end of the journal.
+     */
+    void appendLine(const string& line) const {
+
+        ofstream out(_fileName.c_str(), ios::out | ios::app);
+
+        out << line << "\n";
+
+        out.flush();
+
+        if (!out) throw IOException("Could not write to the journal " + _fileName);
+    }
+
+public:
+    Journal(const ResumableOptions& options, const string& signature) :
+            _fileName((boost::filesystem::path(options.directory) / JOURNAL_NAME).string()),
+            _signature(signature), _entries(), _finished(false) {
+    }
+
+    /**
+     * Load the segments of the journal that are still usable: those written
+     * for the same input and options, one after the other, whose files are
+     * still there.
+     */
+    void load(const ResumableOptions& options) {
+
+        _entries.clear();
+        _finished = false;
+
+        ifstream in(_fileName.c_str());
+
+        string line;
+
+        if (!getline(in, line) || JOURNAL_HEADER != line) return;
+
+        if (!getline(in, line) || _signature != line) return;
+
+        while (getline(in, line)) {
+
+            istringstream fields(line);
+
+            string kind;
+
+            fields >> kind;
+
+            if ("finished" == kind) {
+
+                _finished = !_entries.empty()
+                        && AV_NOPTS_VALUE == _entries.back().nextTimestamp;
+
+                return;
+            }
+
+            JournalEntry entry;
+
+            fields >> entry.index >> entry.firstFrame >> entry.frames >> entry.nextTimestamp;
+
+            int64_t firstFrame = _entries.empty() ? 0
+                    : _entries.back().firstFrame + _entries.back().frames;
+
+            if ("segment" != kind || !fields || static_cast<int>(_entries.size()) != entry.index
+                    || firstFrame != entry.firstFrame || 0 > entry.frames
+                    || !boost::filesystem::exists(segmentFileName(options, entry.index))) {
+
+                return;
+            }
+
+            // Nothing can come after the last segment.
+            if (!_entries.empty() && AV_NOPTS_VALUE == _entries.back().nextTimestamp) return;
+
+            _entries.push_back(entry);
+        }
+    }
+
+    /**
+     * Write the journal again with only the segments that were loaded, so a
+     * torn last line isn't followed by new ones.
+     */
+    void rewrite() const {
+
+        string temporaryFileName = _fileName + ".tmp";
+
+        {
+            ofstream out(temporaryFileName.c_str(), ios::out | ios::trunc);
+
+            out << JOURNAL_HEADER << "\n" << _signature << "\n";
+
+            for (size_t i = 0; i < _entries.size(); i++) {
+
+                out << "segment " << _entries[i].index << " " << _entries[i].firstFrame << " "
+                        << _entries[i].frames << " " << _entries[i].nextTimestamp << "\n";
+            }
+
+            if (_finished) out << "finished\n";
+
+            if (!out) throw IOException("Could not write the journal " + temporaryFileName);
+        }
+
+        if (0 != rename(temporaryFileName.c_str(), _fileName.c_str())) {
+
+            throw IOException("Could not replace the journal " + _fileName);
+        }
+    }
+
+    /**
+     * Record the supplied segment as finished.
+     */
+    void append(const JournalEntry& entry) {
+
+        ostringstream line;
+
+        line << "segment " << entry.index << " " << entry.firstFrame << " " << entry.frames
+                << " " << entry.nextTimestamp;
+
+        appendLine(line.str());
+
+        _entries.push_back(entry);
+    }
+
+    /**
+     * Record the transcode as finished, after its last segment.
+     */
+    void finish() {
+
+        appendLine("finished");
+
+        _finished = true;
+    }
+
+    const vector<JournalEntry>& entries() const {
+
+        return _entries;
+    }
+
+    bool finished() const {
+
+        return _finished;
+    }
+};
+
+/**
+ * Where the packets of the segment being encoded are written.
+ */
+struct SegmentOutput {
+
+    AVFormatContext *output;
+    int64_t firstFrame;
+    AVRational timeBase;
+};
+
+/**
+ * Writes the packets of a pipeline to a segment, counting the frames on from
+ * the frames of the segments before it.
+ */
+struct SegmentSink {
+
+    SegmentOutput *segment;
+
+    void operator()(AVPacket *packet) const {
+
+        AVRational timeBase = segment->output->streams[0]->time_base;
+
+        if (AV_NOPTS_VALUE != packet->pts) {
+
+            packet->pts = av_rescale_q(packet->pts + segment->firstFrame, segment->timeBase,
+                    timeBase);
+        }
+
+        if (AV_NOPTS_VALUE != packet->dts) {
+
+            packet->dts = av_rescale_q(packet->dts + segment->firstFrame, segment->timeBase,
+                    timeBase);
+        }
+
+        packet->duration = av_rescale_q(packet->duration, segment->timeBase, timeBase);
+
+        writePacket(segment->output, packet);
+    }
+};
+
+/**
+ * A segment being encoded, with a decoder and encoder of its own.
+ */
+class ResumableSegment {
+
+private:
+    ResumableSegment(ResumableSegment const&); // Should not be implemented.
+
+    void operator=(ResumableSegment const&); // Should not be implemented.
+
+    SegmentOutput _segment;
+    FramePipeline *_pipeline;
+
+    /**
+     * Free everything that is still held.
+     */
+    void release() {
+
+        try {
+
+            // A segment that wasn't finished is written again when the
+            // transcode is resumed.
+            if (NULL != _segment.output) closeOutputFormatContext(&_segment.output);
+
+        } catch (const exception&) {
+
+            // There is nothing more that can be done for a segment that failed.
+        }
+
+        delete _pipeline;
+
+        _pipeline = NULL;
+    }
+
+public:
+    ResumableSegment(AVStream *input, const ResumableOptions& options, int index,
+            int64_t firstFrame) : _segment(), _pipeline(NULL) {
+
+        TraceSpan span("startResumableSegment");
+
+        _segment.output = NULL;
+        _segment.firstFrame = firstFrame;
+
+        SegmentSink sink = { &_segment };
+
+        _pipeline = new FramePipeline(input, options.pipeline, sink);
+
+        try {
+
+            _segment.timeBase = _pipeline->encoder()->time_base;
+            _segment.output = openOutputFormatContext(segmentFileName(options, index),
+                    SEGMENT_FORMAT);
+
+            addOutputStream(_segment.output, _pipeline->encoder());
+
+            writeOutputHeader(_segment.output);
+
+        } catch (...) {
+
+            release();
+
+            throw;
+        }
+    }
+
+    ~ResumableSegment() {
+
+        release();
+    }
+
+    void push(const AVPacket *packet) {
+
+        _pipeline->push(packet);
+    }
+
+    /**
+     * Encode what the pipeline is still holding and close the segment.
+     *
+     * @return the number of frames in the segment.
+     */
+    int64_t finish() {
+
+        TraceSpan span("finishResumableSegment");
+
+        _pipeline->finish();
+
+        closeOutputFormatContext(&_segment.output);
+
+        return _pipeline->framesEncoded();
+    }
+};
+
+/**
+ * @return a line that is only the same for the same input and options.
+ */
+static string signature(const string& fileName, AVFormatContext *formatContext,
+        const ResumableOptions& options) {
+
+    const PipelineOptions& pipeline = options.pipeline;
+
+    // Another file with the same size and duration can be put in the place of
+    // the input between runs, so its contents are hashed. A sampled hash
+    // misses changes between the samples, which the modification time catches
+    // for a file changed in place. An input that isn't a file, such as a URL,
+    // can only be told apart by its name.
+    string contents = fileName;
+
+    try {
+
+        if (boost::filesystem::is_regular_file(fileName)) {
+
+            ostringstream identity;
+
+            identity << hashFile(fileName, options.hashSampleBytes) << "-"
+                    << boost::filesystem::last_write_time(fileName);
+
+            contents = identity.str();
+        }
+
+    } catch (const boost::filesystem::filesystem_error& e) {
+
+        throw IOException(e.what());
+    }
+
+    ostringstream line;
+
+    line << "signature " << contents
+            << " " << (NULL != formatContext->pb ? avio_size(formatContext->pb) : 0)
+            << " " << formatContext->duration << " " << formatContext->nb_streams
+            << " " << pipeline.encoderName << " " << pipeline.width << " " << pipeline.height
+            << " " << pipeline.bitRate << " " << pipeline.quantizer
+            << " " << pipeline.encodeOptions.profile << " " << pipeline.encodeOptions.slices
+            << " " << options.segmentMilliseconds << " " << options.segmentPrefix;
+
+    return line.str();
+}
+
+/**
+ * Seek the input to the key frame the next segment starts at.
+ *
+ * @return the packet of that key frame.
+ */
+static AVPacket* seekToSegment(AVFormatContext *formatContext, int streamIndex,
+        int64_t timestamp) {
+
+    TraceSpan span("seekToSegment");
+
+    if (0 > av_seek_frame(formatContext, streamIndex, timestamp, AVSEEK_FLAG_BACKWARD)) {
+
+        throw IllegalStateException("Could not seek to the segment to resume from.");
+    }
+
+    // The seek lands on the key frame at or before the timestamp, the packets
+    // up to the segment belong to the segments before it.
+    for (AVPacket *packet = readNextPacket(formatContext); NULL != packet;
+            packet = readNextPacket(formatContext)) {
+
+        if (streamIndex == packet->stream_index && timestamp == packetTimestamp(packet)
+                && 0 != (packet->flags & AV_PKT_FLAG_KEY)) {
+
+            return packet;
+        }
+
+        freePacket(&packet);
+    }
+
+    throw IllegalStateException("Could not find the key frame to resume from.");
+}
+
+/**
+ * Encode the segments from the supplied packet to the end of the input,
+ * recording each in the journal as it is finished.
+ */
+static void encodeSegments(AVFormatContext *formatContext, int streamIndex, AVPacket *packet,
+        const ResumableOptions& options, Journal& journal, ResumableResult& result) {
+
+    AVStream *stream = formatContext->streams[streamIndex];
+
+    int index = journal.entries().size();
+
+    int64_t firstFrame = journal.entries().empty() ? 0
+            : journal.entries().back().firstFrame + journal.entries().back().frames;
+
+    int64_t segmentStart = AV_NOPTS_VALUE;
+
+    boost::shared_ptr<ResumableSegment> segment;
+
+    try {
+
+        segment.reset(new ResumableSegment(stream, options, index, firstFrame));
+
+        while (NULL != packet) {
+
+            if (streamIndex == packet->stream_index) {
+
+                int64_t timestamp = packetTimestamp(packet);
+
+                int64_t milliseconds = AV_NOPTS_VALUE != timestamp
+                        ? av_rescale_q(timestamp, stream->time_base, MILLISECONDS)
+                        : AV_NOPTS_VALUE;
+
+                if (AV_NOPTS_VALUE != milliseconds && AV_NOPTS_VALUE == segmentStart) {
+
+                    segmentStart = milliseconds;
+
+                } else if (AV_NOPTS_VALUE != milliseconds
+                        && 0 != (packet->flags & AV_PKT_FLAG_KEY)
+                        && options.segmentMilliseconds <= milliseconds - segmentStart) {
+
+                    JournalEntry entry = { index, firstFrame, segment->finish(), timestamp };
+
+                    segment.reset();
+
+                    journal.append(entry);
+
+                    result.segmentsWritten++;
+
+                    index++;
+                    firstFrame += entry.frames;
+                    segmentStart = milliseconds;
+
+                    segment.reset(new ResumableSegment(stream, options, index, firstFrame));
+                }
+
+                segment->push(packet);
+            }
+
+            freePacket(&packet);
+
+            packet = readNextPacket(formatContext);
+        }
+
+    } catch (...) {
+
+        if (NULL != packet) freePacket(&packet);
+
+        throw;
+    }
+
+    JournalEntry entry = { index, firstFrame, segment->finish(), AV_NOPTS_VALUE };
+
+    segment.reset();
+
+    journal.append(entry);
+    journal.finish();
+
+    result.segmentsWritten++;
+}
+
+/**
+ * Write the segments of the journal one after the other to the output file.
+ */
+static void concatenate(const Journal& journal, const ResumableOptions& options,
+        const string& outputFileName) {
+
+    TraceSpan span("concatenateSegments");
+
+    string temporaryFileName = outputFileName + ".tmp";
+
+    {
+        ofstream out(temporaryFileName.c_str(), ios::out | ios::trunc | ios::binary);
+
+        for (size_t i = 0; i < journal.entries().size(); i++) {
+
+            string fileName = segmentFileName(options, journal.entries()[i].index);
+
+            ifstream in(fileName.c_str(), ios::in | ios::binary);
+
+            if (!in) throw IOException("Could not read the segment " + fileName);
+
+            out << in.rdbuf();
+        }
+
+        if (!out) throw IOException("Could not write the output " + temporaryFileName);
+    }
+
+    if (0 != rename(temporaryFileName.c_str(), outputFileName.c_str())) {
+
+        throw IOException("Could not replace the output " + outputFileName);
+    }
+}
+
+/**
+ * Finish the transcode of the supplied opened input.
+ */
+static ResumableResult resume(const string& fileName, AVFormatContext *formatContext,
+        const string& outputFileName, const ResumableOptions& options) {
+
+    int streamIndex = -1;
+
+    for (unsigned int i = 0; i < formatContext->nb_streams && 0 > streamIndex; i++) {
+
+        if (AVMEDIA_TYPE_VIDEO == findStreamType(formatContext->streams[i])) streamIndex = i;
+    }
+
+    if (0 > streamIndex) throw IllegalStateException("There is no video stream to transcode.");
+
+    Journal journal(options, signature(fileName, formatContext, options));
+
+    journal.load(options);
+    journal.rewrite();
+
+    ResumableResult result;
+
+    result.segmentsResumed = journal.entries().size();
+
+    if (!journal.finished()) {
+
+        AVPacket *packet = journal.entries().empty() ? readNextPacket(formatContext)
+                : seekToSegment(formatContext, streamIndex,
+                        journal.entries().back().nextTimestamp);
+
+        encodeSegments(formatContext, streamIndex, packet, options, journal, result);
+    }
+
+    for (size_t i = 0; i < journal.entries().size(); i++) {
+
+        result.framesEncoded += journal.entries()[i].frames;
+    }
+
+    concatenate(journal, options, outputFileName);
+
+    return result;
+}
+
+
+ResumableResult transcodeResumable(const string& fileName, const string& outputFileName,
+        const ResumableOptions& options) {
+
+    if (options.directory.empty() || outputFileName.empty()) {
+
+        throw IllegalArgumentException(
+                "The segment directory and output file of a resumable transcode cannot be empty.");
+    }
+
+    if (0 >= options.segmentMilliseconds) {
+
+        throw IllegalArgumentException("The length of a segment must be positive.");
+    }
+
+    try {
+
+        boost::filesystem::create_directories(options.directory);
+
+    } catch (const boost::filesystem::filesystem_error& e) {
+
+        throw IOException(e.what());
+    }
+
+    AVFormatContext *formatContext = openFormatContext(fileName);
+
+    ResumableResult result;
+
+    try {
+
+        result = resume(fileName, formatContext, outputFileName, options);
+
+    } catch (...) {
+
+        closeFormatContext(&formatContext);
+
+        throw;
+    }
+
+    closeFormatContext(&formatContext);
+
+    return result;
+}
+
+} /* namespace libav */
+} /* namespace transcode */
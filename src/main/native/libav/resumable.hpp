@@ -0,0 +1,153 @@
+/*
+ * resumable.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __RESUMABLE_HPP__
+#define __RESUMABLE_HPP__
+
+#include <libav/pipeline.hpp>
+#include <libav/segmenter.hpp>
+
+#include <stdint.h>
+#include <string>
+
+/**
+ * @file resumable.hpp
+ *
+ * A transcode of the first video stream of a file into MPEG-TS that can be
+ * picked up where it left off after the process dies.
+ *
+ * The video is encoded as a run of segments, each of which starts at a key
+ * frame of the input and is decoded and encoded from scratch, with a fresh
+ * decoder and encoder. Every finished segment is recorded in a journal in the
+ * segment directory. A transcode started again with the same input and options
+ * keeps the segments in the journal, an input is told apart from another by a
+ * hash of its contents and its modification time, seeks the input to the key frame the next
+ * segment starts at and carries on from there.
+ *
+ * Nothing a segment is encoded from depends on the segments before it, so as
+ * long as the encoder has no rate control state to carry over, which is why a
+ * fixed quantiser is used by default, the output is the same byte for byte as
+ * a transcode that was never interrupted. The output file is the segments one
+ * after the other, which is still a valid MPEG-TS stream.
+ */
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * The default fixed quantiser of a resumable transcode.
+ */
+const int DEFAULT_RESUMABLE_QUANTIZER = 4;
+
+/**
+ * The default number of bytes hashed from each of the start, middle and end of
+ * the input of a resumable transcode to tell it apart from another input.
+ */
+const uint64_t DEFAULT_RESUMABLE_HASH_SAMPLE_BYTES = 1024 * 1024;
+
+/**
+ * The name of the journal in the segment directory.
+ */
+const std::string JOURNAL_NAME = "journal";
+
+/**
+ * How a resumable transcode is encoded.
+ */
+struct ResumableOptions {
+
+    /**
+     * The directory the segments and the journal are written to, it is created
+     * if it doesn't exist.
+     */
+    std::string directory;
+
+    /**
+     * The start of the name of every segment file, which is followed by the
+     * index of the segment.
+     */
+    std::string segmentPrefix;
+
+    /**
+     * The length each segment should be. A segment only ends at a key frame of
+     * the input, so segments are this long or a little longer.
+     */
+    int64_t segmentMilliseconds;
+
+    /**
+     * How the frames are encoded, with a fixed quantiser unless set otherwise.
+     */
+    PipelineOptions pipeline;
+
+    /**
+     * The size of the samples the input is hashed with, or 0 to hash the
+     * whole input.
+     */
+    uint64_t hashSampleBytes;
+
+    ResumableOptions() : directory(), segmentPrefix("segment"),
+            segmentMilliseconds(DEFAULT_SEGMENT_MILLISECONDS), pipeline(),
+            hashSampleBytes(DEFAULT_RESUMABLE_HASH_SAMPLE_BYTES) {
+
+        pipeline.quantizer = DEFAULT_RESUMABLE_QUANTIZER;
+    }
+};
+
+/**
+ * What was done to finish a resumable transcode.
+ */
+struct ResumableResult {
+
+    /**
+     * The number of segments that were already finished and were kept.
+     */
+    int segmentsResumed;
+
+    /**
+     * The number of segments encoded by this run.
+     */
+    int segmentsWritten;
+
+    /**
+     * The number of frames in the output, including those of the segments
+     * that were kept.
+     */
+    int64_t framesEncoded;
+
+    ResumableResult() : segmentsResumed(0), segmentsWritten(0), framesEncoded(0) {
+    }
+};
+
+/**
+ * Transcode the first video stream of the supplied file into the supplied
+ * MPEG-TS file, resuming from the journal in the segment directory if an
+ * earlier run with the same input and options didn't finish.
+ *
+ * Note: A journal written for a different input or different options is
+ * ignored and the transcode starts again from the beginning.
+ *
+ * @param fileName - the path to the media file.
+ * @param outputFileName - the path of the MPEG-TS file to write.
+ * @param options - how the transcode is encoded.
+ * @return what was done to finish the transcode.
+ */
+ResumableResult transcodeResumable(const std::string& fileName,
+        const std::string& outputFileName, const ResumableOptions& options);
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __RESUMABLE_HPP__ */
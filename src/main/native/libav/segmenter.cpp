@@ -0,0 +1,302 @@
+/*
+ * segmenter.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+#include "libavutil/mathematics.h"
+}
+
+#include <error.hpp>
+#include <libav/libav.hpp>
+#include <libav/segmenter.hpp>
+#include <libav/trace.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+
+/**
+ * @file segmenter.cpp
+ *
+ * The implementation of the segmenter.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+static const AVRational MILLISECONDS = { 1, 1000 };
+
+// The container every segment is written in.
+static const string SEGMENT_FORMAT = "mpegts";
+static const string SEGMENT_EXTENSION = ".ts";
+
+SegmentWriter::SegmentWriter(const SegmentOptions& options) : _options(options),
+        _codecContexts(), _timeBases(), _referenceStream(-1), _output(NULL), _current(),
+        _firstMilliseconds(AV_NOPTS_VALUE), _lastMilliseconds(0), _segments(),
+        _finished(false) {
+
+    if (options.directory.empty()) {
+
+        throw IllegalArgumentException("The directory to write segments to cannot be empty.");
+    }
+
+    if (0 >= options.segmentMilliseconds) {
+
+        throw IllegalArgumentException("The length of a segment must be positive.");
+    }
+
+    try {
+
+        boost::filesystem::create_directories(options.directory);
+
+    } catch (const boost::filesystem::filesystem_error& e) {
+
+        throw IOException(e.what());
+    }
+}
+
+SegmentWriter::~SegmentWriter() {
+
+    if (NULL == _output) return;
+
+    try {
+
+        // The segment is left out of the playlist, it was never finished.
+        closeOutputFormatContext(&_output);
+
+    } catch (const exception&) {
+
+        // There is nothing more that can be done for an unfinished segment.
+    }
+}
+
+int SegmentWriter::addStream(const AVCodecContext *codecContext, AVRational timeBase) {
+
+    if (NULL == codecContext) {
+
+        throw IllegalArgumentException("The codec context of a segment stream cannot be null.");
+    }
+
+    if (0 >= timeBase.num || 0 >= timeBase.den) {
+
+        throw IllegalArgumentException("The time base of a segment stream must be positive.");
+    }
+
+    if (AV_NOPTS_VALUE != _firstMilliseconds || _finished) {
+
+        throw IllegalStateException("Streams can't be added once packets have been written.");
+    }
+
+    _codecContexts.push_back(codecContext);
+    _timeBases.push_back(timeBase);
+
+    int index = _codecContexts.size() - 1;
+
+    // Segments start at the key frames of the first video stream.
+    if (0 > _referenceStream || (AVMEDIA_TYPE_VIDEO == codecContext->codec_type
+            && AVMEDIA_TYPE_VIDEO != _codecContexts[_referenceStream]->codec_type)) {
+
+        _referenceStream = index;
+    }
+
+    return index;
+}
+
+void SegmentWriter::writePacket(AVPacket *packet) {
+
+    if (_finished) throw IllegalStateException("The segment writer has been finished.");
+
+    if (NULL == packet) {
+
+        throw IllegalArgumentException("The packet to write to a segment cannot be null.");
+    }
+
+    if (0 > packet->stream_index
+            || static_cast<int>(_codecContexts.size()) <= packet->stream_index) {
+
+        throw IllegalArgumentException("The packet is not for a stream of the segments.");
+    }
+
+    int stream = packet->stream_index;
+
+    int64_t timestamp = AV_NOPTS_VALUE != packet->pts ? packet->pts : packet->dts;
+
+    int64_t milliseconds = AV_NOPTS_VALUE != timestamp
+            ? av_rescale_q(timestamp, _timeBases[stream], MILLISECONDS) : _lastMilliseconds;
+
+    if (AV_NOPTS_VALUE == _firstMilliseconds) {
+
+        _firstMilliseconds = milliseconds;
+
+        startSegment(milliseconds);
+
+    } else if (_referenceStream == stream && 0 != (packet->flags & AV_PKT_FLAG_KEY)
+            && _options.segmentMilliseconds
+                    <= milliseconds - _firstMilliseconds - _current.startMilliseconds) {
+
+        finishSegment(milliseconds);
+
+        startSegment(milliseconds);
+    }
+
+    _lastMilliseconds = max(_lastMilliseconds, milliseconds
+            + av_rescale_q(packet->duration, _timeBases[stream], MILLISECONDS));
+
+    AVRational timeBase = _output->streams[stream]->time_base;
+
+    if (AV_NOPTS_VALUE != packet->pts) {
+
+        packet->pts = av_rescale_q(packet->pts, _timeBases[stream], timeBase);
+    }
+
+    if (AV_NOPTS_VALUE != packet->dts) {
+
+        packet->dts = av_rescale_q(packet->dts, _timeBases[stream], timeBase);
+    }
+
+    packet->duration = av_rescale_q(packet->duration, _timeBases[stream], timeBase);
+
+    libav::writePacket(_output, packet);
+}
+
+void SegmentWriter::finish() {
+
+    if (_finished) return;
+
+    if (NULL != _output) finishSegment(_lastMilliseconds);
+
+    _finished = true;
+
+    writePlaylist();
+}
+
+const vector<Segment>& SegmentWriter::segments() const {
+
+    return _segments;
+}
+
+string SegmentWriter::playlistFileName() const {
+
+    return (boost::filesystem::path(_options.directory) / _options.playlistName).string();
+}
+
+void SegmentWriter::startSegment(int64_t startMilliseconds) {
+
+    TraceSpan span("startSegment");
+
+    if (_codecContexts.empty()) {
+
+        throw IllegalStateException("There are no streams to write segments of.");
+    }
+
+    _current = Segment();
+
+    _current.index = _segments.size();
+    _current.fileName = (boost::filesystem::path(_options.directory)
+            / segmentName(_current.index)).string();
+    _current.startMilliseconds = startMilliseconds - _firstMilliseconds;
+
+    _output = openOutputFormatContext(_current.fileName, SEGMENT_FORMAT);
+
+    try {
+
+        for (size_t i = 0; i < _codecContexts.size(); i++) {
+
+            addOutputStream(_output, _codecContexts[i]);
+        }
+
+        writeOutputHeader(_output);
+
+    } catch (...) {
+
+        closeOutputFormatContext(&_output);
+
+        throw;
+    }
+}
+
+void SegmentWriter::finishSegment(int64_t endMilliseconds) {
+
+    TraceSpan span("finishSegment");
+
+    closeOutputFormatContext(&_output);
+
+    _current.durationMilliseconds = max(static_cast<int64_t>(0),
+            endMilliseconds - _firstMilliseconds - _current.startMilliseconds);
+
+    _segments.push_back(_current);
+
+    writePlaylist();
+
+    if (_options.segmentFinished) _options.segmentFinished(_segments.back());
+}
+
+string SegmentWriter::segmentName(int index) const {
+
+    ostringstream name;
+
+    name << _options.segmentPrefix << setw(5) << setfill('0') << index << SEGMENT_EXTENSION;
+
+    return name.str();
+}
+
+void SegmentWriter::writePlaylist() const {
+
+    int64_t longest = _options.segmentMilliseconds;
+
+    for (size_t i = 0; i < _segments.size(); i++) {
+
+        longest = max(longest, _segments[i].durationMilliseconds);
+    }
+
+    ostringstream playlist;
+
+    playlist << "#EXTM3U\n"
+            << "#EXT-X-VERSION:3\n"
+            << "#EXT-X-TARGETDURATION:" << (longest + 999) / 1000 << "\n"
+            << "#EXT-X-MEDIA-SEQUENCE:0\n"
+            << "#EXT-X-PLAYLIST-TYPE:EVENT\n";
+
+    playlist << fixed << setprecision(3);
+
+    for (size_t i = 0; i < _segments.size(); i++) {
+
+        playlist << "#EXTINF:" << _segments[i].durationMilliseconds / 1000.0 << ",\n"
+                << segmentName(_segments[i].index) << "\n";
+    }
+
+    if (_finished) playlist << "#EXT-X-ENDLIST\n";
+
+    string fileName = playlistFileName();
+    string temporaryFileName = fileName + ".tmp";
+
+    {
+        ofstream out(temporaryFileName.c_str(), ios::out | ios::trunc);
+
+        out << playlist.str();
+
+        if (!out) throw IOException("Could not write the playlist " + temporaryFileName);
+    }
+
+    // Readers only ever see the old playlist or the new one.
+    if (0 != rename(temporaryFileName.c_str(), fileName.c_str())) {
+
+        throw IOException("Could not replace the playlist " + fileName);
+    }
+}
+
+} /* namespace libav */
+} /* namespace transcode */
@@ -0,0 +1,233 @@
+/*
+ * segmenter.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __SEGMENTER_HPP__
+#define __SEGMENTER_HPP__
+
+extern "C" {
+#include "libavutil/avutil.h"
+}
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <tr1/functional>
+
+/**
+ * @file segmenter.hpp
+ *
+ * Output written as a run of short MPEG-TS segments and an HLS playlist in a
+ * local directory, instead of as a single file.
+ *
+ * A segment is finished, and added to the playlist, as soon as the next one is
+ * started, so the segments can be packaged or published while the job is still
+ * running. The playlist is replaced in one rename so it is never seen half
+ * written, and only gets its end tag once the writer is finished.
+ */
+
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVPacket;
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * The default length of a segment.
+ */
+const int64_t DEFAULT_SEGMENT_MILLISECONDS = 6000;
+
+/**
+ * A finished segment.
+ */
+struct Segment {
+
+    /**
+     * The position of the segment in the playlist, starting at 0.
+     */
+    int index;
+
+    /**
+     * The path of the segment file.
+     */
+    std::string fileName;
+
+    /**
+     * The time of the start of the segment in milliseconds.
+     */
+    int64_t startMilliseconds;
+
+    /**
+     * The length of the segment in milliseconds.
+     */
+    int64_t durationMilliseconds;
+
+    Segment() : index(0), fileName(), startMilliseconds(0), durationMilliseconds(0) {
+    }
+};
+
+/**
+ * How the segments are written.
+ */
+struct SegmentOptions {
+
+    /**
+     * The directory the segments and playlist are written to, it is created if
+     * it doesn't exist.
+     */
+    std::string directory;
+
+    /**
+     * The start of the name of every segment file, which is followed by the
+     * index of the segment.
+     */
+    std::string segmentPrefix;
+
+    /**
+     * The name of the playlist file.
+     */
+    std::string playlistName;
+
+    /**
+     * The length each segment should be. A segment only ends at a key frame,
+     * so segments are this long or a little longer.
+     */
+    int64_t segmentMilliseconds;
+
+    /**
+     * Called on the writing thread with each segment as soon as it is finished
+     * and in the playlist, or empty.
+     */
+    std::tr1::function<void(const Segment& segment)> segmentFinished;
+
+    SegmentOptions() : directory(), segmentPrefix("segment"), playlistName("playlist.m3u8"),
+            segmentMilliseconds(DEFAULT_SEGMENT_MILLISECONDS), segmentFinished() {
+    }
+};
+
+/**
+ * Writes packets to a run of segments and keeps the playlist of the finished
+ * segments up to date.
+ *
+ * Streams are added with <code>addStream</code> before the first packet is
+ * written. A new segment is started at the first key frame of the first video
+ * stream, or the first stream if there is no video, that comes at least the
+ * segment length after the start of the current segment.
+ */
+class SegmentWriter {
+
+private:
+    SegmentWriter(SegmentWriter const&); // Should not be implemented.
+
+    void operator=(SegmentWriter const&); // Should not be implemented.
+
+    SegmentOptions _options;
+
+    std::vector<const AVCodecContext*> _codecContexts;
+    std::vector<AVRational> _timeBases;
+    int _referenceStream;
+
+    AVFormatContext *_output;
+    Segment _current;
+    int64_t _firstMilliseconds;
+    int64_t _lastMilliseconds;
+
+    std::vector<Segment> _segments;
+    bool _finished;
+
+    /**
+     * Start the next segment at the supplied time.
+     */
+    void startSegment(int64_t startMilliseconds);
+
+    /**
+     * Finish the current segment at the supplied time and add it to the playlist.
+     */
+    void finishSegment(int64_t endMilliseconds);
+
+    /**
+     * @return the name of the file of the segment at the supplied index.
+     */
+    std::string segmentName(int index) const;
+
+    /**
+     * Write the playlist of the finished segments.
+     */
+    void writePlaylist() const;
+
+public:
+    /**
+     * Instantiate a new <code>SegmentWriter</code>.
+     *
+     * @param options - how the segments are written.
+     */
+    explicit SegmentWriter(const SegmentOptions& options);
+
+    /**
+     * Close the current segment if the writer wasn't finished.
+     */
+    ~SegmentWriter();
+
+    /**
+     * Add a stream to every segment, with the codec parameters copied from the
+     * supplied codec context.
+     *
+     * Note: The codec parameters are copied again for every segment, so the
+     * codec context must not be freed until the writer is finished.
+     *
+     * @param codecContext - the codec context to copy the stream codec
+     *      parameters from.
+     * @param timeBase - the time base of the timestamps of the packets that
+     *      will be written to the stream.
+     * @return the index of the stream.
+     */
+    int addStream(const AVCodecContext *codecContext, AVRational timeBase);
+
+    /**
+     * Write the supplied packet to the current segment, finishing it first and
+     * starting the next if the packet is where the next segment starts.
+     *
+     * Note: The packet is handed to the muxer, which may hold on to its data,
+     * so the caller must not reuse the packet data. The timestamps of the
+     * packet are changed to the time base of the segment.
+     *
+     * @param packet - the packet to write, its stream index must be the index
+     *      returned by <code>addStream</code>.
+     */
+    void writePacket(AVPacket *packet);
+
+    /**
+     * Finish the last segment and end the playlist.
+     */
+    void finish();
+
+    /**
+     * @return the segments that are finished so far.
+     */
+    const std::vector<Segment>& segments() const;
+
+    /**
+     * @return the path of the playlist.
+     */
+    std::string playlistFileName() const;
+};
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __SEGMENTER_HPP__ */
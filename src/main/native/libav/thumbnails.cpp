@@ -0,0 +1,442 @@
+/*
+ * thumbnails.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+#include "libavutil/mathematics.h"
+#include "libswscale/swscale.h"
+}
+
+#include <error.hpp>
+#include <libav/cancellation.hpp>
+#include <libav/job.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+#include <libav/thumbnails.hpp>
+#include <libav/trace.hpp>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+using namespace std;
+
+
+/**
+ * @file thumbnails.cpp
+ *
+ * The implementation of the thumbnails.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+static const AVRational MILLISECONDS = { 1, 1000 };
+
+/**
+ * Find the first video stream of the supplied format context.
+ *
+ * @return the index of the stream.
+ */
+static int findVideoStream(AVFormatContext *formatContext) {
+
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+
+        if (AVMEDIA_TYPE_VIDEO == findStreamType(formatContext->streams[i])) return i;
+    }
+
+    throw IllegalStateException("There is no video stream to take thumbnails of.");
+}
+
+/**
+ * The first video stream of a file, opened for taking thumbnails from. Everything
+ * is closed when it goes out of scope so a worker can't leak on an exception.
+ */
+class ThumbnailInput {
+
+private:
+    ThumbnailInput(ThumbnailInput const&); // Should not be implemented.
+
+    void operator=(ThumbnailInput const&); // Should not be implemented.
+
+public:
+    AVFormatContext *formatContext;
+    int streamIndex;
+    AVCodecContext *codecContext;
+    SwsContext *scaleContext;
+
+    ThumbnailInput(const string& fileName) : formatContext(NULL), streamIndex(-1),
+            codecContext(NULL), scaleContext(NULL) {
+
+        formatContext = openFormatContext(fileName);
+
+        try {
+
+            streamIndex = findVideoStream(formatContext);
+
+        } catch (...) {
+
+            closeFormatContext(&formatContext);
+
+            throw;
+        }
+    }
+
+    ~ThumbnailInput() {
+
+        if (NULL != scaleContext) sws_freeContext(scaleContext);
+
+        try {
+
+            if (NULL != codecContext) closeCodecContext(&codecContext);
+
+        } catch (const exception&) {
+
+            // The format context still has to be closed.
+        }
+
+        closeFormatContext(&formatContext);
+    }
+
+    AVStream* stream() const {
+
+        return formatContext->streams[streamIndex];
+    }
+
+    /**
+     * Only read and decode the key frames, a thumbnail is always the key frame
+     * the seek lands on.
+     */
+    void openDecoder() {
+
+        DecodeOptions options;
+
+        options.keyFramesOnly = true;
+
+        setKeyFramesOnly(formatContext, true);
+
+        codecContext = openDecodeCodecContext(stream()->codec, options);
+    }
+
+    /**
+     * Seek to the key frame at or before the supplied timestamp and decode it.
+     *
+     * @param milliseconds - the timestamp to seek to.
+     * @return the decoded frame, or NULL if there isn't one.
+     */
+    AVFrame* decodeAt(int64_t milliseconds) {
+
+        AVStream *videoStream = stream();
+
+        int64_t target = av_rescale_q(milliseconds, MILLISECONDS, videoStream->time_base);
+
+        if (AV_NOPTS_VALUE != videoStream->start_time) target += videoStream->start_time;
+
+        if (0 > av_seek_frame(formatContext, streamIndex, target, AVSEEK_FLAG_BACKWARD)) {
+
+            return NULL;
+        }
+
+        avcodec_flush_buffers(codecContext);
+
+        AVFrame *frame = NULL;
+
+        while (NULL == frame) {
+
+            AVPacket *packet = readNextPacket(formatContext);
+
+            if (NULL == packet) break;
+
+            if (streamIndex == packet->stream_index) {
+
+                tryDecodeVideoPacket(codecContext, packet, &frame);
+            }
+
+            freePacket(&packet);
+        }
+
+        if (NULL != frame) return frame;
+
+        // A decoder that delays its output may still be holding the last key
+        // frame of the file.
+        AVPacket flush;
+
+        av_init_packet(&flush);
+
+        flush.data = NULL;
+        flush.size = 0;
+
+        tryDecodeVideoPacket(codecContext, &flush, &frame);
+
+        return frame;
+    }
+
+    /**
+     * Scale the supplied frame into a tile of a sprite sheet.
+     */
+    void scale(const AVFrame *frame, SpriteSheet& spriteSheet, size_t tile) {
+
+        scaleContext = sws_getCachedContext(scaleContext,
+                codecContext->width, codecContext->height, codecContext->pix_fmt,
+                spriteSheet.tileWidth, spriteSheet.tileHeight, PIX_FMT_RGB24,
+                SWS_BILINEAR, NULL, NULL, NULL);
+
+        if (NULL == scaleContext) {
+
+            throw CodecException("Could not scale the video frames to thumbnails.");
+        }
+
+        int column = tile % spriteSheet.columns;
+        int row = tile / spriteSheet.columns;
+
+        int lineSize = spriteSheet.width * 3;
+
+        uint8_t *data[4] = {
+            &spriteSheet.pixels[row * spriteSheet.tileHeight * lineSize
+                    + column * spriteSheet.tileWidth * 3],
+            NULL, NULL, NULL
+        };
+
+        int lineSizes[4] = { lineSize, 0, 0, 0 };
+
+        sws_scale(scaleContext, frame->data, frame->linesize, 0, codecContext->height,
+                data, lineSizes);
+    }
+
+    /**
+     * @return the time of the supplied frame in milliseconds, or the supplied
+     *      default if the frame has no time.
+     */
+    int64_t frameTimestamp(const AVFrame *frame, int64_t defaultMilliseconds) const {
+
+        AVStream *videoStream = stream();
+
+        // The timestamps of the packet the frame was decoded from, a
+        // container without presentation times only has the decode time.
+        int64_t pts = AV_NOPTS_VALUE != frame->pkt_pts ? frame->pkt_pts : frame->pkt_dts;
+
+        if (AV_NOPTS_VALUE == pts) return defaultMilliseconds;
+
+        if (AV_NOPTS_VALUE != videoStream->start_time) pts -= videoStream->start_time;
+
+        return av_rescale_q(pts, videoStream->time_base, MILLISECONDS);
+    }
+};
+
+/**
+ * The first error reported by any of the workers.
+ */
+struct WorkerError {
+
+    boost::mutex mutex;
+    string message;
+};
+
+/**
+ * Takes the thumbnails for one contiguous run of the timestamps, with its own
+ * format context and decoder so the workers share nothing but the sprite sheet,
+ * and each of them only writes its own tiles.
+ */
+struct ThumbnailWorker {
+
+    const string *fileName;
+    const vector<int64_t> *timestamps;
+    size_t begin;
+    size_t end;
+    SpriteSheet *spriteSheet;
+    Job *job;
+    WorkerError *error;
+
+    void operator()() const {
+
+        // The thumbnails are taken for the job that asked for them.
+        ScopedJob scopedJob(job);
+
+        TraceSpan span("thumbnailWorker");
+
+        try {
+
+            ThumbnailInput input(*fileName);
+
+            input.openDecoder();
+
+            for (size_t i = begin; i < end; i++) {
+
+                AVFrame *frame = input.decodeAt((*timestamps)[i]);
+
+                if (NULL == frame) continue;
+
+                try {
+
+                    input.scale(frame, *spriteSheet, i);
+
+                    spriteSheet->frameTimestamps[i] = input.frameTimestamp(frame,
+                            (*timestamps)[i]);
+
+                } catch (...) {
+
+                    freeFrame(&frame);
+
+                    throw;
+                }
+
+                freeFrame(&frame);
+            }
+
+        } catch (const exception& e) {
+
+            boost::mutex::scoped_lock lock(error->mutex);
+
+            if (error->message.empty()) error->message = e.what();
+
+        } catch (...) {
+
+            boost::mutex::scoped_lock lock(error->mutex);
+
+            if (error->message.empty()) error->message = UNKNOWN;
+        }
+    }
+};
+
+
+vector<int64_t> thumbnailTimestamps(int64_t durationMilliseconds,
+        int64_t intervalMilliseconds) {
+
+    if (0 >= intervalMilliseconds) {
+
+        throw IllegalArgumentException("The interval between thumbnails must be positive.");
+    }
+
+    vector<int64_t> timestamps;
+
+    for (int64_t timestamp = 0; timestamp < durationMilliseconds;
+            timestamp += intervalMilliseconds) {
+
+        timestamps.push_back(timestamp);
+    }
+
+    // Even a video shorter than the interval gets one thumbnail.
+    if (timestamps.empty()) timestamps.push_back(0);
+
+    return timestamps;
+}
+
+SpriteSheet extractSpriteSheet(const string& fileName, const vector<int64_t>& timestamps,
+        const ThumbnailOptions& options) {
+
+    if (timestamps.empty()) {
+
+        throw IllegalArgumentException("There must be at least one thumbnail timestamp.");
+    }
+
+    if (0 >= options.width || 0 > options.height || 0 >= options.columns) {
+
+        throw IllegalArgumentException(
+                "The thumbnail width and columns must be positive and the height can't be negative.");
+    }
+
+    SpriteSheet spriteSheet;
+
+    // Only the size of the video is needed up front, the workers open the file
+    // again for themselves. It is kept open until they are finished so the
+    // progress of the job is only started over once, by this input, and the
+    // workers all add to it.
+    ThumbnailInput input(fileName);
+
+    const AVCodecContext *codecContext = input.stream()->codec;
+
+    if (0 >= codecContext->width || 0 >= codecContext->height) {
+
+        throw IllegalStateException("The size of the video is not known.");
+    }
+
+    spriteSheet.tileWidth = options.width;
+    spriteSheet.tileHeight = 0 < options.height ? options.height
+            : max(1, static_cast<int>(av_rescale(options.width, codecContext->height,
+                    codecContext->width)));
+
+    int count = timestamps.size();
+
+    spriteSheet.columns = min(options.columns, count);
+    spriteSheet.rows = (count + spriteSheet.columns - 1) / spriteSheet.columns;
+    spriteSheet.width = spriteSheet.columns * spriteSheet.tileWidth;
+    spriteSheet.height = spriteSheet.rows * spriteSheet.tileHeight;
+    spriteSheet.pixels.assign(static_cast<size_t>(spriteSheet.width) * spriteSheet.height * 3, 0);
+    spriteSheet.frameTimestamps.assign(count, -1);
+
+    size_t threads = 0 < options.threads ? options.threads
+            : max(1u, boost::thread::hardware_concurrency());
+
+    threads = min(threads, timestamps.size());
+
+    WorkerError error;
+
+    boost::thread_group workers;
+
+    for (size_t i = 0; i < threads; i++) {
+
+        ThumbnailWorker worker = {
+            &fileName, &timestamps,
+            i * timestamps.size() / threads, (i + 1) * timestamps.size() / threads,
+            &spriteSheet, currentJob(), &error
+        };
+
+        workers.create_thread(worker);
+    }
+
+    workers.join_all();
+
+    if (!error.message.empty()) {
+
+        // The workers only keep the message, so a cancelled job is told apart here.
+        throwIfCancelled();
+
+        throw Exception(error.message);
+    }
+
+    return spriteSheet;
+}
+
+SpriteSheet extractSpriteSheet(const string& fileName, int64_t intervalMilliseconds,
+        const ThumbnailOptions& options) {
+
+    int64_t duration = 0;
+
+    {
+        AVFormatContext *formatContext = openFormatContext(fileName);
+
+        if (AV_NOPTS_VALUE != formatContext->duration) {
+
+            duration = av_rescale(formatContext->duration, 1000, AV_TIME_BASE);
+        }
+
+        closeFormatContext(&formatContext);
+    }
+
+    return extractSpriteSheet(fileName, thumbnailTimestamps(duration, intervalMilliseconds),
+            options);
+}
+
+void writeSpriteSheetPpm(const SpriteSheet& spriteSheet, const string& fileName) {
+
+    ofstream out(fileName.c_str(), ios::out | ios::binary);
+
+    if (!out) throw IOException("Could not open " + fileName + " to write the sprite sheet.");
+
+    out << "P6\n" << spriteSheet.width << " " << spriteSheet.height << "\n255\n";
+
+    out.write(reinterpret_cast<const char*>(&spriteSheet.pixels[0]), spriteSheet.pixels.size());
+
+    if (!out) throw IOException("Could not write the sprite sheet to " + fileName);
+}
+
+} /* namespace libav */
+} /* namespace transcode */
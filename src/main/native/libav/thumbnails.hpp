@@ -0,0 +1,148 @@
+/*
+ * thumbnails.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __THUMBNAILS_HPP__
+#define __THUMBNAILS_HPP__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * @file thumbnails.hpp
+ *
+ * Thumbnails of a video taken at a set of timestamps and put together into a
+ * single sprite sheet.
+ *
+ * The timestamps are split across worker threads that each open the file
+ * themselves, seek to the key frame at or before each of their timestamps and
+ * decode only that frame, so the cost is a few key frames per worker instead of
+ * decoding the whole file from the start.
+ */
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * How the thumbnails are taken and laid out.
+ */
+struct ThumbnailOptions {
+
+    /**
+     * The width of each thumbnail in pixels.
+     */
+    int width;
+
+    /**
+     * The height of each thumbnail in pixels, or 0 to keep the aspect ratio
+     * of the video.
+     */
+    int height;
+
+    /**
+     * The number of thumbnails in each row of the sprite sheet.
+     */
+    int columns;
+
+    /**
+     * The number of worker threads, or 0 for one per processor.
+     */
+    unsigned int threads;
+
+    ThumbnailOptions() : width(160), height(0), columns(10), threads(0) {
+    }
+};
+
+/**
+ * A grid of thumbnails in a single packed RGB24 image, filled row by row in the
+ * order of the timestamps they were taken at.
+ */
+struct SpriteSheet {
+
+    int width;
+    int height;
+    int tileWidth;
+    int tileHeight;
+    int columns;
+    int rows;
+
+    /**
+     * The pixels, 3 bytes for each pixel and <code>width * 3</code> bytes
+     * for each line. Tiles that couldn't be taken are left black.
+     */
+    std::vector<uint8_t> pixels;
+
+    /**
+     * The presentation time in milliseconds of the frame in each tile, which
+     * is the key frame at or before the timestamp that was asked for, or -1
+     * if there is no frame for the tile.
+     */
+    std::vector<int64_t> frameTimestamps;
+
+    SpriteSheet() : width(0), height(0), tileWidth(0), tileHeight(0), columns(0),
+            rows(0), pixels(), frameTimestamps() {
+    }
+};
+
+/**
+ * Return a timestamp every interval from the start to the end of a video.
+ *
+ * @param durationMilliseconds - the length of the video.
+ * @param intervalMilliseconds - the time between each timestamp.
+ * @return the timestamps in milliseconds, starting at 0.
+ */
+std::vector<int64_t> thumbnailTimestamps(int64_t durationMilliseconds,
+        int64_t intervalMilliseconds);
+
+/**
+ * Take a thumbnail of the first video stream of the supplied file at each of
+ * the supplied timestamps and put them together into a sprite sheet.
+ *
+ * @param fileName - the path to the media file.
+ * @param timestamps - the times in milliseconds to take the thumbnails at.
+ * @param options - the size and layout of the thumbnails.
+ * @return the sprite sheet.
+ */
+SpriteSheet extractSpriteSheet(const std::string& fileName,
+        const std::vector<int64_t>& timestamps,
+        const ThumbnailOptions& options = ThumbnailOptions());
+
+/**
+ * Take a thumbnail of the first video stream of the supplied file every
+ * interval and put them together into a sprite sheet.
+ *
+ * @param fileName - the path to the media file.
+ * @param intervalMilliseconds - the time between each thumbnail.
+ * @param options - the size and layout of the thumbnails.
+ * @return the sprite sheet.
+ */
+SpriteSheet extractSpriteSheet(const std::string& fileName,
+        int64_t intervalMilliseconds,
+        const ThumbnailOptions& options = ThumbnailOptions());
+
+/**
+ * Write the supplied sprite sheet to a binary PPM image.
+ *
+ * @param spriteSheet - the sprite sheet to write.
+ * @param fileName - the path of the image to write.
+ */
+void writeSpriteSheetPpm(const SpriteSheet& spriteSheet, const std::string& fileName);
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __THUMBNAILS_HPP__ */
@@ -0,0 +1,332 @@
+/*
+ * trace.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#include <libav/counters.hpp>
+#include <libav/trace.hpp>
+
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <deque>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+/**
+ * @file trace.cpp
+ *
+ * The implementation of the trace.hpp classes and functions.
+ */
+
+
+namespace transcode {
+namespace libav {
+
+/**
+ * A single recorded span.
+ */
+struct Span {
+
+    const char *name;
+    int streamIndex;
+    uint64_t start;
+    uint64_t duration;
+};
+
+/**
+ * The ring of spans recorded by a single thread.
+ *
+ * Only the owning thread writes spans. It fills the slot first and then publishes
+ * it by moving the head forward, so a reader can copy any slot behind the head and
+ * then check the head again to see if the slot was overwritten while it was being
+ * copied.
+ */
+struct SpanRing {
+
+    long threadId;
+
+    vector<Span> spans;
+
+    // The total number of spans ever written to this ring.
+    boost::atomic<uint64_t> head;
+
+    // The head when the trace was last cleared, spans before it aren't written out.
+    boost::atomic<uint64_t> cleared;
+
+    SpanRing() : threadId(syscall(SYS_gettid)), spans(TRACE_BUFFER_SPANS),
+            head(0), cleared(0) {
+    }
+
+    void record(const char *name, int streamIndex, uint64_t start, uint64_t end) {
+
+        uint64_t position = head.load(boost::memory_order_relaxed);
+
+        Span& span = spans[position % TRACE_BUFFER_SPANS];
+
+        span.name = name;
+        span.streamIndex = streamIndex;
+        span.start = start;
+        span.duration = end - start;
+
+        head.store(position + 1, boost::memory_order_release);
+    }
+
+    /**
+     * Copy every span that is still in the ring and hasn't been cleared.
+     *
+     * @param copies - the vector the copied spans are added to.
+     */
+    void copy(vector<Span>& copies) const {
+
+        uint64_t end = head.load(boost::memory_order_acquire);
+        uint64_t begin = cleared.load(boost::memory_order_relaxed);
+
+        if (end - begin > TRACE_BUFFER_SPANS) begin = end - TRACE_BUFFER_SPANS;
+
+        for (uint64_t i = begin; i < end; i++) {
+
+            Span span = spans[i % TRACE_BUFFER_SPANS];
+
+            // If the writer has reached this slot again while it was being copied
+            // then the copy may be torn, so it has to be thrown away.
+            boost::atomic_thread_fence(boost::memory_order_acquire);
+
+            if (head.load(boost::memory_order_relaxed) - i >= TRACE_BUFFER_SPANS) continue;
+
+            copies.push_back(span);
+        }
+    }
+};
+
+/**
+ * A span recorded by a thread that has finished.
+ */
+struct RetiredSpan {
+
+    long threadId;
+    Span span;
+};
+
+/**
+ * Guards the list of rings and the retired spans.
+ */
+static boost::mutex ringsMutex;
+
+/**
+ * The rings of every thread that has recorded a span and is still running.
+ */
+static vector<SpanRing*> rings;
+
+/**
+ * The spans of the threads that have finished, the oldest at the front.
+ */
+static deque<RetiredSpan> retired;
+
+/**
+ * Move the spans of a finishing thread into the retired spans and free its ring.
+ *
+ * @param ring - the ring of the thread that is finishing.
+ */
+static void finishRing(SpanRing *ring) {
+
+    vector<Span> spans;
+
+    // The owning thread is finishing, so nothing else writes to the ring.
+    ring->copy(spans);
+
+    boost::mutex::scoped_lock lock(ringsMutex);
+
+    for (size_t i = 0; i < spans.size(); i++) {
+
+        RetiredSpan span = { ring->threadId, spans[i] };
+
+        retired.push_back(span);
+    }
+
+    while (TRACE_RETIRED_SPANS < retired.size()) retired.pop_front();
+
+    for (size_t i = 0; i < rings.size(); i++) {
+
+        if (ring != rings[i]) continue;
+
+        rings.erase(rings.begin() + i);
+
+        break;
+    }
+
+    delete ring;
+}
+
+static boost::thread_specific_ptr<SpanRing> threadRing(finishRing);
+
+static boost::atomic<bool> enabled(false);
+
+/**
+ * @return the ring of the calling thread, creating it on first use.
+ */
+static SpanRing& currentThreadRing() {
+
+    SpanRing *ring = threadRing.get();
+
+    if (NULL != ring) return *ring;
+
+    ring = new SpanRing();
+
+    {
+        boost::mutex::scoped_lock lock(ringsMutex);
+
+        rings.push_back(ring);
+    }
+
+    threadRing.reset(ring);
+
+    return *ring;
+}
+
+/**
+ * Write the supplied string as a JSON string.
+ *
+ * @param out - the stream to write to.
+ * @param value - the string to write.
+ */
+static void writeJsonString(ostream& out, const char *value) {
+
+    out << '"';
+
+    for (const char *c = value; '\0' != *c; c++) {
+
+        if ('"' == *c || '\\' == *c) out << '\\';
+
+        out << *c;
+    }
+
+    out << '"';
+}
+
+/**
+ * Write nanoseconds as the fractional microseconds used by the trace event format.
+ *
+ * @param out - the stream to write to.
+ * @param nanoseconds - the value to write.
+ */
+static void writeMicroseconds(ostream& out, uint64_t nanoseconds) {
+
+    uint64_t fraction = nanoseconds % 1000;
+
+    out << nanoseconds / 1000 << '.'
+            << (100 > fraction ? "0" : "") << (10 > fraction ? "0" : "") << fraction;
+}
+
+
+TraceSpan::TraceSpan(const char *name, int streamIndex) :
+        _name(name), _streamIndex(streamIndex), _start(0) {
+
+    if (enabled.load(boost::memory_order_relaxed)) _start = monotonicNanoseconds();
+}
+
+TraceSpan::~TraceSpan() {
+
+    // Spans that started before tracing was turned on are left out.
+    if (0 == _start) return;
+
+    currentThreadRing().record(_name, _streamIndex, _start, monotonicNanoseconds());
+}
+
+void TraceSpan::setStreamIndex(int streamIndex) {
+
+    _streamIndex = streamIndex;
+}
+
+void setTracingEnabled(bool value) {
+
+    enabled.store(value, boost::memory_order_relaxed);
+}
+
+bool tracingEnabled() {
+
+    return enabled.load(boost::memory_order_relaxed);
+}
+
+/**
+ * Write a single span as a trace event.
+ *
+ * @param out - the stream to write to.
+ * @param span - the span to write.
+ * @param processId - the process the span was recorded in.
+ * @param threadId - the thread the span was recorded by.
+ * @param first - true if this is the first event written, set to false.
+ */
+static void writeSpan(ostream& out, const Span& span, pid_t processId, long threadId,
+        bool& first) {
+
+    if (!first) out << ",";
+
+    first = false;
+
+    out << "{\"name\":";
+    writeJsonString(out, span.name);
+    out << ",\"cat\":\"transcode\",\"ph\":\"X\",\"ts\":";
+    writeMicroseconds(out, span.start);
+    out << ",\"dur\":";
+    writeMicroseconds(out, span.duration);
+    out << ",\"pid\":" << processId << ",\"tid\":" << threadId;
+
+    if (0 <= span.streamIndex) out << ",\"args\":{\"stream\":" << span.streamIndex << "}";
+
+    out << "}";
+}
+
+void writeTraceJson(ostream& out) {
+
+    pid_t processId = getpid();
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+
+    boost::mutex::scoped_lock lock(ringsMutex);
+
+    for (size_t i = 0; i < retired.size(); i++) {
+
+        writeSpan(out, retired[i].span, processId, retired[i].threadId, first);
+    }
+
+    for (size_t i = 0; i < rings.size(); i++) {
+
+        vector<Span> spans;
+
+        rings[i]->copy(spans);
+
+        for (size_t j = 0; j < spans.size(); j++) {
+
+            writeSpan(out, spans[j], processId, rings[i]->threadId, first);
+        }
+    }
+
+    out << "]}";
+}
+
+void clearTrace() {
+
+    boost::mutex::scoped_lock lock(ringsMutex);
+
+    retired.clear();
+
+    for (size_t i = 0; i < rings.size(); i++) {
+
+        rings[i]->cleared.store(rings[i]->head.load(boost::memory_order_acquire),
+                boost::memory_order_relaxed);
+    }
+}
+
+} /* namespace libav */
+} /* namespace transcode */
@@ -0,0 +1,121 @@
+/*
+ * trace.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __TRACE_HPP__
+#define __TRACE_HPP__
+
+#include <stdint.h>
+#include <cstddef>
+#include <ostream>
+
+/**
+ * @file trace.hpp
+ *
+ * Optional span tracing of the libav functions, written out as Chrome trace event
+ * JSON so a whole transcode can be looked at as a timeline in a trace viewer.
+ *
+ * Every thread records its spans into its own fixed size ring buffer. The owning
+ * thread is the only writer and never waits on a lock, once a ring is full the
+ * oldest spans are overwritten. When a thread finishes its spans are moved into a
+ * single bounded buffer shared by every finished thread and its ring is freed, so
+ * threads started for every call don't keep a ring each for the life of the
+ * process.
+ */
+
+
+/**
+ * Transcode namespace, all the top level transcode functions and classes are in
+ * this namespace. So this namespace holds officially public API.
+ */
+namespace transcode {
+
+/**
+ * Libav namespace, all libav related functions and classes can be found within
+ * this namespace.
+ */
+namespace libav {
+
+/**
+ * The number of spans each thread keeps before the oldest are overwritten.
+ */
+const size_t TRACE_BUFFER_SPANS = 64 * 1024;
+
+/**
+ * The number of spans kept from the threads that have finished, all of them
+ * together, before the oldest are dropped.
+ */
+const size_t TRACE_RETIRED_SPANS = 64 * 1024;
+
+/**
+ * Records the time between its construction and destruction as a span on the
+ * calling thread, if tracing is enabled when it is constructed.
+ */
+class TraceSpan {
+
+private:
+    const char *_name;
+    int _streamIndex;
+    uint64_t _start;
+
+    TraceSpan(TraceSpan const&); // Should not be implemented.
+
+    void operator=(TraceSpan const&); // Should not be implemented.
+
+public:
+    /**
+     * Start a new span.
+     *
+     * @param name - the name of the span, this must be a string literal or
+     *      otherwise live for the rest of the process.
+     * @param streamIndex - the index of the stream the span is working on, or -1
+     *      if it isn't working on a single stream.
+     */
+    explicit TraceSpan(const char *name, int streamIndex = -1);
+
+    /**
+     * End the span and record it.
+     */
+    ~TraceSpan();
+
+    /**
+     * Set the stream the span is working on, for spans that only find out which
+     * stream they worked on at the end, such as reading a packet.
+     *
+     * @param streamIndex - the index of the stream.
+     */
+    void setStreamIndex(int streamIndex);
+};
+
+/**
+ * Turn tracing on or off for all threads, tracing is off by default.
+ *
+ * @param enabled - true to record spans, false to stop recording them.
+ */
+void setTracingEnabled(bool enabled);
+
+/**
+ * @return true if spans are being recorded, otherwise false.
+ */
+bool tracingEnabled();
+
+/**
+ * Write every span recorded by every thread, including the threads that have
+ * finished, to the supplied stream as Chrome trace event JSON.
+ *
+ * @param out - the stream to write to.
+ */
+void writeTraceJson(std::ostream& out);
+
+/**
+ * Forget every span that has been recorded so far.
+ */
+void clearTrace();
+
+} /* namespace libav */
+} /* namespace transcode */
+
+#endif /* __TRACE_HPP__ */
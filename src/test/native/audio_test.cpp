@@ -0,0 +1,197 @@
+/*
+ * audio_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <error.hpp>
+#include <libav/audio.hpp>
+#include <libav/counters.hpp>
+#include <libav/job.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+
+#include <string>
+
+
+static const std::string AUDIO_WAV = "../../../target/test-classes/lib-test/audio.wav";
+
+static const std::string AUDIO_MP2 = "../../../target/test-classes/lib-test/audio.mp2";
+
+static const std::string AUDIO_MP4 = "../../../target/test-classes/lib-test/audio.mp4";
+
+/**
+ * Counts the frames and samples handed to it.
+ */
+struct CountFrames {
+
+    int64_t *frames;
+    int64_t *samples;
+
+    void operator()(const AVFrame *frame) const {
+
+        (*frames)++;
+        (*samples) += frame->nb_samples;
+    }
+};
+
+/**
+ * Check the supplied file has a single audio stream.
+ */
+static void checkAudioFile(const std::string& fileName) {
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(fileName);
+
+    BOOST_REQUIRE_EQUAL( 1, formatContext->nb_streams );
+    BOOST_REQUIRE_EQUAL( AVMEDIA_TYPE_AUDIO,
+            transcode::libav::findStreamType(formatContext->streams[0]) );
+
+    transcode::libav::closeFormatContext(&formatContext);
+}
+
+/**
+ * Test only the packets of the audio stream are decoded, and every frame is
+ * handed to the sink.
+ */
+BOOST_FIXTURE_TEST_CASE( test_extract_audio_frames, test::LibAvRegisterable )
+{
+
+    transcode::libav::Job job;
+
+    transcode::libav::ScopedJob scopedJob(&job);
+
+    int64_t frames = 0;
+    int64_t samples = 0;
+
+    CountFrames countFrames = { &frames, &samples };
+
+    transcode::libav::resetPerformanceCounters();
+
+    {
+        transcode::libav::AudioExtractor extractor(VIDEO_AVI);
+
+        BOOST_REQUIRE_EQUAL( DIVX_STREAM_TWO, extractor.stream()->index );
+        BOOST_REQUIRE( AVDISCARD_ALL > extractor.stream()->discard );
+        BOOST_REQUIRE_EQUAL( AVMEDIA_TYPE_AUDIO,
+                transcode::libav::findCodecType(extractor.decoder()) );
+
+        transcode::libav::AudioResult result = extractor.run(countFrames);
+
+        BOOST_REQUIRE( 0 < result.packetsRead );
+        BOOST_REQUIRE_EQUAL( frames, result.framesDecoded );
+        BOOST_REQUIRE_EQUAL( samples, result.samplesDecoded );
+        BOOST_REQUIRE( 0 < samples );
+
+        transcode::libav::PerformanceCounters counters = transcode::libav::performanceCounters();
+
+        // Every packet read was an audio packet, the last read found the end
+        // of the file, and only the audio decoder was opened and used.
+        BOOST_REQUIRE_EQUAL( result.packetsRead + 1,
+                counters.stages[transcode::libav::STAGE_READ_PACKET].calls );
+        BOOST_REQUIRE_EQUAL( 1, counters.stages[transcode::libav::STAGE_OPEN_CODEC_CONTEXT].calls );
+        BOOST_REQUIRE_EQUAL( result.packetsRead,
+                counters.stages[transcode::libav::STAGE_DECODE_AUDIO].calls );
+        BOOST_REQUIRE_EQUAL( 0, counters.stages[transcode::libav::STAGE_DECODE_VIDEO].calls );
+    }
+
+    BOOST_REQUIRE_EQUAL( 0, job.memory().used() );
+}
+
+/**
+ * Test extract the audio of an avi file as PCM samples.
+ */
+BOOST_FIXTURE_TEST_CASE( test_extract_avi_audio_to_pcm, test::LibAvRegisterable )
+{
+
+    transcode::libav::AudioResult result = transcode::libav::extractAudio(VIDEO_AVI, AUDIO_WAV);
+
+    BOOST_REQUIRE( 0 < result.framesDecoded );
+
+    checkAudioFile(AUDIO_WAV);
+}
+
+/**
+ * Test extract the planar audio of an mkv file, which is interleaved for the
+ * PCM encoder.
+ */
+BOOST_FIXTURE_TEST_CASE( test_extract_mkv_audio_to_pcm, test::LibAvRegisterable )
+{
+
+    transcode::libav::AudioResult result = transcode::libav::extractAudio(VIDEO_MKV, AUDIO_WAV);
+
+    BOOST_REQUIRE( 0 < result.framesDecoded );
+
+    checkAudioFile(AUDIO_WAV);
+}
+
+/**
+ * Test extract audio through an encoder with a fixed frame size.
+ */
+BOOST_FIXTURE_TEST_CASE( test_extract_audio_to_encoder, test::LibAvRegisterable )
+{
+
+    transcode::libav::AudioOptions options;
+
+    options.encoderName = "mp2";
+    options.bitRate = 128000;
+
+    transcode::libav::AudioResult result = transcode::libav::extractAudio(VIDEO_AVI, AUDIO_MP2,
+            options);
+
+    BOOST_REQUIRE( 0 < result.framesDecoded );
+
+    checkAudioFile(AUDIO_MP2);
+}
+
+/**
+ * Test extract audio into a container that keeps the headers of its streams in
+ * its own header, which the encoder must write into its extradata.
+ */
+BOOST_FIXTURE_TEST_CASE( test_extract_audio_to_mp4, test::LibAvRegisterable )
+{
+
+    transcode::libav::AudioOptions options;
+
+    options.encoderName = "libfaac";
+    options.bitRate = 128000;
+
+    transcode::libav::AudioResult result = transcode::libav::extractAudio(VIDEO_AVI, AUDIO_MP4,
+            options);
+
+    BOOST_REQUIRE( 0 < result.framesDecoded );
+
+    checkAudioFile(AUDIO_MP4);
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(AUDIO_MP4);
+
+    BOOST_REQUIRE( 0 < formatContext->streams[0]->codec->extradata_size );
+
+    transcode::libav::closeFormatContext(&formatContext);
+}
+
+/**
+ * Test audio can only be extracted from an audio stream, with an encoder that
+ * exists.
+ */
+BOOST_FIXTURE_TEST_CASE( test_extract_audio_invalid, test::LibAvRegisterable )
+{
+
+    BOOST_REQUIRE_THROW( transcode::libav::AudioExtractor(VIDEO_AVI, DIVX_STREAM_ONE),
+            transcode::IllegalArgumentException );
+
+    BOOST_REQUIRE_THROW( transcode::libav::AudioExtractor(VIDEO_AVI, 99),
+            transcode::IllegalArgumentException );
+
+    transcode::libav::AudioOptions options;
+
+    options.encoderName = "no such encoder";
+
+    BOOST_REQUIRE_THROW( transcode::libav::extractAudio(VIDEO_AVI, AUDIO_MP2, options),
+            transcode::libav::CodecException );
+}
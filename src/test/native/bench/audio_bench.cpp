@@ -0,0 +1,269 @@
+/*
+ * audio_bench.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+}
+
+#include <bench/bench.hpp>
+
+#include <libav/audio.hpp>
+#include <libav/libav.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @file audio_bench.cpp
+ *
+ * How much faster the audio only fast path is than extracting audio the generic
+ * way, which opens a decoder for every stream and demuxes every packet.
+ *
+ *   genericDecode - open every decoder, read every packet, decode the audio.
+ *   audioDecode   - decode the audio with an AudioExtractor.
+ *   genericPcm    - the generic decode with the frames encoded to PCM.
+ *   audioPcm      - the audio only decode with the frames encoded to PCM.
+ *
+ * The encoded packets are dropped rather than written. The frames per second of
+ * each and the gain of the fast path are written to standard error. Only
+ * test.avi and test.mkv are used unless other media is named with "--media".
+ */
+
+
+using namespace transcode::libav;
+
+/**
+ * Drops every encoded packet.
+ */
+static void dropPacket(AVPacket*) {
+}
+
+/**
+ * Decode the first audio stream of the supplied media the generic way.
+ *
+ * @param pcm - true to encode every frame to PCM.
+ */
+static bench::Work genericAudio(const std::string& media, bool pcm) {
+
+    bench::Work work;
+
+    AVFormatContext *formatContext = openFormatContext(media);
+
+    std::vector<AVCodecContext*> decoders(formatContext->nb_streams,
+            static_cast<AVCodecContext*>(NULL));
+
+    int streamIndex = -1;
+
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+
+        AVMediaType type = findStreamType(formatContext->streams[i]);
+
+        if (AVMEDIA_TYPE_AUDIO == type && 0 > streamIndex) streamIndex = i;
+
+        if (AVMEDIA_TYPE_AUDIO != type && AVMEDIA_TYPE_VIDEO != type) continue;
+
+        try {
+
+            decoders[i] = openDecodeCodecContext(formatContext->streams[i]->codec);
+
+        } catch (const std::exception&) {
+
+            // A stream that can't be decoded is still demuxed.
+        }
+    }
+
+    AudioEncoder *encoder = NULL;
+
+    if (0 <= streamIndex && NULL != decoders[streamIndex] && pcm) {
+
+        encoder = new AudioEncoder(decoders[streamIndex], "", 0, dropPacket);
+    }
+
+    for (AVPacket *packet = readNextPacket(formatContext); NULL != packet;
+            packet = readNextPacket(formatContext)) {
+
+        if (streamIndex == packet->stream_index && NULL != decoders[streamIndex]) {
+
+            work.packets++;
+            work.bytes += packet->size;
+
+            std::vector<AVFrame*> frames;
+
+            tryDecodeAudioPacket(decoders[streamIndex], packet, frames);
+
+            for (size_t i = 0; i < frames.size(); i++) {
+
+                work.frames++;
+
+                if (NULL != encoder) encoder->push(frames[i]);
+
+                freeFrame(&frames[i]);
+            }
+        }
+
+        freePacket(&packet);
+    }
+
+    if (NULL != encoder) encoder->finish();
+
+    delete encoder;
+
+    for (size_t i = 0; i < decoders.size(); i++) {
+
+        if (NULL != decoders[i]) closeCodecContext(&decoders[i]);
+    }
+
+    closeFormatContext(&formatContext);
+
+    return work;
+}
+
+/**
+ * Counts the frames handed to it, and encodes them if it has an encoder.
+ */
+struct CountFrames {
+
+    bench::Work *work;
+    AudioEncoder *encoder;
+
+    void operator()(const AVFrame *frame) const {
+
+        work->frames++;
+
+        if (NULL != encoder) encoder->push(frame);
+    }
+};
+
+/**
+ * Decode the first audio stream of the supplied media through the audio only
+ * fast path.
+ *
+ * @param pcm - true to encode every frame to PCM.
+ */
+static bench::Work fastAudio(const std::string& media, bool pcm) {
+
+    bench::Work work;
+
+    AudioExtractor extractor(media);
+
+    AudioEncoder *encoder = pcm ? new AudioEncoder(extractor.decoder(), "", 0, dropPacket)
+            : NULL;
+
+    CountFrames countFrames = { &work, encoder };
+
+    AudioResult result = extractor.run(countFrames);
+
+    if (NULL != encoder) encoder->finish();
+
+    delete encoder;
+
+    work.packets = result.packetsRead;
+
+    return work;
+}
+
+static bench::Work genericDecode(const std::string& media) {
+
+    return genericAudio(media, false);
+}
+
+static bench::Work audioDecode(const std::string& media) {
+
+    return fastAudio(media, false);
+}
+
+static bench::Work genericPcm(const std::string& media) {
+
+    return genericAudio(media, true);
+}
+
+static bench::Work audioPcm(const std::string& media) {
+
+    return fastAudio(media, true);
+}
+
+/**
+ * Find the result of the supplied scenario over the supplied media.
+ *
+ * @return the result, or NULL if there isn't a successful one.
+ */
+static const bench::Result* findResult(const std::vector<bench::Result>& results,
+        const std::string& scenario, const std::string& media) {
+
+    for (size_t i = 0; i < results.size(); i++) {
+
+        if (scenario == results[i].scenario && media == results[i].media
+                && results[i].succeeded) {
+
+            return &results[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Write the frames per second of the generic way against the fast path.
+ */
+static void reportGain(const std::vector<bench::Result>& results, const std::string& media,
+        const std::string& generic, const std::string& fast) {
+
+    const bench::Result *slow = findResult(results, generic, media);
+    const bench::Result *quick = findResult(results, fast, media);
+
+    if (NULL == slow || NULL == quick || 0 >= slow->seconds || 0 >= quick->seconds) {
+
+        return;
+    }
+
+    double slowFps = slow->work.frames / slow->seconds;
+    double quickFps = quick->work.frames / quick->seconds;
+
+    std::cerr << media << ": " << generic << " " << slowFps << " fps, " << fast << " "
+            << quickFps << " fps, gain " << quickFps / slowFps << "x" << std::endl;
+}
+
+int main(int argc, char **argv) {
+
+    av_log_set_level(AV_LOG_QUIET);
+
+    std::vector<std::pair<std::string, bench::Scenario> > scenarios;
+
+    scenarios.push_back(std::make_pair(std::string("genericDecode"),
+            bench::Scenario(genericDecode)));
+    scenarios.push_back(std::make_pair(std::string("audioDecode"),
+            bench::Scenario(audioDecode)));
+    scenarios.push_back(std::make_pair(std::string("genericPcm"),
+            bench::Scenario(genericPcm)));
+    scenarios.push_back(std::make_pair(std::string("audioPcm"),
+            bench::Scenario(audioPcm)));
+
+    bench::Options options(argc, argv);
+
+    std::vector<std::string> media = options.media;
+
+    if (media.empty()) {
+
+        media.push_back(bench::MEDIA_FILES[0]);
+        media.push_back(bench::MEDIA_FILES[1]);
+    }
+
+    std::vector<bench::Result> results = bench::runScenarios(options, scenarios, media);
+
+    for (size_t i = 0; i < media.size(); i++) {
+
+        std::string name = bench::mediaName(media[i]);
+
+        reportGain(results, name, "genericDecode", "audioDecode");
+        reportGain(results, name, "genericPcm", "audioPcm");
+    }
+
+    return bench::finish(options, results);
+}
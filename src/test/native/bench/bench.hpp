@@ -0,0 +1,498 @@
+/*
+ * bench.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __BENCH_HPP__
+#define __BENCH_HPP__
+
+#include <util_test.hpp>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <tr1/functional>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * @file bench.hpp
+ *
+ * A small harness for the benchmarks. Every scenario is run in its own forked
+ * process so that the peak resident memory and CPU time reported for it belong
+ * to that scenario alone. The results are written out as one JSON object per
+ * line so they can be stored as a baseline and compared against later runs.
+ */
+
+
+namespace bench {
+
+// The same media files the unit tests use.
+const std::string MEDIA_FILES[] = { VIDEO_AVI, VIDEO_MKV, VIDEO_MP4, VIDEO_OGV, VIDEO_FLV };
+
+const int MEDIA_FILE_COUNT = sizeof(MEDIA_FILES) / sizeof(MEDIA_FILES[0]);
+
+// The directory any files written by the benchmarks are placed in.
+const std::string OUTPUT_DIR = "../../../target/test-classes/lib-test/";
+
+// A run is only reported as a regression if it is this much slower than the baseline.
+const double DEFAULT_TOLERANCE = 0.10;
+
+/**
+ * The work done by a single run of a scenario, filled in by the scenario itself.
+ */
+struct Work {
+
+    uint64_t packets;
+    uint64_t frames;
+    uint64_t bytes;
+
+    Work() : packets(0), frames(0), bytes(0) {}
+};
+
+/**
+ * The result of a single run of a scenario over a single media file.
+ */
+struct Result {
+
+    std::string scenario;
+    std::string media;
+    bool succeeded;
+    std::string error;
+    Work work;
+    double seconds;
+    double cpuSeconds;
+    long peakRssKb;
+
+    Result() : scenario(), media(), succeeded(false), error(), work(), seconds(0),
+            cpuSeconds(0), peakRssKb(0) {}
+
+    double packetsPerSecond() const { return 0 < seconds ? work.packets / seconds : 0; }
+
+    double framesPerSecond() const { return 0 < seconds ? work.frames / seconds : 0; }
+
+    double megabytesPerSecond() const {
+
+        return 0 < seconds ? work.bytes / (1024.0 * 1024.0) / seconds : 0;
+    }
+
+    /**
+     * @return the key used to match this result against a baseline result.
+     */
+    std::string key() const { return scenario + " " + media; }
+};
+
+typedef std::tr1::function<Work(const std::string& media)> Scenario;
+
+/**
+ * @return the wall clock time in seconds.
+ */
+inline double now() {
+
+    timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/**
+ * @return the name of the supplied media file without its directory.
+ */
+inline std::string mediaName(const std::string& media) {
+
+    size_t slash = media.find_last_of('/');
+
+    return std::string::npos == slash ? media : media.substr(slash + 1);
+}
+
+/**
+ * Run the supplied scenario over the supplied media file in a child process.
+ *
+ * @param name - the name of the scenario.
+ * @param scenario - the scenario to run.
+ * @param media - the path to the media file to run the scenario over.
+ * @return the result of the run.
+ */
+inline Result run(const std::string& name, Scenario scenario, const std::string& media) {
+
+    Result result;
+
+    result.scenario = name;
+    result.media = mediaName(media);
+
+    int pipeFds[2];
+
+    if (0 != pipe(pipeFds)) {
+
+        result.error = "Could not create a pipe to the scenario process.";
+
+        return result;
+    }
+
+    pid_t child = fork();
+
+    if (0 == child) {
+
+        close(pipeFds[0]);
+
+        std::stringstream out;
+
+        try {
+
+            double start = now();
+
+            Work work = scenario(media);
+
+            out << "ok " << work.packets << " " << work.frames << " " << work.bytes
+                    << " " << now() - start;
+
+        } catch (const std::exception& e) {
+
+            out << "error " << e.what();
+
+        } catch (...) {
+
+            out << "error unknown";
+        }
+
+        std::string message = out.str();
+
+        ssize_t written = write(pipeFds[1], message.c_str(), message.size());
+
+        _exit(static_cast<ssize_t>(message.size()) == written ? 0 : 1);
+    }
+
+    close(pipeFds[1]);
+
+    if (0 > child) {
+
+        close(pipeFds[0]);
+
+        result.error = "Could not fork the scenario process.";
+
+        return result;
+    }
+
+    std::string message;
+
+    char buffer[512];
+
+    for (ssize_t n = read(pipeFds[0], buffer, sizeof(buffer)); 0 < n;
+            n = read(pipeFds[0], buffer, sizeof(buffer))) {
+
+        message.append(buffer, n);
+    }
+
+    close(pipeFds[0]);
+
+    int status = 0;
+    rusage usage;
+
+    memset(&usage, 0, sizeof(usage));
+
+    wait4(child, &status, 0, &usage);
+
+    result.peakRssKb = usage.ru_maxrss;
+    result.cpuSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+            + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+
+    std::stringstream in(message);
+    std::string outcome;
+
+    in >> outcome;
+
+    if ("ok" == outcome) {
+
+        in >> result.work.packets >> result.work.frames >> result.work.bytes
+                >> result.seconds;
+
+        result.succeeded = true;
+
+    } else if ("error" == outcome) {
+
+        std::getline(in >> std::ws, result.error);
+
+    } else {
+
+        result.error = WIFSIGNALED(status)
+                ? "The scenario process was killed by a signal."
+                : "The scenario process exited without a result.";
+    }
+
+    return result;
+}
+
+/**
+ * Write the supplied string as a JSON string.
+ */
+inline void writeJsonString(std::ostream& out, const std::string& value) {
+
+    out << '"';
+
+    for (size_t i = 0; i < value.size(); i++) {
+
+        if ('"' == value[i] || '\\' == value[i]) out << '\\';
+
+        out << (static_cast<unsigned char>(value[i]) < 0x20 ? ' ' : value[i]);
+    }
+
+    out << '"';
+}
+
+/**
+ * Write the supplied result as a single line of JSON.
+ *
+ * @param out - the stream to write to.
+ * @param result - the result to write.
+ */
+inline void writeJson(std::ostream& out, const Result& result) {
+
+    out << "{\"scenario\":";
+    writeJsonString(out, result.scenario);
+    out << ",\"media\":";
+    writeJsonString(out, result.media);
+    out << ",\"succeeded\":" << (result.succeeded ? "true" : "false");
+
+    if (!result.succeeded) {
+
+        out << ",\"error\":";
+        writeJsonString(out, result.error);
+    }
+
+    out << ",\"packets\":" << result.work.packets
+            << ",\"frames\":" << result.work.frames
+            << ",\"bytes\":" << result.work.bytes
+            << ",\"seconds\":" << result.seconds
+            << ",\"packets_per_second\":" << result.packetsPerSecond()
+            << ",\"frames_per_second\":" << result.framesPerSecond()
+            << ",\"mb_per_second\":" << result.megabytesPerSecond()
+            << ",\"cpu_seconds\":" << result.cpuSeconds
+            << ",\"peak_rss_kb\":" << result.peakRssKb
+            << "}" << std::endl;
+}
+
+/**
+ * Read a single field of every successful result in a baseline file.
+ *
+ * @param fileName - the baseline file to read.
+ * @param field - the name of the field to read.
+ * @param baseline - the map the results are added to, keyed by scenario and media.
+ * @return false if the baseline file couldn't be read, otherwise true.
+ */
+inline bool readBaseline(const std::string& fileName, const std::string& field,
+        std::map<std::string, double>& baseline) {
+
+    std::ifstream in(fileName.c_str());
+
+    if (!in) return false;
+
+    std::string line;
+
+    while (std::getline(in, line)) {
+
+        if (line.empty()) continue;
+
+        std::stringstream json(line);
+        boost::property_tree::ptree tree;
+
+        boost::property_tree::read_json(json, tree);
+
+        if (!tree.get<bool>("succeeded", false)) continue;
+
+        baseline[tree.get<std::string>("scenario") + " " + tree.get<std::string>("media")] =
+                tree.get<double>(field);
+    }
+
+    return true;
+}
+
+/**
+ * Compare the supplied results with a baseline file and report every result
+ * that failed or is slower than its baseline by more than the tolerance.
+ *
+ * @param results - the results of this run.
+ * @param fileName - the baseline file to compare with.
+ * @param tolerance - the fraction a result may be slower than its baseline by.
+ * @return the number of regressions found.
+ */
+inline int compareWithBaseline(const std::vector<Result>& results,
+        const std::string& fileName, double tolerance) {
+
+    std::map<std::string, double> baseline;
+
+    if (!readBaseline(fileName, "mb_per_second", baseline)) {
+
+        std::cerr << "No baseline found at " << fileName << ", nothing to compare with."
+                << std::endl;
+
+        return 0;
+    }
+
+    int regressions = 0;
+
+    for (size_t i = 0; i < results.size(); i++) {
+
+        const Result& result = results[i];
+
+        std::map<std::string, double>::const_iterator expected = baseline.find(result.key());
+
+        if (baseline.end() == expected) continue;
+
+        if (!result.succeeded) {
+
+            std::cerr << "REGRESSION " << result.key() << " failed: " << result.error
+                    << std::endl;
+
+            regressions++;
+
+        } else if (result.megabytesPerSecond() < expected->second * (1 - tolerance)) {
+
+            std::cerr << "REGRESSION " << result.key() << " "
+                    << result.megabytesPerSecond() << " MB/s, baseline "
+                    << expected->second << " MB/s" << std::endl;
+
+            regressions++;
+        }
+    }
+
+    return regressions;
+}
+
+/**
+ * The options every benchmark program accepts.
+ *
+ *   --baseline FILE    compare the results with a baseline file.
+ *   --record FILE      write the results to a baseline file.
+ *   --tolerance N      the fraction slower than the baseline that is allowed.
+ *   --scenario NAME    only run the named scenario.
+ *   --repetitions N    the number of timed repetitions of each microbenchmark.
+ *   --media FILE       run over this media file instead of the test media, this
+ *                      can be given more than once.
+ */
+struct Options {
+
+    std::string baseline;
+    std::string record;
+    std::string scenario;
+    double tolerance;
+    int repetitions;
+    std::vector<std::string> media;
+
+    Options(int argc, char **argv) : baseline(), record(), scenario(),
+            tolerance(DEFAULT_TOLERANCE), repetitions(0), media() {
+
+        for (int i = 1; i + 1 < argc; i += 2) {
+
+            std::string option = argv[i];
+
+            if ("--baseline" == option) baseline = argv[i + 1];
+            else if ("--record" == option) record = argv[i + 1];
+            else if ("--scenario" == option) scenario = argv[i + 1];
+            else if ("--tolerance" == option) tolerance = atof(argv[i + 1]);
+            else if ("--repetitions" == option) repetitions = atoi(argv[i + 1]);
+            else if ("--media" == option) media.push_back(argv[i + 1]);
+        }
+    }
+};
+
+/**
+ * Run every supplied scenario over every media file and write the results to
+ * standard out.
+ *
+ * @param options - the command line options.
+ * @param scenarios - the scenarios to run, keyed by name.
+ * @param media - the media files to run them over.
+ * @return the results.
+ */
+inline std::vector<Result> runScenarios(const Options& options,
+        const std::vector<std::pair<std::string, Scenario> >& scenarios,
+        const std::vector<std::string>& media) {
+
+    std::vector<Result> results;
+
+    for (size_t i = 0; i < scenarios.size(); i++) {
+
+        if (!options.scenario.empty() && options.scenario != scenarios[i].first) continue;
+
+        for (size_t j = 0; j < media.size(); j++) {
+
+            Result result = run(scenarios[i].first, scenarios[i].second, media[j]);
+
+            writeJson(std::cout, result);
+
+            results.push_back(result);
+        }
+    }
+
+    return results;
+}
+
+/**
+ * Record or compare the supplied results as the options ask.
+ *
+ * @param options - the command line options.
+ * @param results - the results of the benchmark program.
+ * @return the exit code for the benchmark program.
+ */
+inline int finish(const Options& options, const std::vector<Result>& results) {
+
+    if (!options.record.empty()) {
+
+        std::ofstream out(options.record.c_str());
+
+        for (size_t i = 0; i < results.size(); i++) writeJson(out, results[i]);
+    }
+
+    if (options.baseline.empty()) return 0;
+
+    return 0 == compareWithBaseline(results, options.baseline, options.tolerance) ? 0 : 1;
+}
+
+/**
+ * Run every supplied scenario over every media file, write the results to
+ * standard out and then record or compare them as the options ask.
+ *
+ * @param options - the command line options.
+ * @param scenarios - the scenarios to run, keyed by name.
+ * @param media - the media files to run them over.
+ * @return the exit code for the benchmark program.
+ */
+inline int runAll(const Options& options,
+        const std::vector<std::pair<std::string, Scenario> >& scenarios,
+        const std::vector<std::string>& media) {
+
+    return finish(options, runScenarios(options, scenarios, media));
+}
+
+/**
+ * @return every media file the benchmarks are run over, the files named in the
+ *      options or the test media if there aren't any.
+ */
+inline std::vector<std::string> mediaFiles(const Options& options) {
+
+    if (!options.media.empty()) return options.media;
+
+    return std::vector<std::string>(MEDIA_FILES, MEDIA_FILES + MEDIA_FILE_COUNT);
+}
+
+} /* namespace bench */
+
+#endif /* __BENCH_HPP__ */
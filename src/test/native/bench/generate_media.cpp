@@ -0,0 +1,481 @@
+/*
+ * generate_media.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+#include "libavutil/samplefmt.h"
+}
+
+#include <error.hpp>
+#include <libav/libav.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+
+/**
+ * @file generate_media.cpp
+ *
+ * Writes synthetic media files of any length, resolution and codec so that the
+ * benchmarks can be run over inputs far bigger than the bundled test files.
+ *
+ * The video is a set of colour bars over a moving gradient with a box that
+ * crosses the frame once a second, the audio is a steady tone in each channel
+ * with a beep at the start of every second. Every sample only depends on its
+ * position in the file, so the same options always produce the same file.
+ *
+ *   generate_media --output FILE [--format NAME] [--duration SECONDS]
+ *           [--width N] [--height N] [--fps N] [--video-codec NAME]
+ *           [--video-bitrate N] [--audio-codec NAME] [--sample-rate N]
+ *           [--channels N] [--audio-bitrate N] [--no-video] [--no-audio]
+ */
+
+
+using namespace transcode::libav;
+
+/**
+ * The options of the media to generate.
+ */
+struct Options {
+
+    std::string output;
+    std::string format;
+    double duration;
+    int width;
+    int height;
+    int fps;
+    std::string videoCodec;
+    int videoBitrate;
+    std::string audioCodec;
+    int sampleRate;
+    int channels;
+    int audioBitrate;
+    bool video;
+    bool audio;
+
+    Options(int argc, char **argv) : output(), format(), duration(60), width(1280),
+            height(720), fps(25), videoCodec("mpeg4"), videoBitrate(4000000),
+            audioCodec("mp2"), sampleRate(44100), channels(2), audioBitrate(192000),
+            video(true), audio(true) {
+
+        for (int i = 1; i < argc; i++) {
+
+            std::string option = argv[i];
+
+            if ("--no-video" == option) { video = false; continue; }
+            if ("--no-audio" == option) { audio = false; continue; }
+
+            if (i + 1 >= argc) break;
+
+            std::string value = argv[++i];
+
+            if ("--output" == option) output = value;
+            else if ("--format" == option) format = value;
+            else if ("--duration" == option) duration = atof(value.c_str());
+            else if ("--width" == option) width = atoi(value.c_str());
+            else if ("--height" == option) height = atoi(value.c_str());
+            else if ("--fps" == option) fps = atoi(value.c_str());
+            else if ("--video-codec" == option) videoCodec = value;
+            else if ("--video-bitrate" == option) videoBitrate = atoi(value.c_str());
+            else if ("--audio-codec" == option) audioCodec = value;
+            else if ("--sample-rate" == option) sampleRate = atoi(value.c_str());
+            else if ("--channels" == option) channels = atoi(value.c_str());
+            else if ("--audio-bitrate" == option) audioBitrate = atoi(value.c_str());
+            else std::cerr << "Ignoring unknown option " << option << std::endl;
+        }
+    }
+};
+
+/**
+ * Find an encoder by name.
+ */
+static AVCodec* findEncoder(const std::string& name) {
+
+    AVCodec *codec = avcodec_find_encoder_by_name(name.c_str());
+
+    if (NULL == codec) throw transcode::IllegalArgumentException("Unknown encoder: " + name);
+
+    return codec;
+}
+
+/**
+ * Open an encoder for the synthetic video.
+ */
+static AVCodecContext* openVideoEncoder(const Options& options, AVFormatContext *output) {
+
+    AVCodec *codec = findEncoder(options.videoCodec);
+
+    AVCodecContext *codecContext = avcodec_alloc_context3(codec);
+
+    codecContext->width = options.width;
+    codecContext->height = options.height;
+    codecContext->pix_fmt = PIX_FMT_YUV420P;
+    codecContext->time_base.num = 1;
+    codecContext->time_base.den = options.fps;
+    codecContext->bit_rate = options.videoBitrate;
+    // A key frame every two seconds, like most real world media.
+    codecContext->gop_size = options.fps * 2;
+
+    if (0 != (output->oformat->flags & AVFMT_GLOBALHEADER)) {
+
+        codecContext->flags |= CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    return openEncodeCodecContext(codecContext);
+}
+
+/**
+ * Open an encoder for the synthetic audio, in the first sample format the
+ * encoder supports.
+ */
+static AVCodecContext* openAudioEncoder(const Options& options, AVFormatContext *output) {
+
+    AVCodec *codec = findEncoder(options.audioCodec);
+
+    AVCodecContext *codecContext = avcodec_alloc_context3(codec);
+
+    codecContext->sample_fmt = NULL != codec->sample_fmts
+            ? codec->sample_fmts[0] : AV_SAMPLE_FMT_S16;
+    codecContext->sample_rate = options.sampleRate;
+    codecContext->channels = options.channels;
+    codecContext->channel_layout = av_get_default_channel_layout(options.channels);
+    codecContext->time_base.num = 1;
+    codecContext->time_base.den = options.sampleRate;
+    codecContext->bit_rate = options.audioBitrate;
+
+    if (0 != (output->oformat->flags & AVFMT_GLOBALHEADER)) {
+
+        codecContext->flags |= CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    return openEncodeCodecContext(codecContext);
+}
+
+// Colour bars in Y, U and V, from white to blue.
+static const uint8_t BARS[7][3] = {
+    {235, 128, 128}, {210, 16, 146}, {170, 166, 16}, {145, 54, 34},
+    {106, 202, 222}, {81, 90, 240}, {41, 240, 110}
+};
+
+/**
+ * Draw the test pattern for the supplied frame number.
+ */
+static void drawVideoFrame(AVFrame *frame, int width, int height, int fps, int64_t number) {
+
+    int barsHeight = height * 2 / 3;
+    int boxSize = height / 8;
+    int boxX = static_cast<int>((number % fps) * (width - boxSize) / fps);
+    int boxY = barsHeight + (height - barsHeight - boxSize) / 2;
+
+    for (int y = 0; y < height; y++) {
+
+        uint8_t *luma = frame->data[0] + y * frame->linesize[0];
+
+        for (int x = 0; x < width; x++) {
+
+            if (y < barsHeight) {
+
+                luma[x] = BARS[x * 7 / width][0];
+
+            } else if (x >= boxX && x < boxX + boxSize && y >= boxY && y < boxY + boxSize) {
+
+                luma[x] = 235;
+
+            } else {
+
+                luma[x] = static_cast<uint8_t>(16 + ((x + number * 4) % 220));
+            }
+        }
+    }
+
+    for (int y = 0; y < height / 2; y++) {
+
+        uint8_t *u = frame->data[1] + y * frame->linesize[1];
+        uint8_t *v = frame->data[2] + y * frame->linesize[2];
+
+        for (int x = 0; x < width / 2; x++) {
+
+            bool bars = y * 2 < barsHeight;
+
+            u[x] = bars ? BARS[x * 14 / width][1] : 128;
+            v[x] = bars ? BARS[x * 14 / width][2] : 128;
+        }
+    }
+}
+
+/**
+ * Write a single audio sample in any of the common sample formats.
+ */
+static void writeSample(uint8_t *data, AVSampleFormat format, int index, double value) {
+
+    switch (format) {
+
+    case AV_SAMPLE_FMT_U8:
+    case AV_SAMPLE_FMT_U8P:
+        data[index] = static_cast<uint8_t>(128 + value * 127);
+        break;
+    case AV_SAMPLE_FMT_S16:
+    case AV_SAMPLE_FMT_S16P:
+        reinterpret_cast<int16_t*>(data)[index] = static_cast<int16_t>(value * 32767);
+        break;
+    case AV_SAMPLE_FMT_S32:
+    case AV_SAMPLE_FMT_S32P:
+        reinterpret_cast<int32_t*>(data)[index] = static_cast<int32_t>(value * 2147483647.0);
+        break;
+    case AV_SAMPLE_FMT_FLT:
+    case AV_SAMPLE_FMT_FLTP:
+        reinterpret_cast<float*>(data)[index] = static_cast<float>(value);
+        break;
+    case AV_SAMPLE_FMT_DBL:
+    case AV_SAMPLE_FMT_DBLP:
+        reinterpret_cast<double*>(data)[index] = value;
+        break;
+    default:
+        throw transcode::IllegalArgumentException("Unsupported audio sample format.");
+    }
+}
+
+/**
+ * Fill the supplied audio frame with the tones starting at the supplied sample.
+ */
+static void drawAudioFrame(AVFrame *frame, const AVCodecContext *codecContext,
+        int64_t firstSample) {
+
+    bool planar = 0 != av_sample_fmt_is_planar(codecContext->sample_fmt);
+
+    for (int i = 0; i < frame->nb_samples; i++) {
+
+        int64_t sample = firstSample + i;
+
+        double time = static_cast<double>(sample) / codecContext->sample_rate;
+
+        // A short beep at the start of every second.
+        bool beep = sample % codecContext->sample_rate < codecContext->sample_rate / 10;
+
+        for (int channel = 0; channel < codecContext->channels; channel++) {
+
+            double frequency = beep ? 1000 : 440 * (1 + channel * 0.5);
+
+            double value = 0.5 * std::sin(2 * M_PI * frequency * time);
+
+            if (planar) writeSample(frame->data[channel], codecContext->sample_fmt, i, value);
+            else writeSample(frame->data[0], codecContext->sample_fmt,
+                    i * codecContext->channels + channel, value);
+        }
+    }
+}
+
+/**
+ * Rescale an encoded packets timestamps to its stream then write it.
+ */
+static void writeEncodedPacket(AVFormatContext *output, AVStream *stream,
+        const AVCodecContext *codecContext, AVPacket *packet) {
+
+    if (AV_NOPTS_VALUE != packet->pts) {
+
+        packet->pts = av_rescale_q(packet->pts, codecContext->time_base, stream->time_base);
+    }
+
+    if (AV_NOPTS_VALUE != packet->dts) {
+
+        packet->dts = av_rescale_q(packet->dts, codecContext->time_base, stream->time_base);
+    }
+
+    packet->stream_index = stream->index;
+
+    writePacket(output, packet);
+}
+
+/**
+ * Write out the packets held back by an encoder with a delay.
+ */
+static void flushEncoder(AVFormatContext *output, AVStream *stream,
+        AVCodecContext *codecContext) {
+
+    if (0 == (codecContext->codec->capabilities & CODEC_CAP_DELAY)) return;
+
+    for (;;) {
+
+        AVPacket packet;
+
+        av_init_packet(&packet);
+
+        packet.data = NULL;
+        packet.size = 0;
+
+        int packetEncoded = 0;
+
+        int result = AVMEDIA_TYPE_VIDEO == codecContext->codec_type
+                ? avcodec_encode_video2(codecContext, &packet, NULL, &packetEncoded)
+                : avcodec_encode_audio2(codecContext, &packet, NULL, &packetEncoded);
+
+        if (0 > result || 0 == packetEncoded) return;
+
+        writeEncodedPacket(output, stream, codecContext, &packet);
+
+        av_free_packet(&packet);
+    }
+}
+
+/**
+ * Encode the supplied frame and write the packet it produces, if any.
+ */
+static void encodeAndWrite(AVFormatContext *output, AVStream *stream,
+        AVCodecContext *codecContext, const AVFrame *frame) {
+
+    AVPacket *packet = AVMEDIA_TYPE_VIDEO == codecContext->codec_type
+            ? encodeVideoFrame(codecContext, frame)
+            : encodeAudioFrame(codecContext, frame);
+
+    if (NULL == packet) return;
+
+    writeEncodedPacket(output, stream, codecContext, packet);
+
+    freePacket(&packet);
+}
+
+static void generate(const Options& options) {
+
+    AVFormatContext *output = openOutputFormatContext(options.output, options.format);
+
+    AVCodecContext *videoEncoder = options.video ? openVideoEncoder(options, output) : NULL;
+    AVCodecContext *audioEncoder = options.audio ? openAudioEncoder(options, output) : NULL;
+
+    AVStream *videoStream = NULL != videoEncoder ? addOutputStream(output, videoEncoder) : NULL;
+    AVStream *audioStream = NULL != audioEncoder ? addOutputStream(output, audioEncoder) : NULL;
+
+    writeOutputHeader(output);
+
+    AVFrame *videoFrame = avcodec_alloc_frame();
+    AVFrame *audioFrame = avcodec_alloc_frame();
+
+    uint8_t *videoBuffer = NULL;
+    uint8_t *audioBuffer = NULL;
+
+    if (NULL != videoEncoder) {
+
+        videoBuffer = static_cast<uint8_t*>(av_malloc(
+                avpicture_get_size(PIX_FMT_YUV420P, options.width, options.height)));
+
+        avpicture_fill(reinterpret_cast<AVPicture*>(videoFrame), videoBuffer,
+                PIX_FMT_YUV420P, options.width, options.height);
+    }
+
+    int audioFrameSize = 0;
+
+    if (NULL != audioEncoder) {
+
+        // Encoders that take any frame size, such as PCM, report a frame size of 0.
+        audioFrameSize = 0 < audioEncoder->frame_size ? audioEncoder->frame_size : 1024;
+
+        int audioBufferSize = av_samples_get_buffer_size(NULL, audioEncoder->channels,
+                audioFrameSize, audioEncoder->sample_fmt, 0);
+
+        audioBuffer = static_cast<uint8_t*>(av_malloc(audioBufferSize));
+
+        audioFrame->nb_samples = audioFrameSize;
+
+        avcodec_fill_audio_frame(audioFrame, audioEncoder->channels,
+                audioEncoder->sample_fmt, audioBuffer, audioBufferSize, 0);
+    }
+
+    int64_t videoFrames = NULL != videoEncoder
+            ? static_cast<int64_t>(options.duration * options.fps) : 0;
+    int64_t audioSamples = NULL != audioEncoder
+            ? static_cast<int64_t>(options.duration * options.sampleRate) : 0;
+
+    int64_t videoFrameNumber = 0;
+    int64_t audioSampleNumber = 0;
+
+    // Encode whichever stream is furthest behind so the packets are written
+    // roughly in order.
+    while (videoFrameNumber < videoFrames || audioSampleNumber < audioSamples) {
+
+        double videoTime = videoFrameNumber < videoFrames
+                ? static_cast<double>(videoFrameNumber) / options.fps : options.duration;
+        double audioTime = audioSampleNumber < audioSamples
+                ? static_cast<double>(audioSampleNumber) / options.sampleRate : options.duration;
+
+        if (videoTime <= audioTime) {
+
+            drawVideoFrame(videoFrame, options.width, options.height, options.fps, videoFrameNumber);
+
+            videoFrame->pts = videoFrameNumber++;
+
+            encodeAndWrite(output, videoStream, videoEncoder, videoFrame);
+
+        } else {
+
+            drawAudioFrame(audioFrame, audioEncoder, audioSampleNumber);
+
+            audioFrame->pts = audioSampleNumber;
+
+            audioSampleNumber += audioFrameSize;
+
+            encodeAndWrite(output, audioStream, audioEncoder, audioFrame);
+        }
+    }
+
+    if (NULL != videoEncoder) flushEncoder(output, videoStream, videoEncoder);
+    if (NULL != audioEncoder) flushEncoder(output, audioStream, audioEncoder);
+
+    closeOutputFormatContext(&output);
+
+    if (NULL != videoEncoder) {
+
+        closeCodecContext(&videoEncoder);
+
+        av_free(videoEncoder);
+    }
+
+    if (NULL != audioEncoder) {
+
+        closeCodecContext(&audioEncoder);
+
+        av_free(audioEncoder);
+    }
+
+    av_free(videoBuffer);
+    av_free(audioBuffer);
+    av_free(videoFrame);
+    av_free(audioFrame);
+}
+
+int main(int argc, char **argv) {
+
+    Options options(argc, argv);
+
+    if (options.output.empty() || (!options.video && !options.audio)) {
+
+        std::cerr << "usage: generate_media --output FILE [--format NAME] [--duration SECONDS]"
+                << " [--width N] [--height N] [--fps N] [--video-codec NAME]"
+                << " [--video-bitrate N] [--audio-codec NAME] [--sample-rate N]"
+                << " [--channels N] [--audio-bitrate N] [--no-video] [--no-audio]"
+                << std::endl;
+
+        return 2;
+    }
+
+    av_log_set_level(AV_LOG_ERROR);
+
+    try {
+
+        generate(options);
+
+    } catch (const std::exception& e) {
+
+        std::cerr << "Could not generate " << options.output << ": " << e.what() << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+/*
+ * keyframe_bench.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+}
+
+#include <bench/bench.hpp>
+
+#include <libav/libav.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @file keyframe_bench.cpp
+ *
+ * How much faster decoding only the key frames of the video is than decoding
+ * every frame, for thumbnails and previews.
+ *
+ *   decodeVideo     - read and decode every video packet.
+ *   decodeKeyFrames - read and decode only the key frames.
+ *
+ * The speedup of each media file is written to standard error. Only test.mkv
+ * is used unless other media is named with "--media".
+ */
+
+
+using namespace transcode::libav;
+
+// The media the speedup is measured on by default.
+static const std::string DEFAULT_MEDIA = bench::MEDIA_FILES[1];
+
+/**
+ * Decode the first video stream of the supplied media.
+ */
+static bench::Work decodeVideo(const std::string& media, bool keyFramesOnly) {
+
+    bench::Work work;
+
+    AVFormatContext *formatContext = openFormatContext(media);
+
+    int streamIndex = -1;
+
+    for (unsigned int i = 0; i < formatContext->nb_streams && 0 > streamIndex; i++) {
+
+        if (AVMEDIA_TYPE_VIDEO == findStreamType(formatContext->streams[i])) streamIndex = i;
+    }
+
+    if (0 > streamIndex) {
+
+        closeFormatContext(&formatContext);
+
+        return work;
+    }
+
+    DecodeOptions options;
+
+    options.keyFramesOnly = keyFramesOnly;
+
+    setKeyFramesOnly(formatContext, keyFramesOnly);
+
+    AVCodecContext *codecContext = openDecodeCodecContext(
+            formatContext->streams[streamIndex]->codec, options);
+
+    for (AVPacket *packet = readNextPacket(formatContext); NULL != packet;
+            packet = readNextPacket(formatContext)) {
+
+        if (streamIndex == packet->stream_index) {
+
+            work.packets++;
+            work.bytes += packet->size;
+
+            AVFrame *frame = NULL;
+
+            tryDecodeVideoPacket(codecContext, packet, &frame);
+
+            if (NULL != frame) {
+
+                work.frames++;
+
+                freeFrame(&frame);
+            }
+        }
+
+        freePacket(&packet);
+    }
+
+    closeCodecContext(&codecContext);
+    closeFormatContext(&formatContext);
+
+    return work;
+}
+
+static bench::Work decodeAllFrames(const std::string& media) {
+
+    return decodeVideo(media, false);
+}
+
+static bench::Work decodeKeyFrames(const std::string& media) {
+
+    return decodeVideo(media, true);
+}
+
+/**
+ * Find the result of the supplied scenario over the supplied media.
+ *
+ * @return the result, or NULL if there isn't a successful one.
+ */
+static const bench::Result* findResult(const std::vector<bench::Result>& results,
+        const std::string& scenario, const std::string& media) {
+
+    for (size_t i = 0; i < results.size(); i++) {
+
+        if (scenario == results[i].scenario && media == results[i].media
+                && results[i].succeeded) {
+
+            return &results[i];
+        }
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+
+    av_log_set_level(AV_LOG_QUIET);
+
+    std::vector<std::pair<std::string, bench::Scenario> > scenarios;
+
+    scenarios.push_back(std::make_pair(std::string("decodeVideo"),
+            bench::Scenario(decodeAllFrames)));
+    scenarios.push_back(std::make_pair(std::string("decodeKeyFrames"),
+            bench::Scenario(decodeKeyFrames)));
+
+    bench::Options options(argc, argv);
+
+    std::vector<std::string> media = options.media.empty()
+            ? std::vector<std::string>(1, DEFAULT_MEDIA) : options.media;
+
+    std::vector<bench::Result> results = bench::runScenarios(options, scenarios, media);
+
+    for (size_t i = 0; i < media.size(); i++) {
+
+        std::string name = bench::mediaName(media[i]);
+
+        const bench::Result *all = findResult(results, "decodeVideo", name);
+        const bench::Result *keyFrames = findResult(results, "decodeKeyFrames", name);
+
+        if (NULL == all || NULL == keyFrames || 0 >= keyFrames->seconds) continue;
+
+        std::cerr << name << " key frame speedup: " << all->seconds / keyFrames->seconds
+                << "x, " << keyFrames->work.frames << " of " << all->work.frames
+                << " frames decoded" << std::endl;
+    }
+
+    return bench::finish(options, results);
+}
@@ -0,0 +1,157 @@
+/*
+ * ladder_bench.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+}
+
+#include <bench/bench.hpp>
+
+#include <libav/ladder.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @file ladder_bench.cpp
+ *
+ * How much CPU encoding an adaptive bitrate ladder from one decode saves over
+ * transcoding each rendition on its own.
+ *
+ *   ladderShared      - decode once and encode every rendition in parallel.
+ *   ladderIndependent - decode again for each rendition, one after the other.
+ *
+ * Both encode the same three renditions. The CPU time of each and how much
+ * less the shared decode uses are written to standard error. Only test.avi and
+ * test.mkv are used unless other media is named with "--media".
+ */
+
+
+using namespace transcode::libav;
+
+/**
+ * The renditions of the ladder for the supplied media.
+ */
+static std::vector<Rendition> renditions(const std::string& media) {
+
+    const int WIDTHS[] = { 640, 480, 320 };
+    const int BIT_RATES[] = { 1200000, 800000, 400000 };
+
+    std::vector<Rendition> renditions;
+
+    for (int i = 0; i < 3; i++) {
+
+        std::ostringstream fileName;
+
+        fileName << bench::OUTPUT_DIR << "bench_ladder_" << WIDTHS[i] << "_"
+                << bench::mediaName(media) << ".mkv";
+
+        renditions.push_back(Rendition(fileName.str(), WIDTHS[i], 0, BIT_RATES[i]));
+    }
+
+    return renditions;
+}
+
+/**
+ * Add what was done to encode a ladder to the supplied work.
+ */
+static void addWork(bench::Work& work, const LadderResult& result) {
+
+    work.packets += result.framesDecoded;
+
+    for (size_t i = 0; i < result.framesEncoded.size(); i++) {
+
+        work.frames += result.framesEncoded[i];
+    }
+}
+
+static bench::Work ladderShared(const std::string& media) {
+
+    bench::Work work;
+
+    addWork(work, encodeLadder(media, renditions(media)));
+
+    return work;
+}
+
+static bench::Work ladderIndependent(const std::string& media) {
+
+    bench::Work work;
+
+    std::vector<Rendition> ladder = renditions(media);
+
+    for (size_t i = 0; i < ladder.size(); i++) {
+
+        addWork(work, encodeLadder(media, std::vector<Rendition>(1, ladder[i])));
+    }
+
+    return work;
+}
+
+/**
+ * Find the result of the supplied scenario over the supplied media.
+ *
+ * @return the result, or NULL if there isn't a successful one.
+ */
+static const bench::Result* findResult(const std::vector<bench::Result>& results,
+        const std::string& scenario, const std::string& media) {
+
+    for (size_t i = 0; i < results.size(); i++) {
+
+        if (scenario == results[i].scenario && media == results[i].media
+                && results[i].succeeded) {
+
+            return &results[i];
+        }
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+
+    av_log_set_level(AV_LOG_QUIET);
+
+    std::vector<std::pair<std::string, bench::Scenario> > scenarios;
+
+    scenarios.push_back(std::make_pair(std::string("ladderShared"),
+            bench::Scenario(ladderShared)));
+    scenarios.push_back(std::make_pair(std::string("ladderIndependent"),
+            bench::Scenario(ladderIndependent)));
+
+    bench::Options options(argc, argv);
+
+    std::vector<std::string> media = options.media;
+
+    if (media.empty()) {
+
+        media.push_back(bench::MEDIA_FILES[0]);
+        media.push_back(bench::MEDIA_FILES[1]);
+    }
+
+    std::vector<bench::Result> results = bench::runScenarios(options, scenarios, media);
+
+    for (size_t i = 0; i < media.size(); i++) {
+
+        std::string name = bench::mediaName(media[i]);
+
+        const bench::Result *shared = findResult(results, "ladderShared", name);
+        const bench::Result *independent = findResult(results, "ladderIndependent", name);
+
+        if (NULL == shared || NULL == independent || 0 >= shared->cpuSeconds) continue;
+
+        std::cerr << name << " ladder: shared decode " << shared->cpuSeconds
+                << "s CPU, independent transcodes " << independent->cpuSeconds
+                << "s CPU, " << (1 - shared->cpuSeconds / independent->cpuSeconds) * 100
+                << "% saved, " << independent->seconds / shared->seconds
+                << "x faster" << std::endl;
+    }
+
+    return bench::finish(options, results);
+}
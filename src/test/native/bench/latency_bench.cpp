@@ -0,0 +1,214 @@
+/*
+ * latency_bench.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+}
+
+#include <bench/bench.hpp>
+
+#include <libav/libav.hpp>
+#include <libav/pipeline.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @file latency_bench.cpp
+ *
+ * How long each frame spends in a frame pipeline with the default encoder
+ * profile against the zero latency one.
+ *
+ *   mpeg4Default      - the mpeg4 encoder opened as it is by default.
+ *   mpeg4ZeroLatency  - the mpeg4 encoder with the zero latency profile.
+ *   x264Default       - libx264 with its own defaults, B-frames and lookahead.
+ *   x264ZeroLatency   - libx264 with the zero latency profile.
+ *
+ * The latency of a frame is the time from pushing the packet it was decoded
+ * from to its encoded packet reaching the sink, so frames an encoder holds back
+ * are charged for every push they wait through. The 50th and 99th percentile
+ * latency of each scenario is written to standard error. Only test.avi and
+ * test.mkv are used unless other media is named with "--media".
+ */
+
+
+using namespace transcode::libav;
+
+/**
+ * When each frame was pushed and how long each took to come out.
+ */
+struct Latencies {
+
+    std::vector<double> pushed;
+    double currentPush;
+    std::vector<double> milliseconds;
+
+    Latencies() : pushed(), currentPush(0), milliseconds() {}
+};
+
+/**
+ * Records the latency of every packet that reaches it.
+ */
+struct LatencySink {
+
+    Latencies *latencies;
+
+    void operator()(AVPacket *packet) const {
+
+        double now = bench::now();
+
+        // The timestamps of the encoder count frames, a frame that isn't in
+        // the pushed times yet was decoded by the current push.
+        size_t index = static_cast<size_t>(std::max(static_cast<int64_t>(0), packet->pts));
+
+        double pushed = index < latencies->pushed.size()
+                ? latencies->pushed[index] : latencies->currentPush;
+
+        latencies->milliseconds.push_back((now - pushed) * 1000);
+    }
+};
+
+/**
+ * @return the supplied percentile of the supplied sorted latencies.
+ */
+static double percentile(const std::vector<double>& sorted, double fraction) {
+
+    if (sorted.empty()) return 0;
+
+    size_t index = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+
+    return sorted[std::max(static_cast<size_t>(1), index) - 1];
+}
+
+/**
+ * Run the first video stream of the supplied media through a frame pipeline
+ * that encodes with the supplied encoder and profile.
+ */
+static bench::Work pipelineLatency(const std::string& media, const std::string& name,
+        const std::string& encoderName, EncodeProfile profile) {
+
+    bench::Work work;
+
+    AVFormatContext *formatContext = openFormatContext(media);
+
+    int streamIndex = -1;
+
+    for (unsigned int i = 0; i < formatContext->nb_streams && 0 > streamIndex; i++) {
+
+        if (AVMEDIA_TYPE_VIDEO == findStreamType(formatContext->streams[i])) streamIndex = i;
+    }
+
+    if (0 > streamIndex) {
+
+        closeFormatContext(&formatContext);
+
+        return work;
+    }
+
+    Latencies latencies;
+
+    LatencySink sink = { &latencies };
+
+    PipelineOptions options;
+
+    options.encoderName = encoderName;
+    options.width = 640;
+    options.encodeOptions.profile = profile;
+
+    {
+        FramePipeline pipeline(formatContext->streams[streamIndex], options, sink);
+
+        for (AVPacket *packet = readNextPacket(formatContext); NULL != packet;
+                packet = readNextPacket(formatContext)) {
+
+            if (streamIndex == packet->stream_index) {
+
+                work.packets++;
+                work.bytes += packet->size;
+
+                latencies.currentPush = bench::now();
+
+                pipeline.push(packet);
+
+                latencies.pushed.resize(pipeline.framesDecoded(), latencies.currentPush);
+            }
+
+            freePacket(&packet);
+        }
+
+        latencies.currentPush = bench::now();
+
+        pipeline.finish();
+
+        work.frames = pipeline.framesEncoded();
+    }
+
+    closeFormatContext(&formatContext);
+
+    std::sort(latencies.milliseconds.begin(), latencies.milliseconds.end());
+
+    std::cerr << bench::mediaName(media) << " " << name << ": p50 "
+            << percentile(latencies.milliseconds, 0.50) << " ms, p99 "
+            << percentile(latencies.milliseconds, 0.99) << " ms" << std::endl;
+
+    return work;
+}
+
+static bench::Work mpeg4Default(const std::string& media) {
+
+    return pipelineLatency(media, "mpeg4Default", "mpeg4", ENCODE_DEFAULT);
+}
+
+static bench::Work mpeg4ZeroLatency(const std::string& media) {
+
+    return pipelineLatency(media, "mpeg4ZeroLatency", "mpeg4", ENCODE_ZERO_LATENCY);
+}
+
+static bench::Work x264Default(const std::string& media) {
+
+    return pipelineLatency(media, "x264Default", "libx264", ENCODE_DEFAULT);
+}
+
+static bench::Work x264ZeroLatency(const std::string& media) {
+
+    return pipelineLatency(media, "x264ZeroLatency", "libx264", ENCODE_ZERO_LATENCY);
+}
+
+int main(int argc, char **argv) {
+
+    av_log_set_level(AV_LOG_QUIET);
+
+    std::vector<std::pair<std::string, bench::Scenario> > scenarios;
+
+    scenarios.push_back(std::make_pair(std::string("mpeg4Default"),
+            bench::Scenario(mpeg4Default)));
+    scenarios.push_back(std::make_pair(std::string("mpeg4ZeroLatency"),
+            bench::Scenario(mpeg4ZeroLatency)));
+    scenarios.push_back(std::make_pair(std::string("x264Default"),
+            bench::Scenario(x264Default)));
+    scenarios.push_back(std::make_pair(std::string("x264ZeroLatency"),
+            bench::Scenario(x264ZeroLatency)));
+
+    bench::Options options(argc, argv);
+
+    std::vector<std::string> media = options.media;
+
+    if (media.empty()) {
+
+        media.push_back(bench::MEDIA_FILES[0]);
+        media.push_back(bench::MEDIA_FILES[1]);
+    }
+
+    std::vector<bench::Result> results = bench::runScenarios(options, scenarios, media);
+
+    return bench::finish(options, results);
+}
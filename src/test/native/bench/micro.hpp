@@ -0,0 +1,287 @@
+/*
+ * micro.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#ifndef __MICRO_HPP__
+#define __MICRO_HPP__
+
+#include <bench/bench.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @file micro.hpp
+ *
+ * A harness for timing single calls. Each operation is run in batches that are
+ * long enough to time accurately, the batches are warmed up first and then
+ * repeated so that the median and 99th percentile cost of a call can be
+ * reported instead of a single average that hides the outliers.
+ */
+
+
+namespace bench {
+
+// The untimed repetitions run before the timed ones.
+const int DEFAULT_WARM_UP_REPETITIONS = 5;
+
+// The timed repetitions of each operation.
+const int DEFAULT_REPETITIONS = 50;
+
+// Each repetition runs the operation enough times to take at least this long.
+const double MINIMUM_REPETITION_SECONDS = 0.001;
+
+// The most times an operation is run in a single repetition.
+const long MAXIMUM_BATCH = 1L << 24;
+
+typedef std::tr1::function<void()> Operation;
+
+/**
+ * The cost of a single call to an operation, in nanoseconds.
+ */
+struct MicroResult {
+
+    std::string name;
+    std::string media;
+    long batch;
+    int repetitions;
+    double minimum;
+    double mean;
+    double median;
+    double p99;
+
+    MicroResult() : name(), media(), batch(0), repetitions(0), minimum(0), mean(0),
+            median(0), p99(0) {}
+
+    std::string key() const { return name + " " + media; }
+};
+
+/**
+ * Stops the compiler from optimising away a scalar value that is never used.
+ */
+template<typename T>
+inline void keep(T value) {
+
+    __asm__ __volatile__("" : : "g"(value) : "memory");
+}
+
+/**
+ * Time a single batch of calls to the supplied operation.
+ *
+ * @return the seconds the batch took.
+ */
+inline double timeBatch(const Operation& operation, long batch) {
+
+    double start = now();
+
+    for (long i = 0; i < batch; i++) operation();
+
+    return now() - start;
+}
+
+/**
+ * Summarise a set of timings of the same operation.
+ *
+ * @param name - the name of the operation.
+ * @param media - the name of the media the operation works on, or empty.
+ * @param nanoseconds - the timings, at least one.
+ * @return the summary of the timings, with a batch of 1.
+ */
+inline MicroResult summarise(const std::string& name, const std::string& media,
+        std::vector<double> nanoseconds) {
+
+    MicroResult result;
+
+    std::sort(nanoseconds.begin(), nanoseconds.end());
+
+    double total = 0;
+
+    for (size_t i = 0; i < nanoseconds.size(); i++) total += nanoseconds[i];
+
+    size_t size = nanoseconds.size();
+
+    result.name = name;
+    result.media = media;
+    result.batch = 1;
+    result.repetitions = size;
+    result.minimum = nanoseconds.front();
+    result.mean = total / size;
+    result.median = 0 == size % 2
+            ? (nanoseconds[size / 2 - 1] + nanoseconds[size / 2]) / 2
+            : nanoseconds[size / 2];
+    result.p99 = nanoseconds[static_cast<size_t>(std::ceil(0.99 * size)) - 1];
+
+    return result;
+}
+
+/**
+ * Measure the cost of a single call to the supplied operation.
+ *
+ * @param name - the name of the operation.
+ * @param media - the name of the media the operation works on, or empty.
+ * @param operation - the operation to time.
+ * @param repetitions - the number of timed repetitions, or 0 for the default.
+ * @return the summary of the timings.
+ */
+inline MicroResult measure(const std::string& name, const std::string& media,
+        const Operation& operation, int repetitions) {
+
+    repetitions = 0 < repetitions ? repetitions : DEFAULT_REPETITIONS;
+
+    // Grow the batch until it is long enough to time, this also warms up the
+    // caches and the branch predictors.
+    long batch = 1;
+
+    while (MAXIMUM_BATCH > batch && MINIMUM_REPETITION_SECONDS > timeBatch(operation, batch)) {
+
+        batch *= 2;
+    }
+
+    for (int i = 0; i < DEFAULT_WARM_UP_REPETITIONS; i++) timeBatch(operation, batch);
+
+    std::vector<double> nanoseconds(repetitions);
+
+    for (int i = 0; i < repetitions; i++) {
+
+        nanoseconds[i] = timeBatch(operation, batch) * 1e9 / batch;
+    }
+
+    MicroResult result = summarise(name, media, nanoseconds);
+
+    result.batch = batch;
+
+    return result;
+}
+
+/**
+ * Write the supplied result as a single line of JSON.
+ */
+inline void writeJson(std::ostream& out, const MicroResult& result) {
+
+    out << "{\"scenario\":";
+    writeJsonString(out, result.name);
+    out << ",\"media\":";
+    writeJsonString(out, result.media);
+    out << ",\"succeeded\":true"
+            << ",\"batch\":" << result.batch
+            << ",\"repetitions\":" << result.repetitions
+            << ",\"min_ns\":" << result.minimum
+            << ",\"mean_ns\":" << result.mean
+            << ",\"median_ns\":" << result.median
+            << ",\"p99_ns\":" << result.p99
+            << "}" << std::endl;
+}
+
+/**
+ * Compare the supplied results with a baseline file and report every result
+ * whose median cost is higher than its baseline by more than the tolerance.
+ *
+ * @return the number of regressions found.
+ */
+inline int compareWithBaseline(const std::vector<MicroResult>& results,
+        const std::string& fileName, double tolerance) {
+
+    std::map<std::string, double> baseline;
+
+    if (!readBaseline(fileName, "median_ns", baseline)) {
+
+        std::cerr << "No baseline found at " << fileName << ", nothing to compare with."
+                << std::endl;
+
+        return 0;
+    }
+
+    int regressions = 0;
+
+    for (size_t i = 0; i < results.size(); i++) {
+
+        const MicroResult& result = results[i];
+
+        std::map<std::string, double>::const_iterator expected = baseline.find(result.key());
+
+        if (baseline.end() == expected) continue;
+
+        if (result.median > expected->second * (1 + tolerance)) {
+
+            std::cerr << "REGRESSION " << result.key() << " " << result.median
+                    << " ns, baseline " << expected->second << " ns" << std::endl;
+
+            regressions++;
+        }
+    }
+
+    return regressions;
+}
+
+/**
+ * Collects the results of a microbenchmark program, then records or compares
+ * them as the options ask.
+ */
+class MicroRunner {
+
+private:
+    Options _options;
+    std::vector<MicroResult> _results;
+
+public:
+    MicroRunner(const Options& options) : _options(options), _results() {}
+
+    /**
+     * Measure and report the supplied operation, unless the options ask for
+     * a different scenario.
+     */
+    void run(const std::string& name, const std::string& media, const Operation& operation) {
+
+        if (!_options.scenario.empty() && _options.scenario != name) return;
+
+        add(measure(name, media, operation, _options.repetitions));
+    }
+
+    /**
+     * Report a result that was measured some other way.
+     */
+    void add(const MicroResult& result) {
+
+        writeJson(std::cout, result);
+
+        _results.push_back(result);
+    }
+
+    /**
+     * @return the result of the last operation measured with the supplied name,
+     *      or an empty result if it hasn't been measured.
+     */
+    MicroResult result(const std::string& name) const {
+
+        for (size_t i = _results.size(); i > 0; i--) {
+
+            if (name == _results[i - 1].name) return _results[i - 1];
+        }
+
+        return MicroResult();
+    }
+
+    /**
+     * @return the exit code for the benchmark program.
+     */
+    int finish() const {
+
+        if (!_options.record.empty()) {
+
+            std::ofstream out(_options.record.c_str());
+
+            for (size_t i = 0; i < _results.size(); i++) writeJson(out, _results[i]);
+        }
+
+        if (_options.baseline.empty()) return 0;
+
+        return 0 == compareWithBaseline(_results, _options.baseline, _options.tolerance) ? 0 : 1;
+    }
+};
+
+} /* namespace bench */
+
+#endif /* __MICRO_HPP__ */
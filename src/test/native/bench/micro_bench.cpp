@@ -0,0 +1,320 @@
+/*
+ * micro_bench.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+}
+
+#include <bench/micro.hpp>
+
+#include <libav/codecpool.hpp>
+#include <libav/libav.hpp>
+
+#include <string>
+#include <vector>
+
+
+/**
+ * @file micro_bench.cpp
+ *
+ * The cost of a single call to each of the libav.hpp functions, and of the
+ * singleton and <code>std::tr1::function</code> indirection they are built on.
+ *
+ * Every operation is called through the harness's own
+ * <code>std::tr1::function</code>, so only the differences between the
+ * overhead pairs mean anything, not their absolute values.
+ */
+
+
+using namespace transcode::libav;
+
+/**
+ * Find the first stream of the supplied type.
+ *
+ * @return the index of the stream, or -1 if there isn't one.
+ */
+static int findStream(AVFormatContext *formatContext, AVMediaType type) {
+
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+
+        if (type == formatContext->streams[i]->codec->codec_type) return i;
+    }
+
+    return -1;
+}
+
+/**
+ * The same work as <code>findCodecType</code> without going through the
+ * singleton, kept out of line so it costs a real call.
+ */
+static __attribute__((noinline)) AVMediaType directCodecType(
+        const AVCodecContext *codecContext) {
+
+    if (NULL == codecContext) return AVMEDIA_TYPE_UNKNOWN;
+
+    AVMediaType type = codecContext->codec_type;
+
+    return -1 <= type && 5 >= type ? type : AVMEDIA_TYPE_UNKNOWN;
+}
+
+struct ErrorMessageOperation {
+
+    void operator()() const {
+
+        bench::keep(errorMessage(AVERROR_INVALIDDATA).size());
+    }
+};
+
+struct FindCodecTypeOperation {
+
+    const AVCodecContext *codecContext;
+
+    void operator()() const {
+
+        bench::keep(findCodecType(codecContext));
+    }
+};
+
+struct DirectCodecTypeOperation {
+
+    const AVCodecContext *codecContext;
+
+    void operator()() const {
+
+        bench::keep(directCodecType(codecContext));
+    }
+};
+
+struct FunctionCodecTypeOperation {
+
+    std::tr1::function<AVMediaType(const AVCodecContext*)> function;
+    const AVCodecContext *codecContext;
+
+    void operator()() const {
+
+        bench::keep(function(codecContext));
+    }
+};
+
+struct FindPacketTypeOperation {
+
+    const AVFormatContext *formatContext;
+    const AVPacket *packet;
+
+    void operator()() const {
+
+        bench::keep(findPacketType(formatContext, packet));
+    }
+};
+
+/**
+ * Read one packet, going back to the start of the file when it runs out.
+ */
+struct ReadNextPacketOperation {
+
+    AVFormatContext *formatContext;
+
+    void operator()() const {
+
+        AVPacket *packet = readNextPacket(formatContext);
+
+        if (NULL == packet) {
+
+            av_seek_frame(formatContext, -1, 0, AVSEEK_FLAG_BACKWARD);
+
+            return;
+        }
+
+        freePacket(&packet);
+    }
+};
+
+/**
+ * Open a decoder then close it again, a decoder can't be opened twice so the
+ * two can't be timed apart.
+ */
+struct OpenDecodeCodecContextOperation {
+
+    AVCodecContext *codecContext;
+
+    void operator()() const {
+
+        AVCodecContext *opened = openDecodeCodecContext(codecContext);
+
+        closeCodecContext(&opened);
+    }
+};
+
+/**
+ * Take a decoder from a pool then give it back, to compare with opening and
+ * closing one.
+ */
+struct PooledDecodeCodecContextOperation {
+
+    CodecContextPool *pool;
+    const AVCodecContext *parameters;
+
+    void operator()() const {
+
+        AVCodecContext *acquired = pool->acquireDecodeCodecContext(parameters);
+
+        pool->release(&acquired);
+    }
+};
+
+/**
+ * Decode the next of a set of video packets held in memory, starting over with
+ * a flushed decoder once they have all been decoded.
+ */
+struct DecodeVideoPacketOperation {
+
+    AVCodecContext *codecContext;
+    const std::vector<AVPacket*> *packets;
+    size_t *next;
+
+    void operator()() const {
+
+        if (packets->size() <= *next) {
+
+            avcodec_flush_buffers(codecContext);
+
+            *next = 0;
+        }
+
+        AVFrame *frame = decodeVideoPacket(codecContext, (*packets)[(*next)++]);
+
+        if (NULL != frame) freeFrame(&frame);
+    }
+};
+
+// The number of video packets held in memory for the decode benchmark.
+static const size_t DECODE_PACKETS = 120;
+
+/**
+ * Measure the functions that work on a media file.
+ */
+static void measureMedia(bench::MicroRunner& runner, const std::string& media) {
+
+    std::string name = bench::mediaName(media);
+
+    AVFormatContext *formatContext = openFormatContext(media);
+
+    int videoStream = findStream(formatContext, AVMEDIA_TYPE_VIDEO);
+
+    AVPacket *packet = readNextPacket(formatContext);
+
+    FindPacketTypeOperation findPacketTypeOperation = { formatContext, packet };
+
+    runner.run("findPacketType", name, findPacketTypeOperation);
+
+    freePacket(&packet);
+
+    ReadNextPacketOperation readNextPacketOperation = { formatContext };
+
+    runner.run("readNextPacket", name, readNextPacketOperation);
+
+    if (0 > videoStream) {
+
+        closeFormatContext(&formatContext);
+
+        return;
+    }
+
+    AVCodecContext *codecContext = formatContext->streams[videoStream]->codec;
+
+    OpenDecodeCodecContextOperation openOperation = { codecContext };
+
+    runner.run("openDecodeCodecContext", name, openOperation);
+
+    {
+        CodecContextPool pool;
+
+        PooledDecodeCodecContextOperation pooledOperation = { &pool, codecContext };
+
+        runner.run("pooledDecodeCodecContext", name, pooledOperation);
+    }
+
+    av_seek_frame(formatContext, -1, 0, AVSEEK_FLAG_BACKWARD);
+
+    std::vector<AVPacket*> packets;
+
+    // The count is checked before reading so no packet is read and left unfreed.
+    while (DECODE_PACKETS > packets.size()) {
+
+        AVPacket *p = readNextPacket(formatContext);
+
+        if (NULL == p) break;
+
+        if (videoStream == p->stream_index) packets.push_back(p);
+        else freePacket(&p);
+    }
+
+    if (!packets.empty()) {
+
+        openDecodeCodecContext(codecContext);
+
+        size_t next = 0;
+
+        DecodeVideoPacketOperation decodeOperation = { codecContext, &packets, &next };
+
+        runner.run("decodeVideoPacket", name, decodeOperation);
+
+        closeCodecContext(&codecContext);
+    }
+
+    for (size_t i = 0; i < packets.size(); i++) freePacket(&packets[i]);
+
+    closeFormatContext(&formatContext);
+}
+
+/**
+ * Measure the cost of the indirection every wrapper call goes through.
+ */
+static void measureOverhead(bench::MicroRunner& runner) {
+
+    AVCodecContext *codecContext = avcodec_alloc_context3(NULL);
+
+    codecContext->codec_type = AVMEDIA_TYPE_VIDEO;
+
+    DirectCodecTypeOperation directOperation = { codecContext };
+    FindCodecTypeOperation singletonOperation = { codecContext };
+    FunctionCodecTypeOperation functionOperation = { directCodecType, codecContext };
+
+    runner.run("directCall", "", directOperation);
+    runner.run("findCodecType", "", singletonOperation);
+    runner.run("tr1FunctionCall", "", functionOperation);
+
+    double direct = runner.result("directCall").median;
+
+    std::cerr << "singleton overhead: " << runner.result("findCodecType").median - direct
+            << " ns, tr1::function overhead: "
+            << runner.result("tr1FunctionCall").median - direct << " ns" << std::endl;
+
+    av_free(codecContext);
+}
+
+int main(int argc, char **argv) {
+
+    av_log_set_level(AV_LOG_QUIET);
+
+    bench::Options options(argc, argv);
+
+    bench::MicroRunner runner(options);
+
+    ErrorMessageOperation errorMessageOperation;
+
+    runner.run("errorMessage", "", errorMessageOperation);
+
+    measureOverhead(runner);
+
+    std::vector<std::string> media = bench::mediaFiles(options);
+
+    for (size_t i = 0; i < media.size(); i++) measureMedia(runner, media[i]);
+
+    return runner.finish();
+}
@@ -0,0 +1,231 @@
+/*
+ * proxy_bench.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+#include "libswscale/swscale.h"
+}
+
+#include <bench/bench.hpp>
+
+#include <libav/libav.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @file proxy_bench.cpp
+ *
+ * How much faster decoding video at a reduced resolution inside the decoder is
+ * than decoding it at full size and scaling it down, for proxies.
+ *
+ *   decodeScaleHalf    - decode at full size and scale to half the size.
+ *   decodeScaleQuarter - decode at full size and scale to a quarter of the size.
+ *   proxyHalf          - decode at half the size.
+ *   proxyQuarter       - decode at a quarter of the size.
+ *
+ * Proxy frames are only scaled if the codec couldn't decode at the size asked
+ * for, so both ways end with frames of the same size. The frames per second of
+ * each and the gain of the proxy decode are written to standard error. Only
+ * test.avi and test.mkv are used unless other media is named with "--media".
+ */
+
+
+using namespace transcode::libav;
+
+/**
+ * Decode the first video stream of the supplied media and bring every frame
+ * down to the supplied scale.
+ *
+ * @param scale - the size the frames end up at.
+ * @param proxy - true to decode at that size, false to decode at full size and scale.
+ */
+static bench::Work decodeVideo(const std::string& media, ProxyScale scale, bool proxy) {
+
+    bench::Work work;
+
+    AVFormatContext *formatContext = openFormatContext(media);
+
+    int streamIndex = -1;
+
+    for (unsigned int i = 0; i < formatContext->nb_streams && 0 > streamIndex; i++) {
+
+        if (AVMEDIA_TYPE_VIDEO == findStreamType(formatContext->streams[i])) streamIndex = i;
+    }
+
+    if (0 > streamIndex) {
+
+        closeFormatContext(&formatContext);
+
+        return work;
+    }
+
+    AVCodecContext *codecContext = formatContext->streams[streamIndex]->codec;
+
+    int width = -((-codecContext->width) >> scale);
+    int height = -((-codecContext->height) >> scale);
+
+    DecodeOptions options;
+
+    if (proxy) options.proxyScale = scale;
+
+    codecContext = openDecodeCodecContext(codecContext, options);
+
+    AVFrame *scaled = avcodec_alloc_frame();
+
+    avpicture_alloc(reinterpret_cast<AVPicture*>(scaled), codecContext->pix_fmt, width, height);
+
+    SwsContext *scaleContext = NULL;
+
+    for (AVPacket *packet = readNextPacket(formatContext); NULL != packet;
+            packet = readNextPacket(formatContext)) {
+
+        if (streamIndex == packet->stream_index) {
+
+            work.packets++;
+            work.bytes += packet->size;
+
+            AVFrame *frame = NULL;
+
+            tryDecodeVideoPacket(codecContext, packet, &frame);
+
+            if (NULL != frame) {
+
+                work.frames++;
+
+                // A proxy the decoder couldn't reduce is scaled the rest of the way.
+                if (width != codecContext->width || height != codecContext->height) {
+
+                    scaleContext = sws_getCachedContext(scaleContext,
+                            codecContext->width, codecContext->height, codecContext->pix_fmt,
+                            width, height, codecContext->pix_fmt,
+                            SWS_BILINEAR, NULL, NULL, NULL);
+
+                    sws_scale(scaleContext, frame->data, frame->linesize, 0,
+                            codecContext->height, scaled->data, scaled->linesize);
+                }
+
+                freeFrame(&frame);
+            }
+        }
+
+        freePacket(&packet);
+    }
+
+    if (NULL != scaleContext) sws_freeContext(scaleContext);
+
+    avpicture_free(reinterpret_cast<AVPicture*>(scaled));
+    av_free(scaled);
+
+    closeCodecContext(&codecContext);
+    closeFormatContext(&formatContext);
+
+    return work;
+}
+
+static bench::Work decodeScaleHalf(const std::string& media) {
+
+    return decodeVideo(media, PROXY_HALF, false);
+}
+
+static bench::Work decodeScaleQuarter(const std::string& media) {
+
+    return decodeVideo(media, PROXY_QUARTER, false);
+}
+
+static bench::Work proxyHalf(const std::string& media) {
+
+    return decodeVideo(media, PROXY_HALF, true);
+}
+
+static bench::Work proxyQuarter(const std::string& media) {
+
+    return decodeVideo(media, PROXY_QUARTER, true);
+}
+
+/**
+ * Find the result of the supplied scenario over the supplied media.
+ *
+ * @return the result, or NULL if there isn't a successful one.
+ */
+static const bench::Result* findResult(const std::vector<bench::Result>& results,
+        const std::string& scenario, const std::string& media) {
+
+    for (size_t i = 0; i < results.size(); i++) {
+
+        if (scenario == results[i].scenario && media == results[i].media
+                && results[i].succeeded) {
+
+            return &results[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Write the frames per second of full decode and scale against proxy decode.
+ */
+static void reportGain(const std::vector<bench::Result>& results, const std::string& media,
+        const std::string& size, const std::string& full, const std::string& proxy) {
+
+    const bench::Result *scaled = findResult(results, full, media);
+    const bench::Result *reduced = findResult(results, proxy, media);
+
+    if (NULL == scaled || NULL == reduced || 0 >= scaled->seconds || 0 >= reduced->seconds) {
+
+        return;
+    }
+
+    double scaledFps = scaled->work.frames / scaled->seconds;
+    double reducedFps = reduced->work.frames / reduced->seconds;
+
+    std::cerr << media << " " << size << ": decode and scale " << scaledFps
+            << " fps, proxy decode " << reducedFps << " fps, gain "
+            << reducedFps / scaledFps << "x" << std::endl;
+}
+
+int main(int argc, char **argv) {
+
+    av_log_set_level(AV_LOG_QUIET);
+
+    std::vector<std::pair<std::string, bench::Scenario> > scenarios;
+
+    scenarios.push_back(std::make_pair(std::string("decodeScaleHalf"),
+            bench::Scenario(decodeScaleHalf)));
+    scenarios.push_back(std::make_pair(std::string("decodeScaleQuarter"),
+            bench::Scenario(decodeScaleQuarter)));
+    scenarios.push_back(std::make_pair(std::string("proxyHalf"),
+            bench::Scenario(proxyHalf)));
+    scenarios.push_back(std::make_pair(std::string("proxyQuarter"),
+            bench::Scenario(proxyQuarter)));
+
+    bench::Options options(argc, argv);
+
+    std::vector<std::string> media = options.media;
+
+    if (media.empty()) {
+
+        media.push_back(bench::MEDIA_FILES[0]);
+        media.push_back(bench::MEDIA_FILES[1]);
+    }
+
+    std::vector<bench::Result> results = bench::runScenarios(options, scenarios, media);
+
+    for (size_t i = 0; i < media.size(); i++) {
+
+        std::string name = bench::mediaName(media[i]);
+
+        reportGain(results, name, "1/2", "decodeScaleHalf", "proxyHalf");
+        reportGain(results, name, "1/4", "decodeScaleQuarter", "proxyQuarter");
+    }
+
+    return bench::finish(options, results);
+}
@@ -0,0 +1,286 @@
+/*
+ * startup_bench.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+}
+
+#include <bench/micro.hpp>
+
+#include <error.hpp>
+#include <libav/counters.hpp>
+#include <libav/libav.hpp>
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+/**
+ * @file startup_bench.cpp
+ *
+ * The time from starting a process to its first decoded video frame, with
+ * every libav component registered and with only the components the test
+ * media needs.
+ *
+ * Each sample is a new process, the clock starts in this process just before
+ * the fork so that the exec, the dynamic linking and the libav initialisation
+ * are all counted. Selective registration needs libav to be linked
+ * statically, if it isn't then the selective runs are reported as errors and
+ * left out.
+ */
+
+
+using namespace transcode::libav;
+
+// The processes started for each mode and media when the options don't say.
+static const int DEFAULT_STARTS = 20;
+
+static const std::string CHILD_OPTION = "--child";
+
+static const std::string MODE_ALL = "all";
+
+static const std::string MODE_SELECTIVE = "selective";
+
+/**
+ * @return the components needed to decode the test media.
+ */
+static Registration selectiveRegistration() {
+
+    Registration registration;
+
+    registration.all = false;
+
+    const char *demuxers[] = { "avi", "flv", "matroska", "mov", "ogg" };
+    const char *decoders[] = { "aac", "ac3", "flv", "h264", "mp3", "mpeg4", "theora", "vorbis" };
+    const char *parsers[] = { "aac", "ac3", "h264", "mpegaudio", "mpeg4video" };
+
+    registration.demuxers.assign(demuxers, demuxers + sizeof(demuxers) / sizeof(demuxers[0]));
+    registration.decoders.assign(decoders, decoders + sizeof(decoders) / sizeof(decoders[0]));
+    registration.parsers.assign(parsers, parsers + sizeof(parsers) / sizeof(parsers[0]));
+
+    return registration;
+}
+
+/**
+ * Decode packets from the first video stream until a frame comes out.
+ */
+static void decodeFirstFrame(const std::string& media) {
+
+    AVFormatContext *formatContext = openFormatContext(media);
+
+    int streamIndex = -1;
+
+    for (unsigned int i = 0; i < formatContext->nb_streams && 0 > streamIndex; i++) {
+
+        if (AVMEDIA_TYPE_VIDEO == findStreamType(formatContext->streams[i])) streamIndex = i;
+    }
+
+    if (0 > streamIndex) {
+
+        closeFormatContext(&formatContext);
+
+        throw transcode::IllegalStateException("There is no video stream in " + media);
+    }
+
+    AVCodecContext *codecContext = openDecodeCodecContext(
+            formatContext->streams[streamIndex]->codec);
+
+    AVFrame *frame = NULL;
+
+    AVPacket *packet = NULL;
+
+    while (NULL == frame && NULL != (packet = readNextPacket(formatContext))) {
+
+        if (streamIndex == packet->stream_index) {
+
+            frame = decodeVideoPacket(codecContext, packet);
+        }
+
+        freePacket(&packet);
+    }
+
+    if (NULL != frame) freeFrame(&frame);
+
+    closeCodecContext(&codecContext);
+    closeFormatContext(&formatContext);
+}
+
+/**
+ * Initialise libav and decode the first frame, then write when initialising
+ * started, when it finished and when the frame was decoded to standard out.
+ *
+ * @return the exit code of the child process.
+ */
+static int runChild(const std::string& mode, const std::string& media) {
+
+    av_log_set_level(AV_LOG_QUIET);
+
+    try {
+
+        uint64_t start = monotonicNanoseconds();
+
+        initialise(MODE_SELECTIVE == mode ? selectiveRegistration() : Registration());
+
+        uint64_t initialised = monotonicNanoseconds();
+
+        decodeFirstFrame(media);
+
+        uint64_t decoded = monotonicNanoseconds();
+
+        std::cout << "ok " << start << " " << initialised << " " << decoded << std::endl;
+
+    } catch (const std::exception& e) {
+
+        std::cout << "error " << e.what() << std::endl;
+    }
+
+    return 0;
+}
+
+/**
+ * Start a child process for the supplied mode and media and wait for it.
+ *
+ * @param sample - the startup, time to initialise and time to the first
+ *      frame in nanoseconds, set if it succeeds.
+ * @return empty on success, otherwise the error.
+ */
+static std::string startChild(const std::string& mode, const std::string& media,
+        double sample[3]) {
+
+    int pipeFds[2];
+
+    if (0 != pipe(pipeFds)) return "Could not create a pipe to the child process.";
+
+    uint64_t start = monotonicNanoseconds();
+
+    pid_t child = fork();
+
+    if (0 == child) {
+
+        close(pipeFds[0]);
+
+        dup2(pipeFds[1], STDOUT_FILENO);
+
+        execl("/proc/self/exe", "startup_bench", CHILD_OPTION.c_str(), mode.c_str(),
+                media.c_str(), static_cast<char*>(NULL));
+
+        _exit(127);
+    }
+
+    close(pipeFds[1]);
+
+    if (0 > child) {
+
+        close(pipeFds[0]);
+
+        return "Could not fork the child process.";
+    }
+
+    std::string message;
+
+    char buffer[512];
+
+    ssize_t bytesRead;
+
+    while (0 < (bytesRead = read(pipeFds[0], buffer, sizeof(buffer)))) {
+
+        message.append(buffer, bytesRead);
+    }
+
+    close(pipeFds[0]);
+
+    int status = 0;
+
+    waitpid(child, &status, 0);
+
+    std::stringstream in(message);
+
+    std::string outcome;
+
+    uint64_t childStart = 0, initialised = 0, decoded = 0;
+
+    in >> outcome >> childStart >> initialised >> decoded;
+
+    if ("ok" != outcome || in.fail()) {
+
+        return message.empty() ? "The child process failed without a message." : message;
+    }
+
+    sample[0] = decoded - start;
+    sample[1] = initialised - childStart;
+    sample[2] = decoded - initialised;
+
+    return "";
+}
+
+/**
+ * Measure starting up in the supplied mode over the supplied media.
+ */
+static void measureStartup(bench::MicroRunner& runner, const bench::Options& options,
+        const std::string& mode, const std::string& media) {
+
+    int starts = 0 < options.repetitions ? options.repetitions : DEFAULT_STARTS;
+
+    std::vector<double> startup, initialising, firstFrame;
+
+    for (int i = 0; i < starts; i++) {
+
+        double sample[3];
+
+        std::string error = startChild(mode, media, sample);
+
+        if (!error.empty()) {
+
+            std::cerr << "startup " << mode << " " << bench::mediaName(media)
+                    << " failed: " << error << std::endl;
+
+            return;
+        }
+
+        startup.push_back(sample[0]);
+        initialising.push_back(sample[1]);
+        firstFrame.push_back(sample[2]);
+    }
+
+    std::string name = bench::mediaName(media);
+
+    runner.add(bench::summarise("startup_" + mode, name, startup));
+    runner.add(bench::summarise("initialise_" + mode, name, initialising));
+    runner.add(bench::summarise("first_frame_" + mode, name, firstFrame));
+}
+
+int main(int argc, char **argv) {
+
+    if (4 == argc && CHILD_OPTION == argv[1]) return runChild(argv[2], argv[3]);
+
+    bench::Options options(argc, argv);
+
+    bench::MicroRunner runner(options);
+
+    std::vector<std::string> media = bench::mediaFiles(options);
+
+    const std::string modes[] = { MODE_ALL, MODE_SELECTIVE };
+
+    for (size_t i = 0; i < 2; i++) {
+
+        // The scenario option picks a mode, "all" or "selective".
+        if (!options.scenario.empty() && options.scenario != modes[i]) continue;
+
+        for (size_t j = 0; j < media.size(); j++) {
+
+            measureStartup(runner, options, modes[i], media[j]);
+        }
+    }
+
+    return runner.finish();
+}
@@ -0,0 +1,401 @@
+/*
+ * throughput_bench.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+}
+
+#include <bench/bench.hpp>
+
+#include <libav/job.hpp>
+#include <libav/libav.hpp>
+#include <libav/progress.hpp>
+#include <libav/thumbnails.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @file throughput_bench.cpp
+ *
+ * End to end throughput of whole files through the libav functions.
+ *
+ *   demux      - read every packet.
+ *   decode     - read and decode every audio and video packet.
+ *   transcode  - decode every packet and encode the video again as MPEG-4.
+ *   remux      - copy every audio and video packet into a new matroska file.
+ *   thumbnails - a sprite sheet of a thumbnail every second, on every processor.
+ *
+ *   demuxWithProgress  - demux for a job with a progress callback.
+ *   decodeWithProgress - decode for a job with a progress callback.
+ *
+ * The progress scenarios should be within a percent of the ones without.
+ */
+
+
+using namespace transcode::libav;
+
+/**
+ * The decoders of every audio and video stream of a format context, the other
+ * streams or streams without a decoder are left NULL and skipped.
+ */
+struct Decoders {
+
+    std::vector<AVCodecContext*> codecContexts;
+
+    Decoders(AVFormatContext *formatContext) :
+            codecContexts(formatContext->nb_streams, static_cast<AVCodecContext*>(NULL)) {
+
+        for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+
+            AVCodecContext *codecContext = formatContext->streams[i]->codec;
+
+            AVMediaType type = findCodecType(codecContext);
+
+            if (AVMEDIA_TYPE_AUDIO != type && AVMEDIA_TYPE_VIDEO != type) continue;
+
+            try {
+
+                codecContexts[i] = openDecodeCodecContext(codecContext);
+
+            } catch (const std::exception&) {
+
+                // Streams that can't be decoded are left out of the figures.
+            }
+        }
+    }
+
+    ~Decoders() {
+
+        for (size_t i = 0; i < codecContexts.size(); i++) {
+
+            if (NULL != codecContexts[i]) closeCodecContext(&codecContexts[i]);
+        }
+    }
+
+    /**
+     * Decode the supplied packet if its stream has a decoder.
+     *
+     * @param packet - the packet to decode.
+     * @param frames - the vector the decoded frames are added to, the caller
+     *      must free them.
+     */
+    void decode(const AVPacket *packet, std::vector<AVFrame*>& frames) {
+
+        AVCodecContext *codecContext = codecContexts[packet->stream_index];
+
+        if (NULL == codecContext) return;
+
+        if (AVMEDIA_TYPE_AUDIO == codecContext->codec_type) {
+
+            tryDecodeAudioPacket(codecContext, packet, frames);
+
+            return;
+        }
+
+        AVFrame *frame = NULL;
+
+        tryDecodeVideoPacket(codecContext, packet, &frame);
+
+        if (NULL != frame) frames.push_back(frame);
+    }
+};
+
+static bench::Work demux(const std::string& media) {
+
+    bench::Work work;
+
+    AVFormatContext *formatContext = openFormatContext(media);
+
+    for (AVPacket *packet = readNextPacket(formatContext); NULL != packet;
+            packet = readNextPacket(formatContext)) {
+
+        work.packets++;
+        work.bytes += packet->size;
+
+        freePacket(&packet);
+    }
+
+    closeFormatContext(&formatContext);
+
+    return work;
+}
+
+static bench::Work decode(const std::string& media) {
+
+    bench::Work work;
+
+    AVFormatContext *formatContext = openFormatContext(media);
+
+    {
+        Decoders decoders(formatContext);
+
+        std::vector<AVFrame*> frames;
+
+        for (AVPacket *packet = readNextPacket(formatContext); NULL != packet;
+                packet = readNextPacket(formatContext)) {
+
+            work.packets++;
+            work.bytes += packet->size;
+
+            decoders.decode(packet, frames);
+
+            work.frames += frames.size();
+
+            for (size_t i = 0; i < frames.size(); i++) freeFrame(&frames[i]);
+
+            frames.clear();
+
+            freePacket(&packet);
+        }
+    }
+
+    closeFormatContext(&formatContext);
+
+    return work;
+}
+
+/**
+ * Counts the progress reports it is called with.
+ */
+struct ProgressCounter {
+
+    uint64_t *reports;
+
+    void operator()(const ProgressReport&) const {
+
+        (*reports)++;
+    }
+};
+
+/**
+ * Run the supplied scenario for a job that reports its progress.
+ */
+static bench::Work withProgress(const std::string& media,
+        bench::Work (*scenario)(const std::string& media)) {
+
+    uint64_t reports = 0;
+
+    ProgressCounter counter = { &reports };
+
+    Job job;
+
+    job.progress().setCallback(counter);
+
+    ScopedJob scopedJob(&job);
+
+    return scenario(media);
+}
+
+static bench::Work demuxWithProgress(const std::string& media) {
+
+    return withProgress(media, demux);
+}
+
+static bench::Work decodeWithProgress(const std::string& media) {
+
+    return withProgress(media, decode);
+}
+
+/**
+ * Open an MPEG-4 encoder for the supplied video decoder.
+ *
+ * @return the opened encoder, or NULL if the decoded frames can't be encoded
+ *      without being converted first.
+ */
+static AVCodecContext* openVideoEncoder(const AVCodecContext *decoder) {
+
+    if (PIX_FMT_YUV420P != decoder->pix_fmt) return NULL;
+
+    AVCodec *encoder = avcodec_find_encoder(CODEC_ID_MPEG4);
+
+    AVCodecContext *codecContext = avcodec_alloc_context3(encoder);
+
+    codecContext->width = decoder->width;
+    codecContext->height = decoder->height;
+    codecContext->pix_fmt = PIX_FMT_YUV420P;
+    codecContext->time_base.num = 1;
+    codecContext->time_base.den = 25;
+
+    return openEncodeCodecContext(codecContext);
+}
+
+static bench::Work transcodeVideo(const std::string& media) {
+
+    bench::Work work;
+
+    AVFormatContext *formatContext = openFormatContext(media);
+
+    std::vector<AVCodecContext*> encoders(formatContext->nb_streams,
+            static_cast<AVCodecContext*>(NULL));
+
+    {
+        Decoders decoders(formatContext);
+
+        for (size_t i = 0; i < encoders.size(); i++) {
+
+            AVCodecContext *decoder = decoders.codecContexts[i];
+
+            if (NULL == decoder || AVMEDIA_TYPE_VIDEO != decoder->codec_type) continue;
+
+            encoders[i] = openVideoEncoder(decoder);
+        }
+
+        std::vector<AVFrame*> frames;
+
+        int64_t framesEncoded = 0;
+
+        for (AVPacket *packet = readNextPacket(formatContext); NULL != packet;
+                packet = readNextPacket(formatContext)) {
+
+            work.packets++;
+            work.bytes += packet->size;
+
+            decoders.decode(packet, frames);
+
+            work.frames += frames.size();
+
+            AVCodecContext *encoder = encoders[packet->stream_index];
+
+            for (size_t i = 0; i < frames.size(); i++) {
+
+                if (NULL != encoder) {
+
+                    frames[i]->pts = framesEncoded++;
+
+                    AVPacket *encoded = encodeVideoFrame(encoder, frames[i]);
+
+                    if (NULL != encoded) freePacket(&encoded);
+                }
+
+                freeFrame(&frames[i]);
+            }
+
+            frames.clear();
+
+            freePacket(&packet);
+        }
+    }
+
+    for (size_t i = 0; i < encoders.size(); i++) {
+
+        if (NULL == encoders[i]) continue;
+
+        closeCodecContext(&encoders[i]);
+
+        av_free(encoders[i]);
+    }
+
+    closeFormatContext(&formatContext);
+
+    return work;
+}
+
+static bench::Work remux(const std::string& media) {
+
+    bench::Work work;
+
+    AVFormatContext *formatContext = openFormatContext(media);
+
+    AVFormatContext *output = openOutputFormatContext(
+            bench::OUTPUT_DIR + "bench_remux_" + bench::mediaName(media) + ".mkv");
+
+    // The output stream of every input stream that is copied, or -1.
+    std::vector<int> outputStreams(formatContext->nb_streams, -1);
+
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+
+        AVMediaType type = findStreamType(formatContext->streams[i]);
+
+        if (AVMEDIA_TYPE_AUDIO != type && AVMEDIA_TYPE_VIDEO != type) continue;
+
+        outputStreams[i] = addOutputStream(output, formatContext->streams[i]->codec)->index;
+    }
+
+    writeOutputHeader(output);
+
+    for (AVPacket *packet = readNextPacket(formatContext); NULL != packet;
+            packet = readNextPacket(formatContext)) {
+
+        int outputStream = outputStreams[packet->stream_index];
+
+        if (0 > outputStream) {
+
+            freePacket(&packet);
+
+            continue;
+        }
+
+        work.packets++;
+        work.bytes += packet->size;
+
+        AVRational inputTimeBase = formatContext->streams[packet->stream_index]->time_base;
+        AVRational outputTimeBase = output->streams[outputStream]->time_base;
+
+        if (AV_NOPTS_VALUE != packet->pts) {
+
+            packet->pts = av_rescale_q(packet->pts, inputTimeBase, outputTimeBase);
+        }
+
+        if (AV_NOPTS_VALUE != packet->dts) {
+
+            packet->dts = av_rescale_q(packet->dts, inputTimeBase, outputTimeBase);
+        }
+
+        packet->duration = av_rescale_q(packet->duration, inputTimeBase, outputTimeBase);
+        packet->stream_index = outputStream;
+
+        writePacket(output, packet);
+
+        freePacket(&packet);
+    }
+
+    closeOutputFormatContext(&output);
+    closeFormatContext(&formatContext);
+
+    return work;
+}
+
+static bench::Work thumbnails(const std::string& media) {
+
+    bench::Work work;
+
+    SpriteSheet spriteSheet = extractSpriteSheet(media, 1000);
+
+    for (size_t i = 0; i < spriteSheet.frameTimestamps.size(); i++) {
+
+        if (0 <= spriteSheet.frameTimestamps[i]) work.frames++;
+    }
+
+    work.bytes = spriteSheet.pixels.size();
+
+    return work;
+}
+
+int main(int argc, char **argv) {
+
+    av_log_set_level(AV_LOG_QUIET);
+
+    std::vector<std::pair<std::string, bench::Scenario> > scenarios;
+
+    scenarios.push_back(std::make_pair(std::string("demux"), bench::Scenario(demux)));
+    scenarios.push_back(std::make_pair(std::string("decode"), bench::Scenario(decode)));
+    scenarios.push_back(std::make_pair(std::string("transcode"), bench::Scenario(transcodeVideo)));
+    scenarios.push_back(std::make_pair(std::string("remux"), bench::Scenario(remux)));
+    scenarios.push_back(std::make_pair(std::string("thumbnails"), bench::Scenario(thumbnails)));
+    scenarios.push_back(std::make_pair(std::string("demuxWithProgress"),
+            bench::Scenario(demuxWithProgress)));
+    scenarios.push_back(std::make_pair(std::string("decodeWithProgress"),
+            bench::Scenario(decodeWithProgress)));
+
+    bench::Options options(argc, argv);
+
+    return bench::runAll(options, scenarios, bench::mediaFiles(options));
+}
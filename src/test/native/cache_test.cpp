@@ -0,0 +1,338 @@
+/*
+ * cache_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <error.hpp>
+#include <libav/cache.hpp>
+#include <libav/libav.hpp>
+#include <libav/pipeline.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <tr1/functional>
+
+
+static const std::string CACHE_DIRECTORY = "../../../target/test-classes/lib-test/cache";
+
+static const std::string CACHE_OUTPUT = "../../../target/test-classes/lib-test/cached.out";
+
+/**
+ * Read the whole of the supplied file.
+ */
+static std::string readFile(const std::string& fileName) {
+
+    std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+
+    std::ostringstream contents;
+
+    contents << in.rdbuf();
+
+    return contents.str();
+}
+
+/**
+ * Stands in for a transcode, writing the supplied contents and counting how
+ * many times it was called.
+ */
+static void produce(const std::string& outputFileName, const std::string& contents,
+        int *produced) {
+
+    std::ofstream out(outputFileName.c_str(), std::ios::out | std::ios::binary);
+
+    out << contents;
+
+    (*produced)++;
+}
+
+/**
+ * A transcode that fails part way through writing its file.
+ */
+static void produceAndFail(const std::string& outputFileName) {
+
+    std::ofstream out(outputFileName.c_str(), std::ios::out | std::ios::binary);
+
+    out << "partial";
+
+    throw transcode::IllegalStateException("The transcode failed.");
+}
+
+/**
+ * Fetches from a cache on another thread, keeping whether it was a hit.
+ */
+struct Fetcher {
+
+    transcode::libav::OutputCache *cache;
+    const transcode::libav::EncodeSettings *settings;
+    std::string outputFileName;
+    transcode::libav::CacheProducer producer;
+    bool *hit;
+
+    void operator()() const {
+
+        *hit = cache->fetch(VIDEO_AVI, *settings, outputFileName, producer);
+    }
+};
+
+/**
+ * @return an empty cache directory.
+ */
+static std::string emptyCacheDirectory(const std::string& name) {
+
+    std::string directory = CACHE_DIRECTORY + "/" + name;
+
+    boost::filesystem::remove_all(directory);
+
+    return directory;
+}
+
+/**
+ * Test settings are written the same whatever order they are set in.
+ */
+BOOST_AUTO_TEST_CASE( test_settings_are_canonical )
+{
+
+    transcode::libav::EncodeSettings first;
+    transcode::libav::EncodeSettings second;
+
+    first.set("encoder", "mpeg4").set("width", 320);
+    second.set("width", 320).set("encoder", "mpeg4");
+
+    BOOST_REQUIRE_EQUAL( first.serialise(), second.serialise() );
+
+    second.set("width", 32);
+
+    BOOST_REQUIRE( first.serialise() != second.serialise() );
+
+    transcode::libav::PipelineOptions options;
+
+    std::string pipeline = transcode::libav::encodeSettings(options).serialise();
+
+    options.quantizer = 4;
+
+    BOOST_REQUIRE( pipeline != transcode::libav::encodeSettings(options).serialise() );
+}
+
+/**
+ * Test a whole and a sampled hash of the same file.
+ */
+BOOST_AUTO_TEST_CASE( test_hash_file )
+{
+
+    std::string whole = transcode::libav::hashFile(VIDEO_AVI);
+
+    BOOST_REQUIRE_EQUAL( 32, whole.size() );
+    BOOST_REQUIRE_EQUAL( whole, transcode::libav::hashFile(VIDEO_AVI) );
+    BOOST_REQUIRE( whole != transcode::libav::hashFile(VIDEO_MKV) );
+
+    std::string sampled = transcode::libav::hashFile(VIDEO_AVI, 4096);
+
+    BOOST_REQUIRE( whole != sampled );
+    BOOST_REQUIRE_EQUAL( sampled, transcode::libav::hashFile(VIDEO_AVI, 4096) );
+
+    BOOST_REQUIRE_THROW( transcode::libav::hashFile(CACHE_DIRECTORY + "/missing"),
+            transcode::IOException );
+}
+
+/**
+ * Test the second fetch of the same input and settings is copied from the
+ * cache without transcoding.
+ */
+BOOST_AUTO_TEST_CASE( test_fetch_from_cache )
+{
+
+    transcode::libav::OutputCache cache(emptyCacheDirectory("fetch"));
+
+    transcode::libav::EncodeSettings settings;
+
+    settings.set("encoder", "mpeg4");
+
+    int produced = 0;
+
+    transcode::libav::CacheProducer producer = std::tr1::bind(produce,
+            std::tr1::placeholders::_1, "transcoded", &produced);
+
+    BOOST_REQUIRE( !cache.fetch(VIDEO_AVI, settings, CACHE_OUTPUT, producer) );
+    BOOST_REQUIRE_EQUAL( "transcoded", readFile(CACHE_OUTPUT) );
+
+    boost::filesystem::remove(CACHE_OUTPUT);
+
+    BOOST_REQUIRE( cache.fetch(VIDEO_AVI, settings, CACHE_OUTPUT, producer) );
+    BOOST_REQUIRE_EQUAL( "transcoded", readFile(CACHE_OUTPUT) );
+    BOOST_REQUIRE_EQUAL( 1, produced );
+
+    settings.set("width", 320);
+
+    BOOST_REQUIRE( !cache.fetch(VIDEO_AVI, settings, CACHE_OUTPUT, producer) );
+    BOOST_REQUIRE( !cache.fetch(VIDEO_MKV, settings, CACHE_OUTPUT, producer) );
+    BOOST_REQUIRE_EQUAL( 3, produced );
+
+    transcode::libav::CacheStatistics statistics = cache.statistics();
+
+    BOOST_REQUIRE_EQUAL( 1, statistics.hits );
+    BOOST_REQUIRE_EQUAL( 3, statistics.misses );
+    BOOST_REQUIRE_EQUAL( 3, statistics.entries );
+    BOOST_REQUIRE_EQUAL( 3 * std::string("transcoded").size(), statistics.bytes );
+}
+
+/**
+ * Test the least recently fetched file is removed when the cache is over its
+ * quota, and a cache opened again keeps the same order.
+ */
+BOOST_AUTO_TEST_CASE( test_evict_least_recently_fetched )
+{
+
+    std::string directory = emptyCacheDirectory("evict");
+
+    std::string contents(100, 'x');
+
+    int produced = 0;
+
+    transcode::libav::CacheProducer producer = std::tr1::bind(produce,
+            std::tr1::placeholders::_1, contents, &produced);
+
+    transcode::libav::EncodeSettings first;
+    transcode::libav::EncodeSettings second;
+    transcode::libav::EncodeSettings third;
+
+    first.set("rendition", 1);
+    second.set("rendition", 2);
+    third.set("rendition", 3);
+
+    {
+        transcode::libav::OutputCache cache(directory, 250);
+
+        cache.fetch(VIDEO_AVI, first, CACHE_OUTPUT, producer);
+        cache.fetch(VIDEO_AVI, second, CACHE_OUTPUT, producer);
+
+        BOOST_REQUIRE( cache.fetch(VIDEO_AVI, first, CACHE_OUTPUT, producer) );
+
+        cache.fetch(VIDEO_AVI, third, CACHE_OUTPUT, producer);
+
+        transcode::libav::CacheStatistics statistics = cache.statistics();
+
+        BOOST_REQUIRE_EQUAL( 1, statistics.evicted );
+        BOOST_REQUIRE_EQUAL( 2, statistics.entries );
+        BOOST_REQUIRE_EQUAL( 200, statistics.bytes );
+
+        BOOST_REQUIRE( cache.fetch(VIDEO_AVI, first, CACHE_OUTPUT, producer) );
+        BOOST_REQUIRE( !cache.fetch(VIDEO_AVI, second, CACHE_OUTPUT, producer) );
+    }
+
+    transcode::libav::OutputCache cache(directory, 250);
+
+    BOOST_REQUIRE_EQUAL( 2, cache.statistics().entries );
+
+    BOOST_REQUIRE( cache.fetch(VIDEO_AVI, second, CACHE_OUTPUT, producer) );
+
+    // A file bigger than the whole quota is never kept.
+    transcode::libav::OutputCache small(emptyCacheDirectory("small"), 50);
+
+    BOOST_REQUIRE( !small.fetch(VIDEO_AVI, first, CACHE_OUTPUT, producer) );
+    BOOST_REQUIRE_EQUAL( contents, readFile(CACHE_OUTPUT) );
+    BOOST_REQUIRE_EQUAL( 0, small.statistics().entries );
+}
+
+/**
+ * Test a file is copied out of the cache without holding its lock, and isn't
+ * evicted or cleared while it is being copied.
+ */
+BOOST_AUTO_TEST_CASE( test_file_pinned_while_copied )
+{
+
+    std::string directory = emptyCacheDirectory("pinned");
+
+    // Much more than a pipe holds, so the copy blocks until it is read.
+    std::string contents(1024 * 1024, 'x');
+
+    int produced = 0;
+
+    transcode::libav::CacheProducer producer = std::tr1::bind(produce,
+            std::tr1::placeholders::_1, contents, &produced);
+
+    transcode::libav::EncodeSettings first;
+    transcode::libav::EncodeSettings second;
+
+    first.set("rendition", 1);
+    second.set("rendition", 2);
+
+    std::string pipe = directory + ".pipe";
+
+    boost::filesystem::remove(pipe);
+
+    BOOST_REQUIRE_EQUAL( 0, mkfifo(pipe.c_str(), 0600) );
+
+    // Room for one of the files and not both.
+    transcode::libav::OutputCache cache(directory, contents.size() * 3 / 2);
+
+    cache.fetch(VIDEO_AVI, first, CACHE_OUTPUT, producer);
+
+    bool hit = false;
+
+    Fetcher fetcher = { &cache, &first, pipe, producer, &hit };
+
+    boost::thread copying(fetcher);
+
+    // Opening the pipe waits for the copy to start writing to it.
+    std::ifstream in(pipe.c_str(), std::ios::in | std::ios::binary);
+
+    BOOST_REQUIRE_EQUAL( 1, cache.statistics().entries );
+
+    // The second file only fits once the first is evicted, which it can't be
+    // until it has been copied.
+    BOOST_REQUIRE( !cache.fetch(VIDEO_AVI, second, CACHE_OUTPUT, producer) );
+
+    cache.clear();
+
+    BOOST_REQUIRE_EQUAL( 1, cache.statistics().entries );
+
+    std::ostringstream copied;
+
+    copied << in.rdbuf();
+
+    copying.join();
+
+    BOOST_REQUIRE( hit );
+    BOOST_REQUIRE( contents == copied.str() );
+    BOOST_REQUIRE_EQUAL( 2, produced );
+
+    cache.clear();
+
+    BOOST_REQUIRE_EQUAL( 0, cache.statistics().entries );
+
+    boost::filesystem::remove(pipe);
+}
+
+/**
+ * Test a transcode that fails leaves nothing in the cache.
+ */
+BOOST_AUTO_TEST_CASE( test_failed_transcode_not_cached )
+{
+
+    std::string directory = emptyCacheDirectory("failed");
+
+    transcode::libav::OutputCache cache(directory);
+
+    BOOST_REQUIRE_THROW( cache.fetch(VIDEO_AVI, transcode::libav::EncodeSettings(),
+            CACHE_OUTPUT, produceAndFail), transcode::IllegalStateException );
+
+    BOOST_REQUIRE_EQUAL( 0, cache.statistics().entries );
+    BOOST_REQUIRE( boost::filesystem::is_empty(directory) );
+
+    BOOST_REQUIRE_THROW( transcode::libav::OutputCache(""),
+            transcode::IllegalArgumentException );
+}
@@ -0,0 +1,159 @@
+/*
+ * cancellation_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <libav/cancellation.hpp>
+#include <libav/counters.hpp>
+#include <libav/job.hpp>
+#include <libav/ladder.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+#include <libav/progress.hpp>
+
+#include <vector>
+
+
+static const std::string CANCELLED_LADDER = "../../../target/test-classes/lib-test/cancelled_ladder.mkv";
+
+// How long a job may take to stop once its deadline has passed.
+static const uint64_t STOP_NANOSECONDS = 500000000;
+
+/**
+ * Cancels the job once it has read the supplied number of packets.
+ */
+struct CancelAfter {
+
+    transcode::libav::Job *job;
+    int packets;
+    int *read;
+
+    void operator()(const transcode::libav::ProgressReport&) const {
+
+        if (packets == ++(*read)) job->cancellation().cancel();
+    }
+};
+
+/**
+ * Test cancelling a token and giving it a deadline.
+ */
+BOOST_AUTO_TEST_CASE( test_cancellation_token )
+{
+
+    transcode::libav::CancellationToken token;
+
+    BOOST_REQUIRE( !token.shouldStop() );
+
+    token.setDeadline(3600000);
+
+    BOOST_REQUIRE( !token.isPastDeadline() );
+
+    token.setDeadline(0);
+
+    BOOST_REQUIRE( token.isPastDeadline() );
+    BOOST_REQUIRE_THROW( token.throwIfStopped(), transcode::libav::CancelledException );
+
+    token.clearDeadline();
+
+    BOOST_REQUIRE( !token.shouldStop() );
+
+    token.cancel();
+
+    BOOST_REQUIRE( token.isCancelled() );
+    BOOST_REQUIRE_THROW( token.throwIfStopped(), transcode::libav::CancelledException );
+}
+
+/**
+ * Test nothing can be opened for a job that was cancelled.
+ */
+BOOST_FIXTURE_TEST_CASE( test_open_for_cancelled_job, test::LibAvRegisterable )
+{
+
+    transcode::libav::Job job;
+
+    transcode::libav::ScopedJob scopedJob(&job);
+
+    job.cancellation().cancel();
+
+    BOOST_REQUIRE_THROW( transcode::libav::openFormatContext(VIDEO_AVI),
+            transcode::libav::CancelledException );
+
+    BOOST_REQUIRE_THROW( transcode::libav::openOutputFormatContext(CANCELLED_LADDER),
+            transcode::libav::CancelledException );
+}
+
+/**
+ * Test a job cancelled part way through stops at the next packet and has
+ * released everything once its input is closed.
+ */
+BOOST_FIXTURE_TEST_CASE( test_cancel_between_packets, test::LibAvRegisterable )
+{
+
+    transcode::libav::Job job;
+
+    int read = 0;
+
+    CancelAfter cancelAfter = { &job, 10, &read };
+
+    job.progress().setCallback(cancelAfter, 0);
+
+    transcode::libav::ScopedJob scopedJob(&job);
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(VIDEO_AVI);
+
+    int packets = 0;
+
+    try {
+
+        for (AVPacket *packet = transcode::libav::readNextPacket(formatContext); NULL != packet;
+                packet = transcode::libav::readNextPacket(formatContext)) {
+
+            packets++;
+
+            transcode::libav::freePacket(&packet);
+        }
+
+        BOOST_FAIL( "The job was not cancelled." );
+
+    } catch (const transcode::libav::CancelledException&) {
+
+        // Expected.
+    }
+
+    transcode::libav::closeFormatContext(&formatContext);
+
+    BOOST_REQUIRE_EQUAL( 10, packets );
+    BOOST_REQUIRE_EQUAL( 0, job.memory().used() );
+}
+
+/**
+ * Test a ladder stops soon after the deadline of its job, on every thread.
+ */
+BOOST_FIXTURE_TEST_CASE( test_deadline_stops_ladder, test::LibAvRegisterable )
+{
+
+    transcode::libav::Job job;
+
+    transcode::libav::ScopedJob scopedJob(&job);
+
+    std::vector<transcode::libav::Rendition> renditions;
+
+    renditions.push_back(transcode::libav::Rendition(CANCELLED_LADDER, 160, 0, 100000));
+
+    job.cancellation().setDeadline(20);
+
+    uint64_t deadline = transcode::libav::monotonicNanoseconds() + 20000000;
+
+    BOOST_REQUIRE_THROW( transcode::libav::encodeLadder(VIDEO_AVI, renditions),
+            transcode::libav::CancelledException );
+
+    BOOST_REQUIRE( deadline + STOP_NANOSECONDS > transcode::libav::monotonicNanoseconds() );
+    BOOST_REQUIRE_EQUAL( 0, job.memory().used() );
+}
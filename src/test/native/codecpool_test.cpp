@@ -0,0 +1,330 @@
+/*
+ * codecpool_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <error.hpp>
+#include <libav/codecpool.hpp>
+#include <libav/job.hpp>
+#include <libav/libav.hpp>
+#include <libav/memory.hpp>
+
+
+/**
+ * Find the codec context of the first stream of the supplied type.
+ */
+static const AVCodecContext* findCodecContext(AVFormatContext *formatContext,
+        AVMediaType type) {
+
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+
+        if (type == formatContext->streams[i]->codec->codec_type) {
+
+            return formatContext->streams[i]->codec;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Decode video packets with the supplied decoder until a frame comes out.
+ */
+static void decodeFrame(AVFormatContext *formatContext, AVCodecContext *decoder,
+        const AVCodecContext *parameters) {
+
+    AVFrame *frame = NULL;
+
+    while (NULL == frame) {
+
+        AVPacket *packet = transcode::libav::readNextPacket(formatContext);
+
+        BOOST_REQUIRE( NULL != packet );
+
+        if (parameters == formatContext->streams[packet->stream_index]->codec) {
+
+            frame = transcode::libav::decodeVideoPacket(decoder, packet);
+        }
+
+        transcode::libav::freePacket(&packet);
+    }
+
+    transcode::libav::freeFrame(&frame);
+}
+
+/**
+ * Encode the supplied frame as the first few frames of a stream.
+ *
+ * @return the bytes of every packet, one after the other.
+ */
+static std::string encodeFrames(AVCodecContext *encoder, AVFrame *frame) {
+
+    std::string bytes;
+
+    for (int i = 0; i < 5; i++) {
+
+        // The encoder picks the picture types itself, from its own state.
+        frame->pts = i;
+        frame->pict_type = AV_PICTURE_TYPE_NONE;
+
+        AVPacket *packet = transcode::libav::encodeVideoFrame(encoder, frame);
+
+        BOOST_REQUIRE( NULL != packet );
+
+        bytes.append(reinterpret_cast<const char*>(packet->data), packet->size);
+
+        transcode::libav::freePacket(&packet);
+    }
+
+    return bytes;
+}
+
+/**
+ * Test a released decoder is reused for the same codec parameters.
+ */
+BOOST_FIXTURE_TEST_CASE( test_reuse_decode_codec_context, test::AVIStreamFixture )
+{
+
+    transcode::libav::CodecContextPool pool;
+
+    const AVCodecContext *parameters = findCodecContext(formatContext, AVMEDIA_TYPE_VIDEO);
+
+    AVCodecContext *first = pool.acquireDecodeCodecContext(parameters);
+
+    BOOST_REQUIRE( NULL != first );
+    BOOST_REQUIRE( parameters != first );
+
+    decodeFrame(formatContext, first, parameters);
+
+    AVCodecContext *released = first;
+
+    pool.release(&first);
+
+    BOOST_REQUIRE( NULL == first );
+
+    AVCodecContext *second = pool.acquireDecodeCodecContext(parameters);
+
+    BOOST_REQUIRE_EQUAL( released, second );
+
+    // The reused decoder must still decode after being flushed.
+    av_seek_frame(formatContext, -1, 0, AVSEEK_FLAG_BACKWARD);
+
+    decodeFrame(formatContext, second, parameters);
+
+    pool.release(&second);
+
+    transcode::libav::CodecPoolStatistics statistics = pool.statistics();
+
+    BOOST_REQUIRE_EQUAL( 1, statistics.hits );
+    BOOST_REQUIRE_EQUAL( 1, statistics.misses );
+    BOOST_REQUIRE_EQUAL( 2, statistics.released );
+    BOOST_REQUIRE_EQUAL( 0, statistics.discarded );
+    BOOST_REQUIRE_EQUAL( 1, statistics.idle );
+    BOOST_REQUIRE_EQUAL( 0, statistics.inUse );
+}
+
+/**
+ * Test a reused encoder is reset, so two borrowers in a row encode the same
+ * frames into the same packets.
+ */
+BOOST_FIXTURE_TEST_CASE( test_reused_encode_codec_context_is_reset, test::AVIStreamFixture )
+{
+
+    transcode::libav::CodecContextPool pool;
+
+    const AVCodecContext *video = findCodecContext(formatContext, AVMEDIA_TYPE_VIDEO);
+
+    AVCodecContext *decoder = pool.acquireDecodeCodecContext(video);
+
+    BOOST_REQUIRE_EQUAL( PIX_FMT_YUV420P, decoder->pix_fmt );
+
+    AVFrame *frame = NULL;
+
+    while (NULL == frame) {
+
+        AVPacket *packet = transcode::libav::readNextPacket(formatContext);
+
+        BOOST_REQUIRE( NULL != packet );
+
+        if (video == formatContext->streams[packet->stream_index]->codec) {
+
+            frame = transcode::libav::decodeVideoPacket(decoder, packet);
+        }
+
+        transcode::libav::freePacket(&packet);
+    }
+
+    AVCodecContext *parameters = avcodec_alloc_context3(avcodec_find_encoder(CODEC_ID_MPEG4));
+
+    parameters->width = decoder->width;
+    parameters->height = decoder->height;
+    parameters->pix_fmt = PIX_FMT_YUV420P;
+    parameters->time_base.num = 1;
+    parameters->time_base.den = 25;
+    parameters->gop_size = 3;
+
+    AVCodecContext *first = pool.acquireEncodeCodecContext(parameters);
+
+    std::string firstBytes = encodeFrames(first, frame);
+
+    AVCodecContext *released = first;
+
+    pool.release(&first);
+
+    AVCodecContext *second = pool.acquireEncodeCodecContext(parameters);
+
+    BOOST_REQUIRE_EQUAL( released, second );
+
+    std::string secondBytes = encodeFrames(second, frame);
+
+    pool.release(&second);
+
+    BOOST_REQUIRE( !firstBytes.empty() );
+    BOOST_REQUIRE( firstBytes == secondBytes );
+
+    BOOST_REQUIRE_EQUAL( 1, pool.statistics().hits );
+    BOOST_REQUIRE_EQUAL( 0, pool.statistics().discarded );
+
+    transcode::libav::freeFrame(&frame);
+
+    pool.release(&decoder);
+
+    av_free(parameters);
+}
+
+/**
+ * Test codec contexts for different parameters are not mixed up.
+ */
+BOOST_FIXTURE_TEST_CASE( test_different_parameters_not_reused, test::AVIStreamFixture )
+{
+
+    transcode::libav::CodecContextPool pool;
+
+    const AVCodecContext *video = findCodecContext(formatContext, AVMEDIA_TYPE_VIDEO);
+    const AVCodecContext *audio = findCodecContext(formatContext, AVMEDIA_TYPE_AUDIO);
+
+    AVCodecContext *decoder = pool.acquireDecodeCodecContext(video);
+
+    pool.release(&decoder);
+
+    decoder = pool.acquireDecodeCodecContext(audio);
+
+    BOOST_REQUIRE_EQUAL( AVMEDIA_TYPE_AUDIO, decoder->codec_type );
+
+    pool.release(&decoder);
+
+    BOOST_REQUIRE_EQUAL( 0, pool.statistics().hits );
+    BOOST_REQUIRE_EQUAL( 2, pool.statistics().misses );
+    BOOST_REQUIRE_EQUAL( 2, pool.statistics().idle );
+}
+
+/**
+ * Test the least recently released codec context is closed when the pool is full.
+ */
+BOOST_FIXTURE_TEST_CASE( test_full_pool_discards, test::AVIStreamFixture )
+{
+
+    transcode::libav::CodecContextPool pool(1);
+
+    const AVCodecContext *video = findCodecContext(formatContext, AVMEDIA_TYPE_VIDEO);
+
+    AVCodecContext *first = pool.acquireDecodeCodecContext(video);
+    AVCodecContext *second = pool.acquireDecodeCodecContext(video);
+
+    BOOST_REQUIRE_EQUAL( 2, pool.statistics().inUse );
+
+    pool.release(&first);
+    pool.release(&second);
+
+    BOOST_REQUIRE_EQUAL( 1, pool.statistics().idle );
+    BOOST_REQUIRE_EQUAL( 1, pool.statistics().discarded );
+
+    pool.clear();
+
+    BOOST_REQUIRE_EQUAL( 0, pool.statistics().idle );
+}
+
+/**
+ * Test idle codec contexts are charged to the process instead of the job that
+ * released them, and to the job that takes them again.
+ */
+BOOST_FIXTURE_TEST_CASE( test_idle_codec_context_charge_moves, test::AVIStreamFixture )
+{
+
+    transcode::libav::CodecContextPool pool;
+
+    const AVCodecContext *video = findCodecContext(formatContext, AVMEDIA_TYPE_VIDEO);
+
+    AVCodecContext *decoder = NULL;
+
+    {
+        transcode::libav::Job job;
+        transcode::libav::ScopedJob scopedJob(&job);
+
+        decoder = pool.acquireDecodeCodecContext(video);
+
+        BOOST_REQUIRE( 0 < job.memory().used() );
+
+        pool.release(&decoder);
+
+        BOOST_REQUIRE_EQUAL( 0, job.memory().used() );
+    }
+
+    transcode::libav::Job job;
+    transcode::libav::ScopedJob scopedJob(&job);
+
+    decoder = pool.acquireDecodeCodecContext(video);
+
+    BOOST_REQUIRE( 0 < job.memory().used() );
+
+    pool.release(&decoder);
+}
+
+/**
+ * Test releasing a NULL codec context.
+ */
+BOOST_AUTO_TEST_CASE( test_release_null_codec_context )
+{
+
+    transcode::libav::CodecContextPool pool;
+
+    AVCodecContext *codecContext = NULL;
+
+    BOOST_REQUIRE_THROW( pool.release(NULL), transcode::IllegalArgumentException );
+    BOOST_REQUIRE_THROW( pool.release(&codecContext), transcode::IllegalArgumentException );
+}
+
+/**
+ * Test releasing a codec context that didn't come from the pool.
+ */
+BOOST_FIXTURE_TEST_CASE( test_release_foreign_codec_context, test::AVIStreamFixture )
+{
+
+    transcode::libav::CodecContextPool pool;
+
+    AVCodecContext *codecContext = streams[0]->codec;
+
+    BOOST_REQUIRE_THROW( pool.release(&codecContext), transcode::IllegalArgumentException );
+    BOOST_REQUIRE( NULL != codecContext );
+}
+
+/**
+ * Test acquiring a codec context for NULL parameters.
+ */
+BOOST_AUTO_TEST_CASE( test_acquire_null_parameters )
+{
+
+    transcode::libav::CodecContextPool pool;
+
+    BOOST_REQUIRE_THROW( pool.acquireDecodeCodecContext(NULL),
+            transcode::IllegalArgumentException );
+    BOOST_REQUIRE_THROW( pool.acquireEncodeCodecContext(NULL),
+            transcode::IllegalArgumentException );
+}
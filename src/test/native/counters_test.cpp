@@ -0,0 +1,140 @@
+/*
+ * counters_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <libav/counters.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+
+#include <boost/thread/thread.hpp>
+
+#include <string>
+
+
+/**
+ * Read every packet from the supplied format context.
+ *
+ * @param formatContext - the format context to read from.
+ * @return the total size of the packets read.
+ */
+static uint64_t readAllPackets(AVFormatContext *formatContext) {
+
+    uint64_t bytes = 0;
+
+    AVPacket *packet = NULL;
+
+    while (NULL != (packet = transcode::libav::readNextPacket(formatContext))) {
+
+        bytes += packet->size;
+
+        transcode::libav::freePacket(&packet);
+    }
+
+    return bytes;
+}
+
+/**
+ * Test the read packet counters for an avi file.
+ */
+BOOST_FIXTURE_TEST_CASE( test_read_packet_counters_for_avi_file, test::AVIFormatContextFixture )
+{
+
+    transcode::libav::resetPerformanceCounters();
+
+    uint64_t bytes = readAllPackets(formatContext);
+
+    transcode::libav::StageCounters counters = transcode::libav::performanceCounters()
+            .stages[transcode::libav::STAGE_READ_PACKET];
+
+    BOOST_REQUIRE( 0 < counters.calls );
+    BOOST_REQUIRE_EQUAL( bytes, counters.bytesOut );
+    BOOST_REQUIRE_EQUAL( 0, counters.errors );
+
+    uint64_t histogramCalls = 0;
+
+    for (int i = 0; i < transcode::libav::LATENCY_BUCKETS; i++) {
+
+        histogramCalls += counters.latencyHistogram[i];
+    }
+
+    BOOST_REQUIRE_EQUAL( counters.calls, histogramCalls );
+}
+
+/**
+ * Test the counters of a thread that has finished are still reported.
+ */
+BOOST_FIXTURE_TEST_CASE( test_counters_from_finished_thread, test::FLVFormatContextFixture )
+{
+
+    transcode::libav::resetPerformanceCounters();
+
+    boost::thread reader(readAllPackets, formatContext);
+
+    reader.join();
+
+    BOOST_REQUIRE( 0 < transcode::libav::performanceCounters()
+            .stages[transcode::libav::STAGE_READ_PACKET].calls );
+}
+
+/**
+ * Test a call that throws is counted as an error.
+ */
+BOOST_AUTO_TEST_CASE( test_counters_for_error )
+{
+
+    transcode::libav::resetPerformanceCounters();
+
+    BOOST_REQUIRE_THROW( transcode::libav::readNextPacket((AVFormatContext*) NULL),
+            transcode::IllegalArgumentException );
+
+    transcode::libav::StageCounters counters = transcode::libav::performanceCounters()
+            .stages[transcode::libav::STAGE_READ_PACKET];
+
+    BOOST_REQUIRE_EQUAL( 1, counters.calls );
+    BOOST_REQUIRE_EQUAL( 1, counters.errors );
+}
+
+/**
+ * Test nothing is counted while the counters are disabled.
+ */
+BOOST_AUTO_TEST_CASE( test_counters_disabled )
+{
+
+    transcode::libav::resetPerformanceCounters();
+    transcode::libav::setPerformanceCountersEnabled(false);
+
+    BOOST_REQUIRE_THROW( transcode::libav::readNextPacket((AVFormatContext*) NULL),
+            transcode::IllegalArgumentException );
+
+    transcode::libav::setPerformanceCountersEnabled(true);
+
+    BOOST_REQUIRE_EQUAL( 0, transcode::libav::performanceCounters()
+            .stages[transcode::libav::STAGE_READ_PACKET].calls );
+}
+
+/**
+ * Test the counters JSON contains every stage.
+ */
+BOOST_AUTO_TEST_CASE( test_counters_json )
+{
+
+    std::string json = transcode::libav::performanceCountersJson();
+
+    BOOST_REQUIRE_EQUAL( '{', json[0] );
+    BOOST_REQUIRE_EQUAL( '}', json[json.size() - 1] );
+
+    for (int i = 0; i < transcode::libav::STAGE_COUNT; i++) {
+
+        std::string name = transcode::libav::stageName(static_cast<transcode::libav::Stage>(i));
+
+        BOOST_REQUIRE( std::string::npos != json.find("\"" + name + "\"") );
+    }
+}
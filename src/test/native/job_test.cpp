@@ -0,0 +1,108 @@
+/*
+ * job_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <libav/job.hpp>
+#include <libav/memory.hpp>
+
+#include <boost/thread/thread.hpp>
+
+
+/**
+ * Record the job bound to the thread that calls it.
+ */
+static void recordCurrentJob(transcode::libav::Job **job) {
+
+    *job = transcode::libav::currentJob();
+}
+
+/**
+ * Test no job is bound by default.
+ */
+BOOST_AUTO_TEST_CASE( test_no_current_job )
+{
+
+    BOOST_REQUIRE( NULL == transcode::libav::currentJob() );
+    BOOST_REQUIRE_EQUAL( &transcode::libav::processMemoryAccount(),
+            &transcode::libav::currentMemoryAccount() );
+}
+
+/**
+ * Test a scoped job is bound until it goes out of scope.
+ */
+BOOST_AUTO_TEST_CASE( test_scoped_job )
+{
+
+    transcode::libav::Job job;
+
+    {
+        transcode::libav::ScopedJob scopedJob(&job);
+
+        BOOST_REQUIRE_EQUAL( &job, transcode::libav::currentJob() );
+        BOOST_REQUIRE_EQUAL( &job.memory(), &transcode::libav::currentMemoryAccount() );
+    }
+
+    BOOST_REQUIRE( NULL == transcode::libav::currentJob() );
+}
+
+/**
+ * Test nested scoped jobs bind the outer job again.
+ */
+BOOST_AUTO_TEST_CASE( test_nested_scoped_jobs )
+{
+
+    transcode::libav::Job outer;
+    transcode::libav::Job inner;
+
+    transcode::libav::ScopedJob outerScope(&outer);
+
+    {
+        transcode::libav::ScopedJob innerScope(&inner);
+
+        BOOST_REQUIRE_EQUAL( &inner, transcode::libav::currentJob() );
+    }
+
+    BOOST_REQUIRE_EQUAL( &outer, transcode::libav::currentJob() );
+}
+
+/**
+ * Test a job is only bound to the thread that bound it.
+ */
+BOOST_AUTO_TEST_CASE( test_job_bound_per_thread )
+{
+
+    transcode::libav::Job job;
+    transcode::libav::ScopedJob scopedJob(&job);
+
+    transcode::libav::Job *otherThreadJob = &job;
+
+    boost::thread thread(recordCurrentJob, &otherThreadJob);
+
+    thread.join();
+
+    BOOST_REQUIRE( NULL == otherThreadJob );
+}
+
+/**
+ * Test a jobs memory is also charged to the process.
+ */
+BOOST_AUTO_TEST_CASE( test_job_memory_charges_process )
+{
+
+    transcode::libav::Job job(1000);
+
+    int64_t processUsed = transcode::libav::processMemoryAccount().used();
+
+    job.memory().charge(10);
+
+    BOOST_REQUIRE_EQUAL( processUsed + 10, transcode::libav::processMemoryAccount().used() );
+    BOOST_REQUIRE_EQUAL( 1000, job.memory().budget() );
+
+    job.memory().release(10);
+}
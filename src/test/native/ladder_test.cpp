@@ -0,0 +1,203 @@
+/*
+ * ladder_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <error.hpp>
+#include <libav/ladder.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+static const std::string LADDER_HIGH = "../../../target/test-classes/lib-test/ladder_high.mkv";
+static const std::string LADDER_LOW = "../../../target/test-classes/lib-test/ladder_low.mkv";
+static const std::string LADDER_SEGMENTS = "../../../target/test-classes/lib-test/ladder_segments_";
+
+/**
+ * Read the whole of the supplied playlist.
+ */
+static std::string readPlaylist(const std::string& fileName) {
+
+    std::ifstream in(fileName.c_str());
+
+    std::ostringstream contents;
+
+    contents << in.rdbuf();
+
+    return contents.str();
+}
+
+/**
+ * Read the indexes of the key frame packets of the supplied rendition.
+ */
+static std::vector<int> keyFrames(const std::string& fileName, int *width, int *height) {
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(fileName);
+
+    BOOST_REQUIRE_EQUAL( 1, formatContext->nb_streams );
+
+    *width = formatContext->streams[0]->codec->width;
+    *height = formatContext->streams[0]->codec->height;
+
+    std::vector<int> keyFrames;
+
+    int index = 0;
+
+    for (AVPacket *packet = transcode::libav::readNextPacket(formatContext); NULL != packet;
+            packet = transcode::libav::readNextPacket(formatContext)) {
+
+        if (0 != (packet->flags & AV_PKT_FLAG_KEY)) keyFrames.push_back(index);
+
+        index++;
+
+        transcode::libav::freePacket(&packet);
+    }
+
+    transcode::libav::closeFormatContext(&formatContext);
+
+    return keyFrames;
+}
+
+/**
+ * Test encoding two renditions of an avi file from one decode.
+ */
+BOOST_FIXTURE_TEST_CASE( test_encode_ladder_from_avi_file, test::LibAvRegisterable )
+{
+
+    std::vector<transcode::libav::Rendition> renditions;
+
+    renditions.push_back(transcode::libav::Rendition(LADDER_HIGH, 320, 0, 400000));
+    renditions.push_back(transcode::libav::Rendition(LADDER_LOW, 160, 0, 100000));
+
+    transcode::libav::LadderOptions options;
+
+    options.keyFrameInterval = 12;
+
+    transcode::libav::LadderResult result =
+            transcode::libav::encodeLadder(VIDEO_AVI, renditions, options);
+
+    BOOST_REQUIRE( 0 < result.framesDecoded );
+
+    // The mpeg4 decoder decodes straight into the shared frames.
+    BOOST_REQUIRE_EQUAL( 0, result.framesCopied );
+
+    BOOST_REQUIRE_EQUAL( 2, result.framesEncoded.size() );
+    BOOST_REQUIRE_EQUAL( result.framesDecoded, result.framesEncoded[0] );
+    BOOST_REQUIRE_EQUAL( result.framesDecoded, result.framesEncoded[1] );
+    BOOST_REQUIRE_EQUAL( 0, result.decodeErrors.invalidData );
+    BOOST_REQUIRE_EQUAL( 0, result.decodeErrors.failed );
+
+    int width = 0;
+    int height = 0;
+
+    std::vector<int> high = keyFrames(LADDER_HIGH, &width, &height);
+
+    BOOST_REQUIRE_EQUAL( 320, width );
+    BOOST_REQUIRE_EQUAL( 320 * VIDEO_HEIGHT / VIDEO_WIDTH, height );
+
+    std::vector<int> low = keyFrames(LADDER_LOW, &width, &height);
+
+    BOOST_REQUIRE_EQUAL( 160, width );
+
+    // Every rendition can be switched to at the same frames.
+    BOOST_REQUIRE( high == low );
+    BOOST_REQUIRE_EQUAL( 0, high[0] );
+}
+
+/**
+ * Test a ladder with invalid renditions or options.
+ */
+BOOST_AUTO_TEST_CASE( test_encode_ladder_with_invalid_options )
+{
+
+    std::vector<transcode::libav::Rendition> renditions;
+
+    BOOST_REQUIRE_THROW( transcode::libav::encodeLadder(VIDEO_AVI, renditions),
+            transcode::IllegalArgumentException );
+
+    renditions.push_back(transcode::libav::Rendition(LADDER_LOW, -1, 0, 0));
+
+    BOOST_REQUIRE_THROW( transcode::libav::encodeLadder(VIDEO_AVI, renditions),
+            transcode::IllegalArgumentException );
+
+    renditions[0].width = 160;
+
+    transcode::libav::LadderOptions options;
+
+    options.keyFrameInterval = 0;
+
+    BOOST_REQUIRE_THROW( transcode::libav::encodeLadder(VIDEO_AVI, renditions, options),
+            transcode::IllegalArgumentException );
+}
+
+/**
+ * Test a rendition with an encoder that doesn't exist.
+ */
+BOOST_FIXTURE_TEST_CASE( test_encode_ladder_with_unknown_encoder, test::LibAvRegisterable )
+{
+
+    std::vector<transcode::libav::Rendition> renditions;
+
+    renditions.push_back(transcode::libav::Rendition(LADDER_LOW, 160, 0, 0));
+
+    renditions[0].encoderName = "not an encoder";
+
+    BOOST_REQUIRE_THROW( transcode::libav::encodeLadder(VIDEO_AVI, renditions),
+            transcode::libav::CodecException );
+}
+
+/**
+ * Test a ladder of a file that isn't media.
+ */
+BOOST_FIXTURE_TEST_CASE( test_encode_ladder_from_text_file, test::LibAvRegisterable )
+{
+
+    std::vector<transcode::libav::Rendition> renditions;
+
+    renditions.push_back(transcode::libav::Rendition(LADDER_LOW, 160, 0, 0));
+
+    BOOST_REQUIRE_THROW( transcode::libav::encodeLadder(TEXT_FILE, renditions),
+            transcode::Exception );
+}
+
+/**
+ * Test encoding two renditions of an avi file as segments, which start at the
+ * same frames in both.
+ */
+BOOST_FIXTURE_TEST_CASE( test_encode_segmented_ladder_from_avi_file, test::LibAvRegisterable )
+{
+
+    std::vector<transcode::libav::Rendition> renditions;
+
+    renditions.push_back(transcode::libav::Rendition("", 320, 0, 400000));
+    renditions.push_back(transcode::libav::Rendition("", 160, 0, 100000));
+
+    renditions[0].segmentDirectory = LADDER_SEGMENTS + "high";
+    renditions[1].segmentDirectory = LADDER_SEGMENTS + "low";
+
+    transcode::libav::LadderOptions options;
+
+    options.keyFrameInterval = 12;
+    options.segmentMilliseconds = 2000;
+
+    transcode::libav::encodeLadder(VIDEO_AVI, renditions, options);
+
+    std::string high = readPlaylist(renditions[0].segmentDirectory + "/playlist.m3u8");
+    std::string low = readPlaylist(renditions[1].segmentDirectory + "/playlist.m3u8");
+
+    BOOST_REQUIRE( std::string::npos != high.find("segment00001.ts") );
+    BOOST_REQUIRE( std::string::npos != high.find("#EXT-X-ENDLIST") );
+    BOOST_REQUIRE_EQUAL( high, low );
+}
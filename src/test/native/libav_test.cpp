@@ -13,9 +13,63 @@
 #include <libav/libav.hpp>
 #include <libav/libaverror.hpp>
 
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+
 #include <iostream>
 
 
+/**
+ * The number of threads that open and close codecs at once in the stress test.
+ */
+static const int STRESS_THREADS = 8;
+
+/**
+ * The number of times each stress test thread goes through all the test files.
+ */
+static const int STRESS_ITERATIONS = 5;
+
+/**
+ * Open and close a decoder for every audio and video stream of every test file,
+ * counting every exception thrown.
+ *
+ * @param failures - the count of the exceptions thrown.
+ */
+static void openAndCloseCodecs(boost::atomic<int> *failures) {
+
+    const std::string files[] = { VIDEO_AVI, VIDEO_MKV, VIDEO_MP4, VIDEO_OGV, VIDEO_FLV };
+
+    for (int i = 0; i < STRESS_ITERATIONS; i++) {
+
+        for (int j = 0; j < 5; j++) {
+
+            try {
+
+                AVFormatContext *formatContext = transcode::libav::openFormatContext(files[j]);
+
+                for (unsigned int k = 0; k < formatContext->nb_streams; k++) {
+
+                    AVCodecContext *codecContext = formatContext->streams[k]->codec;
+
+                    AVMediaType type = transcode::libav::findCodecType(codecContext);
+
+                    if (AVMEDIA_TYPE_AUDIO != type && AVMEDIA_TYPE_VIDEO != type) continue;
+
+                    transcode::libav::openDecodeCodecContext(codecContext);
+                    transcode::libav::closeCodecContext(&codecContext);
+                }
+
+                transcode::libav::closeFormatContext(&formatContext);
+
+            } catch (...) {
+
+                failures->fetch_add(1);
+            }
+        }
+    }
+}
+
+
 /**
  * Test error message success.
  */
@@ -46,6 +100,26 @@ BOOST_AUTO_TEST_CASE( test_error_message_invalid_data )
                 transcode::libav::errorMessage(AVERROR_INVALIDDATA) );
 }
 
+/**
+ * Test opening and closing codecs from many threads at once.
+ */
+BOOST_AUTO_TEST_CASE( test_concurrent_open_and_close_codecs )
+{
+
+    boost::atomic<int> failures(0);
+
+    boost::thread_group threads;
+
+    for (int i = 0; i < STRESS_THREADS; i++) {
+
+        threads.create_thread(std::tr1::bind(openAndCloseCodecs, &failures));
+    }
+
+    threads.join_all();
+
+    BOOST_REQUIRE_EQUAL( 0, failures.load() );
+}
+
 /**
  * Test open avi format context.
  */
@@ -268,6 +342,155 @@ BOOST_AUTO_TEST_CASE( test_read_packet_from_null_format_context )
             transcode::IllegalArgumentException );
 }
 
+/**
+ * Test only key frame video packets are read from an mkv file set to key frames only.
+ */
+BOOST_FIXTURE_TEST_CASE( test_read_key_frames_only_from_mkv_file, test::MKVFormatContextFixture )
+{
+
+    transcode::libav::setKeyFramesOnly(formatContext, true);
+
+    int videoPackets = 0;
+    int otherPackets = 0;
+
+    for (AVPacket *packet = transcode::libav::readNextPacket(formatContext); NULL != packet;
+            packet = transcode::libav::readNextPacket(formatContext)) {
+
+        if (AVMEDIA_TYPE_VIDEO == formatContext->streams[packet->stream_index]->codec->codec_type) {
+
+            BOOST_REQUIRE( packet->flags & AV_PKT_FLAG_KEY );
+
+            videoPackets++;
+
+        } else {
+
+            otherPackets++;
+        }
+
+        transcode::libav::freePacket(&packet);
+    }
+
+    BOOST_REQUIRE( 0 < videoPackets );
+    BOOST_REQUIRE( 0 < otherPackets );
+}
+
+/**
+ * Test set key frames only on a NULL format context.
+ */
+BOOST_AUTO_TEST_CASE( test_set_key_frames_only_for_null_format_context )
+{
+
+    BOOST_REQUIRE_THROW( transcode::libav::setKeyFramesOnly(NULL, true),
+            transcode::IllegalArgumentException );
+}
+
+/**
+ * Test remux an avi file into an mkv file.
+ */
+BOOST_FIXTURE_TEST_CASE( test_remux_avi_file_to_mkv, test::AVIFormatContextFixture )
+{
+
+    std::string outputFile = "../../../target/test-classes/lib-test/remux_test.mkv";
+
+    AVFormatContext *output = transcode::libav::openOutputFormatContext(outputFile);
+
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+
+        transcode::libav::addOutputStream(output, formatContext->streams[i]->codec);
+    }
+
+    transcode::libav::writeOutputHeader(output);
+
+    int packetCount = 0;
+
+    // Check the count before reading so that no packet is read without being freed.
+    for (; 100 > packetCount; packetCount++) {
+
+        AVPacket *packet = transcode::libav::readNextPacket(formatContext);
+
+        if (NULL == packet) break;
+
+        AVRational inputTimeBase = formatContext->streams[packet->stream_index]->time_base;
+        AVRational outputTimeBase = output->streams[packet->stream_index]->time_base;
+
+        if (AV_NOPTS_VALUE != packet->pts) {
+
+            packet->pts = av_rescale_q(packet->pts, inputTimeBase, outputTimeBase);
+        }
+
+        if (AV_NOPTS_VALUE != packet->dts) {
+
+            packet->dts = av_rescale_q(packet->dts, inputTimeBase, outputTimeBase);
+        }
+
+        transcode::libav::writePacket(output, packet);
+
+        transcode::libav::freePacket(&packet);
+    }
+
+    transcode::libav::closeOutputFormatContext(&output);
+
+    BOOST_REQUIRE( NULL == output );
+    BOOST_REQUIRE( 0 < packetCount );
+
+    AVFormatContext *remuxed = transcode::libav::openFormatContext(outputFile);
+
+    BOOST_REQUIRE_EQUAL( formatContext->nb_streams, remuxed->nb_streams );
+
+    transcode::libav::closeFormatContext(&remuxed);
+}
+
+/**
+ * Test open output format context for an unknown format.
+ */
+BOOST_AUTO_TEST_CASE( test_open_output_format_context_for_unknown_format )
+{
+
+    BOOST_REQUIRE_THROW( transcode::libav::openOutputFormatContext(
+            "../../../target/test-classes/lib-test/test.unknown"),
+            transcode::IllegalArgumentException );
+}
+
+/**
+ * Test write header for an output format context without any streams.
+ */
+BOOST_AUTO_TEST_CASE( test_write_output_header_without_streams )
+{
+
+    AVFormatContext *output = transcode::libav::openOutputFormatContext(
+            "../../../target/test-classes/lib-test/empty_test.mkv");
+
+    BOOST_REQUIRE_THROW( transcode::libav::writeOutputHeader(output),
+            transcode::IllegalStateException );
+
+    transcode::libav::closeOutputFormatContext(&output);
+}
+
+/**
+ * Test write null packet.
+ */
+BOOST_AUTO_TEST_CASE( test_write_null_packet )
+{
+
+    AVFormatContext *output = transcode::libav::openOutputFormatContext(
+            "../../../target/test-classes/lib-test/null_packet_test.mkv");
+
+    BOOST_REQUIRE_THROW( transcode::libav::writePacket(output, NULL),
+            transcode::IllegalArgumentException );
+
+    transcode::libav::closeOutputFormatContext(&output);
+}
+
+/**
+ * Test close null output format context.
+ */
+BOOST_AUTO_TEST_CASE( test_close_null_output_format_context )
+{
+
+    BOOST_REQUIRE_THROW( transcode::libav::closeOutputFormatContext(NULL),
+            transcode::IllegalArgumentException );
+}
+
 /**
  * Test find stream type from an avi file.
  */
@@ -541,6 +764,75 @@ BOOST_AUTO_TEST_CASE( test_open_decode_codec_for_null_codec )
             transcode::IllegalArgumentException );
 }
 
+/**
+ * Test open a key frames only decode codec for an mkv file.
+ */
+BOOST_FIXTURE_TEST_CASE( test_open_key_frames_only_decode_codec_for_mkv_file, test::MKVCodecContextFixture )
+{
+
+    transcode::libav::DecodeOptions options;
+
+    options.keyFramesOnly = true;
+
+    for (int i = 0; i < codecNumber; i++) {
+
+        if (AVMEDIA_TYPE_VIDEO != decodeCodecs[i]->codec_type) continue;
+
+        BOOST_REQUIRE( transcode::libav::openDecodeCodecContext(decodeCodecs[i], options) );
+        BOOST_REQUIRE_EQUAL( AVDISCARD_NONKEY, decodeCodecs[i]->skip_frame );
+        BOOST_REQUIRE_EQUAL( AVDISCARD_ALL, decodeCodecs[i]->skip_loop_filter );
+    }
+}
+
+/**
+ * Test open video decode codecs for proxies of an avi file, which mpeg4 can
+ * decode at a reduced resolution.
+ */
+BOOST_FIXTURE_TEST_CASE( test_open_proxy_decode_codec_for_avi_file, test::AVICodecContextFixture )
+{
+
+    transcode::libav::DecodeOptions options;
+
+    options.proxyScale = transcode::libav::PROXY_HALF;
+
+    for (int i = 0; i < codecNumber; i++) {
+
+        if (AVMEDIA_TYPE_VIDEO != decodeCodecs[i]->codec_type) continue;
+
+        int width = decodeCodecs[i]->width;
+        int height = decodeCodecs[i]->height;
+
+        BOOST_REQUIRE( transcode::libav::openDecodeCodecContext(decodeCodecs[i], options) );
+        BOOST_REQUIRE_EQUAL( transcode::libav::PROXY_HALF, decodeCodecs[i]->lowres );
+        BOOST_REQUIRE_EQUAL( -((-width) >> 1), decodeCodecs[i]->width );
+        BOOST_REQUIRE_EQUAL( -((-height) >> 1), decodeCodecs[i]->height );
+        BOOST_REQUIRE_EQUAL( AVDISCARD_ALL, decodeCodecs[i]->skip_loop_filter );
+        BOOST_REQUIRE_EQUAL( AVDISCARD_NONREF, decodeCodecs[i]->skip_idct );
+
+        // The frames themselves must come out at half the size.
+        AVFrame *frame = NULL;
+
+        while (NULL == frame) {
+
+            AVPacket *packet = transcode::libav::readNextPacket(formatContext);
+
+            BOOST_REQUIRE( NULL != packet );
+
+            if (i == packet->stream_index) {
+
+                frame = transcode::libav::decodeVideoPacket(decodeCodecs[i], packet);
+            }
+
+            transcode::libav::freePacket(&packet);
+        }
+
+        BOOST_REQUIRE_EQUAL( decodeCodecs[i]->width, frame->width );
+        BOOST_REQUIRE_EQUAL( decodeCodecs[i]->height, frame->height );
+
+        transcode::libav::freeFrame(&frame);
+    }
+}
+
 /**
  * Test close codecs for an avi file.
  */
@@ -740,6 +1032,62 @@ BOOST_AUTO_TEST_CASE( test_decode_audio_packet_with_null_codec_and_packet )
             transcode::IllegalArgumentException );
 }
 
+/**
+ * Test try decode audio packet for an mkv file.
+ */
+BOOST_FIXTURE_TEST_CASE( test_try_decode_audio_packet_for_mkv_file, test::MKVAudioPacketFixture )
+{
+
+    std::vector<AVFrame*> frames;
+
+    transcode::libav::DecodeResult result = transcode::libav::tryDecodeAudioPacket(
+            decodeCodecs[packet->stream_index], packet, frames);
+
+    BOOST_REQUIRE( result.succeeded() );
+    BOOST_REQUIRE_EQUAL( 0, result.errorCode );
+
+    for (int i = 0; i < frames.size(); i++) av_free(frames[i]);
+}
+
+/**
+ * Test try decode audio packet counts damaged packets.
+ */
+BOOST_FIXTURE_TEST_CASE( test_try_decode_damaged_audio_packet, test::AVIAudioPacketFixture )
+{
+
+    // Overwrite the packet with zeros, which have no MPEG audio frame header
+    // for the decoder to sync to.
+    memset(packet->data, 0, packet->size);
+
+    transcode::libav::resetDecodeErrorCounts();
+
+    std::vector<AVFrame*> frames;
+
+    transcode::libav::DecodeResult result = transcode::libav::tryDecodeAudioPacket(
+            decodeCodecs[packet->stream_index], packet, frames);
+
+    transcode::libav::DecodeErrorCounts counts = transcode::libav::decodeErrorCounts();
+
+    BOOST_REQUIRE( !result.succeeded() );
+    BOOST_REQUIRE_EQUAL( transcode::libav::DECODE_INVALID_DATA, result.status );
+    BOOST_REQUIRE_EQUAL( 1, counts.invalidData );
+    BOOST_REQUIRE_EQUAL( 0, counts.failed );
+
+    for (int i = 0; i < frames.size(); i++) transcode::libav::freeFrame(&frames[i]);
+}
+
+/**
+ * Test try decode audio packet with null codec.
+ */
+BOOST_FIXTURE_TEST_CASE( test_try_decode_audio_packet_with_null_codec, test::AVIAudioPacketFixture )
+{
+
+    std::vector<AVFrame*> frames;
+
+    BOOST_REQUIRE_THROW( transcode::libav::tryDecodeAudioPacket(NULL, packet, frames),
+            transcode::IllegalArgumentException );
+}
+
 /**
  * Test encode audio frame for an avi file.
  */
@@ -948,6 +1296,154 @@ BOOST_AUTO_TEST_CASE( test_decode_video_packet_with_null_codec_and_packet )
             transcode::IllegalArgumentException );
 }
 
+/**
+ * Test try decode video packet for an avi file.
+ */
+BOOST_FIXTURE_TEST_CASE( test_try_decode_video_packet_for_avi_file, test::AVIVideoPacketFixture )
+{
+
+    AVFrame *frame = NULL;
+
+    AVCodecContext *codec = decodeCodecs[packet->stream_index];
+
+    while (NULL == frame && NULL != packet) {
+
+        transcode::libav::DecodeResult result =
+                transcode::libav::tryDecodeVideoPacket(codec, packet, &frame);
+
+        BOOST_REQUIRE( result.succeeded() );
+
+        if (NULL != frame) break;
+
+        av_free_packet(packet);
+
+        packet = readPacket(type);
+    }
+
+    BOOST_REQUIRE( NULL != frame );
+
+    av_free(frame);
+}
+
+/**
+ * Test try decode video packet counts damaged packets.
+ */
+BOOST_FIXTURE_TEST_CASE( test_try_decode_damaged_video_packet, test::AVIVideoPacketFixture )
+{
+
+    // Overwrite the packet with data that has no MPEG-4 start code, so the
+    // decoder can't find a picture header.
+    memset(packet->data, 0xFF, packet->size);
+
+    transcode::libav::resetDecodeErrorCounts();
+
+    AVFrame *frame = NULL;
+
+    transcode::libav::DecodeResult result = transcode::libav::tryDecodeVideoPacket(
+            decodeCodecs[packet->stream_index], packet, &frame);
+
+    transcode::libav::DecodeErrorCounts counts = transcode::libav::decodeErrorCounts();
+
+    BOOST_REQUIRE( !result.succeeded() );
+    BOOST_REQUIRE( NULL == frame );
+    BOOST_REQUIRE_EQUAL( 1, counts.invalidData + counts.failed );
+}
+
+/**
+ * Test try decode video packet for a packet bigger than the largest decoded
+ * audio frame, the size packets used to be copied into, with its timestamp
+ * handed on to the frame.
+ */
+BOOST_FIXTURE_TEST_CASE( test_try_decode_large_video_packet, test::LibAvRegisterable )
+{
+
+    const int width = 1920;
+    const int height = 1088;
+
+    AVCodecContext *encoder = avcodec_alloc_context3(avcodec_find_encoder(CODEC_ID_MPEG4));
+
+    encoder->width = width;
+    encoder->height = height;
+    encoder->pix_fmt = PIX_FMT_YUV420P;
+    encoder->time_base.num = 1;
+    encoder->time_base.den = 25;
+    encoder->flags |= CODEC_FLAG_QSCALE;
+    encoder->global_quality = FF_QP2LAMBDA;
+
+    transcode::libav::openEncodeCodecContext(encoder);
+
+    AVFrame *picture = avcodec_alloc_frame();
+
+    avpicture_alloc(reinterpret_cast<AVPicture*>(picture), PIX_FMT_YUV420P, width, height);
+
+    // Noise at the finest quantiser can't be compressed, which makes a key
+    // frame of megabytes.
+    uint32_t noise = 1;
+
+    for (int plane = 0; plane < 3; plane++) {
+
+        int lines = 0 == plane ? height : height / 2;
+
+        for (int i = 0; i < lines * picture->linesize[plane]; i++) {
+
+            noise = noise * 1664525 + 1013904223;
+
+            picture->data[plane][i] = noise >> 24;
+        }
+    }
+
+    picture->pts = 0;
+    picture->quality = FF_QP2LAMBDA;
+
+    AVPacket *packet = transcode::libav::encodeVideoFrame(encoder, picture);
+
+    BOOST_REQUIRE( NULL != packet );
+    BOOST_REQUIRE( 192000 < packet->size );
+
+    packet->pts = 1234;
+    packet->dts = 1234;
+
+    AVCodecContext *decoder = avcodec_alloc_context3(avcodec_find_decoder(CODEC_ID_MPEG4));
+
+    decoder->width = width;
+    decoder->height = height;
+
+    transcode::libav::openDecodeCodecContext(decoder);
+
+    AVFrame *frame = NULL;
+
+    transcode::libav::DecodeResult result =
+            transcode::libav::tryDecodeVideoPacket(decoder, packet, &frame);
+
+    BOOST_REQUIRE( result.succeeded() );
+    BOOST_REQUIRE( NULL != frame );
+    BOOST_REQUIRE_EQUAL( 1234, frame->pkt_pts );
+    BOOST_REQUIRE_EQUAL( width, frame->width );
+
+    transcode::libav::freeFrame(&frame);
+    transcode::libav::freePacket(&packet);
+
+    transcode::libav::closeCodecContext(&decoder);
+    transcode::libav::closeCodecContext(&encoder);
+
+    avpicture_free(reinterpret_cast<AVPicture*>(picture));
+
+    av_free(picture);
+    av_free(decoder);
+    av_free(encoder);
+}
+
+/**
+ * Test try decode video packet with null frame pointer.
+ */
+BOOST_FIXTURE_TEST_CASE( test_try_decode_video_packet_with_null_frame_pointer, test::AVIVideoPacketFixture )
+{
+
+    BOOST_REQUIRE_THROW( transcode::libav::tryDecodeVideoPacket(
+            decodeCodecs[packet->stream_index], packet, NULL),
+            transcode::IllegalArgumentException );
+}
+
 /**
  * Test encode video frame for an avi file.
  */
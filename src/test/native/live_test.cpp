@@ -0,0 +1,197 @@
+/*
+ * live_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <error.hpp>
+#include <libav/counters.hpp>
+#include <libav/libav.hpp>
+#include <libav/live.hpp>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+static const std::string FIFO = "../../../target/test-classes/lib-test/live_test.fifo";
+
+// How much of the test video is fed through the FIFO.
+static const int64_t FEED_MILLISECONDS = 3000;
+
+// The most any packet may arrive behind real time, which allows for the demuxer
+// and parser each holding on to a frame until the start of the next one.
+static const int64_t LATENCY_BOUND_MICROSECONDS = 300000;
+
+static const AVRational MILLISECONDS = { 1, 1000 };
+
+/**
+ * Remux the video of the avi test file into MPEG-TS written to the FIFO, writing
+ * each packet at the time it would be shown, like a capture process would.
+ */
+struct FifoFeeder {
+
+    std::string *error;
+
+    void operator()() const {
+
+        try {
+
+            AVFormatContext *input = transcode::libav::openFormatContext(VIDEO_AVI);
+            AVStream *video = input->streams[DIVX_STREAM_ONE];
+
+            // This blocks until the test opens the other end.
+            AVFormatContext *output = transcode::libav::openOutputFormatContext(FIFO, "mpegts");
+
+            transcode::libav::addOutputStream(output, video->codec);
+            transcode::libav::writeOutputHeader(output);
+
+            avio_flush(output->pb);
+
+            uint64_t start = transcode::libav::monotonicNanoseconds();
+
+            int64_t first = AV_NOPTS_VALUE;
+
+            for (AVPacket *packet = transcode::libav::readNextPacket(input); NULL != packet;
+                    packet = transcode::libav::readNextPacket(input)) {
+
+                if (video->index != packet->stream_index || AV_NOPTS_VALUE == packet->dts) {
+
+                    transcode::libav::freePacket(&packet);
+
+                    continue;
+                }
+
+                if (AV_NOPTS_VALUE == first) first = packet->dts;
+
+                int64_t due = av_rescale_q(packet->dts - first, video->time_base, MILLISECONDS);
+
+                if (FEED_MILLISECONDS < due) {
+
+                    transcode::libav::freePacket(&packet);
+
+                    break;
+                }
+
+                int64_t elapsed = (transcode::libav::monotonicNanoseconds() - start) / 1000000;
+
+                if (due > elapsed) {
+
+                    boost::this_thread::sleep(boost::posix_time::milliseconds(due - elapsed));
+                }
+
+                AVRational timeBase = output->streams[0]->time_base;
+
+                if (AV_NOPTS_VALUE != packet->pts) {
+
+                    packet->pts = av_rescale_q(packet->pts, video->time_base, timeBase);
+                }
+
+                packet->dts = av_rescale_q(packet->dts, video->time_base, timeBase);
+                packet->stream_index = 0;
+
+                transcode::libav::writePacket(output, packet);
+
+                // Nothing is left sitting in the write buffer.
+                avio_flush(output->pb);
+
+                transcode::libav::freePacket(&packet);
+            }
+
+            transcode::libav::closeOutputFormatContext(&output);
+            transcode::libav::closeFormatContext(&input);
+
+        } catch (const std::exception& e) {
+
+            *error = e.what();
+        }
+    }
+};
+
+/**
+ * Test reading a FIFO fed in real time keeps up with it.
+ */
+BOOST_FIXTURE_TEST_CASE( test_read_live_fifo_with_bounded_latency, test::LibAvRegisterable )
+{
+
+    unlink(FIFO.c_str());
+
+    BOOST_REQUIRE_EQUAL( 0, mkfifo(FIFO.c_str(), 0600) );
+
+    std::string error;
+
+    FifoFeeder feeder = { &error };
+
+    boost::thread feed(feeder);
+
+    uint64_t packets = 0;
+
+    {
+        transcode::libav::LiveInput input(FIFO);
+
+        BOOST_REQUIRE_EQUAL( 1, input.formatContext()->nb_streams );
+
+        for (AVPacket *packet = input.readNextPacket(); NULL != packet;
+                packet = input.readNextPacket()) {
+
+            packets++;
+
+            transcode::libav::freePacket(&packet);
+        }
+
+        transcode::libav::LatencyStatistics latency = input.latency();
+
+        BOOST_REQUIRE( 0 < latency.packets );
+        BOOST_REQUIRE( LATENCY_BOUND_MICROSECONDS > latency.maxMicroseconds );
+        BOOST_REQUIRE( latency.meanMicroseconds() <= latency.maxMicroseconds );
+    }
+
+    feed.join();
+
+    unlink(FIFO.c_str());
+
+    BOOST_REQUIRE_EQUAL( "", error );
+    BOOST_REQUIRE( 0 < packets );
+}
+
+/**
+ * Test opening an input with a format that doesn't exist.
+ */
+BOOST_FIXTURE_TEST_CASE( test_open_input_with_unknown_format, test::LibAvRegisterable )
+{
+
+    transcode::libav::InputOptions options;
+
+    options.formatName = "not a format";
+
+    BOOST_REQUIRE_THROW( transcode::libav::openFormatContext(VIDEO_AVI, options),
+            transcode::IllegalArgumentException );
+}
+
+/**
+ * Test opening a file with the live options still finds its streams.
+ */
+BOOST_FIXTURE_TEST_CASE( test_open_file_live, test::LibAvRegisterable )
+{
+
+    transcode::libav::InputOptions options;
+
+    options.live = true;
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(VIDEO_AVI, options);
+
+    BOOST_REQUIRE_EQUAL( 2, formatContext->nb_streams );
+    BOOST_REQUIRE( 0 != (formatContext->flags & AVFMT_FLAG_NOBUFFER) );
+
+    transcode::libav::closeFormatContext(&formatContext);
+}
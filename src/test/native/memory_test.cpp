@@ -0,0 +1,252 @@
+/*
+ * memory_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <error.hpp>
+#include <libav/counters.hpp>
+#include <libav/job.hpp>
+#include <libav/libav.hpp>
+#include <libav/memory.hpp>
+#include <libav/packetreader.hpp>
+
+#include <boost/thread/thread.hpp>
+
+
+// How long to wait for the read ahead thread of a packet reader.
+const uint64_t READ_AHEAD_NANOSECONDS = 5000000000ULL;
+
+/**
+ * Wait until the supplied packet reader has buffered more than the
+ * supplied number of packets, or until the read ahead time has passed.
+ */
+static void waitForBufferedPackets(const transcode::libav::PacketReader& packetReader,
+        size_t packets) {
+
+    uint64_t deadline = transcode::libav::monotonicNanoseconds() + READ_AHEAD_NANOSECONDS;
+
+    while (packets >= packetReader.bufferedPackets()
+            && deadline > transcode::libav::monotonicNanoseconds()) {
+
+        boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+    }
+}
+
+/**
+ * Test charge and release.
+ */
+BOOST_AUTO_TEST_CASE( test_charge_and_release )
+{
+
+    transcode::libav::MemoryAccount account;
+
+    account.charge(100);
+    account.charge(50);
+
+    BOOST_REQUIRE_EQUAL( 150, account.used() );
+
+    account.release(120);
+
+    BOOST_REQUIRE_EQUAL( 30, account.used() );
+    BOOST_REQUIRE_EQUAL( 150, account.peak() );
+}
+
+/**
+ * Test charges are passed on to the parent account.
+ */
+BOOST_AUTO_TEST_CASE( test_charge_parent_account )
+{
+
+    transcode::libav::MemoryAccount parent;
+    transcode::libav::MemoryAccount child(&parent);
+
+    child.charge(100);
+
+    BOOST_REQUIRE_EQUAL( 100, parent.used() );
+
+    child.release(100);
+
+    BOOST_REQUIRE_EQUAL( 0, parent.used() );
+}
+
+/**
+ * Test an account with an unlimited budget is never over budget.
+ */
+BOOST_AUTO_TEST_CASE( test_unlimited_budget )
+{
+
+    transcode::libav::MemoryAccount account;
+
+    account.charge(static_cast<int64_t>(1) << 40);
+
+    BOOST_REQUIRE( !account.overBudget() );
+}
+
+/**
+ * Test an account is over budget once it holds more than its budget.
+ */
+BOOST_AUTO_TEST_CASE( test_over_budget )
+{
+
+    transcode::libav::MemoryAccount account(NULL, 100);
+
+    account.charge(100);
+
+    BOOST_REQUIRE( !account.overBudget() );
+
+    account.charge(1);
+
+    BOOST_REQUIRE( account.overBudget() );
+
+    account.release(1);
+
+    BOOST_REQUIRE( !account.overBudget() );
+}
+
+/**
+ * Test an account is over budget when its parent is.
+ */
+BOOST_AUTO_TEST_CASE( test_over_parent_budget )
+{
+
+    transcode::libav::MemoryAccount parent(NULL, 100);
+    transcode::libav::MemoryAccount child(&parent);
+    transcode::libav::MemoryAccount sibling(&parent);
+
+    sibling.charge(200);
+
+    BOOST_REQUIRE( child.overBudget() );
+}
+
+/**
+ * Test reading a packet charges the current job until the packet is freed.
+ */
+BOOST_FIXTURE_TEST_CASE( test_read_packet_charges_job, test::AVIFormatContextFixture )
+{
+
+    transcode::libav::Job job;
+    transcode::libav::ScopedJob scopedJob(&job);
+
+    AVPacket *packet = transcode::libav::readNextPacket(formatContext);
+
+    BOOST_REQUIRE( packet->size < job.memory().used() );
+
+    transcode::libav::freePacket(&packet);
+
+    BOOST_REQUIRE( NULL == packet );
+    BOOST_REQUIRE_EQUAL( 0, job.memory().used() );
+}
+
+/**
+ * Test opening a codec context charges the current job until it is closed.
+ */
+BOOST_FIXTURE_TEST_CASE( test_open_codec_context_charges_job, test::AVIStreamFixture )
+{
+
+    transcode::libav::Job job;
+    transcode::libav::ScopedJob scopedJob(&job);
+
+    AVCodecContext *codecContext = NULL;
+
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+
+        if (AVMEDIA_TYPE_VIDEO == formatContext->streams[i]->codec->codec_type) {
+
+            codecContext = formatContext->streams[i]->codec;
+        }
+    }
+
+    BOOST_REQUIRE( NULL != codecContext );
+
+    transcode::libav::openDecodeCodecContext(codecContext);
+
+    BOOST_REQUIRE( 0 < job.memory().used() );
+
+    transcode::libav::closeCodecContext(&codecContext);
+
+    BOOST_REQUIRE_EQUAL( 0, job.memory().used() );
+}
+
+/**
+ * Test decoded frames are charged to the current job until they are freed.
+ */
+BOOST_FIXTURE_TEST_CASE( test_decode_video_packet_charges_job, test::AVIVideoPacketFixture )
+{
+
+    transcode::libav::Job job;
+    transcode::libav::ScopedJob scopedJob(&job);
+
+    AVFrame *frame = NULL;
+
+    while (NULL == frame) {
+
+        transcode::libav::tryDecodeVideoPacket(decodeCodecs[packet->stream_index],
+                packet, &frame);
+
+        if (NULL != frame) break;
+
+        av_free_packet(packet);
+
+        packet = readPacket(AVMEDIA_TYPE_VIDEO);
+    }
+
+    BOOST_REQUIRE_EQUAL( static_cast<int64_t>(sizeof(AVFrame)), job.memory().used() );
+
+    transcode::libav::freeFrame(&frame);
+
+    BOOST_REQUIRE_EQUAL( 0, job.memory().used() );
+}
+
+/**
+ * Test a packet reader stops reading ahead while its job is over budget.
+ */
+BOOST_FIXTURE_TEST_CASE( test_packet_reader_paused_over_budget, test::AVIFormatContextFixture )
+{
+
+    transcode::libav::Job job(1);
+    transcode::libav::ScopedJob scopedJob(&job);
+
+    transcode::libav::PacketReader packetReader(formatContext);
+
+    waitForBufferedPackets(packetReader, 0);
+
+    // The reader always buffers one packet so that it can make progress.
+    BOOST_REQUIRE_EQUAL( 1, packetReader.bufferedPackets() );
+
+    job.memory().setBudget(transcode::libav::UNLIMITED_MEMORY);
+
+    AVPacket *packet = packetReader.readNextPacket();
+
+    transcode::libav::freePacket(&packet);
+
+    waitForBufferedPackets(packetReader, 1);
+
+    BOOST_REQUIRE( 1 < packetReader.bufferedPackets() );
+}
+
+/**
+ * Test free null packet.
+ */
+BOOST_AUTO_TEST_CASE( test_free_null_packet )
+{
+
+    BOOST_REQUIRE_THROW( transcode::libav::freePacket(NULL),
+            transcode::IllegalArgumentException );
+}
+
+/**
+ * Test free null frame.
+ */
+BOOST_AUTO_TEST_CASE( test_free_null_frame )
+{
+
+    BOOST_REQUIRE_THROW( transcode::libav::freeFrame(NULL),
+            transcode::IllegalArgumentException );
+}
@@ -0,0 +1,162 @@
+/*
+ * packetreader_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+#include <libav/packetreader.hpp>
+
+
+/**
+ * Count the packets left in the supplied format context by reading them directly.
+ *
+ * @param formatContext - the format context to count the packets of.
+ * @return the number of packets that were read.
+ */
+static int countPackets(AVFormatContext *formatContext) {
+
+    int count = 0;
+
+    AVPacket *packet = NULL;
+
+    while (NULL != (packet = transcode::libav::readNextPacket(formatContext))) {
+
+        transcode::libav::freePacket(&packet);
+
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * Count the packets left in the supplied packet reader, checking that the read
+ * ahead buffer never grows beyond the supplied limit.
+ *
+ * @param packetReader - the packet reader to count the packets of.
+ * @param maxPackets - the read ahead limit of the packet reader.
+ * @return the number of packets that were read.
+ */
+static int countPackets(transcode::libav::PacketReader *packetReader,
+        size_t maxPackets) {
+
+    int count = 0;
+
+    AVPacket *packet = NULL;
+
+    while (NULL != (packet = transcode::libav::readNextPacket(packetReader))) {
+
+        BOOST_REQUIRE( maxPackets >= packetReader->bufferedPackets() );
+
+        transcode::libav::freePacket(&packet);
+
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * Test read ahead packets from an avi file.
+ */
+BOOST_AUTO_TEST_CASE( test_read_ahead_packets_from_avi_file )
+{
+
+    test::AVIFormatContextFixture direct;
+    test::AVIFormatContextFixture readAhead;
+
+    int expected = countPackets(direct.formatContext);
+
+    transcode::libav::PacketReader packetReader(readAhead.formatContext);
+
+    BOOST_REQUIRE_EQUAL( expected, countPackets(&packetReader,
+            transcode::libav::DEFAULT_READ_AHEAD_PACKETS) );
+}
+
+/**
+ * Test read ahead packets from an mkv file with a small buffer.
+ */
+BOOST_AUTO_TEST_CASE( test_read_ahead_packets_from_mkv_file_with_small_buffer )
+{
+
+    test::MKVFormatContextFixture direct;
+    test::MKVFormatContextFixture readAhead;
+
+    int expected = countPackets(direct.formatContext);
+
+    transcode::libav::PacketReader packetReader(readAhead.formatContext, 4, 1024);
+
+    BOOST_REQUIRE_EQUAL( expected, countPackets(&packetReader, 4) );
+}
+
+/**
+ * Test read ahead packet keeps returning NULL at the end of the file.
+ */
+BOOST_FIXTURE_TEST_CASE( test_read_ahead_packet_after_end_of_file, test::FLVFormatContextFixture )
+{
+
+    transcode::libav::PacketReader packetReader(formatContext);
+
+    countPackets(&packetReader, transcode::libav::DEFAULT_READ_AHEAD_PACKETS);
+
+    BOOST_REQUIRE( NULL == transcode::libav::readNextPacket(&packetReader) );
+}
+
+/**
+ * Test destroying a packet reader before all the packets have been read.
+ */
+BOOST_FIXTURE_TEST_CASE( test_destroy_read_ahead_before_end_of_file, test::MP4FormatContextFixture )
+{
+
+    transcode::libav::PacketReader *packetReader =
+            new transcode::libav::PacketReader(formatContext, 8);
+
+    AVPacket *packet = transcode::libav::readNextPacket(packetReader);
+
+    BOOST_REQUIRE( NULL != packet );
+
+    transcode::libav::freePacket(&packet);
+
+    delete packetReader;
+}
+
+/**
+ * Test read ahead from a NULL format context.
+ */
+BOOST_AUTO_TEST_CASE( test_read_ahead_from_null_format_context )
+{
+
+    BOOST_REQUIRE_THROW( transcode::libav::PacketReader packetReader(NULL),
+            transcode::IllegalArgumentException );
+}
+
+/**
+ * Test read ahead from an empty format context.
+ */
+BOOST_AUTO_TEST_CASE( test_read_ahead_from_empty_format_context )
+{
+
+    AVFormatContext formatContext;
+    formatContext.nb_streams = 0;
+
+    BOOST_REQUIRE_THROW( transcode::libav::PacketReader packetReader(&formatContext),
+            transcode::IllegalStateException );
+}
+
+/**
+ * Test read packet from a NULL packet reader.
+ */
+BOOST_AUTO_TEST_CASE( test_read_packet_from_null_packet_reader )
+{
+
+    BOOST_REQUIRE_THROW( transcode::libav::readNextPacket((transcode::libav::PacketReader*) NULL),
+            transcode::IllegalArgumentException );
+}
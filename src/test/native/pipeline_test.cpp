@@ -0,0 +1,205 @@
+/*
+ * pipeline_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <error.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+#include <libav/pipeline.hpp>
+
+#include <cstring>
+#include <string>
+
+
+/**
+ * Counts the packets handed to it and whether any of them were reordered.
+ */
+struct CountingSink {
+
+    int *packets;
+    int *reordered;
+
+    void operator()(AVPacket *packet) const {
+
+        (*packets)++;
+
+        if (packet->pts != packet->dts) (*reordered)++;
+    }
+};
+
+/**
+ * Test opening an encoder with the zero latency profile.
+ */
+BOOST_FIXTURE_TEST_CASE( test_open_zero_latency_encoder, test::LibAvRegisterable )
+{
+
+    AVCodec *codec = avcodec_find_encoder_by_name("mpeg4");
+
+    BOOST_REQUIRE( NULL != codec );
+
+    AVCodecContext *codecContext = avcodec_alloc_context3(codec);
+
+    codecContext->width = VIDEO_WIDTH;
+    codecContext->height = VIDEO_HEIGHT;
+    codecContext->pix_fmt = PIX_FMT_YUV420P;
+    codecContext->time_base.num = 1;
+    codecContext->time_base.den = 25;
+    codecContext->max_b_frames = 2;
+
+    transcode::libav::EncodeOptions options;
+
+    options.profile = transcode::libav::ENCODE_ZERO_LATENCY;
+
+    transcode::libav::openEncodeCodecContext(codecContext, options);
+
+    BOOST_REQUIRE_EQUAL( 0, codecContext->max_b_frames );
+    BOOST_REQUIRE_EQUAL( FF_THREAD_SLICE, codecContext->thread_type );
+    BOOST_REQUIRE( 0 < codecContext->slices );
+
+    transcode::libav::closeCodecContext(&codecContext);
+
+    av_free(codecContext);
+}
+
+/**
+ * Test the packet of every frame comes out of the call that decodes it.
+ */
+BOOST_FIXTURE_TEST_CASE( test_pipeline_encodes_each_frame_as_it_is_decoded, test::LibAvRegisterable )
+{
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(VIDEO_AVI);
+
+    int packets = 0;
+    int reordered = 0;
+
+    CountingSink sink = { &packets, &reordered };
+
+    {
+        transcode::libav::PipelineOptions options;
+
+        options.width = VIDEO_WIDTH / 2;
+
+        transcode::libav::FramePipeline pipeline(formatContext->streams[DIVX_STREAM_ONE],
+                options, sink);
+
+        BOOST_REQUIRE_EQUAL( VIDEO_WIDTH / 2, pipeline.encoder()->width );
+
+        for (AVPacket *packet = transcode::libav::readNextPacket(formatContext); NULL != packet;
+                packet = transcode::libav::readNextPacket(formatContext)) {
+
+            if (DIVX_STREAM_ONE == packet->stream_index) {
+
+                int64_t decoded = pipeline.framesDecoded();
+
+                int written = pipeline.push(packet);
+
+                BOOST_REQUIRE_EQUAL( pipeline.framesDecoded() - decoded, written );
+            }
+
+            transcode::libav::freePacket(&packet);
+        }
+
+        // Nothing was held back by the encoder.
+        BOOST_REQUIRE_EQUAL( 0, pipeline.finish() );
+
+        BOOST_REQUIRE( 0 < pipeline.framesDecoded() );
+        BOOST_REQUIRE_EQUAL( pipeline.framesDecoded(), pipeline.framesEncoded() );
+        BOOST_REQUIRE_EQUAL( 0, pipeline.decodeErrors().invalidData );
+        BOOST_REQUIRE_EQUAL( 0, pipeline.decodeErrors().failed );
+    }
+
+    transcode::libav::closeFormatContext(&formatContext);
+
+    BOOST_REQUIRE( 0 < packets );
+    BOOST_REQUIRE_EQUAL( 0, reordered );
+}
+
+/**
+ * Test a packet that fails to decode is counted and skipped.
+ */
+BOOST_FIXTURE_TEST_CASE( test_pipeline_counts_damaged_packets, test::LibAvRegisterable )
+{
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(VIDEO_AVI);
+
+    int packets = 0;
+    int reordered = 0;
+
+    CountingSink sink = { &packets, &reordered };
+
+    {
+        transcode::libav::PipelineOptions options;
+
+        transcode::libav::FramePipeline pipeline(formatContext->streams[DIVX_STREAM_ONE],
+                options, sink);
+
+        AVPacket *packet = transcode::libav::readNextPacket(formatContext);
+
+        while (NULL != packet && DIVX_STREAM_ONE != packet->stream_index) {
+
+            transcode::libav::freePacket(&packet);
+
+            packet = transcode::libav::readNextPacket(formatContext);
+        }
+
+        BOOST_REQUIRE( NULL != packet );
+
+        // Without an MPEG-4 start code there is nothing the decoder can use.
+        memset(packet->data, 0xFF, packet->size);
+
+        BOOST_REQUIRE_EQUAL( 0, pipeline.push(packet) );
+
+        transcode::libav::freePacket(&packet);
+
+        BOOST_REQUIRE_EQUAL( 0, pipeline.framesDecoded() );
+        BOOST_REQUIRE_EQUAL( 1,
+                pipeline.decodeErrors().invalidData + pipeline.decodeErrors().failed );
+    }
+
+    transcode::libav::closeFormatContext(&formatContext);
+
+    BOOST_REQUIRE_EQUAL( 0, packets );
+}
+
+/**
+ * Test a pipeline over a stream that isn't video, or without a sink.
+ */
+BOOST_FIXTURE_TEST_CASE( test_pipeline_with_invalid_arguments, test::LibAvRegisterable )
+{
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(VIDEO_AVI);
+
+    int packets = 0;
+    int reordered = 0;
+
+    CountingSink sink = { &packets, &reordered };
+
+    transcode::libav::PipelineOptions options;
+
+    BOOST_REQUIRE_THROW( transcode::libav::FramePipeline(NULL, options, sink),
+            transcode::IllegalArgumentException );
+
+    BOOST_REQUIRE_THROW( transcode::libav::FramePipeline(
+            formatContext->streams[DIVX_STREAM_TWO], options, sink),
+            transcode::IllegalArgumentException );
+
+    BOOST_REQUIRE_THROW( transcode::libav::FramePipeline(
+            formatContext->streams[DIVX_STREAM_ONE], options, transcode::libav::PacketSink()),
+            transcode::IllegalArgumentException );
+
+    options.encoderName = "not an encoder";
+
+    BOOST_REQUIRE_THROW( transcode::libav::FramePipeline(
+            formatContext->streams[DIVX_STREAM_ONE], options, sink),
+            transcode::libav::CodecException );
+
+    transcode::libav::closeFormatContext(&formatContext);
+}
@@ -0,0 +1,260 @@
+/*
+ * progress_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <libav/job.hpp>
+#include <libav/libav.hpp>
+#include <libav/progress.hpp>
+
+#include <vector>
+
+
+/**
+ * Keeps every report it is called with.
+ */
+struct RecordingCallback {
+
+    std::vector<transcode::libav::ProgressReport> *reports;
+
+    void operator()(const transcode::libav::ProgressReport& report) const {
+
+        reports->push_back(report);
+    }
+};
+
+/**
+ * Read every packet of the supplied file on the calling thread.
+ *
+ * @return the number of packets read.
+ */
+static int readAll(const std::string& fileName) {
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(fileName);
+
+    int packets = 0;
+
+    for (AVPacket *packet = transcode::libav::readNextPacket(formatContext); NULL != packet;
+            packet = transcode::libav::readNextPacket(formatContext)) {
+
+        packets++;
+
+        transcode::libav::freePacket(&packet);
+    }
+
+    transcode::libav::closeFormatContext(&formatContext);
+
+    return packets;
+}
+
+/**
+ * Test the fraction done and the time left of a report.
+ */
+BOOST_AUTO_TEST_CASE( test_report_fraction_and_remaining )
+{
+
+    transcode::libav::ProgressReport report;
+
+    BOOST_REQUIRE_EQUAL( 0.0, report.fraction() );
+    BOOST_REQUIRE_EQUAL( -1, report.remainingMicroseconds() );
+
+    // Bytes are used when the duration isn't known.
+    report.bytesRead = 250;
+    report.totalBytes = 1000;
+    report.elapsedMicroseconds = 1000000;
+
+    BOOST_REQUIRE_EQUAL( 0.25, report.fraction() );
+    BOOST_REQUIRE_EQUAL( 3000000, report.remainingMicroseconds() );
+
+    report.mediaMicroseconds = 5000000;
+    report.durationMicroseconds = 10000000;
+
+    BOOST_REQUIRE_EQUAL( 0.5, report.fraction() );
+    BOOST_REQUIRE_EQUAL( 1000000, report.remainingMicroseconds() );
+
+    report.mediaMicroseconds = 20000000;
+
+    BOOST_REQUIRE_EQUAL( 1.0, report.fraction() );
+    BOOST_REQUIRE_EQUAL( 0, report.remainingMicroseconds() );
+}
+
+/**
+ * Test reading a whole file reports it all read.
+ */
+BOOST_FIXTURE_TEST_CASE( test_progress_of_reading_avi_file, test::LibAvRegisterable )
+{
+
+    transcode::libav::Job job;
+
+    transcode::libav::ScopedJob scopedJob(&job);
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(VIDEO_AVI);
+
+    transcode::libav::ProgressReport report = job.progress().report();
+
+    BOOST_REQUIRE_EQUAL( VIDEO_AVI_SIZE, report.totalBytes );
+    BOOST_REQUIRE( 0 < report.durationMicroseconds );
+    BOOST_REQUIRE_EQUAL( 0, report.mediaMicroseconds );
+
+    for (AVPacket *packet = transcode::libav::readNextPacket(formatContext); NULL != packet;
+            packet = transcode::libav::readNextPacket(formatContext)) {
+
+        transcode::libav::freePacket(&packet);
+    }
+
+    transcode::libav::closeFormatContext(&formatContext);
+
+    report = job.progress().report();
+
+    BOOST_REQUIRE( 0.9 < report.fraction() );
+    BOOST_REQUIRE( 0 < report.bytesRead );
+    BOOST_REQUIRE( report.totalBytes >= report.bytesRead );
+}
+
+/**
+ * Test the callback is called for every packet without an interval, and only
+ * for the first with a long one.
+ */
+BOOST_FIXTURE_TEST_CASE( test_progress_callback_is_throttled, test::LibAvRegisterable )
+{
+
+    std::vector<transcode::libav::ProgressReport> reports;
+
+    RecordingCallback callback = { &reports };
+
+    {
+        transcode::libav::Job job;
+
+        job.progress().setCallback(callback, 0);
+
+        transcode::libav::ScopedJob scopedJob(&job);
+
+        int packets = readAll(VIDEO_AVI);
+
+        BOOST_REQUIRE_EQUAL( packets, reports.size() );
+
+        for (size_t i = 1; i < reports.size(); i++) {
+
+            BOOST_REQUIRE( reports[i - 1].fraction() <= reports[i].fraction() );
+        }
+    }
+
+    reports.clear();
+
+    {
+        transcode::libav::Job job;
+
+        job.progress().setCallback(callback, 3600000);
+
+        transcode::libav::ScopedJob scopedJob(&job);
+
+        readAll(VIDEO_AVI);
+
+        BOOST_REQUIRE_EQUAL( 1, reports.size() );
+    }
+}
+
+/**
+ * Test decoding counts the decoded frames.
+ */
+BOOST_FIXTURE_TEST_CASE( test_progress_counts_decoded_frames, test::LibAvRegisterable )
+{
+
+    transcode::libav::Job job;
+
+    transcode::libav::ScopedJob scopedJob(&job);
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(VIDEO_AVI);
+
+    AVCodecContext *codecContext = transcode::libav::openDecodeCodecContext(
+            formatContext->streams[DIVX_STREAM_ONE]->codec);
+
+    uint64_t frames = 0;
+
+    for (AVPacket *packet = transcode::libav::readNextPacket(formatContext); NULL != packet;
+            packet = transcode::libav::readNextPacket(formatContext)) {
+
+        if (DIVX_STREAM_ONE == packet->stream_index) {
+
+            AVFrame *frame = NULL;
+
+            transcode::libav::tryDecodeVideoPacket(codecContext, packet, &frame);
+
+            if (NULL != frame) {
+
+                frames++;
+
+                transcode::libav::freeFrame(&frame);
+            }
+        }
+
+        transcode::libav::freePacket(&packet);
+    }
+
+    transcode::libav::closeCodecContext(&codecContext);
+    transcode::libav::closeFormatContext(&formatContext);
+
+    BOOST_REQUIRE( 0 < frames );
+    BOOST_REQUIRE_EQUAL( frames, job.progress().report().framesDecoded );
+}
+
+/**
+ * Test an input opened while another is still open adds to its progress, and
+ * one opened after it is closed starts over.
+ */
+BOOST_AUTO_TEST_CASE( test_progress_of_inputs_open_at_once )
+{
+
+    transcode::libav::Progress progress;
+
+    int first = 0;
+    int second = 0;
+
+    progress.inputOpened(&first, 1000, 100);
+    progress.packetRead(500, 60);
+
+    progress.inputOpened(&second, 2000, 200);
+    progress.packetRead(200, 20);
+
+    transcode::libav::ProgressReport report = progress.report();
+
+    BOOST_REQUIRE_EQUAL( 1000, report.durationMicroseconds );
+    BOOST_REQUIRE_EQUAL( 500, report.mediaMicroseconds );
+    BOOST_REQUIRE_EQUAL( 60, report.bytesRead );
+
+    // Only the input that started the progress over lets it start over again.
+    progress.inputClosed(&second);
+    progress.inputOpened(&second, 2000, 200);
+
+    BOOST_REQUIRE_EQUAL( 60, progress.report().bytesRead );
+
+    progress.inputClosed(&second);
+    progress.inputClosed(&first);
+    progress.inputOpened(&second, 2000, 200);
+
+    report = progress.report();
+
+    BOOST_REQUIRE_EQUAL( 2000, report.durationMicroseconds );
+    BOOST_REQUIRE_EQUAL( 0, report.bytesRead );
+}
+
+/**
+ * Test nothing is recorded without a job.
+ */
+BOOST_FIXTURE_TEST_CASE( test_no_progress_without_job, test::LibAvRegisterable )
+{
+
+    transcode::libav::Job job;
+
+    readAll(VIDEO_AVI);
+
+    BOOST_REQUIRE_EQUAL( 0, job.progress().report().bytesRead );
+    BOOST_REQUIRE_EQUAL( 0, job.progress().report().totalBytes );
+}
@@ -0,0 +1,175 @@
+/*
+ * range_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+#include <libav/packetreader.hpp>
+#include <libav/range.hpp>
+
+
+/**
+ * Test that a packet range reads the same number of packets as reading directly.
+ */
+BOOST_AUTO_TEST_CASE( test_packet_range_for_avi_file )
+{
+
+    test::AVIFormatContextFixture direct;
+    test::AVIFormatContextFixture ranged;
+
+    int expected = 0;
+
+    AVPacket *packet = NULL;
+
+    while (NULL != (packet = transcode::libav::readNextPacket(direct.formatContext))) {
+
+        transcode::libav::freePacket(&packet);
+
+        expected++;
+    }
+
+    transcode::libav::PacketRange range = transcode::libav::packets(ranged.formatContext);
+
+    int count = 0;
+
+    for (transcode::libav::PacketRange::iterator it = range.begin(); it != range.end(); ++it) {
+
+        BOOST_REQUIRE( NULL != *it );
+
+        count++;
+    }
+
+    BOOST_REQUIRE_EQUAL( expected, count );
+}
+
+/**
+ * Test finding the first ten key frame packets of an mkv file.
+ */
+BOOST_FIXTURE_TEST_CASE( test_packet_range_first_key_frames_for_mkv_file, test::MKVFormatContextFixture )
+{
+
+    transcode::libav::PacketRange range = transcode::libav::packets(formatContext);
+
+    int found = 0;
+
+    for (transcode::libav::PacketRange::iterator it = range.begin();
+            it != range.end() && 10 > found; ++it) {
+
+        if ((*it)->flags & AV_PKT_FLAG_KEY) found++;
+    }
+
+    BOOST_REQUIRE_EQUAL( 10, found );
+}
+
+/**
+ * Test a packet range over a packet reader.
+ */
+BOOST_FIXTURE_TEST_CASE( test_packet_range_for_packet_reader, test::FLVFormatContextFixture )
+{
+
+    transcode::libav::PacketReader packetReader(formatContext);
+
+    transcode::libav::PacketRange range = transcode::libav::packets(&packetReader);
+
+    BOOST_REQUIRE( range.begin() != range.end() );
+    BOOST_REQUIRE( formatContext == range.formatContext() );
+}
+
+/**
+ * Test the first video frame of an avi file.
+ */
+BOOST_FIXTURE_TEST_CASE( test_frame_range_first_video_frame_for_avi_file, test::AVIOpenedCodecContextFixture )
+{
+
+    transcode::libav::PacketRange packetRange = transcode::libav::packets(formatContext);
+
+    transcode::libav::FrameRange frameRange =
+            transcode::libav::frames(decodeCodecs[DIVX_STREAM_ONE], packetRange);
+
+    BOOST_REQUIRE_EQUAL( DIVX_STREAM_ONE, frameRange.streamIndex() );
+    BOOST_REQUIRE( frameRange.begin() != frameRange.end() );
+    BOOST_REQUIRE( NULL != *frameRange.begin() );
+}
+
+/**
+ * Test the first audio frame of an mp4 file.
+ */
+BOOST_FIXTURE_TEST_CASE( test_frame_range_first_audio_frame_for_mp4_file, test::MP4OpenedCodecContextFixture )
+{
+
+    transcode::libav::PacketRange packetRange = transcode::libav::packets(formatContext);
+
+    transcode::libav::FrameRange frameRange =
+            transcode::libav::frames(decodeCodecs[MP4_STREAM_TWO], packetRange);
+
+    transcode::libav::FrameRange::iterator it = frameRange.begin();
+
+    BOOST_REQUIRE( it != frameRange.end() );
+    BOOST_REQUIRE( 0 < (*it)->nb_samples );
+}
+
+/**
+ * Test the first few video frames of an flv file.
+ */
+BOOST_FIXTURE_TEST_CASE( test_frame_range_video_frames_for_flv_file, test::FLVOpenedCodecContextFixture )
+{
+
+    transcode::libav::PacketRange packetRange = transcode::libav::packets(formatContext);
+
+    transcode::libav::FrameRange frameRange =
+            transcode::libav::frames(decodeCodecs[FLV_STREAM_ONE], packetRange);
+
+    int count = 0;
+
+    for (transcode::libav::FrameRange::iterator it = frameRange.begin();
+            it != frameRange.end() && 5 > count; ++it) {
+
+        BOOST_REQUIRE_EQUAL( VIDEO_WIDTH, (*it)->width );
+
+        count++;
+    }
+
+    BOOST_REQUIRE_EQUAL( 5, count );
+}
+
+/**
+ * Test a frame range with a codec context from another format context.
+ */
+BOOST_FIXTURE_TEST_CASE( test_frame_range_with_foreign_codec_context, test::AVIOpenedCodecContextFixture )
+{
+
+    test::MKVFormatContextFixture other;
+
+    transcode::libav::PacketRange packetRange = transcode::libav::packets(other.formatContext);
+
+    BOOST_REQUIRE_THROW( transcode::libav::frames(decodeCodecs[0], packetRange),
+            transcode::IllegalArgumentException );
+}
+
+/**
+ * Test a packet range for a NULL format context.
+ */
+BOOST_AUTO_TEST_CASE( test_packet_range_for_null_format_context )
+{
+
+    BOOST_REQUIRE_THROW( transcode::libav::packets((AVFormatContext*) NULL),
+            transcode::IllegalArgumentException );
+}
+
+/**
+ * Test a packet range for a NULL packet reader.
+ */
+BOOST_AUTO_TEST_CASE( test_packet_range_for_null_packet_reader )
+{
+
+    BOOST_REQUIRE_THROW( transcode::libav::packets((transcode::libav::PacketReader*) NULL),
+            transcode::IllegalArgumentException );
+}
@@ -0,0 +1,60 @@
+/*
+ * registration_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <util_test.hpp>
+
+#include <error.hpp>
+#include <libav/libav.hpp>
+
+// None of the test fixtures are used here because they register every libav
+// component themselves. The test cases run in order and libav can only be
+// initialised once per process, so they depend on each other.
+
+
+/**
+ * Test a registration naming a component that can't be registered is rejected
+ * without initialising libav. Without selective registration built in any
+ * partial registration is rejected.
+ */
+BOOST_AUTO_TEST_CASE( test_initialise_unknown_component )
+{
+
+    transcode::libav::Registration registration;
+
+    registration.all = false;
+    registration.demuxers.push_back("not a demuxer");
+
+    BOOST_REQUIRE_THROW( transcode::libav::initialise(registration),
+            transcode::Exception );
+}
+
+/**
+ * Test initialising with every component after a rejected registration.
+ */
+BOOST_AUTO_TEST_CASE( test_initialise_all )
+{
+
+    transcode::libav::initialise(transcode::libav::Registration());
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(VIDEO_AVI);
+
+    BOOST_REQUIRE( NULL != formatContext );
+
+    transcode::libav::closeFormatContext(&formatContext);
+}
+
+/**
+ * Test libav can only be initialised once.
+ */
+BOOST_AUTO_TEST_CASE( test_initialise_twice )
+{
+
+    BOOST_REQUIRE_THROW( transcode::libav::initialise(transcode::libav::Registration()),
+            transcode::IllegalStateException );
+}
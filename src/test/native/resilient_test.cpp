@@ -0,0 +1,139 @@
+/*
+ * resilient_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+#include <libav/resilient.hpp>
+
+#include <vector>
+
+
+/**
+ * Decode every packet of the supplied stream with the supplied decoder, damaging
+ * every packet with an index in the supplied list before it is decoded.
+ *
+ * @param fixture - the fixture holding the format context to read from.
+ * @param decoder - the decoder to decode with.
+ * @param streamIndex - the index of the stream to decode.
+ * @param damaged - the indexes of the stream packets to damage.
+ * @return the number of frames decoded.
+ */
+static int decodeStream(test::FormatContextFixture& fixture,
+        transcode::libav::ResilientDecoder& decoder, int streamIndex,
+        const std::vector<int>& damaged) {
+
+    int frameCount = 0;
+    int packetIndex = 0;
+
+    AVPacket *packet = NULL;
+
+    while (NULL != (packet = transcode::libav::readNextPacket(fixture.formatContext))) {
+
+        if (streamIndex == packet->stream_index) {
+
+            for (int i = 0; i < damaged.size(); i++) {
+
+                if (packetIndex == damaged[i]) memset(packet->data, 0xFF, packet->size);
+            }
+
+            std::vector<AVFrame*> frames = decoder.decodePacket(packet);
+
+            for (int i = 0; i < frames.size(); i++) transcode::libav::freeFrame(&frames[i]);
+
+            frameCount += frames.size();
+
+            packetIndex++;
+        }
+
+        transcode::libav::freePacket(&packet);
+    }
+
+    return frameCount;
+}
+
+/**
+ * Test resilient decode of an undamaged avi file.
+ */
+BOOST_FIXTURE_TEST_CASE( test_resilient_decode_for_avi_file, test::AVIOpenedCodecContextFixture )
+{
+
+    transcode::libav::ResilientDecoder decoder(decodeCodecs[DIVX_STREAM_ONE]);
+
+    int frames = decodeStream(*this, decoder, DIVX_STREAM_ONE, std::vector<int>());
+
+    BOOST_REQUIRE( 0 < frames );
+    BOOST_REQUIRE( decoder.gaps().empty() );
+    BOOST_REQUIRE( !decoder.resyncing() );
+}
+
+/**
+ * Test resilient decode of a damaged mp4 file reaches the end of the file and
+ * records the gaps.
+ */
+BOOST_FIXTURE_TEST_CASE( test_resilient_decode_for_damaged_mp4_file, test::MP4OpenedCodecContextFixture )
+{
+
+    transcode::libav::ResilientDecoder decoder(decodeCodecs[MP4_STREAM_ONE]);
+
+    std::vector<int> damaged;
+    damaged.push_back(10);
+    damaged.push_back(50);
+
+    int frames = decodeStream(*this, decoder, MP4_STREAM_ONE, damaged);
+
+    BOOST_REQUIRE( 0 < frames );
+
+    for (int i = 0; i < decoder.gaps().size(); i++) {
+
+        const transcode::libav::DecodeGap& gap = decoder.gaps()[i];
+
+        BOOST_REQUIRE( 0 < gap.packetCount );
+        BOOST_REQUIRE( !gap.result.succeeded() );
+        BOOST_REQUIRE( gap.startTime <= gap.endTime );
+    }
+}
+
+/**
+ * Test resilient decode of a damaged mkv audio stream.
+ */
+BOOST_FIXTURE_TEST_CASE( test_resilient_decode_for_damaged_mkv_audio, test::MKVOpenedCodecContextFixture )
+{
+
+    transcode::libav::ResilientDecoder decoder(decodeCodecs[MKV_STREAM_TWO]);
+
+    std::vector<int> damaged;
+    damaged.push_back(3);
+
+    BOOST_REQUIRE( 0 < decodeStream(*this, decoder, MKV_STREAM_TWO, damaged) );
+}
+
+/**
+ * Test resilient decode with a null packet.
+ */
+BOOST_FIXTURE_TEST_CASE( test_resilient_decode_with_null_packet, test::AVIOpenedCodecContextFixture )
+{
+
+    transcode::libav::ResilientDecoder decoder(decodeCodecs[DIVX_STREAM_ONE]);
+
+    BOOST_REQUIRE_THROW( decoder.decodePacket(NULL),
+            transcode::IllegalArgumentException );
+}
+
+/**
+ * Test resilient decoder with a null codec.
+ */
+BOOST_AUTO_TEST_CASE( test_resilient_decoder_with_null_codec )
+{
+
+    BOOST_REQUIRE_THROW( transcode::libav::ResilientDecoder decoder(NULL),
+            transcode::IllegalArgumentException );
+}
@@ -0,0 +1,244 @@
+/*
+ * resumable_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <error.hpp>
+#include <libav/job.hpp>
+#include <libav/libav.hpp>
+#include <libav/libaverror.hpp>
+#include <libav/progress.hpp>
+#include <libav/resumable.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+
+static const std::string RESUMABLE_DIRECTORY = "../../../target/test-classes/lib-test/resumable";
+
+/**
+ * Cancels the job once it has read the supplied number of packets.
+ */
+struct CancelAfter {
+
+    transcode::libav::Job *job;
+    int packets;
+    int *read;
+
+    void operator()(const transcode::libav::ProgressReport&) const {
+
+        if (packets == ++(*read)) job->cancellation().cancel();
+    }
+};
+
+/**
+ * Read the whole of the supplied file.
+ */
+static std::string readFile(const std::string& fileName) {
+
+    std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+
+    std::ostringstream contents;
+
+    contents << in.rdbuf();
+
+    return contents.str();
+}
+
+/**
+ * @return options that write short segments to the supplied directory, which
+ *      is emptied first.
+ */
+static transcode::libav::ResumableOptions resumableOptions(const std::string& name) {
+
+    transcode::libav::ResumableOptions options;
+
+    options.directory = RESUMABLE_DIRECTORY + "/" + name;
+    options.segmentMilliseconds = 2000;
+
+    boost::filesystem::remove_all(options.directory);
+
+    return options;
+}
+
+/**
+ * Test a transcode that is never interrupted finishes in one run, and a second
+ * run keeps every segment.
+ */
+BOOST_FIXTURE_TEST_CASE( test_transcode_without_interruption, test::LibAvRegisterable )
+{
+
+    transcode::libav::ResumableOptions options = resumableOptions("whole");
+
+    std::string outputFileName = options.directory + ".ts";
+
+    transcode::libav::ResumableResult result = transcode::libav::transcodeResumable(VIDEO_AVI,
+            outputFileName, options);
+
+    BOOST_REQUIRE_EQUAL( 0, result.segmentsResumed );
+    BOOST_REQUIRE( 1 < result.segmentsWritten );
+    BOOST_REQUIRE( 0 < result.framesEncoded );
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(outputFileName);
+
+    BOOST_REQUIRE_EQUAL( 1, formatContext->nb_streams );
+
+    transcode::libav::closeFormatContext(&formatContext);
+
+    transcode::libav::ResumableResult again = transcode::libav::transcodeResumable(VIDEO_AVI,
+            outputFileName, options);
+
+    BOOST_REQUIRE_EQUAL( result.segmentsWritten, again.segmentsResumed );
+    BOOST_REQUIRE_EQUAL( 0, again.segmentsWritten );
+    BOOST_REQUIRE_EQUAL( result.framesEncoded, again.framesEncoded );
+}
+
+/**
+ * Test a transcode cancelled part way through is resumed from its last
+ * segment, and the output is the same byte for byte as a transcode that was
+ * never interrupted.
+ */
+BOOST_FIXTURE_TEST_CASE( test_resume_after_cancel, test::LibAvRegisterable )
+{
+
+    transcode::libav::ResumableOptions wholeOptions = resumableOptions("uninterrupted");
+    transcode::libav::ResumableOptions options = resumableOptions("interrupted");
+
+    std::string wholeFileName = wholeOptions.directory + ".ts";
+    std::string outputFileName = options.directory + ".ts";
+
+    transcode::libav::ResumableResult whole = transcode::libav::transcodeResumable(VIDEO_AVI,
+            wholeFileName, wholeOptions);
+
+    {
+        transcode::libav::Job job;
+
+        int read = 0;
+
+        // Far enough in for the first segments to be finished.
+        CancelAfter cancelAfter = { &job, 400, &read };
+
+        job.progress().setCallback(cancelAfter, 0);
+
+        transcode::libav::ScopedJob scopedJob(&job);
+
+        BOOST_REQUIRE_THROW( transcode::libav::transcodeResumable(VIDEO_AVI, outputFileName,
+                options), transcode::libav::CancelledException );
+
+        BOOST_REQUIRE_EQUAL( 0, job.memory().used() );
+    }
+
+    BOOST_REQUIRE( !boost::filesystem::exists(outputFileName) );
+
+    transcode::libav::ResumableResult result = transcode::libav::transcodeResumable(VIDEO_AVI,
+            outputFileName, options);
+
+    BOOST_REQUIRE( 0 < result.segmentsResumed );
+    BOOST_REQUIRE( 0 < result.segmentsWritten );
+    BOOST_REQUIRE_EQUAL( whole.segmentsWritten, result.segmentsResumed + result.segmentsWritten );
+    BOOST_REQUIRE_EQUAL( whole.framesEncoded, result.framesEncoded );
+
+    BOOST_REQUIRE( readFile(wholeFileName) == readFile(outputFileName) );
+}
+
+/**
+ * Test a journal written with different options is ignored.
+ */
+BOOST_FIXTURE_TEST_CASE( test_changed_options_start_again, test::LibAvRegisterable )
+{
+
+    transcode::libav::ResumableOptions options = resumableOptions("changed");
+
+    std::string outputFileName = options.directory + ".ts";
+
+    transcode::libav::transcodeResumable(VIDEO_AVI, outputFileName, options);
+
+    options.pipeline.quantizer = 8;
+
+    transcode::libav::ResumableResult result = transcode::libav::transcodeResumable(VIDEO_AVI,
+            outputFileName, options);
+
+    BOOST_REQUIRE_EQUAL( 0, result.segmentsResumed );
+    BOOST_REQUIRE( 0 < result.segmentsWritten );
+}
+
+/**
+ * Test a journal written for another input in the same place is ignored, even
+ * when the input has the same size and modification time.
+ */
+BOOST_FIXTURE_TEST_CASE( test_swapped_input_starts_again, test::LibAvRegisterable )
+{
+
+    transcode::libav::ResumableOptions options = resumableOptions("swapped");
+
+    std::string inputFileName = options.directory + ".avi";
+    std::string outputFileName = options.directory + ".ts";
+
+    boost::filesystem::create_directories(RESUMABLE_DIRECTORY);
+    boost::filesystem::copy_file(VIDEO_AVI, inputFileName,
+            boost::filesystem::copy_option::overwrite_if_exists);
+
+    transcode::libav::ResumableResult first = transcode::libav::transcodeResumable(
+            inputFileName, outputFileName, options);
+
+    BOOST_REQUIRE( 0 < first.segmentsWritten );
+
+    std::time_t modified = boost::filesystem::last_write_time(inputFileName);
+
+    {
+        // Change one byte in the middle, where nothing but its contents tell
+        // the two inputs apart.
+        std::fstream input(inputFileName.c_str(), std::ios::in | std::ios::out
+                | std::ios::binary);
+
+        input.seekg(VIDEO_AVI_SIZE / 2);
+
+        char byte = input.get() ^ 0x01;
+
+        input.seekp(VIDEO_AVI_SIZE / 2);
+        input.put(byte);
+    }
+
+    boost::filesystem::last_write_time(inputFileName, modified);
+
+    transcode::libav::ResumableResult second = transcode::libav::transcodeResumable(
+            inputFileName, outputFileName, options);
+
+    BOOST_REQUIRE_EQUAL( 0, second.segmentsResumed );
+    BOOST_REQUIRE( 0 < second.segmentsWritten );
+
+    boost::filesystem::remove(inputFileName);
+}
+
+/**
+ * Test a resumable transcode can't be started without somewhere to write it.
+ */
+BOOST_FIXTURE_TEST_CASE( test_invalid_resumable_options, test::LibAvRegisterable )
+{
+
+    transcode::libav::ResumableOptions options;
+
+    BOOST_REQUIRE_THROW( transcode::libav::transcodeResumable(VIDEO_AVI,
+            RESUMABLE_DIRECTORY + ".ts", options), transcode::IllegalArgumentException );
+
+    options.directory = RESUMABLE_DIRECTORY;
+
+    BOOST_REQUIRE_THROW( transcode::libav::transcodeResumable(VIDEO_AVI, "", options),
+            transcode::IllegalArgumentException );
+
+    options.segmentMilliseconds = 0;
+
+    BOOST_REQUIRE_THROW( transcode::libav::transcodeResumable(VIDEO_AVI,
+            RESUMABLE_DIRECTORY + ".ts", options), transcode::IllegalArgumentException );
+}
@@ -0,0 +1,168 @@
+/*
+ * segmenter_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <error.hpp>
+#include <libav/libav.hpp>
+#include <libav/segmenter.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <tr1/functional>
+
+
+static const std::string SEGMENT_DIRECTORY = "../../../target/test-classes/lib-test/segments";
+
+/**
+ * Read the whole of the supplied file.
+ */
+static std::string readFile(const std::string& fileName) {
+
+    std::ifstream in(fileName.c_str());
+
+    std::ostringstream contents;
+
+    contents << in.rdbuf();
+
+    return contents.str();
+}
+
+/**
+ * Check a segment can be read and is in the playlist as soon as it is finished,
+ * while the playlist is still open.
+ */
+static void checkSegment(const transcode::libav::Segment& segment,
+        const std::string& playlistFileName, int *finished) {
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(segment.fileName);
+
+    BOOST_REQUIRE_EQUAL( 2, formatContext->nb_streams );
+
+    transcode::libav::closeFormatContext(&formatContext);
+
+    std::string playlist = readFile(playlistFileName);
+
+    BOOST_REQUIRE( std::string::npos != playlist.find(
+            segment.fileName.substr(segment.fileName.rfind('/') + 1)) );
+    BOOST_REQUIRE( std::string::npos == playlist.find("#EXT-X-ENDLIST") );
+
+    BOOST_REQUIRE_EQUAL( *finished, segment.index );
+
+    (*finished)++;
+}
+
+/**
+ * Test remux an avi file into segments and a playlist.
+ */
+BOOST_FIXTURE_TEST_CASE( test_write_segments_of_avi_file, test::AVIFormatContextFixture )
+{
+
+    int finished = 0;
+
+    transcode::libav::SegmentOptions options;
+
+    options.directory = SEGMENT_DIRECTORY;
+    options.segmentMilliseconds = 2000;
+
+    options.segmentFinished = std::tr1::bind(checkSegment, std::tr1::placeholders::_1,
+            SEGMENT_DIRECTORY + "/" + options.playlistName, &finished);
+
+    transcode::libav::SegmentWriter segments(options);
+
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+
+        BOOST_REQUIRE_EQUAL( i, segments.addStream(formatContext->streams[i]->codec,
+                formatContext->streams[i]->time_base) );
+    }
+
+    for (AVPacket *packet = transcode::libav::readNextPacket(formatContext); NULL != packet;
+            packet = transcode::libav::readNextPacket(formatContext)) {
+
+        segments.writePacket(packet);
+
+        transcode::libav::freePacket(&packet);
+    }
+
+    segments.finish();
+
+    BOOST_REQUIRE( 1 < segments.segments().size() );
+    BOOST_REQUIRE_EQUAL( segments.segments().size(), finished );
+
+    for (size_t i = 0; i + 1 < segments.segments().size(); i++) {
+
+        const transcode::libav::Segment& segment = segments.segments()[i];
+
+        BOOST_REQUIRE( 2000 <= segment.durationMilliseconds );
+        BOOST_REQUIRE_EQUAL( segment.startMilliseconds + segment.durationMilliseconds,
+                segments.segments()[i + 1].startMilliseconds );
+    }
+
+    std::string playlist = readFile(segments.playlistFileName());
+
+    BOOST_REQUIRE_EQUAL( 0, playlist.find("#EXTM3U") );
+    BOOST_REQUIRE( std::string::npos != playlist.find("segment00000.ts") );
+    BOOST_REQUIRE( std::string::npos != playlist.find("#EXT-X-ENDLIST") );
+}
+
+/**
+ * Test writing packets before any streams are added, and adding streams after.
+ */
+BOOST_FIXTURE_TEST_CASE( test_write_segments_out_of_order, test::AVIFormatContextFixture )
+{
+
+    transcode::libav::SegmentOptions options;
+
+    options.directory = SEGMENT_DIRECTORY;
+    options.segmentPrefix = "out_of_order";
+
+    transcode::libav::SegmentWriter segments(options);
+
+    AVPacket *packet = transcode::libav::readNextPacket(formatContext);
+
+    packet->stream_index = 0;
+
+    BOOST_REQUIRE_THROW( segments.writePacket(packet), transcode::IllegalArgumentException );
+
+    segments.addStream(formatContext->streams[0]->codec, formatContext->streams[0]->time_base);
+    segments.addStream(formatContext->streams[1]->codec, formatContext->streams[1]->time_base);
+
+    segments.writePacket(packet);
+
+    transcode::libav::freePacket(&packet);
+
+    BOOST_REQUIRE_THROW( segments.addStream(formatContext->streams[0]->codec,
+            formatContext->streams[0]->time_base), transcode::IllegalStateException );
+
+    segments.finish();
+
+    BOOST_REQUIRE_EQUAL( 1, segments.segments().size() );
+}
+
+/**
+ * Test invalid segment options.
+ */
+BOOST_AUTO_TEST_CASE( test_segment_writer_with_invalid_options )
+{
+
+    transcode::libav::SegmentOptions options;
+
+    BOOST_REQUIRE_THROW( transcode::libav::SegmentWriter segments(options),
+            transcode::IllegalArgumentException );
+
+    options.directory = SEGMENT_DIRECTORY;
+    options.segmentMilliseconds = 0;
+
+    BOOST_REQUIRE_THROW( transcode::libav::SegmentWriter segments(options),
+            transcode::IllegalArgumentException );
+}
@@ -0,0 +1,270 @@
+/*
+ * thumbnails_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <error.hpp>
+#include <libav/job.hpp>
+#include <libav/libav.hpp>
+#include <libav/thumbnails.hpp>
+
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <vector>
+
+
+/**
+ * Keeps every report it is called with, and the most calls that were ever
+ * running at once.
+ */
+struct ConcurrentCallback {
+
+    std::vector<transcode::libav::ProgressReport> *reports;
+    boost::mutex *mutex;
+    boost::atomic<int> *running;
+    boost::atomic<int> *mostRunning;
+
+    void operator()(const transcode::libav::ProgressReport& report) const {
+
+        int now = running->fetch_add(1) + 1;
+
+        if (now > mostRunning->load()) mostRunning->store(now);
+
+        {
+            boost::mutex::scoped_lock lock(*mutex);
+
+            reports->push_back(report);
+        }
+
+        running->fetch_sub(1);
+    }
+};
+
+
+/**
+ * @return true if any of the pixels of the supplied tile aren't black.
+ */
+static bool hasPicture(const transcode::libav::SpriteSheet& spriteSheet, int tile) {
+
+    int lineSize = spriteSheet.width * 3;
+
+    int x = (tile % spriteSheet.columns) * spriteSheet.tileWidth * 3;
+    int y = (tile / spriteSheet.columns) * spriteSheet.tileHeight;
+
+    for (int line = y; line < y + spriteSheet.tileHeight; line++) {
+
+        for (int i = x; i < x + spriteSheet.tileWidth * 3; i++) {
+
+            if (0 != spriteSheet.pixels[line * lineSize + i]) return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @return the times in milliseconds of the key frames of the supplied video
+ *      stream, as the demuxer flags them.
+ */
+static std::vector<int64_t> keyFrameMilliseconds(const std::string& fileName, int streamIndex) {
+
+    AVFormatContext *formatContext = transcode::libav::openFormatContext(fileName);
+
+    AVStream *stream = formatContext->streams[streamIndex];
+
+    AVRational milliseconds = { 1, 1000 };
+
+    std::vector<int64_t> keyFrames;
+
+    for (AVPacket *packet = transcode::libav::readNextPacket(formatContext); NULL != packet;
+            packet = transcode::libav::readNextPacket(formatContext)) {
+
+        int64_t timestamp = AV_NOPTS_VALUE != packet->pts ? packet->pts : packet->dts;
+
+        if (streamIndex == packet->stream_index && 0 != (packet->flags & AV_PKT_FLAG_KEY)
+                && AV_NOPTS_VALUE != timestamp) {
+
+            if (AV_NOPTS_VALUE != stream->start_time) timestamp -= stream->start_time;
+
+            keyFrames.push_back(av_rescale_q(timestamp, stream->time_base, milliseconds));
+        }
+
+        transcode::libav::freePacket(&packet);
+    }
+
+    transcode::libav::closeFormatContext(&formatContext);
+
+    return keyFrames;
+}
+
+/**
+ * Test the timestamps every interval.
+ */
+BOOST_AUTO_TEST_CASE( test_thumbnail_timestamps )
+{
+
+    std::vector<int64_t> timestamps = transcode::libav::thumbnailTimestamps(10000, 3000);
+
+    BOOST_REQUIRE_EQUAL( 4, timestamps.size() );
+    BOOST_REQUIRE_EQUAL( 0, timestamps[0] );
+    BOOST_REQUIRE_EQUAL( 9000, timestamps[3] );
+
+    BOOST_REQUIRE_EQUAL( 1, transcode::libav::thumbnailTimestamps(0, 3000).size() );
+
+    BOOST_REQUIRE_THROW( transcode::libav::thumbnailTimestamps(10000, 0),
+            transcode::IllegalArgumentException );
+}
+
+/**
+ * Test a sprite sheet of an avi file is laid out in rows and every tile is filled.
+ */
+BOOST_FIXTURE_TEST_CASE( test_extract_sprite_sheet_from_avi_file, test::LibAvRegisterable )
+{
+
+    transcode::libav::ThumbnailOptions options;
+
+    options.width = 64;
+    options.columns = 3;
+    options.threads = 2;
+
+    std::vector<int64_t> timestamps;
+
+    timestamps.push_back(0);
+    timestamps.push_back(1000);
+    timestamps.push_back(2000);
+    timestamps.push_back(3000);
+
+    transcode::libav::SpriteSheet spriteSheet =
+            transcode::libav::extractSpriteSheet(VIDEO_AVI, timestamps, options);
+
+    BOOST_REQUIRE_EQUAL( 3, spriteSheet.columns );
+    BOOST_REQUIRE_EQUAL( 2, spriteSheet.rows );
+    BOOST_REQUIRE_EQUAL( 64, spriteSheet.tileWidth );
+    BOOST_REQUIRE( 0 < spriteSheet.tileHeight );
+    BOOST_REQUIRE_EQUAL( 3 * 64, spriteSheet.width );
+    BOOST_REQUIRE_EQUAL( 2 * spriteSheet.tileHeight, spriteSheet.height );
+    BOOST_REQUIRE_EQUAL( spriteSheet.width * spriteSheet.height * 3, spriteSheet.pixels.size() );
+
+    std::vector<int64_t> keyFrames = keyFrameMilliseconds(VIDEO_AVI, DIVX_STREAM_ONE);
+
+    BOOST_REQUIRE( !keyFrames.empty() );
+
+    for (int i = 0; i < 4; i++) {
+
+        // Each thumbnail is the last key frame at or before its timestamp.
+        int64_t keyFrame = keyFrames[0];
+
+        for (size_t k = 0; k < keyFrames.size() && keyFrames[k] <= timestamps[i]; k++) {
+
+            keyFrame = keyFrames[k];
+        }
+
+        BOOST_REQUIRE_EQUAL( keyFrame, spriteSheet.frameTimestamps[i] );
+        BOOST_REQUIRE( hasPicture(spriteSheet, i) );
+    }
+}
+
+/**
+ * Test the sprite sheet is the same however many workers take the thumbnails.
+ */
+BOOST_FIXTURE_TEST_CASE( test_extract_sprite_sheet_with_one_and_many_threads, test::LibAvRegisterable )
+{
+
+    transcode::libav::ThumbnailOptions options;
+
+    options.width = 48;
+    options.height = 32;
+
+    options.threads = 1;
+
+    transcode::libav::SpriteSheet serial =
+            transcode::libav::extractSpriteSheet(VIDEO_MKV, 2000, options);
+
+    options.threads = 4;
+
+    transcode::libav::SpriteSheet parallel =
+            transcode::libav::extractSpriteSheet(VIDEO_MKV, 2000, options);
+
+    BOOST_REQUIRE_EQUAL( 32, serial.tileHeight );
+    BOOST_REQUIRE( serial.frameTimestamps == parallel.frameTimestamps );
+    BOOST_REQUIRE( serial.pixels == parallel.pixels );
+}
+
+/**
+ * Test the workers of a job all add to its progress, which only moves forward,
+ * and the callback is never called by two of them at once.
+ */
+BOOST_FIXTURE_TEST_CASE( test_sprite_sheet_progress_with_many_threads, test::LibAvRegisterable )
+{
+
+    std::vector<transcode::libav::ProgressReport> reports;
+    boost::mutex mutex;
+    boost::atomic<int> running(0);
+    boost::atomic<int> mostRunning(0);
+
+    ConcurrentCallback callback = { &reports, &mutex, &running, &mostRunning };
+
+    transcode::libav::Job job;
+
+    job.progress().setCallback(callback, 0);
+
+    {
+        transcode::libav::ScopedJob scopedJob(&job);
+
+        transcode::libav::ThumbnailOptions options;
+
+        options.width = 48;
+        options.threads = 4;
+
+        transcode::libav::extractSpriteSheet(VIDEO_MKV, 500, options);
+    }
+
+    BOOST_REQUIRE( 0 < reports.size() );
+    BOOST_REQUIRE_EQUAL( 1, mostRunning.load() );
+
+    for (size_t i = 1; i < reports.size(); i++) {
+
+        BOOST_REQUIRE( reports[i - 1].bytesRead <= reports[i].bytesRead );
+        BOOST_REQUIRE( reports[i - 1].mediaMicroseconds <= reports[i].mediaMicroseconds );
+        BOOST_REQUIRE_EQUAL( reports[0].totalBytes, reports[i].totalBytes );
+    }
+}
+
+/**
+ * Test invalid thumbnail options.
+ */
+BOOST_AUTO_TEST_CASE( test_extract_sprite_sheet_with_invalid_options )
+{
+
+    transcode::libav::ThumbnailOptions options;
+
+    std::vector<int64_t> timestamps;
+
+    BOOST_REQUIRE_THROW( transcode::libav::extractSpriteSheet(VIDEO_AVI, timestamps, options),
+            transcode::IllegalArgumentException );
+
+    timestamps.push_back(0);
+
+    options.width = 0;
+
+    BOOST_REQUIRE_THROW( transcode::libav::extractSpriteSheet(VIDEO_AVI, timestamps, options),
+            transcode::IllegalArgumentException );
+}
+
+/**
+ * Test taking thumbnails of a file that isn't media.
+ */
+BOOST_FIXTURE_TEST_CASE( test_extract_sprite_sheet_from_text_file, test::LibAvRegisterable )
+{
+
+    BOOST_REQUIRE_THROW( transcode::libav::extractSpriteSheet(TEXT_FILE, 1000),
+            transcode::Exception );
+}
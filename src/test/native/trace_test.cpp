@@ -0,0 +1,184 @@
+/*
+ * trace_test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: karl
+ */
+
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <test_fixtures.hpp>
+#include <util_test.hpp>
+
+#include <libav/libav.hpp>
+#include <libav/packetreader.hpp>
+#include <libav/trace.hpp>
+
+#include <boost/thread/thread.hpp>
+
+#include <sstream>
+#include <string>
+
+
+/**
+ * Write the current trace out as a string.
+ *
+ * @return the trace JSON.
+ */
+static std::string traceJson() {
+
+    std::stringstream json;
+
+    transcode::libav::writeTraceJson(json);
+
+    return json.str();
+}
+
+/**
+ * Test no spans are recorded while tracing is disabled.
+ */
+BOOST_FIXTURE_TEST_CASE( test_trace_disabled, test::AVIFormatContextFixture )
+{
+
+    transcode::libav::setTracingEnabled(false);
+    transcode::libav::clearTrace();
+
+    AVPacket *packet = transcode::libav::readNextPacket(formatContext);
+
+    transcode::libav::freePacket(&packet);
+
+    BOOST_REQUIRE( std::string::npos == traceJson().find("readNextPacket") );
+}
+
+/**
+ * Test read packet spans are recorded with their stream index.
+ */
+BOOST_FIXTURE_TEST_CASE( test_trace_read_packet, test::AVIFormatContextFixture )
+{
+
+    transcode::libav::setTracingEnabled(true);
+    transcode::libav::clearTrace();
+
+    AVPacket *packet = transcode::libav::readNextPacket(formatContext);
+
+    std::stringstream expected;
+    expected << "\"args\":{\"stream\":" << packet->stream_index << "}";
+
+    transcode::libav::freePacket(&packet);
+
+    transcode::libav::setTracingEnabled(false);
+
+    std::string json = traceJson();
+
+    BOOST_REQUIRE( std::string::npos != json.find("\"traceEvents\":[") );
+    BOOST_REQUIRE( std::string::npos != json.find("\"name\":\"readNextPacket\"") );
+    BOOST_REQUIRE( std::string::npos != json.find("\"ph\":\"X\"") );
+    BOOST_REQUIRE( std::string::npos != json.find(expected.str()) );
+}
+
+/**
+ * Test the spans of the read ahead thread are recorded.
+ */
+BOOST_FIXTURE_TEST_CASE( test_trace_read_ahead_thread, test::FLVFormatContextFixture )
+{
+
+    transcode::libav::setTracingEnabled(true);
+    transcode::libav::clearTrace();
+
+    {
+        transcode::libav::PacketReader packetReader(formatContext, 2);
+
+        AVPacket *packet = NULL;
+
+        while (NULL != (packet = transcode::libav::readNextPacket(&packetReader))) {
+
+            transcode::libav::freePacket(&packet);
+        }
+    }
+
+    transcode::libav::setTracingEnabled(false);
+
+    std::string json = traceJson();
+
+    BOOST_REQUIRE( std::string::npos != json.find("\"name\":\"readNextPacket\"") );
+    BOOST_REQUIRE( std::string::npos != json.find("\"name\":\"readAheadFullWait\"") );
+}
+
+/**
+ * Record the supplied number of spans named "retired".
+ */
+static void recordSpans(size_t count) {
+
+    for (size_t i = 0; i < count; i++) transcode::libav::TraceSpan span("retired");
+}
+
+/**
+ * Count the spans with the supplied name in the supplied trace.
+ */
+static size_t countSpans(const std::string& json, const std::string& name) {
+
+    std::string event = "\"name\":\"" + name + "\"";
+
+    size_t count = 0;
+
+    for (size_t at = json.find(event); std::string::npos != at; at = json.find(event, at + 1)) {
+
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * Test the spans of finished threads are kept, but only up to the bound on
+ * retired spans however many threads have finished.
+ */
+BOOST_AUTO_TEST_CASE( test_trace_finished_threads )
+{
+
+    transcode::libav::setTracingEnabled(true);
+    transcode::libav::clearTrace();
+
+    boost::thread first(recordSpans, 10);
+
+    first.join();
+
+    BOOST_REQUIRE_EQUAL( 10, countSpans(traceJson(), "retired") );
+
+    for (int i = 0; i < 3; i++) {
+
+        boost::thread thread(recordSpans, transcode::libav::TRACE_RETIRED_SPANS / 2);
+
+        thread.join();
+    }
+
+    transcode::libav::setTracingEnabled(false);
+
+    BOOST_REQUIRE_EQUAL( transcode::libav::TRACE_RETIRED_SPANS,
+            countSpans(traceJson(), "retired") );
+
+    transcode::libav::clearTrace();
+
+    BOOST_REQUIRE_EQUAL( 0, countSpans(traceJson(), "retired") );
+}
+
+/**
+ * Test clearing the trace.
+ */
+BOOST_AUTO_TEST_CASE( test_trace_clear )
+{
+
+    transcode::libav::setTracingEnabled(true);
+
+    {
+        transcode::libav::TraceSpan span("test", 3);
+    }
+
+    transcode::libav::setTracingEnabled(false);
+
+    BOOST_REQUIRE( std::string::npos != traceJson().find("\"name\":\"test\"") );
+
+    transcode::libav::clearTrace();
+
+    BOOST_REQUIRE_EQUAL( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[]}", traceJson() );
+}
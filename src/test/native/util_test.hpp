@@ -2,7 +2,6 @@
 #define __TEST_UTILS_H__
 
 
-#include <boost/test/unit_test.hpp>
 #include <string>
 #include <vector>
 